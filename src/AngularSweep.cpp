@@ -0,0 +1,161 @@
+#include "AngularSweep.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const float ANGLE_MARGIN = 1e-3f;       // Запас интервала на погрешность углов, радиан
+    const float DISTANCE_SLACK = 1.f;       // Запас нижней оценки расстояния на погрешность пересечений, пикселей
+    const float INSIDE_MARGIN = 1.f;        // Точка ближе к прямоугольнику считается внутри него
+}
+
+AngularSweep::SweepRay AngularSweep::sweepRay(const Ray &ray, uint32_t index)
+{
+    return {std::atan2(ray.direction.y, ray.direction.x), index};
+}
+
+void AngularSweep::build(const sf::Vector2f &origin, const std::vector<const OpticalElement *> &targets, unsigned workers)
+{
+    m_targets = targets;
+    if (m_active.size() < workers)
+        m_active.resize(workers);
+    m_lowerBounds.assign(targets.size(), 0.f);
+    m_surrounding.clear();
+    m_events.clear();
+    m_intervals.clear();
+    m_intervalTargets.clear();
+
+    const float pi = static_cast<float>(M_PI);
+    auto addInterval = [&](float lo, float hi, size_t target)
+    {
+        m_events.push_back({lo, false, target});
+        m_events.push_back({hi, true, target});
+        m_intervals.push_back({lo, hi});
+        m_intervalTargets.push_back(target);
+    };
+
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+        sf::FloatRect bounds = targets[i]->getBounds();
+        m_lowerBounds[i] = std::max(0.f, VectorMath::distanceToRect(origin, bounds) - DISTANCE_SLACK);
+        float start = 0.f, span = 0.f;
+        if (!VectorMath::angularExtent(origin, bounds, INSIDE_MARGIN, start, span))
+        {
+            m_surrounding.push_back(i);
+            continue;
+        }
+        // Интервал, пересекающий -PI/PI, делится на два
+        float lo = VectorMath::normalizeAngle(start - ANGLE_MARGIN);
+        float hi = lo + span + 2.f * ANGLE_MARGIN;
+        if (hi > pi)
+        {
+            addInterval(lo, pi, i);
+            addInterval(-pi, hi - 2.f * pi, i);
+        }
+        else
+        {
+            addInterval(lo, hi, i);
+        }
+    }
+    std::sort(m_events.begin(), m_events.end(), [](const Event &a, const Event &b)
+              { return a.angle < b.angle || (a.angle == b.angle && !a.isEnd && b.isEnd); });
+
+    m_byRank.resize(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i)
+        m_byRank[i] = static_cast<uint32_t>(i);
+    std::sort(m_byRank.begin(), m_byRank.end(), [&](uint32_t a, uint32_t b)
+              { return m_lowerBounds[a] < m_lowerBounds[b] || (m_lowerBounds[a] == m_lowerBounds[b] && a < b); });
+    m_rank.resize(targets.size());
+    for (size_t r = 0; r < m_byRank.size(); ++r)
+        m_rank[m_byRank[r]] = static_cast<uint32_t>(r);
+    m_leaves = 1;
+    while (m_leaves < targets.size())
+        m_leaves *= 2;
+}
+
+void AngularSweep::updateActive(std::vector<uint32_t> &tree, uint32_t rank, int delta) const
+{
+    for (size_t node = m_leaves + rank; node >= 1; node /= 2)
+        tree[node] += static_cast<uint32_t>(delta);
+}
+
+uint32_t AngularSweep::nextActive(const std::vector<uint32_t> &tree, uint32_t rank) const
+{
+    if (rank >= m_leaves)
+        return NO_RANK;
+    size_t node = m_leaves + rank;
+    if (tree[node] > 0)
+        return rank;
+    // Подъём до первого правого соседа с активными элементами, затем спуск к самому левому из них
+    while (node > 1 && ((node & 1) == 1 || tree[node + 1] == 0))
+        node /= 2;
+    if (node <= 1)
+        return NO_RANK;
+    node += 1;
+    while (node < m_leaves)
+        node = tree[2 * node] > 0 ? 2 * node : 2 * node + 1;
+    return static_cast<uint32_t>(node - m_leaves);
+}
+
+void AngularSweep::solve(const Ray *rays, const SweepRay *sorted, size_t begin, size_t end, float maxDistance, Hit *hits, unsigned worker)
+{
+    if (begin >= end)
+        return;
+
+    // Начальное множество: листья заполняются за O(элементов), узлы строятся снизу вверх.
+    // Диапазонов столько же, сколько потоков, поэтому на весь обход это O(потоки x элементы)
+    std::vector<uint32_t> &active = m_active[worker];
+    active.assign(2 * static_cast<size_t>(m_leaves), 0u);
+    for (size_t target : m_surrounding)
+        ++active[m_leaves + m_rank[target]];
+    const float first = sorted[begin].angle;
+    for (size_t k = 0; k < m_intervals.size(); ++k)
+    {
+        if (m_intervals[k].first <= first && first <= m_intervals[k].second)
+            ++active[m_leaves + m_rank[m_intervalTargets[k]]];
+    }
+    for (size_t node = m_leaves - 1; node >= 1; --node)
+        active[node] = active[2 * node] + active[2 * node + 1];
+    // Событие уже учтено для угла a: начало не позже a, конец раньше a
+    auto applied = [](const Event &event, float a) { return event.angle < a || (event.angle == a && !event.isEnd); };
+    size_t next = static_cast<size_t>(std::partition_point(m_events.begin(), m_events.end(), [&](const Event &event)
+                                                           { return applied(event, first); }) - m_events.begin());
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const float angle = sorted[i].angle;
+        for (; next < m_events.size() && applied(m_events[next], angle); ++next)
+        {
+            const Event &event = m_events[next];
+            const uint32_t rank = m_rank[event.target];
+            if (!event.isEnd)
+                updateActive(active, rank, 1);
+            else if (active[m_leaves + rank] > 0)
+                updateActive(active, rank, -1);
+        }
+
+        const Ray &ray = rays[sorted[i].index];
+        Hit &hit = hits[sorted[i].index];
+        hit.intersection = VectorMath::IntersectionResult();
+        hit.intersection.distance = maxDistance;
+        hit.targetIndex = m_targets.size();
+        for (uint32_t rank = nextActive(active, 0); rank != NO_RANK; rank = nextActive(active, rank + 1))
+        {
+            const size_t target = m_byRank[rank];
+            if (m_lowerBounds[target] > hit.intersection.distance)
+                break;
+            VectorMath::IntersectionResult intersection = m_targets[target]->findIntersection(ray);
+            if (!intersection.intersects || intersection.distance <= EPSILON)
+                continue;
+            // Как при полном переборе: ближайшее попадание, при равенстве - меньший номер элемента
+            bool closer = intersection.distance < hit.intersection.distance;
+            bool tie = intersection.distance == hit.intersection.distance && hit.targetIndex < m_targets.size() && target < hit.targetIndex;
+            if (closer || tie)
+            {
+                hit.intersection = intersection;
+                hit.targetIndex = target;
+            }
+        }
+    }
+}
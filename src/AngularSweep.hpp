@@ -0,0 +1,82 @@
+#ifndef HEADER_GUARD_ANGULAR_SWEEP_HPP
+#define HEADER_GUARD_ANGULAR_SWEEP_HPP
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+#include "OpticalElement.hpp"
+
+// Первое попадание лучей, выходящих из одной точки (первичные лучи источника).
+// Каждый элемент проецируется в угловой интервал, под которым из точки виден его
+// ограничивающий прямоугольник. Лучи обходятся по возрастанию угла; события начала и конца
+// интервалов поддерживают множество активных элементов - сбалансированное дерево счётчиков над
+// элементами, упорядоченными по расстоянию до прямоугольника: добавление, удаление и переход
+// к следующему активному элементу - O(log элементов). Для луча элементы проверяются в этом
+// порядке, пока расстояние до прямоугольника не превысит найденное попадание.
+// Стоимость - O(события x log элементов) на обход и O((1 + k) x log элементов) на луч, где k -
+// активные элементы, чей прямоугольник ближе попадания. Обычно k - один-два элемента, но оценка
+// O((лучи + элементы) x log элементов) выполняется не всегда: элементы (дуги, многоугольники)
+// пересекают друг друга, поэтому упорядочить их по глубине вдоль угла нельзя, и если интервалы
+// перекрываются, а лучи ни во что не попадают, k растёт до числа активных элементов, как у перебора.
+// Результат совпадает с полным перебором, включая выбор элемента с меньшим номером при равных расстояниях.
+class AngularSweep
+{
+public:
+    struct Hit
+    {
+        VectorMath::IntersectionResult intersection;
+        size_t targetIndex; // targets.size(), если попадания нет
+    };
+
+    // workers - число потоков, одновременно вызывающих solve
+    void build(const sf::Vector2f &origin, const std::vector<const OpticalElement *> &targets, unsigned workers = 1);
+
+    // Луч в порядке обхода: угол направления в [-PI, PI] и номер луча
+    struct SweepRay
+    {
+        float angle;
+        uint32_t index;
+
+        bool operator<(const SweepRay &other) const { return angle < other.angle || (angle == other.angle && index < other.index); }
+    };
+
+    static SweepRay sweepRay(const Ray &ray, uint32_t index);
+
+    // Попадания лучей rays[sorted[i].index] для i в [begin, end); sorted упорядочен по углу.
+    // Диапазоны можно обрабатывать параллельно: обход начинается с произвольного угла,
+    // у каждого потока (worker < workers из build) своё множество активных элементов
+    void solve(const Ray *rays, const SweepRay *sorted, size_t begin, size_t end, float maxDistance, Hit *hits, unsigned worker = 0);
+
+    size_t intervalCount() const { return m_events.size() / 2; }
+
+private:
+    struct Event
+    {
+        float angle;
+        bool isEnd;    // При равных углах начала идут раньше концов: интервалы замкнуты
+        size_t target;
+    };
+
+    static constexpr uint32_t NO_RANK = UINT32_MAX;
+
+    // Дерево активных элементов потока: листья - ранги элементов по нижней оценке расстояния,
+    // узлы - число активных элементов (интервал, разрезанный в -PI/PI, может учитываться дважды)
+    void updateActive(std::vector<uint32_t> &tree, uint32_t rank, int delta) const;
+    // Наименьший активный ранг не меньше rank (NO_RANK, если его нет)
+    uint32_t nextActive(const std::vector<uint32_t> &tree, uint32_t rank) const;
+
+    std::vector<const OpticalElement *> m_targets;
+    std::vector<float> m_lowerBounds;   // Расстояние от точки до прямоугольника элемента
+    std::vector<uint32_t> m_rank;       // Ранг элемента по (нижняя оценка, номер)
+    std::vector<uint32_t> m_byRank;     // Элемент каждого ранга
+    uint32_t m_leaves = 1;              // Листьев дерева активных элементов (степень двойки)
+    std::vector<size_t> m_surrounding;  // Элементы, чей прямоугольник содержит точку: видны под любым углом
+    std::vector<Event> m_events;
+    std::vector<std::pair<float, float>> m_intervals; // Интервалы событий по парам (для начального множества)
+    std::vector<size_t> m_intervalTargets;
+    std::vector<std::vector<uint32_t>> m_active; // Дерево активных элементов каждого потока (повторно используемая память)
+};
+
+#endif // HEADER_GUARD_ANGULAR_SWEEP_HPP
@@ -11,7 +11,9 @@ enum class Mode
     PLACING_START,    // Готовность начать размещение (первый клик - центр/начальная точка)
     PLACING_END,      // Ожидание второго клика для завершения размещения (радиус/конечная точка)
     DRAGGING_ELEMENT, // Перетаскивание элемента или его ручки
-    EDITING_PARAMETER // Режим ввода текста для параметра
+    EDITING_PARAMETER, // Режим ввода текста для параметра
+    MARQUEE_SELECTING, // Выделение рамкой (Shift + перетаскивание)
+    DRAGGING_GROUP     // Перетаскивание группы выделенных элементов
 };
 
 
@@ -24,6 +26,24 @@ enum class HandleType
 
 };
 
-using RayPath = std::vector<sf::Vertex>;
+// Режим отображения результатов трассировки
+enum class DisplayMode
+{
+    RAY_PATHS,   // Отрисовка каждого пути луча линиями
+    DENSITY_MAP  // Тепловая карта плотности лучей
+};
+
+// Вершина пути луча. Прозрачность цвета - только для отображения (корень из доли энергии,
+// округлённый до 8 бит); intensity - энергия отрезка, заканчивающегося в вершине, в долях
+// энергии первичного луча с учётом веса выборки. По ней взвешивают карта плотности и анализ пятна
+struct PathVertex : sf::Vertex
+{
+    float intensity = 1.f;
+
+    PathVertex() = default;
+    PathVertex(const sf::Vector2f &p, const sf::Color &c, float energy) : sf::Vertex(p, c), intensity(energy) {}
+};
+
+using RayPath = std::vector<PathVertex>;
 
 #endif // APPDEFS_HPP
\ No newline at end of file
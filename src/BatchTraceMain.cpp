@@ -0,0 +1,162 @@
+#include "JobPipeline.hpp"
+#include "ProcessBatch.hpp"
+#include "SceneIO.hpp"
+#include "TraceEquivalence.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    // Задания конвейера: файлы читаются этапом загрузки, встроенные сцены передаются текстом
+    int runPipeline(const std::vector<std::string> &paths, const ProcessBatch::Settings &settings, const std::string &outputDir)
+    {
+        std::vector<JobPipeline::Job> jobs;
+        for (const std::string &path : paths)
+            jobs.push_back({path, path, std::string()});
+        if (jobs.empty())
+        {
+            for (const auto &scene : TraceEquivalence::regressionScenes())
+                jobs.push_back({scene.name, std::string(), SceneIO::toString(scene.view())});
+        }
+
+        JobPipeline::Settings pipelineSettings;
+        pipelineSettings.threads = settings.workers;
+        pipelineSettings.frames = settings.frames;
+        pipelineSettings.seed = settings.seed;
+        pipelineSettings.importanceEmission = settings.importanceEmission;
+        pipelineSettings.outputDir = outputDir;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<JobPipeline::JobResult> results = JobPipeline::run(jobs, pipelineSettings, std::cout);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t failed = 0, rays = 0;
+        for (const JobPipeline::JobResult &result : results)
+        {
+            if (!result.ok)
+                ++failed;
+            rays += result.totalRays;
+        }
+        std::cout << results.size() << " jobs, " << failed << " failed, " << std::fixed << std::setprecision(3) << seconds << " s, "
+                  << std::setprecision(0) << rays / std::max(seconds, 1e-9) << " rays/s" << std::endl;
+        return failed == 0 ? 0 : 1;
+    }
+}
+
+// Пакетная трассировка сцен в нескольких процессах или (--pipeline) конвейером заданий в одном процессе:
+// batch_trace [--workers N] [--frames F] [--seed S] [--importance] [--pipeline] [--output DIR] [scene files...]
+// Без файлов трассируются фиксированные сцены проверки трассировки
+int main(int argc, char *argv[])
+{
+    ProcessBatch::Settings settings;
+    std::vector<std::string> paths;
+    std::vector<std::string> names;
+    std::vector<std::string> texts;
+    bool pipeline = false;
+    std::string outputDir;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--importance")
+        {
+            settings.importanceEmission = true;
+            continue;
+        }
+        if (arg == "--pipeline")
+        {
+            pipeline = true;
+            continue;
+        }
+        if (arg.rfind("--", 0) != 0)
+        {
+            paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 2;
+        }
+        std::string value = argv[++i];
+        try
+        {
+            if (arg == "--workers")
+                settings.workers = static_cast<unsigned>(std::stoul(value));
+            else if (arg == "--frames")
+                settings.frames = static_cast<size_t>(std::stoul(value));
+            else if (arg == "--seed")
+                settings.seed = std::stoull(value);
+            else if (arg == "--output")
+                outputDir = value;
+            else
+            {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return 2;
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 2;
+        }
+    }
+
+    if (pipeline)
+        return runPipeline(paths, settings, outputDir);
+
+    for (const std::string &path : paths)
+    {
+        std::vector<std::unique_ptr<OpticalElement>> elements;
+        std::string error;
+        if (!SceneIO::load(path, elements, error))
+        {
+            std::cerr << "Error: " << path << ": " << error << std::endl;
+            return 2;
+        }
+        std::vector<const OpticalElement *> view;
+        for (const auto &element : elements)
+            view.push_back(element.get());
+        names.push_back(path);
+        texts.push_back(SceneIO::toString(view));
+    }
+    if (texts.empty())
+    {
+        for (const auto &scene : TraceEquivalence::regressionScenes())
+        {
+            names.push_back(scene.name);
+            texts.push_back(SceneIO::toString(scene.view()));
+        }
+    }
+
+    ProcessBatch::Report report = ProcessBatch::run(texts, settings);
+    if (!report.ok)
+    {
+        std::cerr << "Error: " << report.error << std::endl;
+        return 1;
+    }
+
+    size_t failed = 0, rays = 0;
+    std::cout << std::fixed << std::setprecision(4);
+    for (size_t i = 0; i < report.scenes.size(); ++i)
+    {
+        const ProcessBatch::SceneResult &scene = report.scenes[i];
+        failed += scene.failedFrames;
+        rays += scene.totalRays;
+        std::cout << names[i] << ": " << scene.completedFrames << " frames";
+        if (scene.failedFrames > 0)
+            std::cout << " (" << scene.failedFrames << " failed)";
+        std::cout << ", escaped " << scene.escapedEnergy;
+        for (size_t d = 0; d < scene.detectorFlux.size(); ++d)
+            std::cout << ", detector " << d << " " << scene.detectorFlux[d];
+        if (scene.traceSeconds > 0.0)
+            std::cout << ", " << std::setprecision(0) << scene.totalRays / scene.traceSeconds << " rays/s per process" << std::setprecision(4);
+        std::cout << std::endl;
+    }
+    std::cout << report.scenes.size() << " scenes, " << report.workers << " workers, " << report.crashedWorkers << " crashed, "
+              << std::setprecision(3) << report.wallSeconds << " s, " << std::setprecision(0) << rays / std::max(report.wallSeconds, 1e-9) << " rays/s" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
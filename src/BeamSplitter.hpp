@@ -0,0 +1,143 @@
+#ifndef HEADER_GUARD_BEAM_SPLITTER_HPP
+#define HEADER_GUARD_BEAM_SPLITTER_HPP
+
+#include "Mirror.hpp"
+
+// Полупрозрачное зеркало: делит луч на отражённый (доля reflectance) и прошедший
+class BeamSplitter : public Mirror
+{
+public:
+    int reflectancePercent;                    // Коэффициент отражения, %
+    mutable sf::Text reflectanceText;          // Текст "Refl = ...%"
+    mutable sf::Font const *fontPtr = nullptr; // Указатель на шрифт
+
+    BeamSplitter(sf::Vector2f p1, sf::Vector2f p2, int percent = 50, sf::Color c = sf::Color(150, 220, 255))
+        : Mirror(p1, p2, c), reflectancePercent(std::clamp(percent, 0, 100))
+    {
+        reflectanceText.setCharacterSize(14);
+        reflectanceText.setFillColor(sf::Color::White);
+        updateParameterString();
+    }
+
+    Type getType() const override { return Type::BEAM_SPLITTER; }
+    std::unique_ptr<OpticalElement> clone() const override { return std::make_unique<BeamSplitter>(*this); }
+
+    float getReflectance() const { return static_cast<float>(reflectancePercent) / 100.f; }
+
+    RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const override
+    {
+        RayAction reflected = Mirror::interact(incomingRay, intersectionPoint);
+        if (!reflected.outgoingRay.has_value())
+            return reflected;
+        Ray reflectedRay = reflected.outgoingRay.value();
+        Ray transmittedRay = reflectedRay;
+        transmittedRay.direction = incomingRay.direction;
+        transmittedRay.origin = intersectionPoint + incomingRay.direction * EPSILON * 10.f;
+
+        float r = getReflectance();
+        reflectedRay.intensity = incomingRay.intensity * r;
+        transmittedRay.intensity = incomingRay.intensity * (1.f - r);
+        if (reflectancePercent <= 0)
+            return RayAction(intersectionPoint, transmittedRay);
+        if (reflectancePercent >= 100)
+            return RayAction(intersectionPoint, reflectedRay);
+        // Прошедший луч - основная ветвь, отражённый - дочерняя
+        return RayAction(intersectionPoint, transmittedRay, reflectedRay);
+    }
+
+    void draw(sf::RenderTarget &target) const override
+    {
+        sf::RectangleShape rect(sf::Vector2f(length, 3.f));
+        rect.setOrigin(length / 2.f, 1.5f);
+        rect.setPosition(center);
+        rect.setRotation(angle * 180.f / M_PI);
+        rect.setFillColor(sf::Color(color.r, color.g, color.b, 140));
+        rect.setOutlineThickness(1.f);
+        rect.setOutlineColor(color);
+        target.draw(rect);
+    }
+
+    void move(const sf::Vector2f &delta) override
+    {
+        Mirror::move(delta);
+        updateParameterString();
+    }
+    void setHandlePosition(int handleIndex, sf::Vector2f newPos, const sf::Vector2f &lastPos) override
+    {
+        Mirror::setHandlePosition(handleIndex, newPos, lastPos);
+        updateParameterString();
+    }
+    void rotate(float angleDelta) override
+    {
+        Mirror::rotate(angleDelta);
+        updateParameterString();
+    }
+    void setAngle(float newAngle) override
+    {
+        Mirror::setAngle(newAngle);
+        updateParameterString();
+    }
+
+    // Изменение коэффициента отражения (в процентах)
+    void adjustParameter(float delta) override
+    {
+        reflectancePercent = std::clamp(reflectancePercent + static_cast<int>(delta), 0, 100);
+        updateParameterString();
+    }
+
+    void updateParameterString() const
+    {
+        if (!fontPtr)
+            return;
+        reflectanceText.setString("Refl = " + std::to_string(reflectancePercent) + "%");
+        sf::Vector2f dir(std::cos(angle), std::sin(angle));
+        sf::Vector2f normal(-dir.y, dir.x);
+        sf::Vector2f textPos = getP1() - normal * 20.f - dir * 20.f;
+        reflectanceText.setCharacterSize(14);
+        sf::FloatRect textBounds = reflectanceText.getLocalBounds();
+        reflectanceText.setOrigin(textBounds.left + textBounds.width / 2.0f, textBounds.top + textBounds.height / 2.0f);
+        reflectanceText.setPosition(textPos);
+    }
+    std::string getParameterString() const override { return reflectanceText.getString(); }
+    sf::FloatRect getParameterBounds() const override
+    {
+        if (!fontPtr)
+            return {};
+        return reflectanceText.getGlobalBounds();
+    }
+
+    void setParameterFromString(const std::string &s) override
+    {
+        try
+        {
+            if (s.empty())
+            {
+                updateParameterString();
+                return;
+            }
+            reflectancePercent = std::clamp(std::stoi(s), 0, 100);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            std::cerr << "Invalid number format: '" << s << "'" << std::endl;
+        }
+        catch (const std::out_of_range &e)
+        {
+            std::cerr << "Number out of range: '" << s << "'" << std::endl;
+        }
+        updateParameterString();
+    }
+
+    void setFont(const sf::Font &font) const override
+    {
+        if (!fontPtr)
+        {
+            fontPtr = &font;
+            reflectanceText.setFont(*fontPtr);
+            updateParameterString();
+        }
+    }
+    int getReflectancePercent() const { return reflectancePercent; }
+};
+
+#endif // HEADER_GUARD_BEAM_SPLITTER_HPP
@@ -0,0 +1,446 @@
+#include "BeamTracer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Constants.hpp"
+#include "VectorMath.hpp"
+#include "PointSource.hpp"
+#include "DielectricBody.hpp"
+
+namespace
+{
+    const float SOURCE_CHORD = 1.f;            // Радиус хорды, задающей параметр лучей источника
+    const float MAX_SOURCE_WEDGE = 0.785398f;  // Наибольший угол начального клина, радиан
+    const float EDGE_INSET = 1e-3f;            // Отступ граничных лучей от концов интервала (доля интервала)
+    const int MAX_SPLIT_LEVEL = 14;            // Наибольшая глубина деления интервала пополам
+    const int MAX_REFINEMENTS = 256;           // Наибольшее число делений интервала между событиями ради точности модели
+    const float PENCIL_WIDTH = 1e-3f;          // Половина ширины узкого пучка вокруг одного луча, пикселей
+    const float MIN_INTERVAL = 1e-6f;
+    const float POSITION_ULPS = 8.f;           // Различимое смещение начала луча, в единицах точности float
+    const float CHORD_TOLERANCE = 0.5f;        // Отклонение границы области от прямой, пикселей
+    const float SELF_HIT_TOLERANCE = 1e-2f;    // Ближе начала пучка попадание в его же элемент - погрешность начальной точки
+    const float ESCAPE_CHORD_TOLERANCE = 4.f;  // То же для ушедших лучей (на расстоянии maxRayLength)
+    const float ANGLE_TOLERANCE = 2e-3f;       // Расхождение модели клина и настоящего луча, радиан (не больше CHORD_TOLERANCE на maxRayLength)
+    const float PARALLEL_EPSILON = 1e-6f;
+    const float FAR_APEX = 1e6f;               // Более далёкая точка схода - параллельный пучок
+    const float MIN_START_LENGTH = 1e-3f;
+    const float MIN_INTENSITY = 1e-3f;
+
+    float crossProduct(const sf::Vector2f &a, const sf::Vector2f &b) { return a.x * b.y - a.y * b.x; }
+
+    bool alive(const std::optional<Ray> &ray)
+    {
+        return ray.has_value() && ray->bounces_left > 0 && ray->intensity > MIN_INTENSITY;
+    }
+}
+
+Ray BeamTracer::Beam::rayAt(float u) const
+{
+    Ray ray = prototype;
+    ray.origin = start0 + (start1 - start0) * u;
+    ray.direction = parallel ? direction : VectorMath::normalize((ray.origin - apex) * sign);
+    if (fromApex)
+        ray.origin = apex;
+    return ray;
+}
+
+const BeamTracer::Result &BeamTracer::trace(const std::vector<const OpticalElement *> &elements, float maxRayLength)
+{
+    m_result = Result();
+    m_triangles.clear();
+    m_maxRayLength = maxRayLength;
+    // Ошибка направления клина растёт с длиной луча: на всей длине она не должна превышать CHORD_TOLERANCE
+    m_angleTolerance = std::min(ANGLE_TOLERANCE, CHORD_TOLERANCE / std::max(maxRayLength, 1.f));
+    m_targets.clear();
+    m_eventPoints.clear();
+    m_pending.clear();
+
+    for (const OpticalElement *el : elements)
+    {
+        if (!el || el->getType() == OpticalElement::Type::SOURCE)
+            continue;
+        m_targets.push_back(el);
+        // События - концы отрезков и дуг (ручки кроме центра) и вершины тел
+        if (const auto *body = dynamic_cast<const DielectricBody *>(el))
+        {
+            m_eventPoints.insert(m_eventPoints.end(), body->getVertices().begin(), body->getVertices().end());
+        }
+        else
+        {
+            std::vector<sf::Vector2f> handles = el->getHandles();
+            m_eventPoints.insert(m_eventPoints.end(), handles.begin() + std::min<size_t>(1, handles.size()), handles.end());
+        }
+    }
+
+    for (const OpticalElement *el : elements)
+    {
+        const auto *source = dynamic_cast<const PointSource *>(el);
+        if (!source || source->spanAngle <= EPSILON)
+            continue;
+        int pieces = static_cast<int>(std::ceil(source->spanAngle / MAX_SOURCE_WEDGE));
+        for (int p = 0; p < pieces; ++p)
+        {
+            float a0 = source->startAngle + source->spanAngle * p / pieces;
+            float a1 = source->startAngle + source->spanAngle * (p + 1) / pieces;
+            Beam beam;
+            beam.apex = source->position;
+            beam.start0 = source->position + VectorMath::direction(a0).value() * SOURCE_CHORD;
+            beam.start1 = source->position + VectorMath::direction(a1).value() * SOURCE_CHORD;
+            beam.prototype = {source->position, VectorMath::direction(a0).value(), Ray().bounces_left, source->color, source->spectrum.wavelengthAt(0)};
+            beam.origin = m_targets.size();
+            beam.fromApex = true;
+            m_pending.push_back(beam);
+        }
+    }
+
+    while (!m_pending.empty())
+    {
+        if (m_result.wedges >= AppConstants::BEAM_MAX_WEDGES || m_result.regions >= AppConstants::BEAM_MAX_REGIONS)
+        {
+            m_result.truncated = true;
+            break;
+        }
+        Beam beam = m_pending.back();
+        m_pending.pop_back();
+        ++m_result.wedges;
+        traceBeam(beam);
+    }
+    m_pending.clear();
+    m_result.triangles = std::make_shared<const std::vector<sf::Vertex>>(m_triangles);
+    return m_result;
+}
+
+BeamTracer::Hit BeamTracer::closestHit(const Ray &ray, size_t origin) const
+{
+    Hit hit;
+    hit.intersection.distance = m_maxRayLength;
+    hit.target = m_targets.size();
+    for (size_t i = 0; i < m_targets.size(); ++i)
+    {
+        VectorMath::IntersectionResult candidate = m_targets[i]->findIntersection(ray);
+        float minDistance = EPSILON;
+        if (i == origin)
+        {
+            minDistance = m_targets[i]->getType() == OpticalElement::Type::SPHERICAL_MIRROR ? CHORD_TOLERANCE : SELF_HIT_TOLERANCE;
+            // Элемент сообщает только ближайшее попадание: за отброшенным ищется следующее
+            if (candidate.intersects && candidate.distance <= minDistance)
+            {
+                Ray advanced = ray;
+                advanced.origin += ray.direction * minDistance;
+                candidate = m_targets[i]->findIntersection(advanced);
+                candidate.distance += minDistance;
+            }
+        }
+        if (candidate.intersects && candidate.distance > minDistance && candidate.distance < hit.intersection.distance)
+        {
+            hit.intersection = candidate;
+            hit.target = i;
+        }
+    }
+    return hit;
+}
+
+bool BeamTracer::parameterThrough(const Beam &beam, const sf::Vector2f &point, float &u)
+{
+    // Прямая луча через point пересекается с прямой начального отрезка
+    sf::Vector2f v = beam.parallel ? beam.direction : point - beam.apex;
+    float denominator = crossProduct(beam.start1 - beam.start0, v);
+    if (std::abs(denominator) < PARALLEL_EPSILON)
+        return false;
+    u = crossProduct(point - beam.start0, v) / denominator;
+    return true;
+}
+
+bool BeamTracer::beamFromRays(const Ray &a, const Ray &b, Beam &beam)
+{
+    float denominator = crossProduct(a.direction, b.direction);
+    float t = std::abs(denominator) > PARALLEL_EPSILON ? crossProduct(b.origin - a.origin, b.direction) / denominator : FAR_APEX * 2.f;
+    if (VectorMath::distance(a.origin, b.origin) < MIN_START_LENGTH || std::abs(t) < MIN_START_LENGTH)
+    {
+        // Лучи выходят из одной точки (фокус на поверхности): клин расходится из неё, как у источника
+        if (std::abs(denominator) <= PARALLEL_EPSILON)
+            return false;
+        beam.parallel = false;
+        beam.apex = std::abs(t) < MIN_START_LENGTH ? a.origin + a.direction * t : (a.origin + b.origin) * 0.5f;
+        beam.sign = 1.f;
+        beam.start0 = beam.apex + a.direction * SOURCE_CHORD;
+        beam.start1 = beam.apex + b.direction * SOURCE_CHORD;
+        beam.fromApex = true;
+        return true;
+    }
+    beam.start0 = a.origin;
+    beam.start1 = b.origin;
+    if (std::abs(t) > FAR_APEX)
+    {
+        beam.parallel = true;
+        beam.direction = VectorMath::normalize(a.direction + b.direction);
+        return true;
+    }
+    // Точка схода позади начала - пучок расходится, впереди - сходится
+    beam.parallel = false;
+    beam.apex = a.origin + a.direction * t;
+    beam.sign = t < 0.f ? 1.f : -1.f;
+    return true;
+}
+
+BeamTracer::Beam BeamTracer::pencilFromRay(const Ray &ray, const sf::Vector2f &across)
+{
+    // Начальный отрезок вдоль поверхности, чтобы край пучка не начинался за ней; вдоль луча - поперёк
+    sf::Vector2f side = VectorMath::normalize(across);
+    if (std::abs(crossProduct(side, ray.direction)) < 0.1f)
+        side = sf::Vector2f(-ray.direction.y, ray.direction.x);
+    Beam beam;
+    beam.start0 = ray.origin - side * PENCIL_WIDTH;
+    beam.start1 = ray.origin + side * PENCIL_WIDTH;
+    beam.parallel = true;
+    beam.direction = ray.direction;
+    beam.prototype = ray;
+    beam.pencil = true;
+    return beam;
+}
+
+float BeamTracer::findTransition(const Beam &beam, float lo, float hi, size_t target) const
+{
+    while (hi - lo > m_minInterval)
+    {
+        float mid = 0.5f * (lo + hi);
+        if (closestHit(beam.rayAt(mid), beam.origin).target == target)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return 0.5f * (lo + hi);
+}
+
+void BeamTracer::traceBeam(const Beam &beam)
+{
+    std::vector<float> params{0.f, 1.f};
+    for (const sf::Vector2f &point : m_eventPoints)
+    {
+        float u = 0.f;
+        if (parameterThrough(beam, point, u) && u > 0.f && u < 1.f)
+            params.push_back(u);
+    }
+    m_result.events += params.size() - 2;
+    // Более узкие интервалы дают лучи, неотличимые в float: граница элементов между ними - шум округления
+    float extent = std::max({1.f, std::abs(beam.start0.x), std::abs(beam.start0.y), std::abs(beam.start1.x), std::abs(beam.start1.y)});
+    float resolution = extent * std::numeric_limits<float>::epsilon() * POSITION_ULPS;
+    m_minInterval = std::clamp(resolution / std::max(VectorMath::distance(beam.start0, beam.start1), resolution), MIN_INTERVAL, 0.5f);
+    std::sort(params.begin(), params.end());
+    // Слишком близкие события сливаются, чтобы ни один интервал клина не пропал
+    float from = 0.f;
+    for (size_t i = 1; i < params.size(); ++i)
+    {
+        if (i + 1 < params.size() && (params[i] - from <= m_minInterval || 1.f - params[i] <= m_minInterval))
+            continue;
+        m_refinements = 0;
+        traceInterval(beam, from, params[i], 0);
+        from = params[i];
+    }
+}
+
+void BeamTracer::traceInterval(const Beam &beam, float ua, float ub, int level)
+{
+    // Деление интервалов пополам может дать очень много областей: их число ограничено
+    if (m_result.regions >= AppConstants::BEAM_MAX_REGIONS)
+    {
+        m_result.truncated = true;
+        return;
+    }
+    // Граничные лучи немного отступают от событий, средний проверяет модель интервала
+    const float inset = (ub - ua) * EDGE_INSET;
+    const float samples[3] = {ua + inset, 0.5f * (ua + ub), ub - inset};
+    const Ray rays[3] = {beam.rayAt(samples[0]), beam.rayAt(samples[1]), beam.rayAt(samples[2])};
+    Hit hits[3];
+    for (int k = 0; k < 3; ++k)
+        hits[k] = closestHit(rays[k], beam.origin);
+
+    const bool canSplit = level < MAX_SPLIT_LEVEL && ub - ua > 2.f * m_minInterval;
+    // Деления ради точности модели ограничены на интервал между событиями, иначе интервал,
+    // который модель не описывает нигде, делится до предела глубины
+    const bool canRefine = canSplit && m_refinements < MAX_REFINEMENTS;
+    auto split = [&](float um)
+    {
+        traceInterval(beam, ua, um, level + 1);
+        traceInterval(beam, um, ub, level + 1);
+    };
+    auto refine = [&]()
+    {
+        ++m_refinements;
+        split(0.5f * (ua + ub));
+    };
+
+    // Элементы пересекаются или закрывают друг друга не только в концах: делим по границе между ними
+    if (hits[0].target != hits[1].target || hits[1].target != hits[2].target)
+    {
+        if (canSplit)
+        {
+            const int k = hits[0].target != hits[1].target ? 0 : 1;
+            float um = findTransition(beam, samples[k], samples[k + 1], hits[k].target);
+            // Смена у самого конца - скопление смен (луч почти касается дуги): у конца отрезается
+            // интервал, который уже не делится, вместо деления пополам на каждом уровне
+            if (ub - ua > 4.f * m_minInterval && um - ua <= m_minInterval)
+                um = ua + 1.5f * m_minInterval;
+            else if (ub - ua > 4.f * m_minInterval && ub - um <= m_minInterval)
+                um = ub - 1.5f * m_minInterval;
+            else if (um - ua <= m_minInterval || ub - um <= m_minInterval)
+                um = 0.5f * (ua + ub);
+            split(um);
+            return;
+        }
+        if (!beam.pencil)
+        {
+            // На пределе деления пробные лучи с разными элементами продолжаются узкими пучками
+            for (int k = 0; k < 3; ++k)
+            {
+                if (k > 0 && hits[k].target == hits[k - 1].target)
+                    continue;
+                Beam pencil = pencilFromRay(rays[k], beam.start1 - beam.start0);
+                pencil.origin = beam.origin;
+                pushChild(pencil);
+            }
+            return;
+        }
+        // Узкий пучок - один луч: он продолжается по среднему лучу
+        hits[0] = hits[1];
+        hits[2] = hits[1];
+    }
+    const bool escaped = hits[1].target == m_targets.size();
+    sf::Vector2f ends[3];
+    for (int k = 0; k < 3; ++k)
+        ends[k] = escaped ? rays[k].origin + rays[k].direction * m_maxRayLength : hits[k].intersection.point;
+    // Дальняя граница области должна быть прямой (дуга зеркала, ушедшие лучи)
+    float bend = VectorMath::distancePointSegment(ends[1], ends[0], ends[2]);
+    if (bend > (escaped ? ESCAPE_CHORD_TOLERANCE : CHORD_TOLERANCE) && canRefine)
+    {
+        refine();
+        return;
+    }
+
+    // По пучку на ветвь: клин или узкий пучок вокруг пробного луча
+    Beam children[2];
+    int childCount = 0;
+    bool modelMatches = true;
+    if (!escaped)
+    {
+        const OpticalElement *target = m_targets[hits[1].target];
+        RayAction actions[3];
+        for (int k = 0; k < 3; ++k)
+            actions[k] = target->interact(rays[k], hits[k].intersection.point);
+        for (int branch = 0; branch < 2; ++branch)
+        {
+            auto rayOf = [&](int k) -> const std::optional<Ray> & { return branch == 0 ? actions[k].outgoingRay : actions[k].secondaryRay; };
+            int present[3];
+            int presentCount = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                if (alive(rayOf(k)))
+                    present[presentCount++] = k;
+            }
+            if (presentCount == 0)
+                continue;
+            // Ветвь есть не у всех лучей (полное внутреннее отражение): клин по крайним из имеющихся
+            Beam child;
+            const Ray &first = rayOf(present[0]).value();
+            const Ray &last = rayOf(present[presentCount - 1]).value();
+            if (presentCount == 1 || !beamFromRays(first, last, child))
+            {
+                // Совпадающие лучи - один луч; одиночный луч у границы полного отражения уточняется делением
+                modelMatches = modelMatches && presentCount > 1;
+                child = pencilFromRay(rayOf(present[presentCount / 2]).value(), ends[2] - ends[0]);
+                child.origin = hits[1].target;
+                children[childCount++] = child;
+                continue;
+            }
+            modelMatches = modelMatches && presentCount == 3;
+            // Модель проверяется по среднему лучу (или по последнему, если среднего нет)
+            const Ray &middle = rayOf(present[presentCount / 2]).value();
+            float um = 0.f;
+            if (!parameterThrough(child, middle.origin, um))
+            {
+                sf::Vector2f span = child.start1 - child.start0;
+                um = VectorMath::dot(middle.origin - child.start0, span) / VectorMath::dot(span, span);
+            }
+            sf::Vector2f predicted = child.rayAt(um).direction;
+            if (std::abs(crossProduct(predicted, middle.direction)) > m_angleTolerance || VectorMath::dot(predicted, middle.direction) < 0.f)
+                modelMatches = false;
+            if (presentCount == 3)
+            {
+                // Граничные лучи клина отступают от концов интервала: начальный отрезок продолжается
+                // на отступы, иначе теряются лучи у самих концов (например, крайний луч источника)
+                sf::Vector2f span = child.start1 - child.start0;
+                float extend = inset / (samples[2] - samples[0]);
+                child.start0 -= span * extend;
+                child.start1 += span * extend;
+            }
+            child.prototype = middle;
+            child.origin = hits[1].target;
+            children[childCount++] = child;
+        }
+    }
+    if (!modelMatches && canRefine)
+    {
+        refine();
+        return;
+    }
+
+    // Область строится по настоящим границам интервала: концы продолжаются до прямой попаданий
+    Ray rayA = beam.rayAt(ua), rayB = beam.rayAt(ub);
+    sf::Vector2f endA = rayA.origin + rayA.direction * m_maxRayLength;
+    sf::Vector2f endB = rayB.origin + rayB.direction * m_maxRayLength;
+    if (!escaped)
+    {
+        sf::Vector2f line = ends[2] - ends[0];
+        endA = ends[0];
+        endB = ends[2];
+        if (std::abs(crossProduct(rayA.direction, line)) > PARALLEL_EPSILON && std::abs(crossProduct(rayB.direction, line)) > PARALLEL_EPSILON)
+        {
+            endA = rayA.origin + rayA.direction * (crossProduct(ends[0] - rayA.origin, line) / crossProduct(rayA.direction, line));
+            endB = rayB.origin + rayB.direction * (crossProduct(ends[0] - rayB.origin, line) / crossProduct(rayB.direction, line));
+        }
+    }
+    addRegion(beam, rayA, rayB, endA, endB);
+
+    for (int i = 0; i < childCount; ++i)
+        pushChild(children[i]);
+}
+
+void BeamTracer::pushChild(const Beam &child)
+{
+    if (m_result.wedges + m_pending.size() >= AppConstants::BEAM_MAX_WEDGES)
+    {
+        m_result.truncated = true;
+        return;
+    }
+    m_pending.push_back(child);
+}
+
+void BeamTracer::addRegion(const Beam &beam, const Ray &a, const Ray &b, const sf::Vector2f &endA, const sf::Vector2f &endB)
+{
+    sf::Color color = beam.prototype.color;
+    color.a = static_cast<sf::Uint8>(AppConstants::BEAM_FILL_ALPHA * (color.a / 255.f) * std::sqrt(std::clamp(beam.prototype.intensity, 0.f, 1.f)));
+    auto triangle = [&](const sf::Vector2f &p0, const sf::Vector2f &p1, const sf::Vector2f &p2)
+    {
+        m_triangles.emplace_back(p0, color);
+        m_triangles.emplace_back(p1, color);
+        m_triangles.emplace_back(p2, color);
+    };
+    ++m_result.regions;
+
+    // Сходящийся пучок, фокус которого перед концами: два треугольника, сходящиеся в фокусе
+    if (!beam.parallel && beam.sign < 0.f)
+    {
+        float focusDistance = VectorMath::dot(beam.apex - a.origin, a.direction);
+        if (focusDistance > 0.f && focusDistance < VectorMath::dot(endA - a.origin, a.direction))
+        {
+            triangle(a.origin, b.origin, beam.apex);
+            triangle(beam.apex, endA, endB);
+            return;
+        }
+    }
+    triangle(a.origin, endA, endB);
+    if (a.origin != b.origin)
+        triangle(a.origin, endB, b.origin);
+}
@@ -0,0 +1,90 @@
+#ifndef HEADER_GUARD_BEAM_TRACER_HPP
+#define HEADER_GUARD_BEAM_TRACER_HPP
+
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+#include "OpticalElement.hpp"
+
+// Трассировка пучков: вместо веера лучей источник испускает угловые клинья, и освещённые
+// области строятся точными многоугольниками. Клин описывается отрезком, на котором начинаются
+// его лучи, и точкой схода (или общим направлением параллельного пучка). Клин делится на
+// интервалы по концам элементов и вершинам тел: внутри интервала все лучи попадают в один
+// отрезок, поэтому освещённая область - четырёхугольник. Если элементы пересекаются или закрывают
+// друг друга не в концах, граница между ними находится делением пополам по одиночным лучам.
+// Через плоское зеркало и светоделитель клин переходит точно (мнимый источник), через линзу,
+// сферическое зеркало и границы тел - приближённо: интервал делится пополам, пока модель клина
+// не совпадёт с настоящим лучом в середине интервала, но не больше MAX_REFINEMENTS раз на интервал.
+// Лучи, которые моделью клина не описываются (полное внутреннее отражение части интервала,
+// интервал на пределе деления), продолжаются узкими параллельными пучками вокруг одного луча.
+// Стоимость пропорциональна числу событий, а не числу лучей.
+class BeamTracer
+{
+public:
+    // Пучок лучей: луч с параметром u в [0, 1] начинается в start0 + u * (start1 - start0)
+    struct Beam
+    {
+        sf::Vector2f start0, start1;
+        bool parallel = false;
+        sf::Vector2f apex;         // Точка схода лучей (реальная или мнимая)
+        float sign = 1.f;          // -1: лучи сходятся к apex
+        sf::Vector2f direction;    // Направление параллельного пучка
+        Ray prototype;             // Цвет, интенсивность, длина волны, оставшиеся отскоки, среда
+        size_t origin = 0;         // Элемент (индекс в m_targets), от которого идёт пучок; m_targets.size() - источник
+        bool pencil = false;       // Узкий пучок вокруг одного луча (запасной вариант, сам так не продолжается)
+        bool fromApex = false;     // Лучи начинаются в apex (источник); начальный отрезок только задаёт параметр
+
+        Ray rayAt(float u) const;
+    };
+
+    struct Result
+    {
+        // Освещённые области (sf::Triangles); неизменяемы, кадры отрисовки разделяют их без копирования
+        std::shared_ptr<const std::vector<sf::Vertex>> triangles;
+        size_t wedges = 0;                 // Обработанные клинья
+        size_t events = 0;                 // Концы элементов и вершины тел внутри клиньев
+        size_t regions = 0;                // Освещённые четырёхугольники
+        bool truncated = false;            // Достигнут предел числа клиньев или областей
+    };
+
+    const Result &trace(const std::vector<const OpticalElement *> &elements, float maxRayLength);
+    const Result &getResult() const { return m_result; }
+
+private:
+    struct Hit
+    {
+        VectorMath::IntersectionResult intersection;
+        size_t target;
+    };
+
+    // Попадания в сферическое зеркало origin ближе CHORD_TOLERANCE не учитываются: лучи модели
+    // начинаются на хорде дуги, а не на самой дуге; в остальные элементы origin - ближе SELF_HIT_TOLERANCE
+    Hit closestHit(const Ray &ray, size_t origin) const;
+    // Параметр луча пучка, проходящего через точку
+    static bool parameterThrough(const Beam &beam, const sf::Vector2f &point, float &u);
+    // Клин по двум граничным лучам; лучи из одной точки дают расходящийся клин с вершиной в ней.
+    // false, если лучи совпадают
+    static bool beamFromRays(const Ray &a, const Ray &b, Beam &beam);
+    // Узкий параллельный пучок вокруг луча; across - направление начального отрезка (вдоль поверхности)
+    static Beam pencilFromRay(const Ray &ray, const sf::Vector2f &across);
+    // Параметр смены элемента между lo (луч попадает в target) и hi (не попадает)
+    float findTransition(const Beam &beam, float lo, float hi, size_t target) const;
+    void traceBeam(const Beam &beam);
+    void traceInterval(const Beam &beam, float ua, float ub, int level);
+    void pushChild(const Beam &child);
+    void addRegion(const Beam &beam, const Ray &a, const Ray &b, const sf::Vector2f &endA, const sf::Vector2f &endB);
+
+    std::vector<const OpticalElement *> m_targets;
+    std::vector<sf::Vector2f> m_eventPoints;
+    std::vector<Beam> m_pending;
+    std::vector<sf::Vertex> m_triangles;
+    float m_maxRayLength = 0.f;
+    float m_angleTolerance = 0.f;
+    float m_minInterval = 0.f; // Наименьший делимый интервал текущего пучка
+    int m_refinements = 0; // Делений текущего интервала между событиями ради точности модели
+    Result m_result;
+};
+
+#endif // HEADER_GUARD_BEAM_TRACER_HPP
@@ -15,21 +15,55 @@ namespace AppConstants {
 
     // Константы симуляции
     const float MAX_RAY_LENGTH = 2000.f;
+    const float UPDATE_RATE_LIMIT = 240.f; // Предельная частота цикла обработки ввода и трассировки, Гц
     const float ROTATION_SPEED = 0.05f;
     const float PARAM_ADJUST_SPEED = 10.0f;
     const int SOURCE_PARAM_ADJUST_SPEED = 1;
     const float MIN_ELEMENT_PLACEMENT_DISTANCE = 5.0f;
+    const int DEFAULT_DETECTOR_BINS = 64;
+    const int MAX_DETECTOR_BINS = 4096;          // Предел ячеек детектора: ввод, клавиши +/-, файлы сцен и C API
+    const float DEFAULT_REFRACTIVE_INDEX = 1.5f;
+    const int DEFAULT_SPLITTER_REFLECTANCE = 50; // %
 
     // Константы UI и выбора
     const float ELEMENT_SELECT_TOLERANCE = 8.0f;
     const float HANDLE_SELECT_TOLERANCE = 8.0f;
     const unsigned int FONT_SIZE_UI = 14;
+    const float SPATIAL_INDEX_CELL_SIZE = 64.f; // Размер ячейки сетки выбора элементов
+    const float SPATIAL_INDEX_MARGIN = 12.f;    // Запас границ элемента на допуск выбора
+    const float VIEW_ZOOM_STEP = 1.15f;         // Масштаб за один шаг колеса мыши
+    const float VIEW_MIN_SCALE = 0.05f;         // Пределы размера вида относительно окна
+    const float VIEW_MAX_SCALE = 20.f;
+    const float VIEW_CULL_MARGIN = 40.f;        // Запас видимой области на подписи элементов, пикселей экрана
+    const size_t HISTORY_LIMIT = 256;           // Число хранимых шагов отмены
+    const size_t SWEEP_VARIANTS = 256;          // Число вариантов перебора параметра (F5)
+    const float SWEEP_RANGE_FRACTION = 0.5f;    // Перебор значения в пределах +-50% от текущего
+    const float SWEEP_ANGLE_RANGE = 45.f;       // Перебор поворота в пределах +-45 градусов (Shift+F5)
+    const float SWEEP_POSITION_RANGE = 100.f;   // Перебор сдвига в пределах +-100 пикселей (Ctrl+F5, Ctrl+Shift+F5)
+    const float OPTIMIZER_INITIAL_STEP_FRACTION = 0.1f; // Начальный шаг оптимизации: 10% значения параметра
+    const float OPTIMIZER_INITIAL_ANGLE_STEP = 2.f;     // Начальный шаг оптимизации угла, градусы
+    const float OPTIMIZER_INITIAL_POSITION_STEP = 10.f; // Начальный шаг оптимизации положения, пикселей
+    const float SPOT_AUTO_HALF_EXTENT = 256.f;  // Половина длины автоматической плоскости анализа пятна (K)
+    const float PARAXIAL_MARKER_SIZE = 10.f;    // Половина длины отметок фокусов и главных плоскостей (X)
+    const size_t BEAM_MAX_WEDGES = 20000;       // Предел числа клиньев трассировки пучков (W)
+    const size_t BEAM_MAX_REGIONS = 100000;     // Предел числа освещённых областей (время построения и память кадра)
+    const float BEAM_FILL_ALPHA = 90.f;         // Прозрачность освещённых областей при полной интенсивности
+    const size_t LATENCY_SAMPLE_WINDOW = 512;    // Последние взаимодействия в распределении задержки ввода
+    const int IMPORTANCE_EMPTY_RAYS = 8;        // Лучи источника в пустые направления при выборке по значимости (I)
 
     // Цвета
     const sf::Color COLOR_BACKGROUND = sf::Color(30, 30, 50);
     const sf::Color COLOR_HELP_TEXT = sf::Color::White;
     const sf::Color COLOR_HANDLE_MOVE = sf::Color(100, 100, 255);
     const sf::Color COLOR_HANDLE_RESIZE = sf::Color(100, 255, 100);
+    const sf::Color COLOR_MARQUEE_FILL = sf::Color(100, 100, 255, 40);
+    const sf::Color COLOR_MARQUEE_OUTLINE = sf::Color(100, 100, 255);
+    const sf::Color COLOR_SPOT_PLANE = sf::Color(255, 120, 200);
+    const sf::Color COLOR_SPOT_POINT = sf::Color(255, 240, 120);
+    const sf::Color COLOR_PARAXIAL_AXIS = sf::Color(160, 160, 160, 160);
+    const sf::Color COLOR_PARAXIAL_FOCUS = sf::Color(255, 90, 90);
+    const sf::Color COLOR_PARAXIAL_PRINCIPAL = sf::Color(90, 200, 255);
+    const sf::Color COLOR_PARAXIAL_IMAGE = sf::Color(120, 255, 120);
 
     // Цвета для текстового ввода
     const sf::Color COLOR_INPUT_TEXT_FG = sf::Color::Black;
@@ -40,6 +74,9 @@ namespace AppConstants {
     const sf::Color COLOR_PLACEMENT_PREVIEW_MIRROR = sf::Color::White;
     const sf::Color COLOR_PLACEMENT_PREVIEW_LENS = sf::Color(100, 100, 255);
     const sf::Color COLOR_PLACEMENT_PREVIEW_SPHERICAL_MIRROR = sf::Color(192, 192, 192);
+    const sf::Color COLOR_PLACEMENT_PREVIEW_DETECTOR = sf::Color(80, 220, 120);
+    const sf::Color COLOR_PLACEMENT_PREVIEW_DIELECTRIC = sf::Color(120, 200, 255);
+    const sf::Color COLOR_PLACEMENT_PREVIEW_BEAM_SPLITTER = sf::Color(150, 220, 255);
 
     // Константы для UI редактирования текста
     const float TEXT_INPUT_FIELD_MIN_WIDTH = 10.f;
@@ -0,0 +1,349 @@
+#ifndef HEADER_GUARD_COROUTINE_HPP
+#define HEADER_GUARD_COROUTINE_HPP
+
+// Минимальная среда сопрограмм C++20 для конвейера пакетных заданий: пул потоков,
+// ограниченные очереди с ожиданием и этапы, запускаемые на пуле.
+// Требует C++20 (подключается только целью batch_trace).
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Coro
+{
+    // Пул потоков. Сопрограмма переходит в поток пула через co_await executor.schedule()
+    class Executor
+    {
+    public:
+        explicit Executor(unsigned threads)
+        {
+            for (unsigned i = 0; i < std::max(1u, threads); ++i)
+                m_threads.emplace_back([this] { workerLoop(); });
+        }
+
+        ~Executor()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wake.notify_all();
+            for (std::thread &thread : m_threads)
+                thread.join();
+        }
+
+        Executor(const Executor &) = delete;
+        Executor &operator=(const Executor &) = delete;
+
+        unsigned threadCount() const { return static_cast<unsigned>(m_threads.size()); }
+
+        void post(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.push_back(std::move(task));
+            }
+            m_wake.notify_one();
+        }
+
+        void resumeLater(std::coroutine_handle<> handle)
+        {
+            post([handle] { handle.resume(); });
+        }
+
+        auto schedule()
+        {
+            struct Awaiter
+            {
+                Executor *executor;
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> handle) { executor->resumeLater(handle); }
+                void await_resume() const noexcept {}
+            };
+            return Awaiter{this};
+        }
+
+        // fn(i) для i в [0, count) в потоках пула; сопрограмма продолжается в потоке,
+        // завершившем последний вызов. Первое исключение из fn передаётся ожидающему
+        template <typename Fn>
+        auto forEach(size_t count, Fn fn)
+        {
+            struct Awaiter
+            {
+                Executor *executor;
+                size_t count;
+                Fn fn;
+                std::atomic<size_t> remaining{0};
+                std::mutex errorMutex;
+                std::exception_ptr error;
+
+                bool await_ready() const noexcept { return count == 0; }
+                void await_suspend(std::coroutine_handle<> handle)
+                {
+                    remaining.store(count, std::memory_order_relaxed);
+                    // Последняя задача может продолжить сопрограмму до выхода из цикла:
+                    // после публикации задач поля ожидающего объекта не читаются
+                    Executor *target = executor;
+                    const size_t total = count;
+                    for (size_t i = 0; i < total; ++i)
+                    {
+                        target->post([this, handle, i]
+                                     {
+                            try
+                            {
+                                fn(i);
+                            }
+                            catch (...)
+                            {
+                                std::lock_guard<std::mutex> lock(errorMutex);
+                                if (!error)
+                                    error = std::current_exception();
+                            }
+                            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                                handle.resume(); });
+                    }
+                }
+                void await_resume()
+                {
+                    if (error)
+                        std::rethrow_exception(error);
+                }
+            };
+            return Awaiter{this, count, std::move(fn), {}, {}, {}};
+        }
+
+    private:
+        void workerLoop()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                    if (m_tasks.empty())
+                        return;
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<std::function<void()>> m_tasks;
+        bool m_stopping = false;
+    };
+
+    // Ограниченная очередь между этапами. push ждёт свободного места, pop - элемента;
+    // после close() и опустошения pop возвращает std::nullopt. Ожидающая сопрограмма
+    // продолжается в указанном при ожидании пуле
+    template <typename T>
+    class Channel
+    {
+    public:
+        explicit Channel(size_t capacity) : m_capacity(std::max<size_t>(1, capacity)) {}
+
+        auto push(T value, Executor &resumeOn)
+        {
+            struct Awaiter
+            {
+                Channel *channel;
+                Executor *executor;
+                T value;
+
+                bool await_ready() const noexcept { return false; }
+                bool await_suspend(std::coroutine_handle<> handle)
+                {
+                    std::lock_guard<std::mutex> lock(channel->m_mutex);
+                    if (!channel->m_popWaiters.empty())
+                    {
+                        // Элемент передаётся ожидающему получателю напрямую
+                        PopWaiter waiter = channel->m_popWaiters.front();
+                        channel->m_popWaiters.pop_front();
+                        waiter.result->emplace(std::move(value));
+                        waiter.executor->resumeLater(waiter.handle);
+                        return false;
+                    }
+                    if (channel->m_items.size() < channel->m_capacity)
+                    {
+                        channel->m_items.push_back(std::move(value));
+                        return false;
+                    }
+                    channel->m_pushWaiters.push_back({handle, executor, &value});
+                    return true;
+                }
+                void await_resume() const noexcept {}
+            };
+            return Awaiter{this, &resumeOn, std::move(value)};
+        }
+
+        auto pop(Executor &resumeOn)
+        {
+            struct Awaiter
+            {
+                Channel *channel;
+                Executor *executor;
+                std::optional<T> result;
+
+                bool await_ready() const noexcept { return false; }
+                bool await_suspend(std::coroutine_handle<> handle)
+                {
+                    std::lock_guard<std::mutex> lock(channel->m_mutex);
+                    if (!channel->m_items.empty())
+                    {
+                        result.emplace(std::move(channel->m_items.front()));
+                        channel->m_items.pop_front();
+                        // Освободившееся место занимает ожидающий отправитель
+                        if (!channel->m_pushWaiters.empty())
+                        {
+                            PushWaiter waiter = channel->m_pushWaiters.front();
+                            channel->m_pushWaiters.pop_front();
+                            channel->m_items.push_back(std::move(*waiter.value));
+                            waiter.executor->resumeLater(waiter.handle);
+                        }
+                        return false;
+                    }
+                    if (channel->m_closed)
+                        return false;
+                    channel->m_popWaiters.push_back({handle, executor, &result});
+                    return true;
+                }
+                std::optional<T> await_resume() { return std::move(result); }
+            };
+            return Awaiter{this, &resumeOn, std::nullopt};
+        }
+
+        // Больше элементов не будет: ожидающие получатели продолжаются с std::nullopt
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+            for (const PopWaiter &waiter : m_popWaiters)
+                waiter.executor->resumeLater(waiter.handle);
+            m_popWaiters.clear();
+        }
+
+    private:
+        struct PushWaiter
+        {
+            std::coroutine_handle<> handle;
+            Executor *executor;
+            T *value;
+        };
+        struct PopWaiter
+        {
+            std::coroutine_handle<> handle;
+            Executor *executor;
+            std::optional<T> *result;
+        };
+
+        size_t m_capacity;
+        std::mutex m_mutex;
+        std::deque<T> m_items;
+        std::deque<PushWaiter> m_pushWaiters;
+        std::deque<PopWaiter> m_popWaiters;
+        bool m_closed = false;
+    };
+
+    class StageGroup;
+
+    // Этап конвейера: сопрограмма, запускаемая StageGroup::start в указанном пуле
+    class Stage
+    {
+    public:
+        struct promise_type
+        {
+            StageGroup *group = nullptr;
+
+            Stage get_return_object() { return Stage(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept;
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept;
+        };
+
+        Stage(Stage &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+        ~Stage()
+        {
+            if (m_handle)
+                m_handle.destroy(); // Этап так и не был запущен
+        }
+
+    private:
+        friend class StageGroup;
+        explicit Stage(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    // Запуск этапов и ожидание их завершения; первое исключение этапа передаётся из wait()
+    class StageGroup
+    {
+    public:
+        void start(Executor &executor, Stage stage)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_running;
+            }
+            std::coroutine_handle<Stage::promise_type> handle = std::exchange(stage.m_handle, nullptr);
+            handle.promise().group = this;
+            executor.resumeLater(handle);
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_running == 0; });
+            if (m_error)
+                std::rethrow_exception(m_error);
+        }
+
+    private:
+        friend struct Stage::promise_type;
+
+        void finished(std::exception_ptr error)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (error && !m_error)
+                m_error = error;
+            if (--m_running == 0)
+                m_done.notify_all();
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_done;
+        size_t m_running = 0;
+        std::exception_ptr m_error;
+    };
+
+    inline std::suspend_never Stage::promise_type::final_suspend() noexcept
+    {
+        if (group)
+            group->finished(nullptr);
+        return {};
+    }
+
+    inline void Stage::promise_type::unhandled_exception() noexcept
+    {
+        // После исключения вызывается final_suspend: группа получает ошибку здесь
+        // и не уведомляется повторно
+        StageGroup *owner = std::exchange(group, nullptr);
+        if (owner)
+            owner->finished(std::current_exception());
+    }
+}
+
+#endif // HEADER_GUARD_COROUTINE_HPP
@@ -0,0 +1,315 @@
+#ifndef HEADER_GUARD_DETECTOR_HPP
+#define HEADER_GUARD_DETECTOR_HPP
+
+#include "OpticalElement.hpp"
+#include "Constants.hpp"
+#include <fstream>
+
+// Детектор (экран): отрезок, поглощающий лучи и накапливающий попадания в N ячеек по координате
+class Detector : public OpticalElement
+{
+public:
+    sf::Vector2f center;                       // Центр отрезка детектора
+    float length;                              // Длина детектора
+    float angle;                               // Угол наклона (в радианах)
+    int numBins;                               // Количество ячеек гистограммы
+    bool angleWeighted = false;                // Взвешивать попадания косинусом угла падения
+    sf::Color color;                           // Цвет детектора
+    mutable sf::Text binsText;                 // Текст "Bins = ..."
+    mutable sf::Font const *fontPtr = nullptr; // Указатель на шрифт
+
+    Detector(sf::Vector2f p1, sf::Vector2f p2, int bins = 64, sf::Color c = sf::Color(80, 220, 120)) : numBins(clampBins(bins)), color(c)
+    {
+        center = (p1 + p2) / 2.f;
+        sf::Vector2f delta = p2 - p1;
+        length = VectorMath::length(delta);
+        angle = std::atan2(delta.y, delta.x);
+        m_bins.assign(numBins, 0.f);
+        setupText();
+    }
+
+    void setupText() const
+    {
+        binsText.setCharacterSize(14);
+        binsText.setFillColor(sf::Color::White);
+        updateParameterString();
+    }
+
+    Type getType() const override { return Type::DETECTOR; }
+    std::unique_ptr<OpticalElement> clone() const override { return std::make_unique<Detector>(*this); }
+
+    // Получение координат конечных точек детектора
+    sf::Vector2f getP1() const
+    {
+        sf::Vector2f dir(std::cos(angle), std::sin(angle));
+        return center - dir * (length / 2.f);
+    }
+    sf::Vector2f getP2() const
+    {
+        sf::Vector2f dir(std::cos(angle), std::sin(angle));
+        return center + dir * (length / 2.f);
+    }
+
+    VectorMath::IntersectionResult findIntersection(const Ray &ray) const override { return VectorMath::raySegmentIntersection(ray.origin, ray.direction, getP1(), getP2()); }
+
+    // Детектор поглощает луч: исходящего луча нет
+    RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const override
+    {
+        RayAction action;
+        action.interactionPoint = intersectionPoint;
+        return action;
+    }
+
+    // Индекс ячейки для точки на детекторе
+    int binIndexAt(const sf::Vector2f &point) const
+    {
+        sf::Vector2f dir(std::cos(angle), std::sin(angle));
+        float u = VectorMath::dot(point - getP1(), dir) / std::max(length, EPSILON);
+        int index = static_cast<int>(u * numBins);
+        return std::clamp(index, 0, numBins - 1);
+    }
+
+    // Вес попадания луча (1 или |cos| угла падения)
+    float hitWeight(const Ray &ray) const
+    {
+        if (!angleWeighted)
+            return 1.f;
+        sf::Vector2f normal(-std::sin(angle), std::cos(angle));
+        return std::abs(VectorMath::dot(ray.direction, normal));
+    }
+
+    // Результаты последней трассировки
+    const std::vector<float> &getBins() const { return m_bins; }
+    void setBins(std::vector<float> bins)
+    {
+        m_bins = std::move(bins);
+        m_bins.resize(numBins, 0.f);
+    }
+    float getTotalFlux() const
+    {
+        float total = 0.f;
+        for (float v : m_bins)
+            total += v;
+        return total;
+    }
+
+    // Экспорт гистограммы в CSV: номер ячейки, координата центра ячейки вдоль детектора, значение
+    bool exportCsv(const std::string &path) const
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cerr << "Cannot open file for detector export: '" << path << "'" << std::endl;
+            return false;
+        }
+        out << "bin,position,value\n";
+        for (int i = 0; i < static_cast<int>(m_bins.size()); ++i)
+        {
+            float pos = (static_cast<float>(i) + 0.5f) * length / numBins;
+            out << i << "," << pos << "," << m_bins[i] << "\n";
+        }
+        return true;
+    }
+
+    void toggleAngleWeighting()
+    {
+        angleWeighted = !angleWeighted;
+        updateParameterString();
+    }
+
+    bool isPointNear(const sf::Vector2f &point, float tolerance = 5.0f) const override
+    {
+        return VectorMath::distancePointSegment(point, getP1(), getP2()) <= tolerance;
+    }
+    void move(const sf::Vector2f &delta) override
+    {
+        center += delta;
+        updateParameterString();
+    }
+    sf::Vector2f getCenter() const override
+    {
+        return center;
+    }
+    sf::FloatRect getBounds() const override
+    {
+        return VectorMath::segmentBounds(getP1(), getP2());
+    }
+
+    std::vector<sf::Vector2f> getHandles() const override
+    {
+        return {center, getP1(), getP2()};
+    }
+    int getHandleAtPoint(const sf::Vector2f &point, float tolerance = 8.0f) const override
+    {
+        if (VectorMath::distance(point, getP1()) <= tolerance)
+            return 1;
+        if (VectorMath::distance(point, getP2()) <= tolerance)
+            return 2;
+        if (VectorMath::distance(point, center) <= tolerance)
+            return 0;
+        return -1;
+    }
+    void setHandlePosition(int handleIndex, sf::Vector2f newPos, const sf::Vector2f &lastPos) override
+    {
+        if (handleIndex == 0)
+        {
+            move(newPos - lastPos);
+        }
+        else if (handleIndex == 1 || handleIndex == 2)
+        {
+            sf::Vector2f otherP = (handleIndex == 1) ? getP2() : getP1();
+            center = (newPos + otherP) / 2.f;
+            sf::Vector2f delta = newPos - otherP;
+            length = VectorMath::length(delta);
+            angle = std::atan2(delta.y, delta.x);
+            if (handleIndex == 1)
+            {
+                angle += M_PI;
+                if (angle > M_PI)
+                    angle -= 2.0 * M_PI;
+            }
+            updateParameterString();
+        }
+    }
+
+    void rotate(float angleDelta) override
+    {
+        angle += angleDelta;
+        updateParameterString();
+    }
+    void setAngle(float newAngle) override
+    {
+        angle = newAngle;
+        updateParameterString();
+    }
+    float getAngle() const override { return angle; }
+
+    // Изменение количества ячеек
+    void adjustParameter(float delta) override
+    {
+        numBins = clampBins(numBins + static_cast<int>(delta));
+        m_bins.assign(numBins, 0.f);
+        updateParameterString();
+    }
+
+    void updateParameterString() const
+    {
+        if (!fontPtr)
+            return;
+        binsText.setString("Bins = " + std::to_string(numBins) + (angleWeighted ? " (cos)" : ""));
+        sf::Vector2f dir(std::cos(angle), std::sin(angle));
+        sf::Vector2f normal(-dir.y, dir.x);
+        sf::Vector2f textPos = getP1() - normal * 20.f - dir * 20.f;
+        binsText.setCharacterSize(14);
+        sf::FloatRect textBounds = binsText.getLocalBounds();
+        binsText.setOrigin(textBounds.left + textBounds.width / 2.0f, textBounds.top + textBounds.height / 2.0f);
+        binsText.setPosition(textPos);
+    }
+    std::string getParameterString() const override { return binsText.getString(); }
+    sf::FloatRect getParameterBounds() const override
+    {
+        if (!fontPtr)
+            return {};
+        return binsText.getGlobalBounds();
+    }
+
+    void setParameterFromString(const std::string &s) override
+    {
+        try
+        {
+            if (s.empty())
+            {
+                updateParameterString();
+                return;
+            }
+            numBins = clampBins(std::stoi(s));
+            m_bins.assign(numBins, 0.f);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            std::cerr << "Invalid number format for bins: '" << s << "'" << std::endl;
+        }
+        catch (const std::out_of_range &e)
+        {
+            std::cerr << "Number out of range for bins: '" << s << "'" << std::endl;
+        }
+        updateParameterString();
+    }
+
+    void setFont(const sf::Font &font) const override
+    {
+        if (!fontPtr)
+        {
+            fontPtr = &font;
+            binsText.setFont(*fontPtr);
+            updateParameterString();
+        }
+    }
+
+    int getNumBins() const { return numBins; }
+
+    void draw(sf::RenderTarget &target) const override
+    {
+        drawBody(target);
+        drawHistogram(target, m_bins);
+    }
+
+    void drawBody(sf::RenderTarget &target) const
+    {
+        sf::RectangleShape rect(sf::Vector2f(length, 4.f));
+        rect.setOrigin(length / 2.f, 2.f);
+        rect.setPosition(center);
+        rect.setRotation(angle * 180.f / M_PI);
+        rect.setFillColor(color);
+        target.draw(rect);
+    }
+
+    // Гистограмма рядом с детектором (со стороны, противоположной нормали).
+    // Ячейки передаются отдельно: поток отрисовки рисует копию детектора с текущими ячейками
+    void drawHistogram(sf::RenderTarget &target, const std::vector<float> &bins) const
+    {
+        float maxValue = 0.f;
+        for (float v : bins)
+            maxValue = std::max(maxValue, v);
+        if (maxValue <= 0.f || bins.empty())
+            return;
+
+        const float maxHeight = 60.f;
+        sf::Vector2f dir(std::cos(angle), std::sin(angle));
+        sf::Vector2f normal(-dir.y, dir.x);
+        sf::Vector2f base = getP1() - normal * 6.f;
+        float binWidth = length / static_cast<float>(bins.size());
+        sf::VertexArray bars(sf::Quads, bins.size() * 4);
+        sf::Color barColor(color.r, color.g, color.b, 160);
+        for (size_t i = 0; i < bins.size(); ++i)
+        {
+            float h = maxHeight * bins[i] / maxValue;
+            sf::Vector2f b0 = base + dir * (binWidth * i);
+            sf::Vector2f b1 = base + dir * (binWidth * (i + 1));
+            bars[i * 4 + 0] = sf::Vertex(b0, barColor);
+            bars[i * 4 + 1] = sf::Vertex(b1, barColor);
+            bars[i * 4 + 2] = sf::Vertex(b1 - normal * h, barColor);
+            bars[i * 4 + 3] = sf::Vertex(b0 - normal * h, barColor);
+        }
+        target.draw(bars);
+    }
+
+    void drawHandles(sf::RenderTarget &target, sf::Color moveColor, sf::Color resizeColor) const override
+    {
+        auto handles = getHandles();
+        sf::CircleShape handleShape(5.f);
+        handleShape.setOrigin(5.f, 5.f);
+        handleShape.setFillColor(resizeColor);
+        handleShape.setPosition(handles[1]);
+        target.draw(handleShape);
+        handleShape.setPosition(handles[2]);
+        target.draw(handleShape);
+    }
+
+private:
+    static int clampBins(int bins) { return std::clamp(bins, 1, AppConstants::MAX_DETECTOR_BINS); }
+
+    std::vector<float> m_bins; // Накопленные значения ячеек
+};
+
+#endif // HEADER_GUARD_DETECTOR_HPP
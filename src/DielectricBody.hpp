@@ -0,0 +1,354 @@
+#ifndef HEADER_GUARD_DIELECTRIC_BODY_HPP
+#define HEADER_GUARD_DIELECTRIC_BODY_HPP
+
+#include "OpticalElement.hpp"
+#include "EdgeBVH.hpp"
+
+// Преломляющее тело (призма, пластина) в виде замкнутого многоугольника.
+// На рёбрах применяется закон Снеллиуса, при невозможности преломления - полное внутреннее отражение.
+// Пересечения ищутся по иерархии рёбер (EdgeBVH), поэтому тела из сотен рёбер обходятся за O(log E)
+class DielectricBody : public OpticalElement
+{
+public:
+    sf::Vector2f center;                       // Центр тела
+    float radius;                              // Масштаб: радиус описанной окружности
+    float angle;                               // Угол поворота (в радианах)
+    float refractiveIndex;                     // Показатель преломления на опорной длине волны
+    Spectral::Dispersion dispersion;           // Модель дисперсии (по умолчанию без дисперсии)
+    sf::Color color;                           // Цвет тела
+    mutable sf::Text indexText;                // Текст "n = ..."
+    mutable sf::Font const *fontPtr = nullptr; // Указатель на шрифт
+
+    // shape - вершины многоугольника в локальных координатах (масштаб 1, центр в начале координат)
+    DielectricBody(sf::Vector2f c, float r, float a, std::vector<sf::Vector2f> shape, float n = 1.5f, sf::Color col = sf::Color(120, 200, 255))
+        : center(c), radius(std::max(1.f, r)), angle(a), refractiveIndex(std::max(1.f, n)), color(col), m_shape(std::move(shape))
+    {
+        rebuildGeometry();
+        setupText();
+    }
+
+    // Правильный многоугольник (треугольная призма при sides = 3)
+    static std::vector<sf::Vector2f> regularPolygon(int sides)
+    {
+        std::vector<sf::Vector2f> shape;
+        sides = std::max(3, sides);
+        for (int i = 0; i < sides; ++i)
+        {
+            float a = 2.f * static_cast<float>(M_PI) * i / sides - static_cast<float>(M_PI) / 2.f;
+            shape.emplace_back(std::cos(a), std::sin(a));
+        }
+        return shape;
+    }
+
+    // Плоскопараллельная пластина с соотношением сторон 3:1
+    static std::vector<sf::Vector2f> slab()
+    {
+        const float h = 1.f / 3.f;
+        return {{-1.f, -h}, {1.f, -h}, {1.f, h}, {-1.f, h}};
+    }
+
+    void setupText() const
+    {
+        indexText.setCharacterSize(14);
+        indexText.setFillColor(sf::Color::White);
+        updateParameterString();
+    }
+
+    Type getType() const override { return Type::DIELECTRIC; }
+    std::unique_ptr<OpticalElement> clone() const override { return std::make_unique<DielectricBody>(*this); }
+
+    const std::vector<sf::Vector2f> &getVertices() const { return m_vertices; }
+    // Вершины в локальных координатах (масштаб 1, без поворота)
+    const std::vector<sf::Vector2f> &getShape() const { return m_shape; }
+
+    // Показатель преломления для длины волны: дисперсия добавляется к заданному значению
+    float refractiveIndexAt(float wavelength) const
+    {
+        if (!dispersion.isDispersive())
+            return refractiveIndex;
+        return refractiveIndex + dispersion.refractiveIndex(wavelength) - dispersion.refractiveIndex(Spectral::REFERENCE_WAVELENGTH);
+    }
+
+    bool isDispersive() const override { return dispersion.isDispersive(); }
+
+    VectorMath::IntersectionResult findIntersection(const Ray &ray) const override
+    {
+        int edge = -1;
+        return m_bvh.intersect(ray.origin, ray.direction, edge);
+    }
+
+    RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const override
+    {
+        // Точка попадания лежит на ребре с точностью округления: допуск растёт с размером тела
+        int edge = m_bvh.nearestEdge(intersectionPoint, std::max(EPSILON * 10.f, radius * EDGE_SNAP_TOLERANCE));
+        if (edge < 0)
+            return RayAction();
+
+        // Внешняя нормаль ребра; по ней определяется, входит луч в тело или выходит
+        sf::Vector2f outward = edgeOutwardNormal(edge);
+        const sf::Vector2f &d = incomingRay.direction;
+        bool entering = VectorMath::dot(d, outward) < 0.f;
+        float nBody = refractiveIndexAt(incomingRay.wavelength);
+        float eta = entering ? 1.f / nBody : nBody;
+        sf::Vector2f normal = entering ? outward : -outward; // Нормаль навстречу лучу
+
+        float cosI = -VectorMath::dot(d, normal);
+        float k = 1.f - eta * eta * (1.f - cosI * cosI);
+
+        // Отражённый луч остаётся в той же среде
+        Ray reflectedRay = incomingRay;
+        reflectedRay.bounces_left = incomingRay.bounces_left - 1;
+        reflectedRay.direction = VectorMath::reflect(d, normal);
+        reflectedRay.origin = intersectionPoint + reflectedRay.direction * EPSILON * 10.f;
+        if (k < 0.f)
+        {
+            // Полное внутреннее отражение
+            return RayAction(intersectionPoint, reflectedRay);
+        }
+
+        Ray refractedRay = reflectedRay;
+        float cosT = std::sqrt(k);
+        refractedRay.direction = VectorMath::normalize(eta * d + (eta * cosI - cosT) * normal);
+        refractedRay.origin = intersectionPoint + refractedRay.direction * EPSILON * 10.f;
+        refractedRay.medium = entering ? this : nullptr;
+
+        // Энергия делится по формулам Френеля: преломлённый луч - основная ветвь, отражённый - дочерняя
+        float reflectance = fresnelReflectance(cosI, cosT, eta);
+        refractedRay.intensity = incomingRay.intensity * (1.f - reflectance);
+        reflectedRay.intensity = incomingRay.intensity * reflectance;
+        return RayAction(intersectionPoint, refractedRay, reflectedRay);
+    }
+
+    // Коэффициент отражения неполяризованного света; eta = n1 / n2
+    static float fresnelReflectance(float cosI, float cosT, float eta)
+    {
+        float rs = (eta * cosI - cosT) / (eta * cosI + cosT);
+        float rp = (cosI - eta * cosT) / (cosI + eta * cosT);
+        return std::clamp(0.5f * (rs * rs + rp * rp), 0.f, 1.f);
+    }
+
+    // Проверка, лежит ли точка внутри многоугольника (правило чётности пересечений)
+    bool containsPoint(const sf::Vector2f &point) const
+    {
+        bool inside = false;
+        for (size_t i = 0, j = m_vertices.size() - 1; i < m_vertices.size(); j = i++)
+        {
+            const sf::Vector2f &a = m_vertices[i];
+            const sf::Vector2f &b = m_vertices[j];
+            if ((a.y > point.y) != (b.y > point.y) && point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x)
+                inside = !inside;
+        }
+        return inside;
+    }
+
+    bool isPointNear(const sf::Vector2f &point, float tolerance = 5.0f) const override
+    {
+        return containsPoint(point) || m_bvh.nearestEdge(point, tolerance) >= 0;
+    }
+    void move(const sf::Vector2f &delta) override
+    {
+        center += delta;
+        rebuildGeometry();
+        updateParameterString();
+    }
+    sf::Vector2f getCenter() const override
+    {
+        return center;
+    }
+    sf::FloatRect getBounds() const override
+    {
+        return m_bounds;
+    }
+
+    // Ручки: центр (0) и первая вершина (1) - масштаб и поворот
+    std::vector<sf::Vector2f> getHandles() const override
+    {
+        return {center, m_vertices.front()};
+    }
+    int getHandleAtPoint(const sf::Vector2f &point, float tolerance = 8.0f) const override
+    {
+        if (VectorMath::distance(point, m_vertices.front()) <= tolerance)
+            return 1;
+        if (VectorMath::distance(point, center) <= tolerance)
+            return 0;
+        if (isPointNear(point, tolerance))
+            return 0;
+        return -1;
+    }
+    void setHandlePosition(int handleIndex, sf::Vector2f newPos, const sf::Vector2f &lastPos) override
+    {
+        if (handleIndex == 0)
+        {
+            move(newPos - lastPos);
+        }
+        else if (handleIndex == 1)
+        {
+            sf::Vector2f delta = newPos - center;
+            const sf::Vector2f &local = m_shape.front();
+            radius = std::max(1.f, VectorMath::length(delta) / std::max(VectorMath::length(local), EPSILON));
+            angle = std::atan2(delta.y, delta.x) - std::atan2(local.y, local.x);
+            rebuildGeometry();
+            updateParameterString();
+        }
+    }
+
+    void rotate(float angleDelta) override
+    {
+        angle += angleDelta;
+        rebuildGeometry();
+        updateParameterString();
+    }
+    void setAngle(float newAngle) override
+    {
+        angle = newAngle;
+        rebuildGeometry();
+        updateParameterString();
+    }
+    float getAngle() const override { return angle; }
+
+    // Изменение показателя преломления (шаг в тысячных долях от delta)
+    void adjustParameter(float delta) override
+    {
+        refractiveIndex = std::max(1.f, refractiveIndex + delta * 0.001f);
+        updateParameterString();
+    }
+
+    void cycleDispersion()
+    {
+        dispersion.cycle();
+        updateParameterString();
+    }
+
+    void updateParameterString() const
+    {
+        if (!fontPtr)
+            return;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2) << refractiveIndex;
+        std::string nStr = ss.str();
+        if (dispersion.isDispersive())
+        {
+            nStr += " (" + dispersion.name() + ")";
+        }
+        indexText.setString("n = " + nStr);
+        sf::Vector2f textPos = sf::Vector2f(center.x, m_bounds.top - 15.f);
+        indexText.setCharacterSize(14);
+        sf::FloatRect textBounds = indexText.getLocalBounds();
+        indexText.setOrigin(textBounds.left + textBounds.width / 2.0f, textBounds.top + textBounds.height / 2.0f);
+        indexText.setPosition(textPos);
+    }
+    std::string getParameterString() const override { return indexText.getString(); }
+    sf::FloatRect getParameterBounds() const override
+    {
+        if (!fontPtr)
+            return {};
+        return indexText.getGlobalBounds();
+    }
+
+    void setParameterFromString(const std::string &s) override
+    {
+        try
+        {
+            if (s.empty())
+            {
+                updateParameterString();
+                return;
+            }
+            refractiveIndex = std::max(1.f, std::stof(s));
+        }
+        catch (const std::invalid_argument &e)
+        {
+            std::cerr << "Invalid number format: '" << s << "'" << std::endl;
+        }
+        catch (const std::out_of_range &e)
+        {
+            std::cerr << "Number out of range: '" << s << "'" << std::endl;
+        }
+        updateParameterString();
+    }
+    void setFont(const sf::Font &font) const override
+    {
+        if (!fontPtr)
+        {
+            fontPtr = &font;
+            indexText.setFont(*fontPtr);
+            updateParameterString();
+        }
+    }
+    float getRefractiveIndex() const { return refractiveIndex; }
+
+    void draw(sf::RenderTarget &target) const override
+    {
+        sf::VertexArray fill(sf::TriangleFan, m_vertices.size() + 2);
+        sf::Color fillColor(color.r, color.g, color.b, 60);
+        fill[0] = sf::Vertex(center, fillColor);
+        for (size_t i = 0; i <= m_vertices.size(); ++i)
+            fill[i + 1] = sf::Vertex(m_vertices[i % m_vertices.size()], fillColor);
+        target.draw(fill);
+
+        sf::VertexArray outline(sf::LineStrip, m_vertices.size() + 1);
+        for (size_t i = 0; i <= m_vertices.size(); ++i)
+            outline[i] = sf::Vertex(m_vertices[i % m_vertices.size()], color);
+        target.draw(outline);
+    }
+    void drawHandles(sf::RenderTarget &target, sf::Color moveColor, sf::Color resizeColor) const override
+    {
+        sf::CircleShape handleShape(5.f);
+        handleShape.setOrigin(5.f, 5.f);
+        handleShape.setFillColor(moveColor);
+        handleShape.setPosition(center);
+        target.draw(handleShape);
+        handleShape.setFillColor(resizeColor);
+        handleShape.setPosition(m_vertices.front());
+        target.draw(handleShape);
+    }
+
+private:
+    static constexpr float EDGE_SNAP_TOLERANCE = 1e-3f; // Доля радиуса при поиске ребра в точке попадания
+
+    // Пересчёт мировых координат вершин, границ и иерархии рёбер после изменения геометрии
+    void rebuildGeometry()
+    {
+        if (m_shape.size() < 3)
+            m_shape = regularPolygon(3);
+        float s = std::sin(angle);
+        float c = std::cos(angle);
+        m_vertices.resize(m_shape.size());
+        float area = 0.f;
+        for (size_t i = 0; i < m_shape.size(); ++i)
+        {
+            const sf::Vector2f &p = m_shape[i];
+            m_vertices[i] = center + radius * sf::Vector2f(p.x * c - p.y * s, p.x * s + p.y * c);
+        }
+        float minX = m_vertices[0].x, maxX = minX, minY = m_vertices[0].y, maxY = minY;
+        for (size_t i = 0; i < m_vertices.size(); ++i)
+        {
+            const sf::Vector2f &a = m_vertices[i];
+            const sf::Vector2f &b = m_vertices[(i + 1) % m_vertices.size()];
+            area += a.x * b.y - b.x * a.y;
+            minX = std::min(minX, a.x);
+            maxX = std::max(maxX, a.x);
+            minY = std::min(minY, a.y);
+            maxY = std::max(maxY, a.y);
+        }
+        m_counterClockwise = area > 0.f;
+        m_bounds = sf::FloatRect(minX, minY, maxX - minX, maxY - minY);
+        m_bvh.build(m_vertices);
+    }
+
+    sf::Vector2f edgeOutwardNormal(int edge) const
+    {
+        sf::Vector2f e = m_bvh.edgeEnd(edge) - m_bvh.edgeStart(edge);
+        // При положительной ориентированной площади внешняя нормаль лежит справа от ребра
+        sf::Vector2f n = m_counterClockwise ? sf::Vector2f(e.y, -e.x) : sf::Vector2f(-e.y, e.x);
+        return VectorMath::normalize(n);
+    }
+
+    std::vector<sf::Vector2f> m_shape;    // Вершины в локальных координатах
+    std::vector<sf::Vector2f> m_vertices; // Вершины в мировых координатах
+    sf::FloatRect m_bounds;
+    bool m_counterClockwise = true;
+    EdgeBVH m_bvh;
+};
+
+#endif // HEADER_GUARD_DIELECTRIC_BODY_HPP
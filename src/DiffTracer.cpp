@@ -0,0 +1,233 @@
+#include "DiffTracer.hpp"
+
+#include <cmath>
+
+#include "ParallelFor.hpp"
+#include "Mirror.hpp"
+#include "BeamSplitter.hpp"
+#include "IdealLens.hpp"
+#include "SphericalMirror.hpp"
+#include "Detector.hpp"
+#include "PointSource.hpp"
+
+namespace
+{
+    const float DEGREE = static_cast<float>(M_PI) / 180.f;
+
+    bool isSegmentElement(OpticalElement::Type type)
+    {
+        return type == OpticalElement::Type::MIRROR || type == OpticalElement::Type::LENS ||
+               type == OpticalElement::Type::DETECTOR || type == OpticalElement::Type::BEAM_SPLITTER;
+    }
+}
+
+bool DiffTracer::supports(const OpticalElement &element, SweepParameter parameter)
+{
+    auto type = element.getType();
+    switch (parameter)
+    {
+    case SweepParameter::FOCAL_LENGTH:
+        return type == OpticalElement::Type::LENS;
+    case SweepParameter::RADIUS:
+        return type == OpticalElement::Type::SPHERICAL_MIRROR;
+    case SweepParameter::ANGLE:
+        return isSegmentElement(type) || type == OpticalElement::Type::SOURCE;
+    case SweepParameter::POSITION_X:
+    case SweepParameter::POSITION_Y:
+        return isSegmentElement(type) || type == OpticalElement::Type::SOURCE || type == OpticalElement::Type::SPHERICAL_MIRROR;
+    case SweepParameter::NUM_RAYS:
+        return false;
+    }
+    return false;
+}
+
+bool DiffTracer::trace(const std::vector<const OpticalElement *> &elements, const std::vector<Parameter> &parameters, std::vector<RayResult> &rays) const
+{
+    rays.clear();
+    if (parameters.size() > static_cast<size_t>(MAX_PARAMETERS))
+        return false;
+    for (const Parameter &p : parameters)
+    {
+        if (p.elementIndex >= elements.size() || !supports(*elements[p.elementIndex], p.parameter))
+            return false;
+    }
+
+    // Параметры всех элементов в дуальных числах; выбранные параметры - независимые переменные
+    std::vector<ElementState> states(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i)
+        states[i] = elementState(elements, i, parameters);
+
+    // Первичные лучи всех источников
+    std::vector<Ray> primaryRays;
+    std::vector<size_t> raySources;
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        if (const auto *source = dynamic_cast<const PointSource *>(elements[i]))
+        {
+            std::vector<Ray> emitted = source->emitRays();
+            primaryRays.insert(primaryRays.end(), emitted.begin(), emitted.end());
+            raySources.insert(raySources.end(), emitted.size(), i);
+        }
+    }
+
+    rays.resize(primaryRays.size());
+    Parallel::forEachChunk(primaryRays.size(), [&](size_t begin, size_t end, unsigned)
+    {
+        for (size_t r = begin; r < end; ++r)
+            traceRay(primaryRays[r], elements, states, &states[raySources[r]], rays[r]);
+    });
+    return true;
+}
+
+DiffTracer::ElementState DiffTracer::elementState(const std::vector<const OpticalElement *> &elements, size_t index,
+                                                  const std::vector<Parameter> &parameters)
+{
+    const OpticalElement *element = elements[index];
+    ElementState state;
+    state.center = Vec(element->getCenter());
+    if (const auto *source = dynamic_cast<const PointSource *>(element))
+        state.angle = Scalar(source->startAngle);
+    else
+        state.angle = Scalar(element->getAngle());
+    if (const auto *lens = dynamic_cast<const IdealLens *>(element))
+        state.focalLength = Scalar(lens->focalLength);
+    if (const auto *mirror = dynamic_cast<const SphericalMirror *>(element))
+        state.radius = Scalar(mirror->radius);
+    for (size_t k = 0; k < parameters.size() && k < static_cast<size_t>(MAX_PARAMETERS); ++k)
+    {
+        if (parameters[k].elementIndex != index)
+            continue;
+        int variable = static_cast<int>(k);
+        switch (parameters[k].parameter)
+        {
+        case SweepParameter::POSITION_X: state.center.x.d[variable] = 1.f; break;
+        case SweepParameter::POSITION_Y: state.center.y.d[variable] = 1.f; break;
+        case SweepParameter::ANGLE: state.angle.d[variable] = DEGREE; break;
+        case SweepParameter::FOCAL_LENGTH: state.focalLength.d[variable] = 1.f; break;
+        case SweepParameter::RADIUS: state.radius.d[variable] = 1.f; break;
+        case SweepParameter::NUM_RAYS: break;
+        }
+    }
+    return state;
+}
+
+void DiffTracer::traceRay(const Ray &primary, const std::vector<const OpticalElement *> &elements, const std::vector<ElementState> &states,
+                          const ElementState *sourceState, RayResult &out) const
+{
+    // Исходная точка и направление зависят от положения и поворота источника
+    Vec origin = sourceState->center;
+    Scalar angleOffset = sourceState->angle - sourceState->angle.v;
+    Vec direction = VectorMath::direction(Scalar(std::atan2(primary.direction.y, primary.direction.x)) + angleOffset);
+
+    Ray ray = primary;
+    while (ray.bounces_left > 0)
+    {
+        // Элемент выбирается обычной трассировкой
+        size_t hitIndex = elements.size();
+        VectorMath::IntersectionResult hit;
+        hit.distance = m_maxRayLength;
+        for (size_t i = 0; i < elements.size(); ++i)
+        {
+            if (elements[i]->getType() == OpticalElement::Type::SOURCE)
+                continue;
+            VectorMath::IntersectionResult candidate = elements[i]->findIntersection(ray);
+            if (candidate.intersects && candidate.distance > EPSILON && candidate.distance < hit.distance)
+            {
+                hit = candidate;
+                hitIndex = i;
+            }
+        }
+        if (hitIndex == elements.size())
+            break;
+
+        const OpticalElement *element = elements[hitIndex];
+        const ElementState &state = states[hitIndex];
+        auto type = element->getType();
+
+        // Расстояние до точки попадания в дуальных числах
+        Scalar t(hit.distance);
+        if (isSegmentElement(type))
+        {
+            t = VectorMath::rayLineDistance(origin, direction, state.center, VectorMath::direction(state.angle));
+        }
+        else if (type == OpticalElement::Type::SPHERICAL_MIRROR)
+        {
+            VectorMath::CircleIntersection roots = VectorMath::rayCircleIntersection(ray.origin, ray.direction, element->getCenter(), std::abs(state.radius.v));
+            int root = std::abs(roots.t[0] - hit.distance) <= std::abs(roots.t[1] - hit.distance) ? 0 : 1;
+            t = VectorMath::rayCircleRoot(origin, direction, state.center, abs(state.radius), root);
+        }
+        else
+        {
+            out.differentiable = false;
+        }
+        Vec point = origin + direction * t;
+        out.hitPoints.push_back(point);
+        out.hitElements.push_back(hitIndex);
+
+        RayAction action = element->interact(ray, hit.point);
+        if (!action.outgoingRay.has_value())
+            break;
+        const Ray &outgoing = action.outgoingRay.value();
+
+        // Новое направление по той же формуле, что и в interact
+        if (type == OpticalElement::Type::MIRROR)
+        {
+            direction = Mirror::reflectDirection(direction, state.angle);
+        }
+        else if (type == OpticalElement::Type::BEAM_SPLITTER)
+        {
+            // Основная ветвь делителя - прошедший луч, если он есть
+            if (static_cast<const BeamSplitter *>(element)->getReflectancePercent() >= 100)
+                direction = Mirror::reflectDirection(direction, state.angle);
+        }
+        else if (type == OpticalElement::Type::LENS)
+        {
+            const auto *lens = static_cast<const IdealLens *>(element);
+            Scalar f = state.focalLength / lens->dispersion.powerScale(ray.wavelength);
+            direction = IdealLens::refractDirection(direction, point, state.center, state.angle, f);
+        }
+        else if (type == OpticalElement::Type::SPHERICAL_MIRROR)
+        {
+            direction = SphericalMirror::reflectDirection(direction, point, state.center);
+        }
+        else
+        {
+            out.differentiable = false;
+            direction = Vec(outgoing.direction);
+        }
+        origin = point + direction * (EPSILON * 10.f);
+        ray = outgoing;
+    }
+    out.direction = direction;
+}
+
+bool DiffTracer::spotOnDetector(const std::vector<RayResult> &rays, const std::vector<const OpticalElement *> &elements,
+                                const std::vector<Parameter> &parameters, size_t detectorElement, Scalar &center, Scalar &rms)
+{
+    const auto *detector = dynamic_cast<const Detector *>(elements[detectorElement]);
+    if (!detector)
+        return false;
+    // Положение попадания вдоль детектора; начало и ось детектора зависят от его собственных параметров
+    ElementState state = elementState(elements, detectorElement, parameters);
+    Vec axis = VectorMath::direction(state.angle);
+    Vec start = state.center - axis * (detector->length / 2.f);
+    Scalar sum, sumSq;
+    size_t count = 0;
+    for (const RayResult &ray : rays)
+    {
+        // Лучи без производных исказили бы суммы: их вклад считался бы независимым от параметров
+        if (!ray.differentiable || ray.hitElements.empty() || ray.hitElements.back() != detectorElement)
+            continue;
+        Scalar u = VectorMath::dot(ray.hitPoints.back() - start, axis);
+        sum += u;
+        sumSq += u * u;
+        ++count;
+    }
+    if (count == 0)
+        return false;
+    float inv = 1.f / static_cast<float>(count);
+    center = sum * inv;
+    Scalar variance = sumSq * inv - center * center;
+    rms = variance.v > 0.f ? sqrt(variance) : Scalar();
+    return true;
+}
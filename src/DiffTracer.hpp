@@ -0,0 +1,73 @@
+#ifndef HEADER_GUARD_DIFF_TRACER_HPP
+#define HEADER_GUARD_DIFF_TRACER_HPP
+
+#include <vector>
+#include <cstddef>
+
+#include "Constants.hpp"
+#include "Dual.hpp"
+#include "OpticalElement.hpp"
+#include "ParameterSweep.hpp"
+
+class Detector;
+
+// Дифференцируемая трассировка: производные точек попадания и итогового направления
+// каждого луча по выбранным параметрам элементов за один проход (прямое автодифференцирование).
+// Выбор элемента, в который попадает луч, делается обычной трассировкой, а точка попадания
+// и новое направление пересчитываются в дуальных числах по тем же формулам (Mirror, IdealLens,
+// SphericalMirror, BeamSplitter, Detector). Для остальных элементов производные не переносятся,
+// и луч помечается как недифференцируемый. Следуется основной ветви луча (без дочерних ветвей).
+class DiffTracer
+{
+public:
+    static const int MAX_PARAMETERS = 8;
+    using Scalar = Dual<MAX_PARAMETERS>;
+    using Vec = VectorMath::Vec2T<Scalar>;
+
+    // Параметр, по которому берутся производные (единицы - как у SweepParameter: поворот в градусах)
+    struct Parameter
+    {
+        size_t elementIndex = 0;
+        SweepParameter parameter = SweepParameter::ANGLE;
+    };
+
+    // Путь одного первичного луча
+    struct RayResult
+    {
+        std::vector<Vec> hitPoints;         // Точки взаимодействия с производными
+        std::vector<size_t> hitElements;    // Номера элементов, в которые попал луч
+        Vec direction;                      // Итоговое направление
+        bool differentiable = true;         // false - путь прошёл через элемент без дифференцируемой модели
+    };
+
+    explicit DiffTracer(float maxRayLength = AppConstants::MAX_RAY_LENGTH) : m_maxRayLength(maxRayLength) {}
+
+    static bool supports(const OpticalElement &element, SweepParameter parameter);
+
+    // false, если параметров больше MAX_PARAMETERS или параметр не поддерживается
+    bool trace(const std::vector<const OpticalElement *> &elements, const std::vector<Parameter> &parameters, std::vector<RayResult> &rays) const;
+
+    // Центр и среднеквадратичный размер пятна на детекторе с производными по тем же parameters,
+    // что и в trace (в том числе по положению и углу самого детектора). Учитываются дифференцируемые
+    // лучи, закончившиеся на этом детекторе. false, если таких попаданий нет
+    static bool spotOnDetector(const std::vector<RayResult> &rays, const std::vector<const OpticalElement *> &elements,
+                               const std::vector<Parameter> &parameters, size_t detectorElement, Scalar &center, Scalar &rms);
+
+private:
+    // Параметры элемента в дуальных числах (для незадействованных - константы)
+    struct ElementState
+    {
+        Vec center;
+        Scalar angle;
+        Scalar focalLength;
+        Scalar radius;
+    };
+
+    static ElementState elementState(const std::vector<const OpticalElement *> &elements, size_t index, const std::vector<Parameter> &parameters);
+    void traceRay(const Ray &ray, const std::vector<const OpticalElement *> &elements, const std::vector<ElementState> &states,
+                  const ElementState *sourceState, RayResult &out) const;
+
+    float m_maxRayLength;
+};
+
+#endif // HEADER_GUARD_DIFF_TRACER_HPP
@@ -0,0 +1,120 @@
+#ifndef HEADER_GUARD_DUAL_HPP
+#define HEADER_GUARD_DUAL_HPP
+
+#include <array>
+#include <cmath>
+
+// Дуальное число для прямого автоматического дифференцирования:
+// значение v и производные d[i] по N независимым параметрам.
+// Одно вычисление с Dual<N> даёт значение и все N частных производных сразу.
+template <int N>
+struct Dual
+{
+    float v = 0.f;
+    std::array<float, N> d{};
+
+    Dual() = default;
+    Dual(float value) : v(value) {} // Константа: производные нулевые
+
+    // Независимая переменная с номером index
+    static Dual variable(float value, int index)
+    {
+        Dual r(value);
+        r.d[index] = 1.f;
+        return r;
+    }
+
+    Dual &operator+=(const Dual &b)
+    {
+        v += b.v;
+        for (int i = 0; i < N; ++i)
+            d[i] += b.d[i];
+        return *this;
+    }
+    Dual &operator-=(const Dual &b)
+    {
+        v -= b.v;
+        for (int i = 0; i < N; ++i)
+            d[i] -= b.d[i];
+        return *this;
+    }
+    Dual &operator*=(const Dual &b)
+    {
+        for (int i = 0; i < N; ++i)
+            d[i] = d[i] * b.v + v * b.d[i];
+        v *= b.v;
+        return *this;
+    }
+    Dual &operator/=(const Dual &b)
+    {
+        float inv = 1.f / b.v;
+        for (int i = 0; i < N; ++i)
+            d[i] = (d[i] - v * inv * b.d[i]) * inv;
+        v *= inv;
+        return *this;
+    }
+};
+
+template <int N> inline Dual<N> operator+(Dual<N> a, const Dual<N> &b) { return a += b; }
+template <int N> inline Dual<N> operator-(Dual<N> a, const Dual<N> &b) { return a -= b; }
+template <int N> inline Dual<N> operator*(Dual<N> a, const Dual<N> &b) { return a *= b; }
+template <int N> inline Dual<N> operator/(Dual<N> a, const Dual<N> &b) { return a /= b; }
+template <int N> inline Dual<N> operator+(Dual<N> a, float b) { a.v += b; return a; }
+template <int N> inline Dual<N> operator+(float a, Dual<N> b) { b.v += a; return b; }
+template <int N> inline Dual<N> operator-(Dual<N> a, float b) { a.v -= b; return a; }
+template <int N> inline Dual<N> operator-(float a, const Dual<N> &b) { return Dual<N>(a) - b; }
+template <int N> inline Dual<N> operator*(Dual<N> a, float b)
+{
+    a.v *= b;
+    for (int i = 0; i < N; ++i)
+        a.d[i] *= b;
+    return a;
+}
+template <int N> inline Dual<N> operator*(float a, const Dual<N> &b) { return b * a; }
+template <int N> inline Dual<N> operator/(const Dual<N> &a, float b) { return a * (1.f / b); }
+template <int N> inline Dual<N> operator/(float a, const Dual<N> &b) { return Dual<N>(a) / b; }
+template <int N> inline Dual<N> operator-(const Dual<N> &a) { return a * -1.f; }
+
+// Сравнения - по значению (ветвления не дифференцируются)
+template <int N> inline bool operator<(const Dual<N> &a, const Dual<N> &b) { return a.v < b.v; }
+template <int N> inline bool operator>(const Dual<N> &a, const Dual<N> &b) { return a.v > b.v; }
+
+// Производная сложной функции: f(a) и f'(a)
+template <int N>
+inline Dual<N> chain(const Dual<N> &a, float value, float derivative)
+{
+    Dual<N> r(value);
+    for (int i = 0; i < N; ++i)
+        r.d[i] = a.d[i] * derivative;
+    return r;
+}
+
+template <int N> inline float scalarValue(const Dual<N> &a) { return a.v; }
+
+template <int N> inline Dual<N> sqrt(const Dual<N> &a)
+{
+    float s = std::sqrt(a.v);
+    return chain(a, s, s > 0.f ? 0.5f / s : 0.f);
+}
+template <int N> inline Dual<N> sin(const Dual<N> &a) { return chain(a, std::sin(a.v), std::cos(a.v)); }
+template <int N> inline Dual<N> cos(const Dual<N> &a) { return chain(a, std::cos(a.v), -std::sin(a.v)); }
+template <int N> inline Dual<N> tan(const Dual<N> &a)
+{
+    float t = std::tan(a.v);
+    return chain(a, t, 1.f + t * t);
+}
+template <int N> inline Dual<N> atan(const Dual<N> &a) { return chain(a, std::atan(a.v), 1.f / (1.f + a.v * a.v)); }
+template <int N> inline Dual<N> abs(const Dual<N> &a) { return a.v < 0.f ? -a : a; }
+template <int N> inline Dual<N> atan2(const Dual<N> &y, const Dual<N> &x)
+{
+    float r2 = x.v * x.v + y.v * y.v;
+    Dual<N> r(std::atan2(y.v, x.v));
+    if (r2 > 0.f)
+    {
+        for (int i = 0; i < N; ++i)
+            r.d[i] = (x.v * y.d[i] - y.v * x.d[i]) / r2;
+    }
+    return r;
+}
+
+#endif // HEADER_GUARD_DUAL_HPP
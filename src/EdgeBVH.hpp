@@ -0,0 +1,201 @@
+#ifndef HEADER_GUARD_EDGE_BVH_HPP
+#define HEADER_GUARD_EDGE_BVH_HPP
+
+#include <SFML/System/Vector2.hpp>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "VectorMath.hpp"
+
+// Иерархия ограничивающих прямоугольников по рёбрам замкнутого многоугольника.
+// Поиск пересечения луча с телом из E рёбер стоит O(log E)
+class EdgeBVH
+{
+public:
+    // Глубина дерева; при разбиении по медиане она не превышает log2(E) + 1,
+    // поэтому стек обхода фиксированного размера не переполняется
+    static const int MAX_DEPTH = 48;
+
+    // Построение по вершинам многоугольника (ребро i соединяет вершины i и i+1)
+    void build(const std::vector<sf::Vector2f> &vertices)
+    {
+        m_vertices = vertices;
+        m_nodes.clear();
+        m_edges.resize(m_vertices.size());
+        for (size_t i = 0; i < m_edges.size(); ++i)
+            m_edges[i] = static_cast<int>(i);
+        if (!m_edges.empty())
+        {
+            m_nodes.reserve(2 * m_edges.size());
+            buildNode(0, static_cast<int>(m_edges.size()), 0);
+        }
+    }
+
+    // Ближайшее пересечение луча с рёбрами; edgeIndex получает номер ребра
+    VectorMath::IntersectionResult intersect(const sf::Vector2f &origin, const sf::Vector2f &dir, int &edgeIndex) const
+    {
+        VectorMath::IntersectionResult best;
+        edgeIndex = -1;
+        if (m_nodes.empty())
+            return best;
+
+        const float invX = std::abs(dir.x) > EPSILON ? 1.f / dir.x : std::numeric_limits<float>::max();
+        const float invY = std::abs(dir.y) > EPSILON ? 1.f / dir.y : std::numeric_limits<float>::max();
+        int stack[MAX_DEPTH + 2];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node &node = m_nodes[stack[--top]];
+            if (!rayHitsBox(node, origin, invX, invY, best.distance))
+                continue;
+            if (node.count > 0)
+            {
+                for (int i = node.first; i < node.first + node.count; ++i)
+                {
+                    int e = m_edges[i];
+                    VectorMath::IntersectionResult hit = VectorMath::raySegmentIntersection(origin, dir, edgeStart(e), edgeEnd(e));
+                    if (hit.intersects && hit.distance < best.distance)
+                    {
+                        best = hit;
+                        edgeIndex = e;
+                    }
+                }
+            }
+            else
+            {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+        return best;
+    }
+
+    // Ребро, ближайшее к точке (для определения нормали в точке попадания)
+    int nearestEdge(const sf::Vector2f &point, float tolerance) const
+    {
+        int bestEdge = -1;
+        float bestDist = tolerance;
+        if (m_nodes.empty())
+            return bestEdge;
+        int stack[MAX_DEPTH + 2];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node &node = m_nodes[stack[--top]];
+            if (point.x < node.minX - bestDist || point.x > node.maxX + bestDist ||
+                point.y < node.minY - bestDist || point.y > node.maxY + bestDist)
+                continue;
+            if (node.count > 0)
+            {
+                for (int i = node.first; i < node.first + node.count; ++i)
+                {
+                    int e = m_edges[i];
+                    float d = VectorMath::distancePointSegment(point, edgeStart(e), edgeEnd(e));
+                    if (d <= bestDist)
+                    {
+                        bestDist = d;
+                        bestEdge = e;
+                    }
+                }
+            }
+            else
+            {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+        return bestEdge;
+    }
+
+    const sf::Vector2f &edgeStart(int e) const { return m_vertices[e]; }
+    const sf::Vector2f &edgeEnd(int e) const { return m_vertices[(static_cast<size_t>(e) + 1) % m_vertices.size()]; }
+
+private:
+    static const int LEAF_SIZE = 4;
+
+    struct Node
+    {
+        float minX, minY, maxX, maxY;
+        int left = -1, right = -1; // Дочерние узлы (для внутренних узлов)
+        int first = 0, count = 0;  // Диапазон рёбер в m_edges (для листьев)
+    };
+
+    int buildNode(int first, int count, int depth)
+    {
+        assert(depth < MAX_DEPTH && "EdgeBVH: глубина дерева превышает размер стека обхода");
+        int index = static_cast<int>(m_nodes.size());
+        m_nodes.emplace_back();
+        Node node;
+        node.minX = node.minY = std::numeric_limits<float>::max();
+        node.maxX = node.maxY = -std::numeric_limits<float>::max();
+        for (int i = first; i < first + count; ++i)
+        {
+            const sf::Vector2f &a = edgeStart(m_edges[i]);
+            const sf::Vector2f &b = edgeEnd(m_edges[i]);
+            node.minX = std::min({node.minX, a.x, b.x});
+            node.minY = std::min({node.minY, a.y, b.y});
+            node.maxX = std::max({node.maxX, a.x, b.x});
+            node.maxY = std::max({node.maxY, a.y, b.y});
+        }
+
+        if (count <= LEAF_SIZE)
+        {
+            node.first = first;
+            node.count = count;
+            m_nodes[index] = node;
+            return index;
+        }
+
+        // Разбиение по медиане центров рёбер вдоль длинной стороны
+        bool splitX = (node.maxX - node.minX) >= (node.maxY - node.minY);
+        int mid = first + count / 2;
+        std::nth_element(m_edges.begin() + first, m_edges.begin() + mid, m_edges.begin() + first + count,
+                         [&](int a, int b)
+                         {
+                             sf::Vector2f ca = edgeStart(a) + edgeEnd(a);
+                             sf::Vector2f cb = edgeStart(b) + edgeEnd(b);
+                             return splitX ? ca.x < cb.x : ca.y < cb.y;
+                         });
+        node.left = buildNode(first, mid - first, depth + 1);
+        node.right = buildNode(mid, first + count - mid, depth + 1);
+        m_nodes[index] = node;
+        return index;
+    }
+
+    static bool rayHitsBox(const Node &node, const sf::Vector2f &origin, float invX, float invY, float maxDist)
+    {
+        const float pad = EPSILON * 10.f;
+        float tx1 = (node.minX - pad - origin.x) * invX;
+        float tx2 = (node.maxX + pad - origin.x) * invX;
+        float ty1 = (node.minY - pad - origin.y) * invY;
+        float ty2 = (node.maxY + pad - origin.y) * invY;
+        // Луч параллелен оси: проверяем, лежит ли начало в полосе
+        if (invX == std::numeric_limits<float>::max())
+        {
+            if (origin.x < node.minX - pad || origin.x > node.maxX + pad)
+                return false;
+            tx1 = -std::numeric_limits<float>::max();
+            tx2 = std::numeric_limits<float>::max();
+        }
+        if (invY == std::numeric_limits<float>::max())
+        {
+            if (origin.y < node.minY - pad || origin.y > node.maxY + pad)
+                return false;
+            ty1 = -std::numeric_limits<float>::max();
+            ty2 = std::numeric_limits<float>::max();
+        }
+        float tmin = std::max(std::min(tx1, tx2), std::min(ty1, ty2));
+        float tmax = std::min(std::max(tx1, tx2), std::max(ty1, ty2));
+        return tmax >= std::max(tmin, 0.f) && tmin <= maxDist;
+    }
+
+    std::vector<sf::Vector2f> m_vertices;
+    std::vector<Node> m_nodes;
+    std::vector<int> m_edges;
+};
+
+#endif // HEADER_GUARD_EDGE_BVH_HPP
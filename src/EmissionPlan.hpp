@@ -0,0 +1,169 @@
+#ifndef HEADER_GUARD_EMISSION_PLAN_HPP
+#define HEADER_GUARD_EMISSION_PLAN_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "PointSource.hpp"
+#include "Random.hpp"
+
+// Выборка направлений источника по значимости. Сектор испускания делится на углы, под которыми
+// из источника видны элементы сцены (по их ограничивающим прямоугольникам), и пустые направления.
+// Основная часть лучей равномерно распределяется по видимым углам, пустые направления
+// представлены несколькими лучами. Вес луча - отношение его доли сектора к доле луча
+// равномерного веера, поэтому сумма весов равна числу лучей, а оценки детекторов не смещены.
+class EmissionPlan
+{
+public:
+    // План для источника; неактивен, если выборка по значимости не сгущает лучи
+    static EmissionPlan build(const PointSource &source, const OpticalElement *const *elements, size_t count, int emptyRays)
+    {
+        EmissionPlan plan;
+        const int total = source.getNumRays();
+        const float span = source.spanAngle;
+        if (total <= 0 || span <= EPSILON)
+            return plan;
+
+        // Углы видимых элементов в координатах сектора: t = angle - startAngle в [0, 2pi)
+        std::vector<std::pair<float, float>> covered;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const OpticalElement *el = elements[i];
+            if (!el || el->getType() == OpticalElement::Type::SOURCE)
+                continue;
+            float extentStart = 0.f, extentSpan = 0.f;
+            if (!VectorMath::angularExtent(source.position, el->getBounds(), ANGLE_MARGIN_DISTANCE, extentStart, extentSpan))
+                return plan; // Источник внутри элемента: видны все направления
+            const float fullTurn = static_cast<float>(2.0 * M_PI);
+            float start = VectorMath::normalizeAngle(extentStart - ANGLE_MARGIN - source.startAngle);
+            if (start < 0.f)
+                start += fullTurn;
+            float end = start + extentSpan + 2.f * ANGLE_MARGIN;
+            addClipped(covered, start, end, span);
+            if (end > fullTurn)
+                addClipped(covered, 0.f, end - fullTurn, span);
+        }
+        if (covered.empty())
+            return plan;
+
+        // Слияние пересекающихся интервалов и пустые промежутки между ними
+        std::sort(covered.begin(), covered.end());
+        float position = 0.f;
+        for (const auto &interval : covered)
+        {
+            if (!plan.m_covered.empty() && interval.first <= position)
+            {
+                position = std::max(position, interval.second);
+                plan.m_covered.back().second = position;
+                continue;
+            }
+            if (interval.first > position)
+                plan.m_empty.push_back({position, interval.first});
+            plan.m_covered.push_back(interval);
+            position = interval.second;
+        }
+        if (position < span)
+            plan.m_empty.push_back({position, span});
+        plan.m_coveredPrefix = prefixSums(plan.m_covered);
+        plan.m_emptyPrefix = prefixSums(plan.m_empty);
+        plan.m_coveredMeasure = plan.m_coveredPrefix.back();
+        plan.m_emptyMeasure = std::max(0.f, span - plan.m_coveredMeasure);
+
+        plan.m_emptyRays = plan.m_emptyMeasure > EPSILON ? std::clamp(emptyRays, 1, total) : 0;
+        plan.m_coveredRays = total - plan.m_emptyRays;
+        // Видимые углы должны получить больше лучей, чем при равномерном веере
+        if (plan.m_coveredRays <= 0 || plan.m_coveredMeasure / span >= static_cast<float>(plan.m_coveredRays) / total)
+            return EmissionPlan();
+
+        const float uniformShare = span / total;
+        plan.m_coveredWeight = plan.m_coveredMeasure / plan.m_coveredRays / uniformShare;
+        plan.m_emptyWeight = plan.m_emptyRays > 0 ? plan.m_emptyMeasure / plan.m_emptyRays / uniformShare : 0.f;
+        plan.m_active = true;
+        return plan;
+    }
+
+    bool isActive() const { return m_active; }
+    // Доля сектора, под которой видны элементы
+    float coveredMeasure() const { return m_coveredMeasure; }
+
+    // Вес луча с номером index (первые лучи - видимые углы, последние - пустые направления)
+    float weight(size_t index) const
+    {
+        return index < static_cast<size_t>(m_coveredRays) ? m_coveredWeight : m_emptyWeight;
+    }
+
+    // Луч детерминированного веера: середины равных долей видимых углов и пустых направлений
+    Ray ray(const PointSource &source, size_t index) const
+    {
+        return rayAtFraction(source, index, 0.5f);
+    }
+
+    // Луч стохастического режима: равномерная выборка внутри своей группы направлений
+    Ray sampleRay(const PointSource &source, uint64_t streamKey, size_t index) const
+    {
+        return rayAtFraction(source, index, Random::uniformFloat(streamKey, index));
+    }
+
+private:
+    static constexpr float ANGLE_MARGIN = 2e-3f;          // Запас видимых углов, радиан
+    static constexpr float ANGLE_MARGIN_DISTANCE = 1.f;   // Запас прямоугольника при проверке источника внутри элемента
+
+    static void addClipped(std::vector<std::pair<float, float>> &intervals, float start, float end, float span)
+    {
+        end = std::min(end, span);
+        if (end > start)
+            intervals.push_back({start, end});
+    }
+
+    // Суммы длин интервалов нарастающим итогом: prefix[i] - доля сектора до конца интервала i
+    static std::vector<float> prefixSums(const std::vector<std::pair<float, float>> &intervals)
+    {
+        std::vector<float> prefix;
+        prefix.reserve(intervals.size());
+        float sum = 0.f;
+        for (const auto &interval : intervals)
+        {
+            sum += interval.second - interval.first;
+            prefix.push_back(sum);
+        }
+        return prefix;
+    }
+
+    // Угол с долей measure по набору интервалов (двоичный поиск по суммам длин)
+    static float angleAt(const std::vector<std::pair<float, float>> &intervals, const std::vector<float> &prefix, float measure)
+    {
+        size_t i = static_cast<size_t>(std::upper_bound(prefix.begin(), prefix.end(), measure) - prefix.begin());
+        if (i >= intervals.size())
+            return intervals.back().second;
+        float before = i > 0 ? prefix[i - 1] : 0.f;
+        return std::min(intervals[i].first + (measure - before), intervals[i].second);
+    }
+
+    Ray rayAtFraction(const PointSource &source, size_t index, float fraction) const
+    {
+        bool empty = index >= static_cast<size_t>(m_coveredRays);
+        size_t slot = empty ? index - m_coveredRays : index;
+        int count = empty ? m_emptyRays : m_coveredRays;
+        float measure = empty ? m_emptyMeasure : m_coveredMeasure;
+        float share = (static_cast<float>(slot) + fraction) / count * measure;
+        float t = empty ? angleAt(m_empty, m_emptyPrefix, share) : angleAt(m_covered, m_coveredPrefix, share);
+        float angle = source.startAngle + t;
+        return {source.position, sf::Vector2f(std::cos(angle), std::sin(angle)), Ray().bounces_left, source.color, source.spectrum.wavelengthAt(0)};
+    }
+
+    bool m_active = false;
+    std::vector<std::pair<float, float>> m_covered; // Видимые углы, отсчитанные от startAngle
+    std::vector<std::pair<float, float>> m_empty;   // Пустые направления
+    std::vector<float> m_coveredPrefix;             // Суммы длин m_covered нарастающим итогом
+    std::vector<float> m_emptyPrefix;               // То же для m_empty
+    float m_coveredMeasure = 0.f;
+    float m_emptyMeasure = 0.f;
+    int m_coveredRays = 0;
+    int m_emptyRays = 0;
+    float m_coveredWeight = 1.f;
+    float m_emptyWeight = 1.f;
+};
+
+#endif // HEADER_GUARD_EMISSION_PLAN_HPP
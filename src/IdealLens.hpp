@@ -12,6 +12,7 @@ public:
     float angle;                               // Угол наклона линзы
     float focalLength;                         // Фокусное расстояние (+ для собирающей, - для рассеивающей)
     sf::Color color;                           // Цвет тела линзы
+    Spectral::Dispersion dispersion;           // Модель дисперсии (по умолчанию без дисперсии)
     mutable sf::Text focalLengthText;          // Текст "F = ..."
     mutable sf::Font const *fontPtr = nullptr; // Указатель на шрифт
 
@@ -32,6 +33,7 @@ public:
     }
 
     Type getType() const override { return Type::LENS; }
+    std::unique_ptr<OpticalElement> clone() const override { return std::make_unique<IdealLens>(*this); }
 
     // Получение координат конечных точек линзы
     sf::Vector2f getP1() const
@@ -57,37 +59,99 @@ public:
 
     VectorMath::IntersectionResult findIntersection(const Ray &ray) const override { return VectorMath::raySegmentIntersection(ray.origin, ray.direction, getP1(), getP2()); }
 
-    RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const override
+    // Направление луча после тонкой линзы с центром center, углом наклона angle и фокусным расстоянием f.
+    // T - float или Dual<N>: та же формула даёт производные по параметрам (см. DiffTracer)
+    template <typename T>
+    static VectorMath::Vec2T<T> refractDirection(const VectorMath::Vec2T<T> &direction, const VectorMath::Vec2T<T> &point,
+                                                 const VectorMath::Vec2T<T> &center, const T &angle, const T &f)
     {
+        using std::atan;
+        using std::atan2;
+        using std::tan;
+        using VectorMath::scalarValue; // Для Dual<N> находится по ADL
         // Локальная система координат линзы
-        sf::Vector2f u_axis_geom = VectorMath::normalize(getP2() - getP1());
-        sf::Vector2f v_axis = VectorMath::normalize(sf::Vector2f(-u_axis_geom.y, u_axis_geom.x));
+        VectorMath::Vec2T<T> u_axis_geom = VectorMath::direction(angle);
+        VectorMath::Vec2T<T> v_axis(-u_axis_geom.y, u_axis_geom.x);
         // Ориентируем локальную оптическую ось (v_axis) навстречу лучу
-        if (VectorMath::dot(v_axis, incomingRay.direction) < 0.f)
+        if (scalarValue(VectorMath::dot(v_axis, direction)) < 0.f)
             v_axis = -v_axis;
         // Ось u перпендикулярна v
-        sf::Vector2f u_axis(-v_axis.y, v_axis.x);
+        VectorMath::Vec2T<T> u_axis(-v_axis.y, v_axis.x);
         // Входные параметры луча в локальной системе
-        float y_in = VectorMath::dot(intersectionPoint - center, u_axis); // Высота луча
-        float v_axis_angle_global = std::atan2(v_axis.y, v_axis.x);
-        float incoming_angle_global = std::atan2(incomingRay.direction.y, incomingRay.direction.x);
-        float alpha_in = VectorMath::normalizeAngle(incoming_angle_global - v_axis_angle_global); // Угол входа отн. v_axis
+        T y_in = VectorMath::dot(point - center, u_axis); // Высота луча
+        T v_axis_angle_global = atan2(v_axis.y, v_axis.x);
+        T alpha_in = VectorMath::wrapAngle(atan2(direction.y, direction.x) - v_axis_angle_global); // Угол входа отн. v_axis
         // Формула тонкой линзы для углов
-        float alpha_out = alpha_in;
-        if (std::abs(focalLength) > EPSILON)
-        {
-            float tan_alpha_in = std::tan(alpha_in);
-            float tan_alpha_out_approx = tan_alpha_in - y_in / focalLength;
-            alpha_out = std::atan(tan_alpha_out_approx);
-        }
+        T alpha_out = alpha_in;
+        if (std::abs(scalarValue(f)) > EPSILON)
+            alpha_out = atan(tan(alpha_in) - y_in / f);
         // Выходной угол и направление в абсолютной системе
-        float outgoing_angle_global = v_axis_angle_global + alpha_out;
-        sf::Vector2f newDirection(std::cos(outgoing_angle_global), std::sin(outgoing_angle_global));
+        return VectorMath::direction(v_axis_angle_global + alpha_out);
+    }
+
+    RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const override
+    {
+        sf::Vector2f newDirection = refractDirection(VectorMath::Vec2T<float>(incomingRay.direction), VectorMath::Vec2T<float>(intersectionPoint),
+                                                     VectorMath::Vec2T<float>(center), angle, focalLengthAt(incomingRay.wavelength)).value();
         // Формирование исходящего луча
-        auto outgoingRay = Ray{intersectionPoint + newDirection * EPSILON * 10.f, VectorMath::normalize(newDirection), incomingRay.bounces_left - 1, incomingRay.color};
+        Ray outgoingRay = incomingRay;
+        outgoingRay.origin = intersectionPoint + newDirection * EPSILON * 10.f;
+        outgoingRay.direction = VectorMath::normalize(newDirection);
+        outgoingRay.bounces_left = incomingRay.bounces_left - 1;
         return RayAction(intersectionPoint, outgoingRay);
     }
 
+    // Фокусное расстояние для заданной длины волны (focalLength задано для опорной длины волны)
+    float focalLengthAt(float wavelength) const
+    {
+        return focalLength / dispersion.powerScale(wavelength);
+    }
+
+    bool isDispersive() const override { return dispersion.isDispersive(); }
+
+    // Пакетное преломление: геометрия считается один раз на пакет, по дорожкам - только оптическая сила.
+    // Вместо atan/cos/sin используется эквивалентная запись через тангенсы, которая векторизуется компилятором
+    bool interactPacket(const RayPacket &packet, const sf::Vector2f &intersectionPoint, sf::Vector2f *outDirections) const override
+    {
+        sf::Vector2f u_axis_geom = VectorMath::normalize(getP2() - getP1());
+        sf::Vector2f v_axis = VectorMath::normalize(sf::Vector2f(-u_axis_geom.y, u_axis_geom.x));
+        if (VectorMath::dot(v_axis, packet.direction) < 0.f)
+            v_axis = -v_axis;
+        sf::Vector2f u_axis(-v_axis.y, v_axis.x);
+        float cos_in = VectorMath::dot(packet.direction, v_axis);
+        if (cos_in < EPSILON)
+            return false; // Скользящее падение: обрабатывается по дорожкам
+        float tan_in = VectorMath::dot(packet.direction, u_axis) / cos_in;
+        float y_in = VectorMath::dot(intersectionPoint - center, u_axis);
+
+        float tan_out[Spectral::MAX_PACKET_LANES];
+        const int lanes = packet.laneCount;
+        if (std::abs(focalLength) > EPSILON)
+        {
+            float power = 1.f / focalLength;
+            for (int k = 0; k < lanes; ++k)
+                tan_out[k] = tan_in - y_in * power * dispersion.powerScale(packet.wavelength[k]);
+        }
+        else
+        {
+            for (int k = 0; k < lanes; ++k)
+                tan_out[k] = tan_in;
+        }
+        for (int k = 0; k < lanes; ++k)
+        {
+            float s = 1.f / std::sqrt(1.f + tan_out[k] * tan_out[k]);
+            outDirections[k] = sf::Vector2f((v_axis.x + u_axis.x * tan_out[k]) * s, (v_axis.y + u_axis.y * tan_out[k]) * s);
+        }
+        return true;
+    }
+
+    // Переключение модели дисперсии: нет -> крон -> флинт
+    void cycleDispersion()
+    {
+        dispersion.cycle();
+        updateParameterString();
+    }
+
     bool isPointNear(const sf::Vector2f &point, float tolerance = 5.0f) const override
     {
         return VectorMath::distancePointSegment(point, getP1(), getP2()) <= tolerance;
@@ -101,18 +165,21 @@ public:
     {
         return center;
     }
+    sf::FloatRect getBounds() const override
+    {
+        return VectorMath::segmentBounds(getP1(), getP2());
+    }
     std::vector<sf::Vector2f> getHandles() const override
     {
         return {center, getP1(), getP2()};
     }
     int getHandleAtPoint(const sf::Vector2f &point, float tolerance = 8.0f) const override
     {
-        auto handles = getHandles();
-        if (VectorMath::distance(point, handles[1]) <= tolerance)
+        if (VectorMath::distance(point, getP1()) <= tolerance)
             return 1;
-        if (VectorMath::distance(point, handles[2]) <= tolerance)
+        if (VectorMath::distance(point, getP2()) <= tolerance)
             return 2;
-        if (VectorMath::distance(point, handles[0]) <= tolerance)
+        if (VectorMath::distance(point, center) <= tolerance)
             return 0;
         if (VectorMath::distancePointSegment(point, getP1(), getP2()) <= tolerance + 3.f)
             return 0;
@@ -177,6 +244,10 @@ public:
         {
             fStr = fStr.substr(0, fStr.length() - 2);
         }
+        if (dispersion.isDispersive())
+        {
+            fStr += " (" + dispersion.name() + ")";
+        }
         focalLengthText.setString("F = " + fStr);
         sf::Vector2f p1 = getP1();
         sf::Vector2f p2 = getP2();
@@ -0,0 +1,281 @@
+#include "InputRecorder.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+bool InputRecorder::startRecording(const std::string &path)
+{
+    m_out.open(path);
+    if (!m_out.is_open())
+    {
+        std::cerr << "Error: Could not open file " << path << " for writing" << std::endl;
+        return false;
+    }
+    m_out << "# optics input recording\n";
+    m_mode = Mode::RECORD;
+    m_clock.restart();
+    return true;
+}
+
+bool InputRecorder::startReplay(const std::string &path, bool realTime)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        std::cerr << "Error: Could not open file " << path << std::endl;
+        return false;
+    }
+    m_frames.clear();
+    m_events.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        std::istringstream lineStream(line);
+        std::string kind;
+        if (!(lineStream >> kind) || kind[0] == '#')
+            continue;
+        bool valid = false;
+        if (kind == "frame")
+        {
+            Frame frame;
+            int shift = 0, control = 0, left = 0;
+            valid = static_cast<bool>(lineStream >> frame.timeUs >> frame.input.mousePixel.x >> frame.input.mousePixel.y >> shift >> control >> left);
+            frame.input.shift = shift != 0;
+            frame.input.control = control != 0;
+            frame.input.leftButton = left != 0;
+            frame.firstEvent = m_events.size();
+            m_frames.push_back(frame);
+        }
+        else if (kind == "event" && !m_frames.empty())
+        {
+            sf::Event event;
+            valid = parseEvent(line, event);
+            if (valid)
+            {
+                m_events.push_back(event);
+                ++m_frames.back().eventCount;
+            }
+        }
+        if (!valid)
+        {
+            std::cerr << "Error: Invalid input recording " << path << ", line " << lineNumber << std::endl;
+            return false;
+        }
+    }
+    m_mode = Mode::REPLAY;
+    m_realTime = realTime;
+    m_nextFrame = 0;
+    m_frameMs.clear();
+    m_frameMs.reserve(m_frames.size());
+    m_clock.restart();
+    return true;
+}
+
+InputRecorder::InputState InputRecorder::beginFrame(const sf::Window &window)
+{
+    m_frameClock.restart();
+    InputState input;
+    if (m_mode == Mode::REPLAY)
+    {
+        if (m_nextFrame >= m_frames.size())
+            return input;
+        const Frame &frame = m_frames[m_nextFrame];
+        if (m_realTime)
+        {
+            sf::Time wait = sf::microseconds(frame.timeUs) - m_clock.getElapsedTime();
+            if (wait > sf::Time::Zero)
+                sf::sleep(wait);
+            m_frameClock.restart();
+        }
+        m_currentFrame = m_nextFrame++;
+        m_nextEvent = frame.firstEvent;
+        return frame.input;
+    }
+
+    input.mousePixel = sf::Mouse::getPosition(window);
+    input.shift = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) || sf::Keyboard::isKeyPressed(sf::Keyboard::RShift);
+    input.control = sf::Keyboard::isKeyPressed(sf::Keyboard::LControl) || sf::Keyboard::isKeyPressed(sf::Keyboard::RControl);
+    input.leftButton = sf::Mouse::isButtonPressed(sf::Mouse::Left);
+    if (m_mode == Mode::RECORD)
+    {
+        m_out << "frame " << m_clock.getElapsedTime().asMicroseconds() << ' ' << input.mousePixel.x << ' ' << input.mousePixel.y << ' '
+              << input.shift << ' ' << input.control << ' ' << input.leftButton << '\n';
+    }
+    return input;
+}
+
+void InputRecorder::recordEvent(const sf::Event &event)
+{
+    if (m_mode != Mode::RECORD)
+        return;
+    std::string line = formatEvent(event);
+    if (!line.empty())
+        m_out << line << '\n';
+}
+
+bool InputRecorder::pollReplayEvent(sf::Event &event)
+{
+    if (m_mode != Mode::REPLAY || m_currentFrame >= m_frames.size())
+        return false;
+    const Frame &frame = m_frames[m_currentFrame];
+    if (m_nextEvent >= frame.firstEvent + frame.eventCount)
+        return false;
+    event = m_events[m_nextEvent++];
+    return true;
+}
+
+void InputRecorder::endFrame()
+{
+    if (m_mode == Mode::REPLAY)
+        m_frameMs.push_back(m_frameClock.getElapsedTime().asMicroseconds() / 1000.f);
+    else if (m_mode == Mode::RECORD)
+        m_out.flush();
+}
+
+void InputRecorder::reportTimings(std::ostream &out, const std::string &timingsPath) const
+{
+    if (m_frameMs.empty())
+        return;
+    std::vector<float> sorted = m_frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](float p)
+    { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5f))]; };
+    double total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+    out << std::fixed << std::setprecision(2) << "Replay: " << m_frameMs.size() << " frames, " << total << " ms total, mean "
+        << total / sorted.size() << " ms, median " << percentile(0.5f) << " ms, p95 " << percentile(0.95f) << " ms, max "
+        << sorted.back() << " ms (" << (m_realTime ? "real time" : "fast") << ")" << std::endl;
+
+    if (timingsPath.empty())
+        return;
+    std::ofstream file(timingsPath);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not open file " << timingsPath << " for writing" << std::endl;
+        return;
+    }
+    file << "frame,recorded_ms,frame_ms\n";
+    for (size_t i = 0; i < m_frameMs.size(); ++i)
+        file << i << ',' << m_frames[i].timeUs / 1000.0 << ',' << m_frameMs[i] << '\n';
+    out << "Frame timings exported to: " << timingsPath << std::endl;
+}
+
+std::string InputRecorder::formatEvent(const sf::Event &event)
+{
+    std::ostringstream out;
+    out << "event ";
+    switch (event.type)
+    {
+    case sf::Event::Closed:
+        out << "closed";
+        break;
+    case sf::Event::Resized:
+        out << "resized " << event.size.width << ' ' << event.size.height;
+        break;
+    case sf::Event::LostFocus:
+        out << "focus_lost";
+        break;
+    case sf::Event::GainedFocus:
+        out << "focus_gained";
+        break;
+    case sf::Event::TextEntered:
+        out << "text " << event.text.unicode;
+        break;
+    case sf::Event::KeyPressed:
+    case sf::Event::KeyReleased:
+        out << (event.type == sf::Event::KeyPressed ? "key_down " : "key_up ") << static_cast<int>(event.key.code) << ' '
+            << static_cast<int>(event.key.scancode) << ' ' << event.key.alt << ' ' << event.key.control << ' '
+            << event.key.shift << ' ' << event.key.system;
+        break;
+    case sf::Event::MouseWheelScrolled:
+        out << "wheel " << static_cast<int>(event.mouseWheelScroll.wheel) << ' ' << std::setprecision(9)
+            << event.mouseWheelScroll.delta << ' ' << event.mouseWheelScroll.x << ' ' << event.mouseWheelScroll.y;
+        break;
+    case sf::Event::MouseButtonPressed:
+    case sf::Event::MouseButtonReleased:
+        out << (event.type == sf::Event::MouseButtonPressed ? "button_down " : "button_up ")
+            << static_cast<int>(event.mouseButton.button) << ' ' << event.mouseButton.x << ' ' << event.mouseButton.y;
+        break;
+    case sf::Event::MouseMoved:
+        out << "move " << event.mouseMove.x << ' ' << event.mouseMove.y;
+        break;
+    case sf::Event::MouseEntered:
+        out << "enter";
+        break;
+    case sf::Event::MouseLeft:
+        out << "leave";
+        break;
+    default:
+        return ""; // Джойстик, сенсоры и устаревшие события приложение не обрабатывает
+    }
+    return out.str();
+}
+
+bool InputRecorder::parseEvent(const std::string &line, sf::Event &event)
+{
+    std::istringstream in(line);
+    std::string kind, name;
+    in >> kind >> name;
+    event = sf::Event();
+    if (name == "closed")
+        event.type = sf::Event::Closed;
+    else if (name == "resized")
+    {
+        event.type = sf::Event::Resized;
+        return static_cast<bool>(in >> event.size.width >> event.size.height);
+    }
+    else if (name == "focus_lost")
+        event.type = sf::Event::LostFocus;
+    else if (name == "focus_gained")
+        event.type = sf::Event::GainedFocus;
+    else if (name == "text")
+    {
+        event.type = sf::Event::TextEntered;
+        return static_cast<bool>(in >> event.text.unicode);
+    }
+    else if (name == "key_down" || name == "key_up")
+    {
+        event.type = name == "key_down" ? sf::Event::KeyPressed : sf::Event::KeyReleased;
+        int code = 0, scancode = 0, alt = 0, control = 0, shift = 0, system = 0;
+        if (!(in >> code >> scancode >> alt >> control >> shift >> system))
+            return false;
+        event.key.code = static_cast<sf::Keyboard::Key>(code);
+        event.key.scancode = static_cast<sf::Keyboard::Scancode>(scancode);
+        event.key.alt = alt != 0;
+        event.key.control = control != 0;
+        event.key.shift = shift != 0;
+        event.key.system = system != 0;
+    }
+    else if (name == "wheel")
+    {
+        event.type = sf::Event::MouseWheelScrolled;
+        int wheel = 0;
+        if (!(in >> wheel >> event.mouseWheelScroll.delta >> event.mouseWheelScroll.x >> event.mouseWheelScroll.y))
+            return false;
+        event.mouseWheelScroll.wheel = static_cast<sf::Mouse::Wheel>(wheel);
+    }
+    else if (name == "button_down" || name == "button_up")
+    {
+        event.type = name == "button_down" ? sf::Event::MouseButtonPressed : sf::Event::MouseButtonReleased;
+        int button = 0;
+        if (!(in >> button >> event.mouseButton.x >> event.mouseButton.y))
+            return false;
+        event.mouseButton.button = static_cast<sf::Mouse::Button>(button);
+    }
+    else if (name == "move")
+    {
+        event.type = sf::Event::MouseMoved;
+        return static_cast<bool>(in >> event.mouseMove.x >> event.mouseMove.y);
+    }
+    else if (name == "enter")
+        event.type = sf::Event::MouseEntered;
+    else if (name == "leave")
+        event.type = sf::Event::MouseLeft;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef HEADER_GUARD_INPUT_RECORDER_HPP
+#define HEADER_GUARD_INPUT_RECORDER_HPP
+
+#include <SFML/Graphics.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Запись и воспроизведение сеанса ввода. Каждый шаг цикла обновления записывается как кадр:
+// время от начала записи, положение мыши в пикселях окна и опрашиваемые напрямую клавиши
+// и кнопки, затем события SFML этого шага. При воспроизведении приложение получает тот же
+// ввод по кадрам - в реальном времени или без пауз, - а время обработки каждого кадра
+// сохраняется для отчёта, поэтому любой интерактивный сеанс становится повторяемым замером.
+// Формат - текст, по строке на кадр ("frame ...") и на событие ("event ...").
+class InputRecorder
+{
+public:
+    enum class Mode
+    {
+        OFF,
+        RECORD,
+        REPLAY
+    };
+
+    // Ввод, который приложение опрашивает в начале шага
+    struct InputState
+    {
+        sf::Vector2i mousePixel;
+        bool shift = false;
+        bool control = false;
+        bool leftButton = false;
+    };
+
+    bool startRecording(const std::string &path);
+    // realTime: выдерживать записанные интервалы между кадрами; иначе кадры идут без пауз
+    bool startReplay(const std::string &path, bool realTime);
+
+    Mode getMode() const { return m_mode; }
+    bool isReplaying() const { return m_mode == Mode::REPLAY; }
+    bool isRealTime() const { return m_realTime; }
+    // Записанные кадры закончились
+    bool replayFinished() const { return m_mode == Mode::REPLAY && m_nextFrame >= m_frames.size(); }
+
+    // Начало шага: снимок живого ввода (с записью) или следующий записанный кадр
+    InputState beginFrame(const sf::Window &window);
+    // Запись события живого ввода (в режиме записи)
+    void recordEvent(const sf::Event &event);
+    // Следующее записанное событие текущего кадра
+    bool pollReplayEvent(sf::Event &event);
+    // Конец обработки шага: время кадра для отчёта
+    void endFrame();
+
+    // Сводка времени кадров воспроизведения; timingsPath - CSV по кадрам (пустой - без файла)
+    void reportTimings(std::ostream &out, const std::string &timingsPath) const;
+
+private:
+    struct Frame
+    {
+        int64_t timeUs = 0;
+        InputState input;
+        size_t firstEvent = 0;
+        size_t eventCount = 0;
+    };
+
+    static std::string formatEvent(const sf::Event &event);
+    static bool parseEvent(const std::string &line, sf::Event &event);
+
+    Mode m_mode = Mode::OFF;
+    bool m_realTime = true;
+    sf::Clock m_clock;             // Время от начала записи или воспроизведения
+    sf::Clock m_frameClock;        // Время обработки текущего кадра
+    std::ofstream m_out;
+    std::vector<Frame> m_frames;   // Кадры воспроизведения
+    std::vector<sf::Event> m_events;
+    size_t m_nextFrame = 0;
+    size_t m_currentFrame = 0;
+    size_t m_nextEvent = 0;
+    std::vector<float> m_frameMs;  // Время обработки кадров воспроизведения
+};
+
+#endif // HEADER_GUARD_INPUT_RECORDER_HPP
@@ -0,0 +1,272 @@
+#include "JobPipeline.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <sstream>
+
+#include "Coroutine.hpp"
+#include "Detector.hpp"
+#include "ParallelFor.hpp"
+#include "RayTracer.hpp"
+#include "SceneIO.hpp"
+
+namespace
+{
+    // Кадров в одной порции трассировки. Разбиение не зависит от числа потоков,
+    // а ячейки хранятся по кадрам, поэтому результат совпадает с ProcessBatch
+    const size_t FRAMES_PER_CHUNK = 4;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Задание, передаваемое между этапами
+    struct JobState
+    {
+        size_t index = 0;
+        Clock::time_point start;
+        std::vector<std::unique_ptr<OpticalElement>> elements;
+        std::vector<const OpticalElement *> view;
+        std::vector<size_t> detectorBins; // Ячеек каждого детектора
+        size_t binCount = 0;              // Ячеек всех детекторов на кадр
+        std::vector<float> frameBins;     // Ячейки по кадрам: frames * binCount
+        std::vector<double> frameEscaped;
+        std::vector<size_t> frameRays;
+        std::vector<double> binMeans;     // Средние за кадр ячейки (после сведения)
+        JobPipeline::JobResult result;
+    };
+
+    using JobPtr = std::unique_ptr<JobState>;
+
+    struct Pipeline
+    {
+        const std::vector<JobPipeline::Job> &jobs;
+        const JobPipeline::Settings &settings;
+        std::ostream &log;
+        std::vector<JobPipeline::JobResult> &results;
+        size_t frames;
+    };
+
+    void traceChunk(JobState &job, const Pipeline &pipeline, size_t chunk)
+    {
+        TraceOptions options;
+        options.threadCount = 1; // Параллельность обеспечивают порции
+        options.recordPaths = false;
+        options.stochastic = true;
+        options.seed = pipeline.settings.seed;
+        options.importanceEmission = pipeline.settings.importanceEmission;
+        RayTracer tracer(options);
+        TraceResult result;
+
+        const size_t last = std::min(pipeline.frames, (chunk + 1) * FRAMES_PER_CHUNK);
+        for (size_t frame = chunk * FRAMES_PER_CHUNK; frame < last; ++frame)
+        {
+            options.frameIndex = frame;
+            tracer.setOptions(options);
+            tracer.trace(job.view, result);
+            float *bins = job.frameBins.data() + frame * job.binCount;
+            size_t written = 0;
+            for (const auto &detectorBins : result.detectorBins)
+            {
+                for (float value : detectorBins)
+                {
+                    if (written < job.binCount)
+                        bins[written++] = value;
+                }
+            }
+            job.frameEscaped[frame] = result.escapedEnergy;
+            job.frameRays[frame] = result.totalRays;
+        }
+    }
+
+    // Загрузка сцен в потоке ввода-вывода; опережает трассировку на ёмкость очереди
+    Coro::Stage loadStage(Pipeline &pipeline, Coro::Executor &io, Coro::Channel<JobPtr> &out)
+    {
+        for (size_t i = 0; i < pipeline.jobs.size(); ++i)
+        {
+            const JobPipeline::Job &source = pipeline.jobs[i];
+            JobPtr job = std::make_unique<JobState>();
+            job->index = i;
+            job->start = Clock::now();
+            job->result.name = source.name;
+
+            std::string error;
+            bool loaded = source.path.empty() ? SceneIO::fromString(source.text, job->elements, error)
+                                              : SceneIO::load(source.path, job->elements, error);
+            if (loaded)
+            {
+                for (const auto &element : job->elements)
+                {
+                    job->view.push_back(element.get());
+                    if (element->getType() == OpticalElement::Type::DETECTOR)
+                        job->detectorBins.push_back(static_cast<size_t>(static_cast<const Detector *>(element.get())->numBins));
+                }
+                for (size_t bins : job->detectorBins)
+                    job->binCount += bins;
+                job->frameBins.assign(pipeline.frames * job->binCount, 0.f);
+                job->frameEscaped.assign(pipeline.frames, 0.0);
+                job->frameRays.assign(pipeline.frames, 0);
+                job->result.ok = true;
+            }
+            else
+                job->result.error = error;
+            co_await out.push(std::move(job), io);
+        }
+        out.close();
+    }
+
+    // Трассировка порций кадров задания в общем пуле
+    Coro::Stage traceStage(Pipeline &pipeline, Coro::Executor &compute, Coro::Channel<JobPtr> &in, Coro::Channel<JobPtr> &out)
+    {
+        while (std::optional<JobPtr> item = co_await in.pop(compute))
+        {
+            JobState &job = **item;
+            if (job.result.ok)
+            {
+                const size_t chunks = (pipeline.frames + FRAMES_PER_CHUNK - 1) / FRAMES_PER_CHUNK;
+                try
+                {
+                    co_await compute.forEach(chunks, [&job, &pipeline](size_t chunk)
+                                             { traceChunk(job, pipeline, chunk); });
+                }
+                catch (const std::exception &e)
+                {
+                    job.result.ok = false;
+                    job.result.error = e.what();
+                }
+            }
+            co_await out.push(std::move(*item), compute);
+        }
+        out.close();
+    }
+
+    // Сведение кадров в порядке номеров: поток, центр распределения и ушедшая энергия
+    Coro::Stage reduceStage(Pipeline &pipeline, Coro::Executor &compute, Coro::Channel<JobPtr> &in, Coro::Channel<JobPtr> &out)
+    {
+        while (std::optional<JobPtr> item = co_await in.pop(compute))
+        {
+            JobState &job = **item;
+            if (job.result.ok)
+            {
+                std::vector<double> binSums(job.binCount, 0.0);
+                for (size_t frame = 0; frame < pipeline.frames; ++frame)
+                {
+                    job.result.totalRays += job.frameRays[frame];
+                    job.result.escapedEnergy += job.frameEscaped[frame];
+                    const float *bins = job.frameBins.data() + frame * job.binCount;
+                    for (size_t b = 0; b < job.binCount; ++b)
+                        binSums[b] += bins[b];
+                }
+                const double frames = static_cast<double>(pipeline.frames);
+                job.result.escapedEnergy /= frames;
+                size_t offset = 0;
+                for (size_t count : job.detectorBins)
+                {
+                    double flux = 0.0, moment = 0.0;
+                    for (size_t b = 0; b < count; ++b)
+                    {
+                        flux += binSums[offset + b];
+                        moment += binSums[offset + b] * (static_cast<double>(b) + 0.5);
+                    }
+                    offset += count;
+                    job.result.detectorFlux.push_back(flux / frames);
+                    job.result.detectorCentroid.push_back(flux > 0.0 ? moment / flux / static_cast<double>(count) : 0.5);
+                }
+                for (double &sum : binSums)
+                    sum /= frames;
+                job.binMeans = std::move(binSums);
+                job.frameBins = std::vector<float>(); // Покадровые ячейки больше не нужны
+            }
+            co_await out.push(std::move(*item), compute);
+        }
+        out.close();
+    }
+
+    // Номер задания в имени файла различает сцены с одинаковыми именами
+    std::string fileName(const JobState &job)
+    {
+        std::string stem = std::filesystem::path(job.result.name).stem().string();
+        for (char &c : stem)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_')
+                c = '_';
+        }
+        std::ostringstream name;
+        name << std::setw(3) << std::setfill('0') << job.index << '_' << stem << ".csv";
+        return name.str();
+    }
+
+    void writeResult(const Pipeline &pipeline, JobState &job)
+    {
+        std::error_code code;
+        std::filesystem::create_directories(pipeline.settings.outputDir, code);
+        std::filesystem::path path = std::filesystem::path(pipeline.settings.outputDir) / fileName(job);
+        std::ofstream out(path);
+        if (!out)
+        {
+            job.result.ok = false;
+            job.result.error = "cannot write " + path.string();
+            return;
+        }
+        out << std::setprecision(9);
+        out << "detector,bin,mean" << '\n';
+        size_t offset = 0;
+        for (size_t d = 0; d < job.detectorBins.size(); ++d)
+        {
+            for (size_t b = 0; b < job.detectorBins[d]; ++b)
+                out << d << ',' << b << ',' << job.binMeans[offset + b] << '\n';
+            offset += job.detectorBins[d];
+        }
+        job.result.outputPath = path.string();
+    }
+
+    // Запись результатов и журнала в потоке ввода-вывода
+    Coro::Stage writeStage(Pipeline &pipeline, Coro::Executor &io, Coro::Channel<JobPtr> &in)
+    {
+        while (std::optional<JobPtr> item = co_await in.pop(io))
+        {
+            JobState &job = **item;
+            if (job.result.ok && !pipeline.settings.outputDir.empty())
+                writeResult(pipeline, job);
+            job.result.latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - job.start).count();
+
+            const JobPipeline::JobResult &result = job.result;
+            pipeline.log << std::fixed << result.name << ": ";
+            if (!result.ok)
+                pipeline.log << "failed: " << result.error;
+            else
+            {
+                pipeline.log << std::setprecision(4) << pipeline.frames << " frames, escaped " << result.escapedEnergy;
+                for (size_t d = 0; d < result.detectorFlux.size(); ++d)
+                    pipeline.log << ", detector " << d << " " << result.detectorFlux[d] << " (centroid " << result.detectorCentroid[d] << ")";
+            }
+            pipeline.log << std::setprecision(1) << ", " << result.latencyMs << " ms" << std::endl;
+            pipeline.results[job.index] = std::move(job.result);
+        }
+    }
+}
+
+std::vector<JobPipeline::JobResult> JobPipeline::run(const std::vector<Job> &jobs, const Settings &settings, std::ostream &log)
+{
+    std::vector<JobResult> results(jobs.size());
+    Pipeline pipeline{jobs, settings, log, results, std::max<size_t>(1, settings.frames)};
+
+    // Очереди и группа объявлены раньше пулов: пулы останавливаются первыми,
+    // и кадры сопрограмм освобождаются, пока очереди ещё существуют
+    Coro::Channel<JobPtr> loaded(settings.queueCapacity), traced(settings.queueCapacity), reduced(settings.queueCapacity);
+    Coro::StageGroup group;
+    Coro::Executor io(1);
+    Coro::Executor compute(settings.threads > 0 ? settings.threads : Parallel::workerCount());
+
+    group.start(io, loadStage(pipeline, io, loaded));
+    group.start(compute, traceStage(pipeline, compute, loaded, traced));
+    group.start(compute, reduceStage(pipeline, compute, traced, reduced));
+    group.start(io, writeStage(pipeline, io, reduced));
+    group.wait();
+    return results;
+}
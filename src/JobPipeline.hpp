@@ -0,0 +1,52 @@
+#ifndef HEADER_GUARD_JOB_PIPELINE_HPP
+#define HEADER_GUARD_JOB_PIPELINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Конвейер пакетных заданий на сопрограммах C++20 (см. Coroutine.hpp). Каждое задание
+// проходит этапы: загрузка сцены -> трассировка порциями кадров -> сведение метрик -> запись
+// результата. Загрузка и запись выполняются в отдельном потоке ввода-вывода, трассировка
+// и сведение - в общем пуле; этапы связаны ограниченными очередями. Поэтому чтение
+// задания N+1 и запись задания N-1 идут одновременно с трассировкой задания N.
+class JobPipeline
+{
+public:
+    struct Job
+    {
+        std::string name;
+        std::string path; // Файл сцены в формате SceneIO; пустой - сцена в text
+        std::string text;
+    };
+
+    struct Settings
+    {
+        unsigned threads = 0;      // Потоки трассировки; 0 - по числу аппаратных потоков
+        size_t frames = 64;        // Стохастических кадров на задание
+        uint64_t seed = 1;
+        bool importanceEmission = false;
+        size_t queueCapacity = 2;  // Заданий в очереди между соседними этапами
+        std::string outputDir;     // Каталог CSV с результатами; пустой - без записи
+    };
+
+    struct JobResult
+    {
+        std::string name;
+        bool ok = false;
+        std::string error;
+        std::vector<double> detectorFlux;     // Средняя за кадр сумма ячеек детектора
+        std::vector<double> detectorCentroid; // Центр распределения попаданий вдоль детектора, доля длины
+        double escapedEnergy = 0.0;           // Средняя за кадр ушедшая энергия
+        size_t totalRays = 0;
+        double latencyMs = 0.0;               // От начала загрузки до записи результата
+        std::string outputPath;
+    };
+
+    // Результаты в порядке заданий; ход выполнения выводится в log
+    static std::vector<JobResult> run(const std::vector<Job> &jobs, const Settings &settings, std::ostream &log);
+};
+
+#endif // HEADER_GUARD_JOB_PIPELINE_HPP
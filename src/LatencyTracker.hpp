@@ -0,0 +1,128 @@
+#ifndef HEADER_GUARD_LATENCY_TRACKER_HPP
+#define HEADER_GUARD_LATENCY_TRACKER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Отметки времени одного взаимодействия: от ввода до кадра, переданного потоку отрисовки
+struct LatencyStamp
+{
+    using Clock = std::chrono::steady_clock;
+
+    bool valid = false;
+    Clock::time_point input;     // Ввод замечен главным потоком (опрос мыши или событие)
+    Clock::time_point applied;   // Сцена изменена перетаскиванием
+    Clock::time_point traced;    // Трассировка изменённой сцены завершена
+    Clock::time_point published; // Кадр передан потоку отрисовки
+
+    // Кадр с отметкой a заменён новым до вывода на экран: задержка считается от более раннего ввода
+    static LatencyStamp earliest(const LatencyStamp &a, const LatencyStamp &b)
+    {
+        if (!a.valid)
+            return b;
+        if (!b.valid)
+            return a;
+        LatencyStamp result = b;
+        result.input = std::min(a.input, b.input);
+        return result;
+    }
+};
+
+// Распределение задержки от ввода до вывода кадра (display) по последним взаимодействиям.
+// Образцы добавляет поток отрисовки, сводку читает главный поток
+class LatencyTracker
+{
+public:
+    struct Summary
+    {
+        size_t count = 0;
+        float p50 = 0.f, p95 = 0.f, p99 = 0.f, max = 0.f; // Полная задержка, мс
+        // Средняя длительность этапов, мс: ввод -> изменение сцены -> трассировка -> публикация -> экран
+        float applyMs = 0.f, traceMs = 0.f, publishMs = 0.f, displayMs = 0.f;
+    };
+
+    explicit LatencyTracker(size_t window = 512) : m_window(std::max<size_t>(1, window)) {}
+
+    void record(const LatencyStamp &stamp, LatencyStamp::Clock::time_point displayed)
+    {
+        Sample sample{milliseconds(stamp.input, displayed), milliseconds(stamp.input, stamp.applied),
+                      milliseconds(stamp.applied, stamp.traced), milliseconds(stamp.traced, stamp.published),
+                      milliseconds(stamp.published, displayed)};
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_samples.size() < m_window)
+            m_samples.push_back(sample);
+        else
+            m_samples[m_next] = sample;
+        m_next = (m_next + 1) % m_window;
+    }
+
+    // Начало нового замера (например, нового перетаскивания)
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_samples.clear();
+        m_next = 0;
+    }
+
+    Summary summary() const
+    {
+        std::vector<Sample> samples;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            samples = m_samples;
+        }
+        Summary result;
+        result.count = samples.size();
+        if (samples.empty())
+            return result;
+        std::vector<float> totals;
+        totals.reserve(samples.size());
+        for (const Sample &sample : samples)
+        {
+            totals.push_back(sample.total);
+            result.applyMs += sample.apply;
+            result.traceMs += sample.trace;
+            result.publishMs += sample.publish;
+            result.displayMs += sample.display;
+        }
+        std::sort(totals.begin(), totals.end());
+        // Ближайший ранг: p-я доля образцов не превышает значения
+        auto percentile = [&](float p)
+        {
+            size_t rank = static_cast<size_t>(std::ceil(p * static_cast<float>(totals.size())));
+            return totals[std::clamp<size_t>(rank, 1, totals.size()) - 1];
+        };
+        result.p50 = percentile(0.50f);
+        result.p95 = percentile(0.95f);
+        result.p99 = percentile(0.99f);
+        result.max = totals.back();
+        const float n = static_cast<float>(samples.size());
+        result.applyMs /= n;
+        result.traceMs /= n;
+        result.publishMs /= n;
+        result.displayMs /= n;
+        return result;
+    }
+
+private:
+    struct Sample
+    {
+        float total, apply, trace, publish, display;
+    };
+
+    static float milliseconds(LatencyStamp::Clock::time_point from, LatencyStamp::Clock::time_point to)
+    {
+        return std::chrono::duration<float, std::milli>(to - from).count();
+    }
+
+    size_t m_window;
+    mutable std::mutex m_mutex;
+    std::vector<Sample> m_samples; // Кольцевой буфер последних образцов
+    size_t m_next = 0;
+};
+
+#endif // HEADER_GUARD_LATENCY_TRACKER_HPP
@@ -21,6 +21,7 @@ public:
     }
 
     Type getType() const override { return Type::MIRROR; }
+    std::unique_ptr<OpticalElement> clone() const override { return std::make_unique<Mirror>(*this); }
 
     // Получение координат конечных точек зеркала
     sf::Vector2f getP1() const
@@ -46,18 +47,28 @@ public:
 
     VectorMath::IntersectionResult findIntersection(const Ray &ray) const override { return VectorMath::raySegmentIntersection(ray.origin, ray.direction, getP1(), getP2()); }
 
-    RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const override
+    // Направление отражённого луча для зеркала с углом наклона angle.
+    // T - float или Dual<N>: та же формула даёт производные по параметрам (см. DiffTracer)
+    template <typename T>
+    static VectorMath::Vec2T<T> reflectDirection(const VectorMath::Vec2T<T> &direction, const T &angle)
     {
-        sf::Vector2f p1 = getP1();
-        sf::Vector2f p2 = getP2();
-        sf::Vector2f segmentVec = p2 - p1;
-        // Нормаль перпендикулярна отрезку
-        sf::Vector2f normal = VectorMath::normalize(sf::Vector2f(-segmentVec.y, segmentVec.x));
-        // Убедимся, что нормаль направлена против луча
-        if (VectorMath::dot(normal, incomingRay.direction) > 0)
+        using VectorMath::scalarValue; // Для Dual<N> находится по ADL
+        VectorMath::Vec2T<T> segmentDir = VectorMath::direction(angle);
+        // Нормаль перпендикулярна отрезку и направлена против луча
+        VectorMath::Vec2T<T> normal(-segmentDir.y, segmentDir.x);
+        if (scalarValue(VectorMath::dot(normal, direction)) > 0.f)
             normal = -normal;
-        sf::Vector2f reflectedDir = VectorMath::reflect(incomingRay.direction, normal); // Отражаем луч
-        return RayAction(intersectionPoint, Ray{intersectionPoint + reflectedDir * EPSILON * 10.f, reflectedDir, incomingRay.bounces_left - 1, incomingRay.color});
+        return VectorMath::reflect(direction, normal);
+    }
+
+    RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const override
+    {
+        sf::Vector2f reflectedDir = reflectDirection(VectorMath::Vec2T<float>(incomingRay.direction), angle).value(); // Отражаем луч
+        Ray outgoingRay = incomingRay;
+        outgoingRay.origin = intersectionPoint + reflectedDir * EPSILON * 10.f;
+        outgoingRay.direction = reflectedDir;
+        outgoingRay.bounces_left = incomingRay.bounces_left - 1;
+        return RayAction(intersectionPoint, outgoingRay);
     }
 
     bool isPointNear(const sf::Vector2f &point, float tolerance = 5.0f) const override
@@ -72,6 +83,10 @@ public:
     {
         return center;
     }
+    sf::FloatRect getBounds() const override
+    {
+        return VectorMath::segmentBounds(getP1(), getP2());
+    }
 
     std::vector<sf::Vector2f> getHandles() const override
     {
@@ -79,12 +94,11 @@ public:
     }
     int getHandleAtPoint(const sf::Vector2f &point, float tolerance = 8.0f) const override
     {
-        auto handles = getHandles();
-        if (VectorMath::distance(point, handles[1]) <= tolerance)
+        if (VectorMath::distance(point, getP1()) <= tolerance)
             return 1;
-        if (VectorMath::distance(point, handles[2]) <= tolerance)
+        if (VectorMath::distance(point, getP2()) <= tolerance)
             return 2;
-        if (VectorMath::distance(point, handles[0]) <= tolerance)
+        if (VectorMath::distance(point, center) <= tolerance)
             return 0;
         return -1;
     }
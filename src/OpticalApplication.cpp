@@ -1,14 +1,45 @@
 #include "OpticalApplication.hpp"
+#include "ParallelFor.hpp"
 #include <iostream>
+#include <limits>
 
 // Конструктор и деструктор
 OpticalApplication::OpticalApplication()
     : m_window(sf::VideoMode(AppConstants::WINDOW_WIDTH, AppConstants::WINDOW_HEIGHT), AppConstants::WINDOW_TITLE_BASE),
       m_fontLoaded(false),
       m_frameCount(0),
+      m_lastRenderedFrames(0),
+      m_renderThread(m_window),
+      m_view(m_window.getDefaultView()),
+      m_panning(false),
+      m_hasPendingInput(false),
+      m_publishedSequence(0),
+      m_lastLatencySequence(0),
+      m_monteCarloMode(false),
+      m_sceneVersion(0),
+      m_accumulatedSceneVersion(0),
+      m_sceneExtentVersion(std::numeric_limits<uint64_t>::max()),
+      m_accumulationValid(false),
+      m_densityNeedsReset(true),
+      m_accumulatedFrames(0),
+      m_displayMode(DisplayMode::RAY_PATHS),
+      m_densityMap(AppConstants::WINDOW_WIDTH, AppConstants::WINDOW_HEIGHT),
+      m_densityVersion(0),
+      m_densityPixelsReady(false),
       m_currentMode(Mode::IDLE),
       m_placementType(OpticalElement::Type::NONE),
+      m_placementSlab(false),
       m_selectedElementIndex(std::nullopt),
+      m_spatialIndex(AppConstants::SPATIAL_INDEX_CELL_SIZE, AppConstants::SPATIAL_INDEX_MARGIN),
+      m_history(AppConstants::HISTORY_LIMIT),
+      m_showSpotAnalysis(false),
+      m_showParaxial(false),
+      m_paraxialDirty(true),
+      m_paraxialSceneVersion(0),
+      m_paraxialSourceIndex(0),
+      m_showBeams(false),
+      m_beamDirty(true),
+      m_beamSceneVersion(0),
       m_activeHandleIndex(static_cast<int>(HandleType::NONE)),
       m_placementPreviewLine(sf::Lines, 2)
 {
@@ -32,16 +63,49 @@ void OpticalApplication::run() {
         return;
     }
     m_fpsClock.restart();
+    m_renderThread.start();
 
+    // Отрисовка идёт в отдельном потоке, поэтому ввод обрабатывается с собственной частотой
     while (m_window.isOpen()) {
         updateMouseState();
         processEvents();
+        if (!m_window.isOpen()) break;
+        commitSceneHistory();
         update();
         traceRaysInternal();
-        render();
+        updateDensityMap();
+        updateSpotAnalysis();
+        updateParaxialOverlay();
+        updateBeamTracing();
+        publishFrame();
+        m_inputRecorder.endFrame();
+        if (m_inputRecorder.replayFinished()) {
+            sf::Event closed;
+            closed.type = sf::Event::Closed;
+            handleSingleEvent(closed);
+            break;
+        }
+        // Быстрое воспроизведение идёт без пауз между шагами
+        if (!m_inputRecorder.isReplaying() || m_inputRecorder.isRealTime()) {
+            limitUpdateRate();
+        }
+    }
+    m_renderThread.stop();
+    if (m_inputRecorder.isReplaying()) {
+        m_inputRecorder.reportTimings(std::cout, "replay_timings.csv");
     }
 }
 
+bool OpticalApplication::recordInput(const std::string& path) {
+    if (!m_inputRecorder.startRecording(path)) return false;
+    std::cout << "Recording input to: " << path << std::endl;
+    return true;
+}
+
+bool OpticalApplication::replayInput(const std::string& path, bool realTime) {
+    return m_inputRecorder.startReplay(path, realTime);
+}
+
 // Инициализация
 bool OpticalApplication::initialize() {
     m_fontLoaded = loadFontInternal();
@@ -51,7 +115,8 @@ bool OpticalApplication::initialize() {
     setupUIElements();
    // createDefaultScene(); Для вызова дефолт системы
     rebuildSourcesVector();
-    m_lastMousePos = m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window));
+    m_history.reset(m_elements);
+    m_lastMousePos = m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window), m_view);
     return true;
 }
 
@@ -59,6 +124,7 @@ bool OpticalApplication::loadFontInternal() {
     for (const auto& path : AppConstants::FONT_PATHS) {
         if (m_font.loadFromFile(path)) {
             std::cout << "Font loaded successfully from: " << path << std::endl;
+            prewarmFontGlyphs();
             return true;
         }
     }
@@ -66,13 +132,37 @@ bool OpticalApplication::loadFontInternal() {
     return false;
 }
 
+void OpticalApplication::prewarmFontGlyphs() {
+    // sf::Font дописывает глифы в текстуру при первом обращении. Все тексты используют ASCII
+    // и один размер шрифта, поэтому после прогрева поток отрисовки только читает кэш
+    for (sf::Uint32 c = 32; c < 127; ++c) {
+        m_font.getGlyph(c, AppConstants::FONT_SIZE_UI, false);
+    }
+    m_font.getTexture(AppConstants::FONT_SIZE_UI);
+}
+
 void OpticalApplication::setupUIElements() {
     m_helpText.setFont(m_font);
     m_helpText.setCharacterSize(AppConstants::FONT_SIZE_UI);
     m_helpText.setFillColor(AppConstants::COLOR_HELP_TEXT);
-    m_helpText.setString("Place: [M] Mirror | [L] Lens | [S] Source | [B] Sph. Mirror | [Del] Delete \nSelect & [=] Edit Param | [+/-] Adjust | [Wheel] Rotate ");
+    m_helpText.setString("Place: [M] Mirror | [L] Lens | [S] Source | [B] Sph. Mirror | [D] Detector | [P] Prism (Shift: slab) | [T] Splitter | [Del] Delete | [Shift+Drag] Select group \nSelect & [=] Edit Param | [+/-] Adjust | [Wheel] Rotate | [A] Detector cos-weight | [Ctrl+Wheel] Zoom | [RMB drag] Pan | [Home] Reset view\n[C] Source spectrum | [G] Glass | [H] Heatmap | [R] Monte Carlo accumulation | [I] Importance emission | [E] Export detectors | [Ctrl+Z/Y] Undo/Redo | [Ctrl+S] Save scene | [F5] Sweep (Shift: angle, Ctrl: X, Ctrl+Shift: Y) | [F6] Optimize (Shift: center) | [J] Sensitivity | [K] Spot | [X] Paraxial | [W] Beams ");
     m_helpText.setPosition(10.f, 10.f);
 
+    m_spotText.setFont(m_font);
+    m_spotText.setCharacterSize(AppConstants::FONT_SIZE_UI);
+    m_spotText.setFillColor(AppConstants::COLOR_SPOT_POINT);
+    m_spotText.setPosition(10.f, AppConstants::WINDOW_HEIGHT - 4.f * AppConstants::FONT_SIZE_UI);
+
+    m_paraxialText.setFont(m_font);
+    m_paraxialText.setCharacterSize(AppConstants::FONT_SIZE_UI);
+    m_paraxialText.setFillColor(AppConstants::COLOR_PARAXIAL_IMAGE);
+    m_paraxialText.setPosition(10.f, AppConstants::WINDOW_HEIGHT - 7.f * AppConstants::FONT_SIZE_UI);
+
+    m_beamText.setFont(m_font);
+    m_beamText.setCharacterSize(AppConstants::FONT_SIZE_UI);
+    m_beamText.setFillColor(AppConstants::COLOR_HELP_TEXT);
+    m_beamText.setPosition(10.f, AppConstants::WINDOW_HEIGHT - 9.f * AppConstants::FONT_SIZE_UI);
+
     m_placementPreviewCircle.setFillColor(sf::Color::Transparent);
     m_placementPreviewCircle.setOutlineThickness(2.f);
 
@@ -107,40 +197,113 @@ void OpticalApplication::setFontForElement(OpticalElement* element) {
 // Цикличные функии
 void OpticalApplication::updateMouseState() {
     m_lastMousePos = m_mousePos;
-    m_mousePos = m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window));
+    // Вид окна принадлежит потоку отрисовки, поэтому координаты считаются по собственной копии вида
+    m_input = m_inputRecorder.beginFrame(m_window);
+    m_mousePos = m_window.mapPixelToCoords(m_input.mousePixel, m_view);
+    if (m_mousePos != m_lastMousePos) noteInput();
+}
+
+void OpticalApplication::noteInput() {
+    // Учитывается самый ранний ввод шага: задержка не занижается
+    if (!m_hasPendingInput) {
+        m_pendingInputTime = LatencyStamp::Clock::now();
+        m_hasPendingInput = true;
+    }
+}
+
+void OpticalApplication::logDragLatency() const {
+    LatencyTracker::Summary latency = m_renderThread.latency().summary();
+    if (latency.count == 0) return;
+    std::cout << std::fixed << std::setprecision(1) << "Drag latency (" << latency.count << " frames): p50 " << latency.p50
+              << " ms, p95 " << latency.p95 << " ms, p99 " << latency.p99 << " ms, max " << latency.max
+              << " ms; stages: apply " << latency.applyMs << ", trace " << latency.traceMs << ", publish "
+              << latency.publishMs << ", display " << latency.displayMs << " ms" << std::endl;
 }
 
 void OpticalApplication::processEvents() {
     sf::Event event;
     while (m_window.pollEvent(event)) {
+        // При воспроизведении живой ввод игнорируется, кроме закрытия окна
+        if (m_inputRecorder.isReplaying() && event.type != sf::Event::Closed) continue;
+        m_inputRecorder.recordEvent(event);
+        noteInput();
         handleSingleEvent(event);
+        if (!m_window.isOpen()) return;
+    }
+    while (m_inputRecorder.pollReplayEvent(event)) {
+        noteInput();
+        handleSingleEvent(event);
+        if (!m_window.isOpen()) return;
     }
 }
 
 void OpticalApplication::update() {
     updatePlacementPreviewVisuals();
     updateDraggingLogic();
+    applyOptimizerResult();
+    printSweepResult();
     if (m_currentMode == Mode::EDITING_PARAMETER) {
         updateAndPositionParameterEditorUI();
     }
     updateFPSDisplay();
 }
 
-void OpticalApplication::render() {
-    m_window.clear(AppConstants::COLOR_BACKGROUND);
-    drawAllRayPaths();
-    drawElementsAndUI();
-    drawActivePlacementPreview();
-    drawMainHelpText();
-    if (m_currentMode == Mode::EDITING_PARAMETER) {
-        drawParameterEditingUI();
+void OpticalApplication::publishFrame() {
+    RenderFrame& frame = m_renderThread.backFrame();
+    frame.displayMode = m_displayMode;
+    frame.worldView = m_view;
+    frame.screenView = m_window.getDefaultView();
+    // Освещённые области заменяют пути лучей
+    frame.showBeams = m_showBeams;
+    if (m_displayMode == DisplayMode::RAY_PATHS && !m_showBeams) {
+        buildRayVertices(frame.rayVertices, getVisibleRect());
+    } else {
+        frame.rayVertices.clear();
+    }
+    if (m_densityPixelsReady) {
+        m_densityMap.swapPixels(frame.densityPixels);
+        frame.densityWidth = m_densityMap.getWidth();
+        frame.densityHeight = m_densityMap.getHeight();
+        frame.densityWorldRect = m_densityMap.getWorldRect();
+        frame.densityVersion = m_densityVersion;
+        m_densityPixelsReady = false;
+    }
+    buildElementsAndUI(frame);
+
+    // Предыдущий кадр с отметкой ещё не забран потоком отрисовки и будет заменён этим:
+    // отметка переносится, чтобы задержка считалась от более раннего ввода
+    LatencyStamp stamp = m_latencyStamp;
+    if (m_lastPublishedLatency.valid && m_renderThread.getPickedSequence() < m_lastLatencySequence) {
+        stamp = LatencyStamp::earliest(m_lastPublishedLatency, stamp);
     }
-    m_window.display();
+    frame.sequence = ++m_publishedSequence;
+    if (stamp.valid) {
+        stamp.published = LatencyStamp::Clock::now();
+        m_lastPublishedLatency = stamp;
+        m_lastLatencySequence = frame.sequence;
+    }
+    frame.latency = stamp;
+    m_latencyStamp = LatencyStamp();
+    m_renderThread.publish();
+}
+
+void OpticalApplication::limitUpdateRate() {
+    // В режиме Монте-Карло каждый шаг добавляет выборку, поэтому цикл не ограничивается
+    if (!m_monteCarloMode) {
+        sf::Time minStep = sf::seconds(1.f / AppConstants::UPDATE_RATE_LIMIT);
+        sf::Time elapsed = m_updateClock.getElapsedTime();
+        if (elapsed < minStep) {
+            sf::sleep(minStep - elapsed);
+        }
+    }
+    m_updateClock.restart();
 }
 
 // Обработка событий
 void OpticalApplication::handleSingleEvent(const sf::Event& event) {
     if (event.type == sf::Event::Closed) {
+        // Контекст окна принадлежит потоку отрисовки: он должен завершиться до закрытия окна
+        m_renderThread.stop();
         m_window.close();
         return;
     }
@@ -190,11 +353,28 @@ void OpticalApplication::handleKeyPressed(const sf::Event::KeyEvent& keyEvent) {
         }
         return;
     }
+    if (m_currentMode == Mode::IDLE && keyEvent.control) {
+        if (keyEvent.scancode == sf::Keyboard::Scan::Z) {
+            undoSceneChange(keyEvent.shift);
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::Y) {
+            undoSceneChange(true);
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::S) {
+            saveScene();
+            return;
+        }
+    }
     if (m_currentMode == Mode::IDLE) {
         OpticalElement::Type newType = OpticalElement::Type::NONE;
         if (keyEvent.scancode == sf::Keyboard::Scan::M) newType = OpticalElement::Type::MIRROR;
         else if (keyEvent.scancode == sf::Keyboard::Scan::L) newType = OpticalElement::Type::LENS;
         else if (keyEvent.scancode == sf::Keyboard::Scan::B) newType = OpticalElement::Type::SPHERICAL_MIRROR;
+        else if (keyEvent.scancode == sf::Keyboard::Scan::D) newType = OpticalElement::Type::DETECTOR;
+        else if (keyEvent.scancode == sf::Keyboard::Scan::P) newType = OpticalElement::Type::DIELECTRIC;
+        else if (keyEvent.scancode == sf::Keyboard::Scan::T) newType = OpticalElement::Type::BEAM_SPLITTER;
 
         if (newType != OpticalElement::Type::NONE) {
             m_currentMode = Mode::PLACING_START;
@@ -208,13 +388,64 @@ void OpticalApplication::handleKeyPressed(const sf::Event::KeyEvent& keyEvent) {
                  m_placementPreviewLine[1].color = AppConstants::COLOR_PLACEMENT_PREVIEW_LENS;
             } else if (newType == OpticalElement::Type::SPHERICAL_MIRROR) {
                  m_placementPreviewCircle.setOutlineColor(AppConstants::COLOR_PLACEMENT_PREVIEW_SPHERICAL_MIRROR);
+            } else if (newType == OpticalElement::Type::DETECTOR) {
+                 m_placementPreviewLine[0].color = AppConstants::COLOR_PLACEMENT_PREVIEW_DETECTOR;
+                 m_placementPreviewLine[1].color = AppConstants::COLOR_PLACEMENT_PREVIEW_DETECTOR;
+            } else if (newType == OpticalElement::Type::DIELECTRIC) {
+                 m_placementSlab = keyEvent.shift;
+                 m_placementPreviewLine[0].color = AppConstants::COLOR_PLACEMENT_PREVIEW_DIELECTRIC;
+                 m_placementPreviewLine[1].color = AppConstants::COLOR_PLACEMENT_PREVIEW_DIELECTRIC;
+            } else if (newType == OpticalElement::Type::BEAM_SPLITTER) {
+                 m_placementPreviewLine[0].color = AppConstants::COLOR_PLACEMENT_PREVIEW_BEAM_SPLITTER;
+                 m_placementPreviewLine[1].color = AppConstants::COLOR_PLACEMENT_PREVIEW_BEAM_SPLITTER;
             }
             return;
         }
+        if (!m_groupSelection.empty() && (keyEvent.code == sf::Keyboard::Delete || keyEvent.code == sf::Keyboard::Backspace)) {
+            deleteSelectedElementLogic();
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::H) {
+            toggleDisplayMode();
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::E) {
+            exportDetectorData();
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::R) {
+            toggleMonteCarloMode();
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::I) {
+            toggleImportanceEmission();
+            return;
+        }
+        if (keyEvent.code == sf::Keyboard::F6) {
+            toggleOptimization(keyEvent.shift);
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::K) {
+            toggleSpotAnalysis();
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::X) {
+            toggleParaxialOverlay();
+            return;
+        }
+        if (keyEvent.scancode == sf::Keyboard::Scan::W) {
+            toggleBeamTracing();
+            return;
+        }
+        if (keyEvent.code == sf::Keyboard::Home) {
+            resetView();
+            return;
+        }
         if (keyEvent.scancode == sf::Keyboard::Scan::S) {
             m_elements.push_back(new PointSource(m_mousePos, 30, sf::Color::Yellow));
             setFontForElement(m_elements.back());
             rebuildSourcesVector();
+            markElementChanged(m_elements.size() - 1);
             selectElementByIndex(m_elements.size() - 1);
             return;
         }
@@ -228,11 +459,44 @@ void OpticalApplication::handleKeyPressed(const sf::Event::KeyEvent& keyEvent) {
             adjustSelectedParameterValue(1.0f);
         } else if (keyEvent.code == sf::Keyboard::Subtract || keyEvent.code == sf::Keyboard::Hyphen) {
             adjustSelectedParameterValue(-1.0f);
+        } else if (keyEvent.scancode == sf::Keyboard::Scan::J) {
+            printSensitivity();
+        } else if (keyEvent.code == sf::Keyboard::F5 && m_currentMode == Mode::IDLE) {
+            if (keyEvent.control) {
+                runParameterSweep(keyEvent.shift ? SweepParameter::POSITION_Y : SweepParameter::POSITION_X);
+            } else if (keyEvent.shift) {
+                runParameterSweep(SweepParameter::ANGLE);
+            } else {
+                runParameterSweep(std::nullopt);
+            }
+        } else if (keyEvent.scancode == sf::Keyboard::Scan::A) {
+            if (auto* detector = dynamic_cast<Detector*>(m_elements[m_selectedElementIndex.value()])) {
+                detector->toggleAngleWeighting();
+                markElementChanged(m_selectedElementIndex.value());
+            }
+        } else if (keyEvent.scancode == sf::Keyboard::Scan::C) {
+            if (auto* source = dynamic_cast<PointSource*>(m_elements[m_selectedElementIndex.value()])) {
+                source->cycleSpectrum();
+                markElementChanged(m_selectedElementIndex.value());
+            }
+        } else if (keyEvent.scancode == sf::Keyboard::Scan::G) {
+            if (auto* lens = dynamic_cast<IdealLens*>(m_elements[m_selectedElementIndex.value()])) {
+                lens->cycleDispersion();
+                markElementChanged(m_selectedElementIndex.value());
+            } else if (auto* body = dynamic_cast<DielectricBody*>(m_elements[m_selectedElementIndex.value()])) {
+                body->cycleDispersion();
+                markElementChanged(m_selectedElementIndex.value());
+            }
         }
     }
 }
 
 void OpticalApplication::handleMouseButtonPressed(const sf::Event::MouseButtonEvent& mouseButtonEvent) {
+    if (mouseButtonEvent.button == sf::Mouse::Right || mouseButtonEvent.button == sf::Mouse::Middle) {
+        m_panning = true;
+        m_panLastPixel = sf::Vector2i(mouseButtonEvent.x, mouseButtonEvent.y);
+        return;
+    }
     if (mouseButtonEvent.button != sf::Mouse::Left) return;
 
     if (m_currentMode == Mode::PLACING_START) {
@@ -254,24 +518,50 @@ void OpticalApplication::handleMouseButtonPressed(const sf::Event::MouseButtonEv
                 float start = VectorMath::normalizeAngle(angleToMouse - span / 2.f);
                 m_elements.push_back(new SphericalMirror(m_placementStartPos, radius, start, span));
                 placed = true;
+            } else if (m_placementType == OpticalElement::Type::DETECTOR) {
+                m_elements.push_back(new Detector(m_placementStartPos, m_mousePos, AppConstants::DEFAULT_DETECTOR_BINS));
+                placed = true;
+            } else if (m_placementType == OpticalElement::Type::DIELECTRIC) {
+                // Первая вершина тела ставится в точку второго щелчка
+                std::vector<sf::Vector2f> shape = m_placementSlab ? DielectricBody::slab() : DielectricBody::regularPolygon(3);
+                sf::Vector2f delta = m_mousePos - m_placementStartPos;
+                float radius = VectorMath::length(delta) / VectorMath::length(shape.front());
+                float angle = std::atan2(delta.y, delta.x) - std::atan2(shape.front().y, shape.front().x);
+                m_elements.push_back(new DielectricBody(m_placementStartPos, radius, angle, std::move(shape), AppConstants::DEFAULT_REFRACTIVE_INDEX));
+                placed = true;
+            } else if (m_placementType == OpticalElement::Type::BEAM_SPLITTER) {
+                m_elements.push_back(new BeamSplitter(m_placementStartPos, m_mousePos, AppConstants::DEFAULT_SPLITTER_REFLECTANCE));
+                placed = true;
             }
             if (placed && !m_elements.empty()) {
                 setFontForElement(m_elements.back());
                 rebuildSourcesVector();
+                markElementChanged(m_elements.size() - 1);
                 selectElementByIndex(m_elements.size() - 1);
             }
         }
         m_placementType = OpticalElement::Type::NONE;
         m_currentMode = Mode::IDLE;
     } else if (m_currentMode == Mode::IDLE) {
+        if (m_input.shift) {
+            selectElementByIndex(std::nullopt);
+            m_marqueeStartPos = m_mousePos;
+            m_currentMode = Mode::MARQUEE_SELECTING;
+            return;
+        }
         std::optional<size_t> foundIndex = findElementAt(m_mousePos);
-        if (foundIndex.has_value()) {
+        if (foundIndex.has_value() &&
+            std::find(m_groupSelection.begin(), m_groupSelection.end(), foundIndex.value()) != m_groupSelection.end()) {
+            m_currentMode = Mode::DRAGGING_GROUP;
+            m_renderThread.latency().reset();
+        } else if (foundIndex.has_value()) {
             selectElementByIndex(foundIndex);
             m_activeHandleIndex = m_elements[m_selectedElementIndex.value()]->getHandleAtPoint(m_mousePos, AppConstants::HANDLE_SELECT_TOLERANCE);
             if (m_activeHandleIndex == static_cast<int>(HandleType::NONE)) {
                 m_activeHandleIndex = static_cast<int>(HandleType::MOVE);
             }
             m_currentMode = Mode::DRAGGING_ELEMENT;
+            m_renderThread.latency().reset();
         } else {
             selectElementByIndex(std::nullopt);
         }
@@ -279,18 +569,36 @@ void OpticalApplication::handleMouseButtonPressed(const sf::Event::MouseButtonEv
 }
 
 void OpticalApplication::handleMouseButtonReleased(const sf::Event::MouseButtonEvent& mouseButtonEvent) {
+    if (mouseButtonEvent.button == sf::Mouse::Right || mouseButtonEvent.button == sf::Mouse::Middle) {
+        m_panning = false;
+    }
     if (mouseButtonEvent.button == sf::Mouse::Left) {
-        if (m_currentMode == Mode::DRAGGING_ELEMENT) {
+        if (m_currentMode == Mode::DRAGGING_ELEMENT || m_currentMode == Mode::DRAGGING_GROUP) {
             m_currentMode = Mode::IDLE;
+            logDragLatency();
+        } else if (m_currentMode == Mode::MARQUEE_SELECTING) {
+            finishMarqueeSelection();
         }
     }
 }
 
-void OpticalApplication::handleMouseMoved(const sf::Event::MouseMoveEvent& ) {
+void OpticalApplication::handleMouseMoved(const sf::Event::MouseMoveEvent& mouseMoveEvent) {
+    if (m_panning) {
+        // Точка сцены под курсором остаётся под ним
+        sf::Vector2i pixel(mouseMoveEvent.x, mouseMoveEvent.y);
+        m_view.move(m_window.mapPixelToCoords(m_panLastPixel, m_view) - m_window.mapPixelToCoords(pixel, m_view));
+        m_panLastPixel = pixel;
+    }
 }
 
 void OpticalApplication::handleMouseWheelScrolled(const sf::Event::MouseWheelScrollEvent& mouseWheelEvent) {
-    if (mouseWheelEvent.wheel == sf::Mouse::VerticalWheel && m_selectedElementIndex.has_value() && m_currentMode != Mode::EDITING_PARAMETER) {
+    if (mouseWheelEvent.wheel != sf::Mouse::VerticalWheel) return;
+    // Без выбранного элемента или с Ctrl колесо масштабирует вид
+    if (m_input.control || !m_selectedElementIndex.has_value()) {
+        zoomViewAt(sf::Vector2i(mouseWheelEvent.x, mouseWheelEvent.y), mouseWheelEvent.delta);
+        return;
+    }
+    if (m_currentMode != Mode::EDITING_PARAMETER) {
         bool overInputField = false;
         if (m_currentMode == Mode::EDITING_PARAMETER && m_inputBackground.getGlobalBounds().contains(m_mousePos)) {
              overInputField = true;
@@ -312,8 +620,12 @@ void OpticalApplication::handleTextEntered(const sf::Event::TextEvent& textEvent
                 if (std::isdigit(enteredChar)) allowChar = true;
                 else if (enteredChar == '.' && m_currentInputString.find('.') == std::string::npos) allowChar = true;
                 else if (enteredChar == '-' && m_currentInputString.empty()) allowChar = true;
-            } else if (type == OpticalElement::Type::SOURCE) {
+            } else if (type == OpticalElement::Type::SOURCE || type == OpticalElement::Type::DETECTOR ||
+                       type == OpticalElement::Type::BEAM_SPLITTER) {
                 if (std::isdigit(enteredChar)) allowChar = true;
+            } else if (type == OpticalElement::Type::DIELECTRIC) {
+                if (std::isdigit(enteredChar)) allowChar = true;
+                else if (enteredChar == '.' && m_currentInputString.find('.') == std::string::npos) allowChar = true;
             }
             if (allowChar) {
                 m_currentInputString += enteredChar;
@@ -325,7 +637,9 @@ void OpticalApplication::handleTextEntered(const sf::Event::TextEvent& textEvent
 // Обновление логики
 void OpticalApplication::updatePlacementPreviewVisuals() {
     if (m_currentMode == Mode::PLACING_END) {
-        if (m_placementType == OpticalElement::Type::MIRROR || m_placementType == OpticalElement::Type::LENS) {
+        if (m_placementType == OpticalElement::Type::MIRROR || m_placementType == OpticalElement::Type::LENS ||
+            m_placementType == OpticalElement::Type::DETECTOR || m_placementType == OpticalElement::Type::DIELECTRIC ||
+            m_placementType == OpticalElement::Type::BEAM_SPLITTER) {
             m_placementPreviewLine[0].position = m_placementStartPos;
             m_placementPreviewLine[1].position = m_mousePos;
         } else if (m_placementType == OpticalElement::Type::SPHERICAL_MIRROR) {
@@ -338,11 +652,28 @@ void OpticalApplication::updatePlacementPreviewVisuals() {
 }
 
 void OpticalApplication::updateDraggingLogic() {
-    if (m_currentMode == Mode::DRAGGING_ELEMENT && m_selectedElementIndex.has_value() && sf::Mouse::isButtonPressed(sf::Mouse::Left)) {
-        if (m_activeHandleIndex != static_cast<int>(HandleType::NONE)) {
+    bool dragged = false;
+    if (m_currentMode == Mode::DRAGGING_ELEMENT && m_selectedElementIndex.has_value() && m_input.leftButton) {
+        if (m_activeHandleIndex != static_cast<int>(HandleType::NONE) && m_mousePos != m_lastMousePos) {
              m_elements[m_selectedElementIndex.value()]->setHandlePosition(m_activeHandleIndex, m_mousePos, m_lastMousePos);
+             markElementChanged(m_selectedElementIndex.value());
+             dragged = true;
+        }
+    }
+    if (m_currentMode == Mode::DRAGGING_GROUP && m_input.leftButton && m_mousePos != m_lastMousePos) {
+        for (size_t index : m_groupSelection) {
+            m_elements[index]->move(m_mousePos - m_lastMousePos);
+            markElementChanged(index);
         }
+        dragged = !m_groupSelection.empty();
     }
+    // Ввод, не изменивший сцену, в задержку не входит
+    if (dragged && m_hasPendingInput && !m_latencyStamp.valid) {
+        m_latencyStamp.valid = true;
+        m_latencyStamp.input = m_pendingInputTime;
+        m_latencyStamp.applied = LatencyStamp::Clock::now();
+    }
+    m_hasPendingInput = false;
 }
 
 void OpticalApplication::updateAndPositionParameterEditorUI() {
@@ -354,6 +685,9 @@ void OpticalApplication::updateAndPositionParameterEditorUI() {
     if (type == OpticalElement::Type::LENS) m_editPromptText.setString("F = ");
     else if (type == OpticalElement::Type::SPHERICAL_MIRROR) m_editPromptText.setString("R = ");
     else if (type == OpticalElement::Type::SOURCE) m_editPromptText.setString("N = ");
+    else if (type == OpticalElement::Type::DETECTOR) m_editPromptText.setString("Bins = ");
+    else if (type == OpticalElement::Type::DIELECTRIC) m_editPromptText.setString("n = ");
+    else if (type == OpticalElement::Type::BEAM_SPLITTER) m_editPromptText.setString("Refl % = ");
     else m_editPromptText.setString("Val = ");
 
     m_inputTextDisplay.setString(m_currentInputString);
@@ -398,114 +732,746 @@ void OpticalApplication::updateAndPositionParameterEditorUI() {
 void OpticalApplication::updateFPSDisplay() {
     m_frameCount++;
     if (m_fpsClock.getElapsedTime().asSeconds() >= 1.0f) {
-        float fps = static_cast<float>(m_frameCount) / m_fpsClock.getElapsedTime().asSeconds();
-        m_window.setTitle(AppConstants::WINDOW_TITLE_BASE + " - FPS: " + std::to_string(static_cast<int>(fps)));
+        float seconds = m_fpsClock.getElapsedTime().asSeconds();
+        uint64_t renderedFrames = m_renderThread.getRenderedFrames();
+        float fps = static_cast<float>(renderedFrames - m_lastRenderedFrames) / seconds;
+        float updates = static_cast<float>(m_frameCount) / seconds;
+        m_lastRenderedFrames = renderedFrames;
+        std::string title = AppConstants::WINDOW_TITLE_BASE + " - FPS: " + std::to_string(static_cast<int>(fps)) +
+                            " - Updates: " + std::to_string(static_cast<int>(updates));
+        if (m_monteCarloMode) {
+            title += " - MC frames: " + std::to_string(m_accumulatedFrames);
+        }
+        if (m_tracer.getOptions().importanceEmission && m_traceResult.totalRays > 0) {
+            // Доля лучей, не ушедших из сцены впустую
+            double escaped = static_cast<double>(m_traceResult.escapedRays) / m_traceResult.totalRays;
+            title += " - Importance emission: " + std::to_string(static_cast<int>(100.0 * std::max(0.0, 1.0 - escaped))) + "% rays hit";
+        }
+        LatencyTracker::Summary latency = m_renderThread.latency().summary();
+        if (latency.count > 0) {
+            // Задержка от движения мыши до кадра с обновлёнными лучами на экране
+            std::ostringstream ss;
+            ss << " - Drag latency p50/p95/p99: " << std::fixed << std::setprecision(1) << latency.p50 << "/" << latency.p95 << "/" << latency.p99 << " ms";
+            title += ss.str();
+        }
+        if (m_optimizer.isRunning() && m_optimizer.getProgress().sweep) {
+            title += " - Sweeping";
+        } else if (m_optimizer.isRunning()) {
+            OptimizerProgress progress = m_optimizer.getProgress();
+            std::ostringstream ss;
+            ss << " - Optimizing: iter " << progress.iteration << ", merit " << std::fixed << std::setprecision(3) << progress.bestMerit;
+            title += ss.str();
+        }
+        m_window.setTitle(title);
         m_frameCount = 0;
         m_fpsClock.restart();
     }
 }
 
-// Рендер
-void OpticalApplication::drawAllRayPaths() {
-    for (const auto& path : m_rayPaths) {
-        if (path.size() >= 2) {
-            m_window.draw(path.data(), path.size(), sf::LinesStrip);
+// Подготовка кадра
+void OpticalApplication::buildRayVertices(std::vector<sf::Vertex>& vertices, const sf::FloatRect& visible) const {
+    // Два прохода: число видимых отрезков каждого пути, затем запись отсечённых отрезков по смещениям
+    const auto& paths = m_traceResult.paths;
+    std::vector<size_t> offsets(paths.size() + 1, 0);
+    Parallel::forEachChunk(paths.size(), [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; ++i) {
+            size_t count = 0;
+            for (size_t j = 1; j < paths[i].size(); ++j) {
+                sf::Vector2f a = paths[i][j - 1].position, b = paths[i][j].position;
+                if (VectorMath::clipSegmentToRect(a, b, visible)) ++count;
+            }
+            offsets[i + 1] = count * 2;
         }
+    });
+    for (size_t i = 0; i < paths.size(); ++i) {
+        offsets[i + 1] += offsets[i];
     }
+    vertices.resize(offsets.back());
+    Parallel::forEachChunk(paths.size(), [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; ++i) {
+            sf::Vertex* out = vertices.data() + offsets[i];
+            for (size_t j = 1; j < paths[i].size(); ++j) {
+                sf::Vertex a = paths[i][j - 1], b = paths[i][j];
+                if (!VectorMath::clipSegmentToRect(a.position, b.position, visible)) continue;
+                *out++ = a;
+                *out++ = b;
+            }
+        }
+    });
 }
 
-void OpticalApplication::drawActivePlacementPreview() {
-    if (m_currentMode == Mode::PLACING_END) {
-        if (m_placementType == OpticalElement::Type::MIRROR || m_placementType == OpticalElement::Type::LENS) {
-            m_window.draw(m_placementPreviewLine);
-        } else if (m_placementType == OpticalElement::Type::SPHERICAL_MIRROR) {
-            m_window.draw(m_placementPreviewCircle);
+sf::FloatRect OpticalApplication::getVisibleRect() const {
+    sf::Vector2f size = m_view.getSize();
+    return sf::FloatRect(m_view.getCenter() - size / 2.f, size);
+}
+
+void OpticalApplication::zoomViewAt(const sf::Vector2i& pixel, float wheelDelta) {
+    sf::Vector2f before = m_window.mapPixelToCoords(pixel, m_view);
+    sf::Vector2f size = m_view.getSize() * std::pow(AppConstants::VIEW_ZOOM_STEP, -wheelDelta);
+    float scale = size.x / static_cast<float>(std::max(1u, m_window.getSize().x));
+    if (scale < AppConstants::VIEW_MIN_SCALE || scale > AppConstants::VIEW_MAX_SCALE) return;
+    m_view.setSize(size);
+    // Точка под курсором остаётся на месте
+    m_view.move(before - m_window.mapPixelToCoords(pixel, m_view));
+}
+
+void OpticalApplication::resetView() {
+    m_view = m_window.getDefaultView();
+}
+
+const sf::Text* OpticalApplication::getSelectedParameterText() const {
+    if (!m_selectedElementIndex.has_value()) return nullptr;
+    const OpticalElement* el = m_elements[m_selectedElementIndex.value()];
+    auto type = el->getType();
+    if (type == OpticalElement::Type::LENS) return &dynamic_cast<const IdealLens*>(el)->focalLengthText;
+    if (type == OpticalElement::Type::SPHERICAL_MIRROR) return &dynamic_cast<const SphericalMirror*>(el)->radiusText;
+    if (type == OpticalElement::Type::SOURCE) return &dynamic_cast<const PointSource*>(el)->numRaysText;
+    if (type == OpticalElement::Type::DETECTOR) return &dynamic_cast<const Detector*>(el)->binsText;
+    if (type == OpticalElement::Type::DIELECTRIC) return &dynamic_cast<const DielectricBody*>(el)->indexText;
+    if (type == OpticalElement::Type::BEAM_SPLITTER) return &dynamic_cast<const BeamSplitter*>(el)->reflectanceText;
+    return nullptr;
+}
+
+void OpticalApplication::buildElementsAndUI(RenderFrame& frame) const {
+    // В кадр попадают элементы, задевающие видимую область (с запасом на подписи), и выделенные.
+    // Копия элемента переиспользуется, пока элемент не изменился; гистограммы детекторов
+    // обновляются каждый кадр и передаются отдельно
+    sf::FloatRect visible = getVisibleRect();
+    float margin = AppConstants::VIEW_CULL_MARGIN * visible.width / static_cast<float>(std::max(1u, m_window.getSize().x));
+    visible = sf::FloatRect(visible.left - margin, visible.top - margin, visible.width + 2.f * margin, visible.height + 2.f * margin);
+    std::vector<size_t> visibleIndices;
+    m_spatialIndex.queryRect(visible, visibleIndices);
+    if (m_selectedElementIndex.has_value()) visibleIndices.push_back(m_selectedElementIndex.value());
+    visibleIndices.insert(visibleIndices.end(), m_groupSelection.begin(), m_groupSelection.end());
+    m_frameElements.resize(m_elements.size());
+    frame.elements.assign(m_elements.size(), nullptr);
+    frame.detectorBins.resize(m_elements.size());
+    for (auto& bins : frame.detectorBins) bins.clear();
+    for (size_t index : visibleIndices) {
+        OpticalElement* el = index < m_elements.size() ? m_elements[index] : nullptr;
+        if (!el || frame.elements[index]) continue;
+        FrameElement& cached = m_frameElements[index];
+        uint64_t version = index < m_elementVersions.size() ? m_elementVersions[index] : 0;
+        if (!cached.copy || cached.source != el || cached.version != version) {
+            el->setFont(m_font);
+            cached.source = el;
+            cached.version = version;
+            cached.copy = el->clone();
+        }
+        frame.elements[index] = cached.copy;
+        if (el->getType() == OpticalElement::Type::DETECTOR) {
+            const std::vector<float>& bins = static_cast<const Detector*>(el)->getBins();
+            frame.detectorBins[index].assign(bins.begin(), bins.end());
         }
     }
-}
 
-void OpticalApplication::drawElementsAndUI() {
-    for (size_t i = 0; i < m_elements.size(); ++i) {
-        if (!m_elements[i]) continue;
-        setFontForElement(m_elements[i]);
-        m_elements[i]->draw(m_window);
+    bool showSelection = m_selectedElementIndex.has_value() &&
+        m_currentMode != Mode::EDITING_PARAMETER &&
+        m_currentMode != Mode::PLACING_START && m_currentMode != Mode::PLACING_END;
+    frame.selectedIndex = showSelection ? static_cast<int>(m_selectedElementIndex.value()) : -1;
+    frame.groupIndices.assign(m_groupSelection.begin(), m_groupSelection.end());
+    frame.showMarquee = m_currentMode == Mode::MARQUEE_SELECTING;
+    if (frame.showMarquee) {
+        sf::FloatRect rect = getMarqueeRect();
+        frame.marquee.setPosition(rect.left, rect.top);
+        frame.marquee.setSize(sf::Vector2f(rect.width, rect.height));
+        frame.marquee.setFillColor(AppConstants::COLOR_MARQUEE_FILL);
+        frame.marquee.setOutlineColor(AppConstants::COLOR_MARQUEE_OUTLINE);
+        frame.marquee.setOutlineThickness(1.f);
+    }
+    const sf::Text* label = showSelection ? getSelectedParameterText() : nullptr;
+    frame.showSelectedLabel = label != nullptr;
+    // getGlobalBounds() строит геометрию текста здесь, в главном потоке; копия рисуется без обращения к шрифту
+    if (label) {
+        label->getGlobalBounds();
+        frame.selectedLabel = *label;
+    }
 
-        if (m_selectedElementIndex.has_value() && m_selectedElementIndex.value() == i &&
-            m_currentMode != Mode::EDITING_PARAMETER &&
-            m_currentMode != Mode::PLACING_START && m_currentMode != Mode::PLACING_END)
-        {
-            m_elements[i]->drawHandles(m_window, AppConstants::COLOR_HANDLE_MOVE, AppConstants::COLOR_HANDLE_RESIZE);
-            auto type = m_elements[i]->getType();
-            if (type == OpticalElement::Type::LENS) m_window.draw(dynamic_cast<IdealLens*>(m_elements[i])->focalLengthText);
-            else if (type == OpticalElement::Type::SPHERICAL_MIRROR) m_window.draw(dynamic_cast<SphericalMirror*>(m_elements[i])->radiusText);
-            else if (type == OpticalElement::Type::SOURCE) m_window.draw(dynamic_cast<PointSource*>(m_elements[i])->numRaysText);
+    bool placing = m_currentMode == Mode::PLACING_END;
+    frame.showPlacementLine = placing && m_placementType != OpticalElement::Type::SPHERICAL_MIRROR;
+    frame.showPlacementCircle = placing && m_placementType == OpticalElement::Type::SPHERICAL_MIRROR;
+    frame.placementLine = m_placementPreviewLine;
+    frame.placementCircle = m_placementPreviewCircle;
+
+    frame.showSpotAnalysis = m_showSpotAnalysis;
+    if (m_showSpotAnalysis) {
+        const SpotAnalysis::Result& spot = m_spotAnalysis.getResult();
+        sf::Vector2f half = spot.planeTangent * spot.halfExtent;
+        frame.spotPlane[0] = sf::Vertex(spot.planeOrigin - half, AppConstants::COLOR_SPOT_PLANE);
+        frame.spotPlane[1] = sf::Vertex(spot.planeOrigin + half, AppConstants::COLOR_SPOT_PLANE);
+        const auto& points = m_spotAnalysis.getSpotPoints();
+        frame.spotPoints.resize(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            frame.spotPoints[i] = sf::Vertex(points[i], AppConstants::COLOR_SPOT_POINT);
         }
+        m_spotText.getGlobalBounds();
+        frame.spotText = m_spotText;
+    }
+
+    if (m_showBeams) {
+        frame.beamTriangles = m_beamTracer.getResult().triangles;
+        m_beamText.getGlobalBounds();
+        frame.beamText = m_beamText;
+    }
+
+    frame.showParaxial = m_showParaxial;
+    if (m_showParaxial) {
+        frame.paraxialLines = m_paraxialLines;
+        m_paraxialText.getGlobalBounds();
+        frame.paraxialText = m_paraxialText;
     }
-}
 
-void OpticalApplication::drawMainHelpText() {
-    if (m_fontLoaded) {
-        m_window.draw(m_helpText);
+    m_helpText.getGlobalBounds();
+    frame.helpText = m_helpText;
+    frame.showParameterEditor = m_currentMode == Mode::EDITING_PARAMETER;
+    if (frame.showParameterEditor) {
+        m_editPromptText.getGlobalBounds();
+        m_inputTextDisplay.getGlobalBounds();
+        frame.inputBackground = m_inputBackground;
+        frame.editPromptText = m_editPromptText;
+        frame.inputText = m_inputTextDisplay;
     }
 }
 
-void OpticalApplication::drawParameterEditingUI() {
-    if (m_fontLoaded) {
-        m_window.draw(m_inputBackground);
-        m_window.draw(m_editPromptText);
-        m_window.draw(m_inputTextDisplay);
+const sf::FloatRect& OpticalApplication::sceneExtent() {
+    if (m_sceneExtentVersion != m_sceneVersion) {
+        m_sceneExtentVersion = m_sceneVersion;
+        float minX = 0.f, minY = 0.f, maxX = 0.f, maxY = 0.f;
+        for (size_t i = 0; i < m_elements.size(); ++i) {
+            sf::FloatRect bounds = m_elements[i]->getBounds();
+            minX = i == 0 ? bounds.left : std::min(minX, bounds.left);
+            minY = i == 0 ? bounds.top : std::min(minY, bounds.top);
+            maxX = i == 0 ? bounds.left + bounds.width : std::max(maxX, bounds.left + bounds.width);
+            maxY = i == 0 ? bounds.top + bounds.height : std::max(maxY, bounds.top + bounds.height);
+        }
+        m_sceneExtent = sf::FloatRect(minX, minY, maxX - minX, maxY - minY);
     }
+    return m_sceneExtent;
+}
+
+float OpticalApplication::sceneRayLength() {
+    const sf::FloatRect& extent = sceneExtent();
+    return std::max(AppConstants::MAX_RAY_LENGTH, VectorMath::length(sf::Vector2f(extent.width, extent.height)));
+}
+
+TraceOptions OpticalApplication::analysisTraceOptions() {
+    // Результат не должен зависеть от масштаба и сдвига вида, поэтому длина - по границам сцены
+    TraceOptions options = m_tracer.getOptions();
+    options.maxRayLength = sceneRayLength();
+    return options;
 }
 
 // Управление элементами
 void OpticalApplication::traceRaysInternal() {
-    m_rayPaths.clear();
-    if (m_sources.empty()) return;
-
-    for (const auto* sourcePtr : m_sources) {
-        if (!sourcePtr) continue;
-        std::vector<Ray> currentRaysBatch = sourcePtr->emitRays();
-        for (Ray currentRay : currentRaysBatch) {
-            RayPath singleRayPath;
-            singleRayPath.push_back(sf::Vertex(currentRay.origin, currentRay.color));
-
-            while (currentRay.bounces_left > 0) {
-                VectorMath::IntersectionResult closestIntersection;
-                closestIntersection.distance = AppConstants::MAX_RAY_LENGTH;
-                const OpticalElement* hitElement = nullptr;
-
-                for (OpticalElement* el_ptr : m_elements) {
-                    if (!el_ptr) continue;
-                    if (el_ptr == sourcePtr || el_ptr->getType() == OpticalElement::Type::SOURCE) {
-                        continue;
-                    }
-                    VectorMath::IntersectionResult intersection = el_ptr->findIntersection(currentRay);
-                    if (intersection.intersects && intersection.distance > EPSILON && intersection.distance < closestIntersection.distance) {
-                        closestIntersection = intersection;
-                        hitElement = el_ptr;
-                    }
-                }
-
-                if (hitElement) {
-                    singleRayPath.push_back(sf::Vertex(closestIntersection.point, currentRay.color));
-                    RayAction interaction = hitElement->interact(currentRay, closestIntersection.point);
-                    if (interaction.outgoingRay.has_value() && interaction.outgoingRay.value().bounces_left > 0) {
-                        currentRay = interaction.outgoingRay.value();
-                    } else {
-                        break;
-                    }
-                } else {
-                    singleRayPath.push_back(sf::Vertex(currentRay.origin + currentRay.direction * AppConstants::MAX_RAY_LENGTH, currentRay.color));
-                    break;
-                }
+    bool resetAccumulation = !m_monteCarloMode || !m_accumulationValid || m_sceneVersion != m_accumulatedSceneVersion;
+    if (resetAccumulation) {
+        m_accumulatedFrames = 0;
+        m_accumulatedDetectorBins.clear();
+        m_accumulatedSceneVersion = m_sceneVersion;
+        m_accumulationValid = true;
+        m_densityNeedsReset = true;
+    }
+
+    // В стохастическом режиме номер кадра задаёт свежую, но воспроизводимую выборку лучей
+    TraceOptions options = m_tracer.getOptions();
+    options.stochastic = m_monteCarloMode;
+    options.frameIndex = m_accumulatedFrames;
+    // Ушедшие лучи продлеваются так, чтобы пересечь видимую область из любой точки сцены
+    const sf::FloatRect& extent = sceneExtent();
+    sf::FloatRect reach = getVisibleRect();
+    float minX = std::min(reach.left, extent.left), minY = std::min(reach.top, extent.top);
+    float maxX = std::max(reach.left + reach.width, extent.left + extent.width);
+    float maxY = std::max(reach.top + reach.height, extent.top + extent.height);
+    options.maxRayLength = std::max(AppConstants::MAX_RAY_LENGTH, VectorMath::length(sf::Vector2f(maxX - minX, maxY - minY)));
+    m_tracer.setOptions(options);
+    m_tracer.trace(m_elements, m_traceResult);
+    if (m_latencyStamp.valid) {
+        m_latencyStamp.traced = LatencyStamp::Clock::now();
+    }
+
+    if (m_accumulatedDetectorBins.size() != m_traceResult.detectorBins.size()) {
+        m_accumulatedDetectorBins.assign(m_traceResult.detectorBins.size(), {});
+    }
+    for (size_t d = 0; d < m_traceResult.detectorBins.size(); ++d) {
+        const auto& bins = m_traceResult.detectorBins[d];
+        auto& accumulated = m_accumulatedDetectorBins[d];
+        if (accumulated.size() != bins.size()) {
+            accumulated.assign(bins.size(), 0.f);
+        }
+        for (size_t b = 0; b < bins.size(); ++b) {
+            accumulated[b] += bins[b];
+        }
+    }
+    ++m_accumulatedFrames;
+    applyDetectorResults();
+}
+
+void OpticalApplication::applyDetectorResults() {
+    // Детекторам передаётся среднее значение за накопленные кадры
+    float invFrames = 1.f / static_cast<float>(std::max<uint64_t>(1, m_accumulatedFrames));
+    size_t detectorIndex = 0;
+    for (OpticalElement* el : m_elements) {
+        if (!el || el->getType() != OpticalElement::Type::DETECTOR) continue;
+        if (auto* detector = dynamic_cast<Detector*>(el)) {
+            if (detectorIndex < m_accumulatedDetectorBins.size()) {
+                std::vector<float> bins = m_accumulatedDetectorBins[detectorIndex];
+                for (float& v : bins) v *= invFrames;
+                detector->setBins(std::move(bins));
             }
-            if (singleRayPath.size() > 1) {
-                m_rayPaths.push_back(singleRayPath);
+            ++detectorIndex;
+        }
+    }
+}
+
+void OpticalApplication::markElementChanged(size_t index) {
+    m_spatialIndex.update(index, *m_elements[index]);
+    m_history.touch(index);
+    markSceneChanged();
+    noteElementVersion(index);
+}
+
+void OpticalApplication::noteElementVersion(size_t index) {
+    if (m_elementVersions.size() < m_elements.size()) m_elementVersions.resize(m_elements.size(), m_sceneVersion);
+    if (index < m_elementVersions.size()) m_elementVersions[index] = m_sceneVersion;
+}
+
+void OpticalApplication::markStructureChanged() {
+    // Номера элементов сдвинулись: копии кадра строятся заново
+    markSceneChanged();
+    m_elementVersions.assign(m_elements.size(), m_sceneVersion);
+}
+
+void OpticalApplication::commitSceneHistory() {
+    // Перетаскивание и ввод параметра записываются одним шагом после завершения
+    if (m_currentMode == Mode::DRAGGING_ELEMENT || m_currentMode == Mode::DRAGGING_GROUP ||
+        m_currentMode == Mode::EDITING_PARAMETER) {
+        return;
+    }
+    m_history.commit(m_elements);
+}
+
+void OpticalApplication::undoSceneChange(bool redo) {
+    commitSceneHistory();
+    if (redo ? !m_history.canRedo() : !m_history.canUndo()) return;
+    std::vector<size_t> changed;
+    bool structural = redo ? m_history.redo(m_elements, changed) : m_history.undo(m_elements, changed);
+    for (size_t index : changed) {
+        setFontForElement(m_elements[index]);
+    }
+    rebuildSourcesVector();
+    if (structural) {
+        selectElementByIndex(std::nullopt);
+        m_spatialIndex.rebuild(m_elements);
+        markStructureChanged();
+    } else {
+        markSceneChanged();
+        for (size_t index : changed) {
+            m_spatialIndex.update(index, *m_elements[index]);
+            noteElementVersion(index);
+        }
+    }
+}
+
+void OpticalApplication::markSceneChanged() {
+    ++m_sceneVersion;
+}
+
+void OpticalApplication::invalidateAccumulation() {
+    m_accumulationValid = false;
+}
+
+void OpticalApplication::toggleMonteCarloMode() {
+    m_monteCarloMode = !m_monteCarloMode;
+    invalidateAccumulation();
+}
+
+void OpticalApplication::toggleImportanceEmission() {
+    TraceOptions options = m_tracer.getOptions();
+    options.importanceEmission = !options.importanceEmission;
+    m_tracer.setOptions(options);
+    invalidateAccumulation();
+}
+
+void OpticalApplication::exportDetectorData() {
+    size_t detectorIndex = 0;
+    for (OpticalElement* el : m_elements) {
+        if (!el || el->getType() != OpticalElement::Type::DETECTOR) continue;
+        if (const auto* detector = dynamic_cast<const Detector*>(el)) {
+            std::string path = "detector_" + std::to_string(detectorIndex) + ".csv";
+            if (detector->exportCsv(path)) {
+                std::cout << "Detector data exported to: " << path << std::endl;
             }
+            ++detectorIndex;
         }
     }
 }
 
+void OpticalApplication::saveScene() {
+    std::vector<const OpticalElement*> view(m_elements.begin(), m_elements.end());
+    if (SceneIO::save("scene.optics", view)) {
+        std::cout << "Scene saved to: scene.optics" << std::endl;
+    }
+}
+
+void OpticalApplication::runParameterSweep(std::optional<SweepParameter> parameter) {
+    if (!m_selectedElementIndex.has_value()) return;
+    commitSceneHistory(); // Снимок истории совпадает с текущей сценой
+    const OpticalElement* element = m_elements[m_selectedElementIndex.value()];
+
+    SweepRequest request;
+    request.elementIndex = m_selectedElementIndex.value();
+    request.steps = AppConstants::SWEEP_VARIANTS;
+    findTargetDetector(request.detectorIndex);
+    request.traceOptions = analysisTraceOptions();
+    request.traceOptions.stochastic = false;
+    if (parameter.has_value()) {
+        request.parameter = parameter.value();
+    } else if (element->getType() == OpticalElement::Type::LENS) {
+        request.parameter = SweepParameter::FOCAL_LENGTH;
+    } else if (element->getType() == OpticalElement::Type::SPHERICAL_MIRROR) {
+        request.parameter = SweepParameter::RADIUS;
+    } else if (element->getType() == OpticalElement::Type::SOURCE) {
+        request.parameter = SweepParameter::NUM_RAYS;
+    } else {
+        request.parameter = SweepParameter::ANGLE;
+    }
+    if (request.parameter == SweepParameter::ANGLE) {
+        request.from = -AppConstants::SWEEP_ANGLE_RANGE;
+        request.to = AppConstants::SWEEP_ANGLE_RANGE;
+    } else if (request.parameter == SweepParameter::POSITION_X || request.parameter == SweepParameter::POSITION_Y) {
+        request.from = -AppConstants::SWEEP_POSITION_RANGE;
+        request.to = AppConstants::SWEEP_POSITION_RANGE;
+    } else {
+        float value = ParameterSweep::currentValue(*element, request.parameter);
+        request.from = value * (1.f - AppConstants::SWEEP_RANGE_FRACTION);
+        request.to = value * (1.f + AppConstants::SWEEP_RANGE_FRACTION);
+    }
+
+    if (!m_optimizer.startSweep(m_history.current(), request)) {
+        std::cerr << (m_optimizer.isRunning() ? "Optimization or sweep is already running."
+                                              : "Parameter sweep is not supported for the selected element.") << std::endl;
+        return;
+    }
+    m_sweepClock.restart();
+    std::cout << "Sweep of " << ParameterSweep::parameterName(request.parameter) << " started: " << request.steps << " variants" << std::endl;
+}
+
+void OpticalApplication::printSweepResult() {
+    SweepRequest request;
+    std::vector<SweepVariant> results;
+    if (!m_optimizer.takeSweepResult(request, results)) return;
+    std::cout << "Sweep of " << ParameterSweep::parameterName(request.parameter) << ": " << results.size()
+              << " variants in " << m_sweepClock.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+    ParameterSweep::printTable(request, results);
+    if (ParameterSweep::writeCsv("sweep.csv", request, results)) {
+        std::cout << "Sweep results exported to: sweep.csv" << std::endl;
+    }
+}
+
+const Detector* OpticalApplication::findTargetDetector(int& ordinal) const {
+    // Номер детектора считается среди детекторов сцены, как в TraceResult::detectors
+    const Detector* first = nullptr;
+    int count = 0;
+    ordinal = -1;
+    for (size_t i = 0; i < m_elements.size(); ++i) {
+        if (m_elements[i]->getType() != OpticalElement::Type::DETECTOR) continue;
+        const auto* detector = dynamic_cast<const Detector*>(m_elements[i]);
+        if (!detector) continue;
+        if (std::find(m_groupSelection.begin(), m_groupSelection.end(), i) != m_groupSelection.end()) {
+            ordinal = count;
+            return detector;
+        }
+        if (!first) {
+            first = detector;
+            ordinal = count;
+        }
+        ++count;
+    }
+    return first;
+}
+
+void OpticalApplication::toggleOptimization(bool targetCenter) {
+    if (m_optimizer.isRunning()) {
+        m_optimizer.cancel();
+        return;
+    }
+    // Выбранный элемент обычно входит и в выделение рамкой: каждый параметр берётся один раз
+    std::vector<size_t> indices = m_groupSelection;
+    if (m_selectedElementIndex.has_value()) {
+        indices.push_back(m_selectedElementIndex.value());
+    }
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    commitSceneHistory(); // Снимок истории совпадает с текущей сценой
+
+    OptimizerRequest request;
+    request.traceOptions = analysisTraceOptions();
+    request.traceOptions.stochastic = false;
+    const Detector* detector = findTargetDetector(request.detectorIndex);
+    if (!detector) {
+        std::cerr << "Optimization needs a detector in the scene." << std::endl;
+        return;
+    }
+    // Свободные параметры: фокусное расстояние линз, радиус сферических зеркал, угол остальных элементов
+    // и положение каждого элемента. Источник и детектор задают саму задачу и не сдвигаются
+    for (size_t index : indices) {
+        OptimizerParameter p;
+        p.elementIndex = index;
+        auto type = m_elements[index]->getType();
+        if (type == OpticalElement::Type::LENS || type == OpticalElement::Type::SPHERICAL_MIRROR) {
+            p.parameter = (type == OpticalElement::Type::LENS) ? SweepParameter::FOCAL_LENGTH : SweepParameter::RADIUS;
+            p.initialValue = ParameterSweep::currentValue(*m_elements[index], p.parameter);
+            p.initialStep = std::max(AppConstants::PARAM_ADJUST_SPEED, std::abs(p.initialValue) * AppConstants::OPTIMIZER_INITIAL_STEP_FRACTION);
+        } else if (type == OpticalElement::Type::DETECTOR || type == OpticalElement::Type::SOURCE) {
+            continue;
+        } else {
+            p.parameter = SweepParameter::ANGLE;
+            p.initialStep = AppConstants::OPTIMIZER_INITIAL_ANGLE_STEP;
+        }
+        request.parameters.push_back(p);
+        for (SweepParameter axis : {SweepParameter::POSITION_X, SweepParameter::POSITION_Y}) {
+            OptimizerParameter offset;
+            offset.elementIndex = index;
+            offset.parameter = axis;
+            offset.initialStep = AppConstants::OPTIMIZER_INITIAL_POSITION_STEP;
+            request.parameters.push_back(offset);
+        }
+    }
+    if (targetCenter) {
+        request.merit = MeritFunction::TARGET_MISS;
+        request.targetPosition = detector->length / 2.f;
+    }
+    if (!m_optimizer.start(m_history.current(), request)) {
+        std::cerr << "Select lenses, mirrors or other elements to optimize." << std::endl;
+        return;
+    }
+    std::cout << "Optimization started: " << request.parameters.size() << " parameters" << std::endl;
+}
+
+void OpticalApplication::applyOptimizerResult() {
+    std::vector<float> values;
+    SceneSnapshot scene;
+    if (!m_optimizer.takeResult(values, scene)) return;
+    OptimizerProgress progress = m_optimizer.getProgress();
+    std::cout << "Optimization " << (progress.cancelled ? "cancelled" : "finished") << ": " << progress.iteration
+              << " iterations, " << progress.evaluations << " evaluations, merit " << progress.bestMerit << std::endl;
+    if (progress.cancelled) return;
+    // Сцена, изменённая во время оптимизации, не перезаписывается
+    commitSceneHistory();
+    if (!m_history.current().sharesRootWith(scene)) {
+        std::cerr << "Scene changed during optimization; result not applied." << std::endl;
+        return;
+    }
+    // Параметры с собственным текстом задаются через строку, чтобы обновить подпись элемента
+    const std::vector<OptimizerParameter>& parameters = m_optimizer.getRequest().parameters;
+    for (size_t i = 0; i < parameters.size() && i < values.size(); ++i) {
+        OpticalElement* el = m_elements[parameters[i].elementIndex];
+        if (parameters[i].parameter == SweepParameter::FOCAL_LENGTH || parameters[i].parameter == SweepParameter::RADIUS ||
+            parameters[i].parameter == SweepParameter::NUM_RAYS) {
+            el->setParameterFromString(std::to_string(values[i]));
+        } else {
+            ParameterSweep::applyParameter(*el, parameters[i].parameter, values[i]);
+        }
+        markElementChanged(parameters[i].elementIndex);
+    }
+}
+
+void OpticalApplication::printSensitivity() {
+    if (!m_selectedElementIndex.has_value()) return;
+    size_t index = m_selectedElementIndex.value();
+    std::vector<const OpticalElement*> elements(m_elements.begin(), m_elements.end());
+    // Тот же детектор, что у перебора и оптимизатора; DiffTracer ждёт номер элемента в сцене
+    int ordinal = -1;
+    const Detector* detector = findTargetDetector(ordinal);
+    size_t detectorIndex = std::find(elements.begin(), elements.end(), detector) - elements.begin();
+    if (!detector || detectorIndex == elements.size()) {
+        std::cerr << "Sensitivity analysis needs a detector in the scene." << std::endl;
+        return;
+    }
+
+    std::vector<DiffTracer::Parameter> parameters;
+    const SweepParameter candidates[] = {SweepParameter::POSITION_X, SweepParameter::POSITION_Y, SweepParameter::ANGLE,
+                                         SweepParameter::FOCAL_LENGTH, SweepParameter::RADIUS};
+    for (SweepParameter p : candidates) {
+        if (DiffTracer::supports(*elements[index], p)) {
+            parameters.push_back({index, p});
+        }
+    }
+    DiffTracer tracer(sceneRayLength());
+    std::vector<DiffTracer::RayResult> rays;
+    DiffTracer::Scalar center, rms;
+    if (parameters.empty() || !tracer.trace(elements, parameters, rays) ||
+        !DiffTracer::spotOnDetector(rays, elements, parameters, detectorIndex, center, rms)) {
+        std::cerr << "No differentiable rays reach the detector." << std::endl;
+        return;
+    }
+    size_t partial = std::count_if(rays.begin(), rays.end(), [](const DiffTracer::RayResult& r) { return !r.differentiable; });
+    std::cout << "Spot on detector: center " << center.v << ", rms " << rms.v;
+    if (partial > 0) {
+        std::cout << " (" << partial << " rays without derivatives)";
+    }
+    std::cout << std::endl;
+    for (size_t k = 0; k < parameters.size(); ++k) {
+        std::cout << "  d/d " << ParameterSweep::parameterName(parameters[k].parameter) << ": center " << center.d[k]
+                  << ", rms " << rms.d[k] << std::endl;
+    }
+}
+
+void OpticalApplication::updateDensityMap() {
+    if (m_displayMode != DisplayMode::DENSITY_MAP) return;
+    // Карта покрывает видимую область: после сдвига или масштаба накопление начинается заново
+    sf::FloatRect visible = getVisibleRect();
+    if (visible != m_densityMap.getWorldRect()) {
+        m_densityMap.setWorldRect(visible);
+        m_densityNeedsReset = true;
+    }
+    if (m_densityNeedsReset) {
+        m_densityMap.clear();
+        m_densityNeedsReset = false;
+    }
+    m_densityMap.accumulate(m_traceResult.paths);
+    m_densityMap.updatePixels();
+    ++m_densityVersion;
+    m_densityPixelsReady = true;
+}
+
+void OpticalApplication::updateSpotAnalysis() {
+    if (!m_showSpotAnalysis) return;
+    // Опорная плоскость - выбранный детектор, иначе первый детектор сцены, иначе наилучшая фокусировка
+    const Detector* detector = nullptr;
+    if (m_selectedElementIndex.has_value()) {
+        detector = dynamic_cast<const Detector*>(m_elements[m_selectedElementIndex.value()]);
+    }
+    for (size_t i = 0; i < m_elements.size() && !detector; ++i) {
+        detector = dynamic_cast<const Detector*>(m_elements[i]);
+    }
+    if (detector) {
+        m_spotAnalysis.setPlane(detector->getP1(), detector->getP2());
+    } else {
+        m_spotAnalysis.setAutoFocus(AppConstants::SPOT_AUTO_HALF_EXTENT);
+    }
+    // Суммы накапливаются вместе с детекторами: сброс при изменении сцены или режима
+    if (m_accumulatedFrames <= 1) {
+        m_spotAnalysis.reset();
+    }
+    m_spotAnalysis.accumulate(m_traceResult.paths);
+
+    const SpotAnalysis::Result& r = m_spotAnalysis.getResult();
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    if (!r.valid) {
+        ss << "Spot (" << (detector ? "detector" : "best focus") << "): no rays";
+    } else {
+        ss << "Spot (" << (detector ? "detector" : "best focus") << "): " << r.rayCount << " rays, centroid " << r.centroid
+           << ", RMS " << r.rmsRadius << "\nEE50 " << r.ee50Radius << ", EE80 " << r.ee80Radius
+           << " | best focus shift " << r.bestFocusShift << ", RMS " << r.bestFocusRms;
+    }
+    m_spotText.setString(ss.str());
+}
+
+void OpticalApplication::toggleSpotAnalysis() {
+    m_showSpotAnalysis = !m_showSpotAnalysis;
+    if (m_showSpotAnalysis) {
+        m_spotAnalysis.reset();
+    }
+}
+
+void OpticalApplication::updateParaxialOverlay() {
+    if (!m_showParaxial) return;
+    // Ось строится от выбранного источника, иначе от первого источника сцены
+    size_t sourceIndex = m_elements.size();
+    if (m_selectedElementIndex.has_value() && m_elements[m_selectedElementIndex.value()]->getType() == OpticalElement::Type::SOURCE) {
+        sourceIndex = m_selectedElementIndex.value();
+    }
+    for (size_t i = 0; i < m_elements.size() && sourceIndex == m_elements.size(); ++i) {
+        if (m_elements[i]->getType() == OpticalElement::Type::SOURCE) sourceIndex = i;
+    }
+    // Цепочка пересчитывается только после изменения сцены или смены источника
+    if (!m_paraxialDirty && m_paraxialSceneVersion == m_sceneVersion && m_paraxialSourceIndex == sourceIndex) return;
+    m_paraxialDirty = false;
+    m_paraxialSceneVersion = m_sceneVersion;
+    m_paraxialSourceIndex = sourceIndex;
+
+    const ParaxialSystem::Result& r = m_paraxial.build(m_elements, sourceIndex);
+    m_paraxialLines.clear();
+    for (size_t i = 1; i < r.axisPoints.size(); ++i) {
+        m_paraxialLines.emplace_back(r.axisPoints[i - 1], AppConstants::COLOR_PARAXIAL_AXIS);
+        m_paraxialLines.emplace_back(r.axisPoints[i], AppConstants::COLOR_PARAXIAL_AXIS);
+    }
+    // Отметка - отрезок поперёк оси с направлением axis
+    auto addMarker = [this](const sf::Vector2f& point, const sf::Vector2f& axis, const sf::Color& color, bool cross) {
+        sf::Vector2f across = sf::Vector2f(-axis.y, axis.x) * AppConstants::PARAXIAL_MARKER_SIZE;
+        m_paraxialLines.emplace_back(point - across, color);
+        m_paraxialLines.emplace_back(point + across, color);
+        if (cross) {
+            sf::Vector2f along = axis * AppConstants::PARAXIAL_MARKER_SIZE;
+            m_paraxialLines.emplace_back(point - along, color);
+            m_paraxialLines.emplace_back(point + along, color);
+        }
+    };
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    if (!r.valid) {
+        ss << "Paraxial: no coaxial lens/mirror train (" << ParaxialSystem::stopReasonName(r.stopReason) << ")";
+    } else {
+        ss << "Paraxial: " << r.elementIndices.size() << " elements, ends: " << ParaxialSystem::stopReasonName(r.stopReason);
+        if (r.afocal) {
+            ss << " | afocal";
+        } else {
+            addMarker(r.frontFocus, r.inputDirection, AppConstants::COLOR_PARAXIAL_FOCUS, false);
+            addMarker(r.backFocus, r.outputDirection, AppConstants::COLOR_PARAXIAL_FOCUS, false);
+            addMarker(r.frontPrincipal, r.inputDirection, AppConstants::COLOR_PARAXIAL_PRINCIPAL, false);
+            addMarker(r.backPrincipal, r.outputDirection, AppConstants::COLOR_PARAXIAL_PRINCIPAL, false);
+            ss << " | EFL " << r.effectiveFocalLength << ", BFD " << r.backFocalDistance << ", FFD " << r.frontFocalDistance;
+        }
+        ss << "\n";
+        if (r.imageAtInfinity) {
+            ss << "Image at infinity";
+        } else {
+            addMarker(r.imagePoint, r.outputDirection, AppConstants::COLOR_PARAXIAL_IMAGE, true);
+            ss << "Image " << r.imageDistance << (r.imageDistance >= 0.0 ? " (real)" : " (virtual)")
+               << ", magnification " << std::setprecision(3) << r.magnification << std::setprecision(2);
+            if (r.checked) {
+                ss << " | trace " << r.tracedImageDistance << " (diff " << r.tracedImageDistance - r.imageDistance << ")";
+            }
+        }
+    }
+    m_paraxialText.setString(ss.str());
+}
+
+void OpticalApplication::toggleParaxialOverlay() {
+    m_showParaxial = !m_showParaxial;
+    m_paraxialDirty = true;
+}
+
+void OpticalApplication::updateBeamTracing() {
+    if (!m_showBeams) return;
+    if (!m_beamDirty && m_beamSceneVersion == m_sceneVersion) return;
+    m_beamDirty = false;
+    m_beamSceneVersion = m_sceneVersion;
+
+    sf::Clock clock;
+    std::vector<const OpticalElement*> elements(m_elements.begin(), m_elements.end());
+    const BeamTracer::Result& r = m_beamTracer.trace(elements, sceneRayLength());
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "Beams: " << r.wedges << " wedges, " << r.events << " edge events, " << r.regions << " regions, "
+       << clock.getElapsedTime().asSeconds() * 1000.f << " ms";
+    if (r.truncated) ss << " (truncated)";
+    m_beamText.setString(ss.str());
+}
+
+void OpticalApplication::toggleBeamTracing() {
+    m_showBeams = !m_showBeams;
+    m_beamDirty = true;
+}
+
+void OpticalApplication::toggleDisplayMode() {
+    m_displayMode = (m_displayMode == DisplayMode::RAY_PATHS) ? DisplayMode::DENSITY_MAP : DisplayMode::RAY_PATHS;
+    invalidateAccumulation();
+}
+
 void OpticalApplication::rebuildSourcesVector() {
     m_sources.clear();
     for (OpticalElement* el : m_elements) {
@@ -517,7 +1483,9 @@ void OpticalApplication::rebuildSourcesVector() {
 }
 
 std::optional<size_t> OpticalApplication::findElementAt(const sf::Vector2f& pos) {
-    for (int i = static_cast<int>(m_elements.size()) - 1; i >= 0; --i) {
+    // Индекс возвращает только элементы, чьи границы содержат точку, начиная с верхнего
+    m_spatialIndex.queryPoint(pos, m_pickCandidates);
+    for (size_t i : m_pickCandidates) {
         if (!m_elements[i]) continue;
         if (m_elements[i]->getHandleAtPoint(pos, AppConstants::HANDLE_SELECT_TOLERANCE) != static_cast<int>(HandleType::NONE) ) {
             return static_cast<size_t>(i);
@@ -531,6 +1499,7 @@ std::optional<size_t> OpticalApplication::findElementAt(const sf::Vector2f& pos)
 
 void OpticalApplication::selectElementByIndex(std::optional<size_t> index, int handleIndexIfSelected) {
     m_selectedElementIndex = index;
+    m_groupSelection.clear();
     if (m_selectedElementIndex.has_value()) {
         m_activeHandleIndex = handleIndexIfSelected;
     } else {
@@ -541,12 +1510,58 @@ void OpticalApplication::selectElementByIndex(std::optional<size_t> index, int h
     }
 }
 
+sf::FloatRect OpticalApplication::getMarqueeRect() const {
+    sf::Vector2f minPos(std::min(m_marqueeStartPos.x, m_mousePos.x), std::min(m_marqueeStartPos.y, m_mousePos.y));
+    sf::Vector2f maxPos(std::max(m_marqueeStartPos.x, m_mousePos.x), std::max(m_marqueeStartPos.y, m_mousePos.y));
+    return sf::FloatRect(minPos, maxPos - minPos);
+}
+
+void OpticalApplication::finishMarqueeSelection() {
+    m_currentMode = Mode::IDLE;
+    sf::FloatRect rect = getMarqueeRect();
+    m_spatialIndex.queryRect(rect, m_pickCandidates);
+    // Выделяются элементы, геометрия которых целиком лежит внутри рамки
+    std::vector<size_t> selected;
+    for (size_t i : m_pickCandidates) {
+        sf::FloatRect b = m_elements[i]->getBounds();
+        if (b.left >= rect.left && b.top >= rect.top &&
+            b.left + b.width <= rect.left + rect.width && b.top + b.height <= rect.top + rect.height) {
+            selected.push_back(i);
+        }
+    }
+    if (selected.size() == 1) {
+        selectElementByIndex(selected.front());
+    } else {
+        selectElementByIndex(std::nullopt);
+        m_groupSelection = std::move(selected);
+    }
+}
+
 void OpticalApplication::deleteSelectedElementLogic() {
+    if (!m_groupSelection.empty()) {
+        // Удаление с конца, чтобы номера оставшихся выбранных элементов не сдвигались
+        std::sort(m_groupSelection.begin(), m_groupSelection.end(), std::greater<size_t>());
+        m_history.erase(m_groupSelection);
+        for (size_t index : m_groupSelection) {
+            delete m_elements[index];
+            m_elements.erase(m_elements.begin() + index);
+        }
+        m_groupSelection.clear();
+        rebuildSourcesVector();
+        m_spatialIndex.rebuild(m_elements);
+        markStructureChanged();
+        selectElementByIndex(std::nullopt);
+        m_currentMode = Mode::IDLE;
+        return;
+    }
     if (m_selectedElementIndex.has_value()) {
         OpticalElement* elementToDelete = m_elements[m_selectedElementIndex.value()];
+        m_history.erase({m_selectedElementIndex.value()});
         delete elementToDelete;
         m_elements.erase(m_elements.begin() + m_selectedElementIndex.value());
         rebuildSourcesVector();
+        m_spatialIndex.rebuild(m_elements);
+        markStructureChanged();
         m_selectedElementIndex.reset();
         m_currentMode = Mode::IDLE;
         m_activeHandleIndex = static_cast<int>(HandleType::NONE);
@@ -557,7 +1572,8 @@ void OpticalApplication::beginParameterEditForSelected() {
     if (m_currentMode == Mode::IDLE && m_selectedElementIndex.has_value()) {
         OpticalElement* selectedElement = m_elements[m_selectedElementIndex.value()];
         auto type = selectedElement->getType();
-        if (type == OpticalElement::Type::LENS || type == OpticalElement::Type::SPHERICAL_MIRROR || type == OpticalElement::Type::SOURCE) {
+        if (type == OpticalElement::Type::LENS || type == OpticalElement::Type::SPHERICAL_MIRROR || type == OpticalElement::Type::SOURCE ||
+            type == OpticalElement::Type::DETECTOR || type == OpticalElement::Type::DIELECTRIC || type == OpticalElement::Type::BEAM_SPLITTER) {
             m_currentMode = Mode::EDITING_PARAMETER;
             m_parameterBackupString = getCurrentParameterValueAsString(selectedElement);
             m_currentInputString = "";
@@ -568,6 +1584,7 @@ void OpticalApplication::beginParameterEditForSelected() {
 void OpticalApplication::confirmParameterEdit() {
     if (m_selectedElementIndex.has_value()) {
         m_elements[m_selectedElementIndex.value()]->setParameterFromString(m_currentInputString);
+        markElementChanged(m_selectedElementIndex.value());
     }
     m_currentMode = Mode::IDLE;
     m_currentInputString = "";
@@ -575,7 +1592,11 @@ void OpticalApplication::confirmParameterEdit() {
 
 void OpticalApplication::cancelParameterEdit() {
     if (m_selectedElementIndex.has_value()) {
+        // Восстановление прежнего значения не является новым шагом истории
         m_elements[m_selectedElementIndex.value()]->setParameterFromString(m_parameterBackupString);
+        m_spatialIndex.update(m_selectedElementIndex.value(), *m_elements[m_selectedElementIndex.value()]);
+        markSceneChanged();
+        noteElementVersion(m_selectedElementIndex.value());
     }
     m_currentMode = Mode::IDLE;
     m_currentInputString = "";
@@ -585,18 +1606,21 @@ void OpticalApplication::adjustSelectedParameterValue(float direction) {
     if (m_selectedElementIndex.has_value()) {
         OpticalElement* el = m_elements[m_selectedElementIndex.value()];
         float adjustAmount;
-        if (el->getType() == OpticalElement::Type::SOURCE) {
+        if (el->getType() == OpticalElement::Type::SOURCE || el->getType() == OpticalElement::Type::DETECTOR ||
+            el->getType() == OpticalElement::Type::BEAM_SPLITTER) {
             adjustAmount = static_cast<float>(AppConstants::SOURCE_PARAM_ADJUST_SPEED);
         } else {
             adjustAmount = AppConstants::PARAM_ADJUST_SPEED;
         }
         el->adjustParameter(direction * adjustAmount);
+        markElementChanged(m_selectedElementIndex.value());
     }
 }
 
 void OpticalApplication::rotateSelectedElementByDelta(float angleDelta) {
     if (m_selectedElementIndex.has_value()) {
         m_elements[m_selectedElementIndex.value()]->rotate(angleDelta);
+        markElementChanged(m_selectedElementIndex.value());
     }
 }
 
@@ -620,6 +1644,19 @@ std::string OpticalApplication::getCurrentParameterValueAsString(const OpticalEl
         if (const auto* source = dynamic_cast<const PointSource*>(element)) {
             return std::to_string(source->getNumRays());
         }
+    } else if (type == OpticalElement::Type::DETECTOR) {
+        if (const auto* detector = dynamic_cast<const Detector*>(element)) {
+            return std::to_string(detector->getNumBins());
+        }
+    } else if (type == OpticalElement::Type::BEAM_SPLITTER) {
+        if (const auto* splitter = dynamic_cast<const BeamSplitter*>(element)) {
+            return std::to_string(splitter->getReflectancePercent());
+        }
+    } else if (type == OpticalElement::Type::DIELECTRIC) {
+        if (const auto* body = dynamic_cast<const DielectricBody*>(element)) {
+            ss << std::fixed << std::setprecision(3) << body->getRefractiveIndex();
+            return ss.str();
+        }
     }
     if (valStr.length() > 2 && valStr.substr(valStr.length() - 2) == ".0") {
         valStr = valStr.substr(0, valStr.length() - 2);
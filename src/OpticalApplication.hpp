@@ -19,7 +19,23 @@
 #include "Mirror.hpp"
 #include "IdealLens.hpp"
 #include "SphericalMirror.hpp"
+#include "Detector.hpp"
+#include "DielectricBody.hpp"
+#include "BeamSplitter.hpp"
 #include "VectorMath.hpp"
+#include "RayDensityMap.hpp"
+#include "RayTracer.hpp"
+#include "RenderThread.hpp"
+#include "SpatialIndex.hpp"
+#include "SceneHistory.hpp"
+#include "ParameterSweep.hpp"
+#include "Optimizer.hpp"
+#include "DiffTracer.hpp"
+#include "SpotAnalysis.hpp"
+#include "ParaxialSystem.hpp"
+#include "BeamTracer.hpp"
+#include "SceneIO.hpp"
+#include "InputRecorder.hpp"
 #include <iostream>
 
 
@@ -28,6 +44,9 @@ public:
     OpticalApplication();
     ~OpticalApplication();
     void run();
+    // Запись сеанса ввода в файл или воспроизведение записи (вызываются до run)
+    bool recordInput(const std::string& path);
+    bool replayInput(const std::string& path, bool realTime);
 
 private:
     // SFML и окно
@@ -36,18 +55,83 @@ private:
     bool m_fontLoaded;
     sf::Clock m_fpsClock;
     int m_frameCount;
+    uint64_t m_lastRenderedFrames;      // Счётчик кадров потока отрисовки на момент прошлого замера
+    sf::Clock m_updateClock;            // Ограничение частоты цикла обновления
+    RenderThread m_renderThread;
+    sf::View m_view;                    // Масштаб и сдвиг сцены (главный поток; в кадр передаётся копия)
+    bool m_panning;                     // Сдвиг вида правой или средней кнопкой мыши
+    sf::Vector2i m_panLastPixel;
+    InputRecorder m_inputRecorder;      // Запись и воспроизведение сеанса ввода
+    InputRecorder::InputState m_input;  // Ввод текущего шага: мышь и опрашиваемые клавиши
+
+    // Задержка от ввода до экрана при перетаскивании (см. LatencyTracker)
+    bool m_hasPendingInput;             // Ввод текущего шага, ещё не изменивший сцену
+    LatencyStamp::Clock::time_point m_pendingInputTime;
+    LatencyStamp m_latencyStamp;        // Взаимодействие, ожидающее публикации кадра
+    LatencyStamp m_lastPublishedLatency;
+    uint64_t m_publishedSequence;
+    uint64_t m_lastLatencySequence;     // Кадр, с которым опубликовано m_lastPublishedLatency
 
 
     std::vector<OpticalElement*> m_elements;
     std::vector<const PointSource*> m_sources;
-    std::vector<RayPath> m_rayPaths;
+    RayTracer m_tracer;
+    TraceResult m_traceResult;
+
+    // Прогрессивное накопление (метод Монте-Карло)
+    bool m_monteCarloMode;
+    uint64_t m_sceneVersion;              // Увеличивается при каждом изменении сцены
+    uint64_t m_accumulatedSceneVersion;   // Версия сцены, для которой накоплены данные
+    std::vector<uint64_t> m_elementVersions; // Версия сцены при последнем изменении каждого элемента
+    sf::FloatRect m_sceneExtent;          // Границы всех элементов для версии m_sceneExtentVersion
+    uint64_t m_sceneExtentVersion;
+    bool m_accumulationValid;
+    bool m_densityNeedsReset;
+    uint64_t m_accumulatedFrames;
+    std::vector<std::vector<float>> m_accumulatedDetectorBins;
+    DisplayMode m_displayMode;
+    RayDensityMap m_densityMap;
+    uint64_t m_densityVersion;            // Номер последнего обновления пикселей карты плотности
+    bool m_densityPixelsReady;            // Пиксели обновлены и ещё не переданы в кадр
 
     // Состояние и UI-
     Mode m_currentMode;
     OpticalElement::Type m_placementType;
+    bool m_placementSlab;           // Размещаемое тело - пластина, а не призма
     std::optional<size_t> m_selectedElementIndex;
+    std::vector<size_t> m_groupSelection;   // Элементы, выделенные рамкой
+    sf::Vector2f m_marqueeStartPos;         // Начальный угол рамки выделения
+    SpatialIndex m_spatialIndex;            // Сетка для выбора элементов и запросов по рамке
+    std::vector<size_t> m_pickCandidates;   // Буфер кандидатов для запросов к индексу
+    SceneHistory m_history;                 // Снимки сцены для отмены/повтора
+    Optimizer m_optimizer;                  // Фоновая оптимизация параметров (F6) и перебор параметра (F5)
+    sf::Clock m_sweepClock;                 // Время фонового перебора
+    SpotAnalysis m_spotAnalysis;            // Анализ пятна рассеяния (K)
+    bool m_showSpotAnalysis;
+    sf::Text m_spotText;
+    ParaxialSystem m_paraxial;              // Матрицы ABCD соосной цепочки (X)
+    bool m_showParaxial;
+    bool m_paraxialDirty;                   // Цепочку нужно построить заново
+    uint64_t m_paraxialSceneVersion;        // Версия сцены, для которой построена цепочка
+    size_t m_paraxialSourceIndex;           // Источник, от которого построена цепочка
+    std::vector<sf::Vertex> m_paraxialLines;
+    sf::Text m_paraxialText;
+    BeamTracer m_beamTracer;                // Освещённые области вместо отдельных лучей (W)
+    bool m_showBeams;
+    bool m_beamDirty;
+    uint64_t m_beamSceneVersion;            // Версия сцены, для которой построены области
+    sf::Text m_beamText;
     int m_activeHandleIndex; // Используем HandleType для значений
 
+    // Копии элементов для кадров: элемент копируется заново, только если изменился
+    struct FrameElement
+    {
+        const OpticalElement* source = nullptr;
+        uint64_t version = 0;
+        std::shared_ptr<const OpticalElement> copy;
+    };
+    mutable std::vector<FrameElement> m_frameElements;
+
 
     sf::Vector2f m_mousePos;         // Текущая позиция мыши
     sf::Vector2f m_lastMousePos;     // Предыдущая позиция мыши
@@ -57,7 +141,7 @@ private:
     sf::Text m_inputTextDisplay;     // Отображение вводимой строки m_currentInputString
     sf::RectangleShape m_inputBackground; // Фон для поля ввода
 
-    sf::VertexArray m_placementPreviewLine;    // Для Mirror, IdealLens
+    sf::VertexArray m_placementPreviewLine;    // Для Mirror, IdealLens, Detector, DielectricBody
     sf::CircleShape m_placementPreviewCircle;  // Для SphericalMirror
 
 
@@ -74,7 +158,8 @@ private:
 
     void processEvents();           // Обработка всех событий SFML
     void update();                  // Обновление состояния приложения
-    void render();                  // Отрисовка всего
+    void publishFrame();            // Передача данных кадра потоку отрисовки
+    void limitUpdateRate();         // Пауза до следующего шага цикла обновления
     void handleSingleEvent(const sf::Event& event); // Обработчик одного события
     void handleTextEditingEvent(const sf::Event& event); // Если m_currentMode == EDITING_PARAMETER
     void handleGeneralEvent(const sf::Event& event);     // Если m_currentMode != EDITING_PARAMETER
@@ -91,19 +176,54 @@ private:
     void updateDraggingLogic();                // Логика перетаскивания элемента/ручки
     void updateAndPositionParameterEditorUI(); // Расчет размеров/позиций для UI редактирования
     void updateFPSDisplay();                   // Обновление заголовка окна с FPS
-
-    void drawAllRayPaths();
-    void drawActivePlacementPreview();
-    void drawElementsAndUI(); // Рисует элементы, их ручки и текст параметра
-    void drawMainHelpText();
-    void drawParameterEditingUI(); // Рисует UI для ввода текста параметра
-
+    void noteInput();                          // Отметка времени ввода текущего шага
+    void logDragLatency() const;               // Распределение задержки завершённого перетаскивания
+
+    void buildRayVertices(std::vector<sf::Vertex>& vertices, const sf::FloatRect& visible) const; // Пути лучей -> отрезки sf::Lines в видимой области
+    void buildElementsAndUI(RenderFrame& frame) const;              // Копии элементов, ручки и текст параметра
+    const sf::Text* getSelectedParameterText() const;
+    sf::FloatRect getVisibleRect() const;     // Область сцены, видимая в окне
+    void zoomViewAt(const sf::Vector2i& pixel, float wheelDelta); // Масштаб относительно точки под курсором
+    void resetView();
+    void prewarmFontGlyphs();       // Заполнение кэша глифов до запуска потока отрисовки
+
+    const sf::FloatRect& sceneExtent();  // Границы элементов, пересчитываются один раз на версию сцены
+    float sceneRayLength();         // Продолжение ушедших лучей через всю сцену, без учёта вида
+    TraceOptions analysisTraceOptions(); // Параметры трассировки для перебора, оптимизации, пучков и производных
     void traceRaysInternal();       // Трассировка лучей
+    void updateDensityMap();        // Накопление карты плотности по результатам трассировки
+    void updateSpotAnalysis();      // Накопление статистики пятна в плоскости детектора или наилучшей фокусировки
+    void updateParaxialOverlay();   // Пересчёт параксиальной цепочки после изменения сцены
+    void updateBeamTracing();       // Построение освещённых областей после изменения сцены
+    void toggleDisplayMode();
     void rebuildSourcesVector();    // Обновление m_sources
+    void applyDetectorResults();    // Перенос накопленных ячеек в объекты детекторов
+    void markSceneChanged();        // Сцена изменилась: накопленные данные устарели
+    void markElementChanged(size_t index); // Элемент изменился: обновление индекса и версии сцены
+    void noteElementVersion(size_t index); // Версия элемента для кэша копий кадра
+    void markStructureChanged();    // Элементы добавлены или удалены со сдвигом номеров
+    void invalidateAccumulation();  // Сброс накопления без изменения сцены
+    void commitSceneHistory();      // Запись завершённого изменения сцены в историю
+    void undoSceneChange(bool redo); // Ctrl+Z / Ctrl+Y
+    void toggleMonteCarloMode();
+    void toggleImportanceEmission(); // Лучи источников направляются на элементы сцены (I)
+    void exportDetectorData();      // Экспорт гистограмм детекторов в CSV
+    void saveScene();               // Сохранение сцены для batch_trace (Ctrl+S)
+    void runParameterSweep(std::optional<SweepParameter> parameter); // Перебор параметра выбранного элемента (F5); nullopt - основной параметр
+    void toggleOptimization(bool targetCenter); // Запуск/отмена оптимизации выбранных элементов (F6)
+    void applyOptimizerResult();    // Перенос найденных значений в сцену после завершения оптимизации
+    void printSweepResult();        // Таблица и CSV после завершения фонового перебора
+    const Detector* findTargetDetector(int& ordinal) const; // Детектор для метрик пятна: выделенный рамкой или первый в сцене
+    void toggleSpotAnalysis();
+    void toggleParaxialOverlay();
+    void toggleBeamTracing();
+    void printSensitivity();        // Производные пятна на детекторе по параметрам выбранного элемента (J)
 
     std::optional<size_t> findElementAt(const sf::Vector2f& pos); // Находит элемент под курсором
     void selectElementByIndex(std::optional<size_t> index, int handleIndexIfSelected = static_cast<int>(HandleType::MOVE));
     void deleteSelectedElementLogic();
+    void finishMarqueeSelection();
+    sf::FloatRect getMarqueeRect() const;
     void beginParameterEditForSelected();
     void confirmParameterEdit();
     void cancelParameterEdit();
@@ -14,8 +14,10 @@
 #include <iostream>
 
 #include "VectorMath.hpp"
+#include "Spectral.hpp"
 
 
+class OpticalElement;
 
 // Структура, представляющая луч
 struct Ray
@@ -24,6 +26,9 @@ struct Ray
     sf::Vector2f direction;              // Нормализованный вектор направления
     int bounces_left = 5;                // Максимальное количество взаимодействий (отскоков/преломлений)
     sf::Color color = sf::Color::Yellow; // Цвет луча по умолчанию
+    float wavelength = Spectral::DEFAULT_WAVELENGTH; // Длина волны, нм
+    const OpticalElement *medium = nullptr;          // Тело, внутри которого распространяется луч (nullptr - воздух)
+    float intensity = 1.f;                           // Доля энергии исходного луча, переносимая этой ветвью
 };
 
 // Структура для хранения результата взаимодействия луча с элементом
@@ -31,10 +36,14 @@ struct RayAction
 {
     std::optional<Ray> outgoingRay; // Исходящий луч (если взаимодействие произошло)
     sf::Vector2f interactionPoint;  // Точка взаимодействия
+    std::optional<Ray> secondaryRay; // Второй дочерний луч при делении энергии (частичное отражение)
 
     inline RayAction() : outgoingRay(std::nullopt) {}
 
     inline RayAction(sf::Vector2f p, Ray r) : interactionPoint(p), outgoingRay(std::make_optional(r)) {}
+
+    inline RayAction(sf::Vector2f p, Ray r, Ray secondary)
+        : interactionPoint(p), outgoingRay(std::make_optional(r)), secondaryRay(std::make_optional(secondary)) {}
 };
 
 // Базовый класс для всех оптических элементов
@@ -52,6 +61,11 @@ public:
     }
     // Расчет взаимодействия луча (отражение/преломление) в точке пересечения
     virtual RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const { return RayAction(); }
+    // Зависит ли взаимодействие от длины волны
+    virtual bool isDispersive() const { return false; }
+    // Пакетное взаимодействие дисперсионного элемента: направление исходящего луча для каждой дорожки пакета.
+    // Возвращает false, если элемент не поддерживает пакетную обработку
+    virtual bool interactPacket(const RayPacket &packet, const sf::Vector2f &intersectionPoint, sf::Vector2f *outDirections) const { return false; }
 
     // Проверка, находится ли точка рядом с элементом (для выбора мышью)
     virtual bool isPointNear(const sf::Vector2f &point, float tolerance = 5.0f) const = 0;
@@ -59,6 +73,8 @@ public:
     virtual void move(const sf::Vector2f &delta) = 0;
     // Получение центральной точки элемента
     virtual sf::Vector2f getCenter() const = 0;
+    // Ограничивающий прямоугольник геометрии элемента (без ручек и текста)
+    virtual sf::FloatRect getBounds() const { return sf::FloatRect(getCenter(), sf::Vector2f(0.f, 0.f)); }
 
     // Получение позиций ручек управления (по умолчанию только центр)
     virtual std::vector<sf::Vector2f> getHandles() const { return {getCenter()}; }
@@ -99,9 +115,15 @@ public:
         SOURCE,
         MIRROR,
         LENS,
-        SPHERICAL_MIRROR
+        SPHERICAL_MIRROR,
+        DETECTOR,
+        DIELECTRIC,
+        BEAM_SPLITTER
     };
 
+    // Копия элемента (используется потоком отрисовки, чтобы не читать изменяемую сцену)
+    virtual std::unique_ptr<OpticalElement> clone() const = 0;
+
     // Получение типа конкретного элемента
     virtual Type getType() const = 0;
 };
@@ -0,0 +1,271 @@
+#include "OpticsCApi.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "PointSource.hpp"
+#include "Mirror.hpp"
+#include "IdealLens.hpp"
+#include "SphericalMirror.hpp"
+#include "Detector.hpp"
+#include "RayTracer.hpp"
+#include "ParallelFor.hpp"
+
+struct OpticsScene
+{
+    std::vector<std::unique_ptr<OpticalElement>> elements;
+    std::vector<const OpticalElement *> view; // Указатели для RayTracer::trace
+    RayTracer tracer;
+    TraceResult result;                       // Переиспользуется между вызовами
+    std::unique_ptr<Parallel::ThreadPool> pool; // Рабочие потоки трассировки; пересоздаются только при смене thread_count
+    uint64_t vertexCount = 0;
+    bool traced = false;
+};
+
+namespace
+{
+    // Размеры структур первой версии API: меньшие struct_size не принимаются
+    const size_t TRACE_OPTIONS_V1_SIZE = offsetof(OpticsTraceOptions, record_paths) + sizeof(uint32_t);
+    const size_t TRACE_STATS_V1_SIZE = offsetof(OpticsTraceStats, detector_count) + sizeof(uint32_t);
+
+    // Запись поля структуры вызывающей стороны, только если оно умещается в её struct_size
+    // (программа, собранная со старым заголовком, передаёт структуру короче текущей)
+    template <typename Struct, typename T, typename V>
+    void storeField(Struct &out, T Struct::*field, V value)
+    {
+        size_t end = static_cast<size_t>(reinterpret_cast<const char *>(&(out.*field)) - reinterpret_cast<const char *>(&out)) + sizeof(T);
+        if (end <= out.struct_size)
+            out.*field = static_cast<T>(value);
+    }
+
+    // Исключения не должны пересекать границу C
+    template <typename Fn>
+    OpticsStatus guarded(Fn &&fn)
+    {
+        try
+        {
+            return fn();
+        }
+        catch (const std::bad_alloc &)
+        {
+            return OPTICS_ERROR_OUT_OF_MEMORY;
+        }
+        catch (...)
+        {
+            return OPTICS_ERROR_INTERNAL;
+        }
+    }
+
+    OpticsStatus addElement(OpticsScene *scene, std::unique_ptr<OpticalElement> element, uint32_t *outIndex)
+    {
+        scene->view.reserve(scene->elements.size() + 1);
+        scene->elements.push_back(std::move(element));
+        scene->view.push_back(scene->elements.back().get());
+        scene->traced = false;
+        if (outIndex)
+            *outIndex = static_cast<uint32_t>(scene->elements.size() - 1);
+        return OPTICS_OK;
+    }
+}
+
+int32_t optics_api_version(void)
+{
+    return OPTICS_API_VERSION;
+}
+
+OpticsScene *optics_scene_create(void)
+{
+    try
+    {
+        return new OpticsScene();
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void optics_scene_destroy(OpticsScene *scene)
+{
+    delete scene;
+}
+
+OpticsStatus optics_scene_clear(OpticsScene *scene)
+{
+    if (!scene)
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    scene->elements.clear();
+    scene->view.clear();
+    scene->traced = false;
+    return OPTICS_OK;
+}
+
+size_t optics_scene_element_count(const OpticsScene *scene)
+{
+    return scene ? scene->elements.size() : 0;
+}
+
+OpticsStatus optics_scene_add_source(OpticsScene *scene, float x, float y, int32_t rays, float start_angle, float span_angle,
+                                     uint32_t *out_index)
+{
+    if (!scene || rays <= 0 || span_angle <= 0.f)
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    return guarded([&]
+                   { return addElement(scene, std::make_unique<PointSource>(sf::Vector2f(x, y), rays, sf::Color::Yellow, start_angle, span_angle), out_index); });
+}
+
+OpticsStatus optics_scene_add_mirror(OpticsScene *scene, float x1, float y1, float x2, float y2, uint32_t *out_index)
+{
+    if (!scene)
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    return guarded([&]
+                   { return addElement(scene, std::make_unique<Mirror>(sf::Vector2f(x1, y1), sf::Vector2f(x2, y2)), out_index); });
+}
+
+OpticsStatus optics_scene_add_lens(OpticsScene *scene, float x1, float y1, float x2, float y2, float focal_length, uint32_t *out_index)
+{
+    if (!scene || focal_length == 0.f)
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    return guarded([&]
+                   { return addElement(scene, std::make_unique<IdealLens>(sf::Vector2f(x1, y1), sf::Vector2f(x2, y2), focal_length), out_index); });
+}
+
+OpticsStatus optics_scene_add_spherical_mirror(OpticsScene *scene, float center_x, float center_y, float radius, float start_angle,
+                                               float span_angle, uint32_t *out_index)
+{
+    if (!scene || radius <= 0.f || span_angle <= 0.f)
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    return guarded([&]
+                   { return addElement(scene, std::make_unique<SphericalMirror>(sf::Vector2f(center_x, center_y), radius, start_angle, span_angle), out_index); });
+}
+
+OpticsStatus optics_scene_add_detector(OpticsScene *scene, float x1, float y1, float x2, float y2, int32_t bins, uint32_t *out_index)
+{
+    if (!scene || bins <= 0)
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    return guarded([&]
+                   { return addElement(scene, std::make_unique<Detector>(sf::Vector2f(x1, y1), sf::Vector2f(x2, y2), bins), out_index); });
+}
+
+OpticsStatus optics_scene_move_element(OpticsScene *scene, uint32_t index, float dx, float dy)
+{
+    if (!scene || index >= scene->elements.size())
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    scene->elements[index]->move(sf::Vector2f(dx, dy));
+    return OPTICS_OK;
+}
+
+OpticsStatus optics_scene_set_element_angle(OpticsScene *scene, uint32_t index, float angle)
+{
+    if (!scene || index >= scene->elements.size())
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    scene->elements[index]->setAngle(angle);
+    return OPTICS_OK;
+}
+
+void optics_trace_options_init(OpticsTraceOptions *options)
+{
+    if (!options)
+        return;
+    TraceOptions defaults;
+    options->struct_size = sizeof(OpticsTraceOptions);
+    options->max_bounces = defaults.maxBounces;
+    options->max_ray_length = defaults.maxRayLength;
+    options->thread_count = defaults.threadCount;
+    options->record_paths = defaults.recordPaths ? 1u : 0u;
+}
+
+OpticsStatus optics_scene_trace(OpticsScene *scene, const OpticsTraceOptions *options, OpticsTraceStats *stats)
+{
+    if (!scene || (options && options->struct_size < TRACE_OPTIONS_V1_SIZE) || (stats && stats->struct_size < TRACE_STATS_V1_SIZE))
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    // Поля, которых нет в структуре вызывающей стороны, остаются по умолчанию; поля более новой версии игнорируются
+    OpticsTraceOptions settings;
+    optics_trace_options_init(&settings);
+    if (options)
+        std::memcpy(&settings, options, std::min<size_t>(options->struct_size, sizeof(OpticsTraceOptions)));
+    if (settings.max_bounces < 0 || !(settings.max_ray_length > 0.f))
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+
+    return guarded([&]
+                   {
+        TraceOptions traceOptions = scene->tracer.getOptions();
+        traceOptions.maxBounces = settings.max_bounces;
+        traceOptions.maxRayLength = settings.max_ray_length;
+        traceOptions.threadCount = settings.thread_count;
+        traceOptions.recordPaths = settings.record_paths != 0;
+        scene->tracer.setOptions(traceOptions);
+        // Вызывающий поток участвует в трассировке, поэтому пулу нужно на один поток меньше
+        unsigned threads = settings.thread_count > 0 ? settings.thread_count : Parallel::workerCount();
+        if (!scene->pool || scene->pool->threadCount() != threads - 1)
+        {
+            scene->pool.reset();
+            scene->pool = std::make_unique<Parallel::ThreadPool>(threads - 1);
+        }
+        Parallel::ThreadPool::Scope scope(*scene->pool);
+        scene->tracer.trace(scene->view, scene->result);
+
+        scene->vertexCount = 0;
+        for (const RayPath &path : scene->result.paths)
+            scene->vertexCount += path.size();
+        scene->traced = true;
+        if (stats)
+        {
+            storeField(*stats, &OpticsTraceStats::total_rays, scene->result.totalRays);
+            storeField(*stats, &OpticsTraceStats::escaped_rays, scene->result.escapedRays);
+            storeField(*stats, &OpticsTraceStats::escaped_energy, scene->result.escapedEnergy);
+            storeField(*stats, &OpticsTraceStats::path_count, scene->result.paths.size());
+            storeField(*stats, &OpticsTraceStats::vertex_count, scene->vertexCount);
+            storeField(*stats, &OpticsTraceStats::detector_count, scene->result.detectorBins.size());
+        }
+        return OPTICS_OK; });
+}
+
+OpticsStatus optics_scene_get_paths(const OpticsScene *scene, uint64_t *offsets, size_t offset_capacity, OpticsPathVertex *vertices,
+                                    size_t vertex_capacity, uint64_t *out_path_count, uint64_t *out_vertex_count)
+{
+    if (!scene || !scene->traced)
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    const std::vector<RayPath> &paths = scene->result.paths;
+    if (out_path_count)
+        *out_path_count = paths.size();
+    if (out_vertex_count)
+        *out_vertex_count = scene->vertexCount;
+    if (offset_capacity < paths.size() + 1 || vertex_capacity < scene->vertexCount || !offsets || (scene->vertexCount > 0 && !vertices))
+        return OPTICS_ERROR_BUFFER_TOO_SMALL;
+
+    uint64_t position = 0;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        offsets[i] = position;
+        for (const sf::Vertex &vertex : paths[i])
+        {
+            OpticsPathVertex &out = vertices[position++];
+            out.x = vertex.position.x;
+            out.y = vertex.position.y;
+            out.r = vertex.color.r;
+            out.g = vertex.color.g;
+            out.b = vertex.color.b;
+            out.a = vertex.color.a;
+        }
+    }
+    offsets[paths.size()] = position;
+    return OPTICS_OK;
+}
+
+OpticsStatus optics_scene_get_detector_hits(const OpticsScene *scene, uint32_t detector, float *bins, size_t capacity, uint32_t *out_bin_count)
+{
+    if (!scene || !scene->traced || detector >= scene->result.detectorBins.size())
+        return OPTICS_ERROR_INVALID_ARGUMENT;
+    const std::vector<float> &values = scene->result.detectorBins[detector];
+    if (out_bin_count)
+        *out_bin_count = static_cast<uint32_t>(values.size());
+    if (capacity < values.size() || (!values.empty() && !bins))
+        return OPTICS_ERROR_BUFFER_TOO_SMALL;
+    std::copy(values.begin(), values.end(), bins);
+    return OPTICS_OK;
+}
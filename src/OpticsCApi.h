@@ -0,0 +1,127 @@
+#ifndef HEADER_GUARD_OPTICS_C_API_H
+#define HEADER_GUARD_OPTICS_C_API_H
+
+/*
+ * C-интерфейс трассировщика для встраивания в другие программы (библиотека optics_c).
+ * Сцена - непрозрачный объект; элементы добавляются функциями optics_scene_add_*,
+ * индекс элемента возвращается через out_index. Результаты трассировки хранятся в сцене
+ * (пути - во внутреннем формате трассировщика) и при каждом вызове функций чтения копируются
+ * в буферы вызывающей стороны: optics_scene_get_paths переводит все вершины в OpticsPathVertex,
+ * что стоит O(vertex_count). Если нужны только попадания в детекторы, record_paths = 0
+ * избавляет и от хранения путей, и от копирования. Функции чтения результатов сообщают нужный
+ * размер: при нулевой ёмкости (буфер может быть NULL) или недостаточной ёмкости они
+ * записывают требуемое количество и возвращают OPTICS_ERROR_BUFFER_TOO_SMALL.
+ *
+ * Каждая сцена держит собственные рабочие потоки (thread_count - 1, вызывающий поток участвует
+ * в трассировке); они создаются при первой трассировке и при смене thread_count.
+ * Повторная трассировка той же сцены переиспользует внутренние буферы и потоки: после первого
+ * вызова с теми же элементами, числом лучей и thread_count память не выделяется.
+ * Одна сцена не должна использоваться из нескольких потоков одновременно.
+ *
+ * Совместимость: структуры с полем struct_size можно расширять только добавлением полей
+ * в конец; optics_api_version() увеличивается при несовместимых изменениях.
+ * Библиотека принимает struct_size любой версии не меньше первой: недостающие поля параметров
+ * берутся по умолчанию, лишние игнорируются, а поля статистики записываются только в пределах
+ * struct_size вызывающей стороны.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(OPTICS_C_API_BUILD)
+#define OPTICS_API __declspec(dllexport)
+#else
+#define OPTICS_API __declspec(dllimport)
+#endif
+#else
+#define OPTICS_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OPTICS_API_VERSION 1
+
+typedef int32_t OpticsStatus;
+#define OPTICS_OK 0
+#define OPTICS_ERROR_INVALID_ARGUMENT 1
+#define OPTICS_ERROR_BUFFER_TOO_SMALL 2
+#define OPTICS_ERROR_OUT_OF_MEMORY 3
+#define OPTICS_ERROR_INTERNAL 4
+
+typedef struct OpticsScene OpticsScene;
+
+typedef struct OpticsTraceOptions
+{
+    uint32_t struct_size;   /* sizeof(OpticsTraceOptions), заполняется optics_trace_options_init */
+    int32_t max_bounces;    /* Взаимодействий на луч; 0 - по умолчанию */
+    float max_ray_length;   /* Длина продолжения луча, ни во что не попавшего */
+    uint32_t thread_count;  /* 0 - по числу аппаратных потоков */
+    uint32_t record_paths;  /* 0 - пути не сохраняются (доступны только попадания) */
+} OpticsTraceOptions;
+
+typedef struct OpticsTraceStats
+{
+    uint32_t struct_size;     /* sizeof(OpticsTraceStats), заполняется вызывающей стороной */
+    uint64_t total_rays;      /* Первичные лучи с учётом длин волн */
+    uint64_t escaped_rays;    /* Лучи, ушедшие из сцены */
+    double escaped_energy;    /* Ушедшая энергия в долях первичного луча */
+    uint64_t path_count;      /* Пути (для optics_scene_get_paths) */
+    uint64_t vertex_count;    /* Вершины всех путей */
+    uint32_t detector_count;
+} OpticsTraceStats;
+
+/* Вершина пути луча: координаты и цвет (яркость кодирует энергию ветви) */
+typedef struct OpticsPathVertex
+{
+    float x, y;
+    uint8_t r, g, b, a;
+} OpticsPathVertex;
+
+OPTICS_API int32_t optics_api_version(void);
+
+OPTICS_API OpticsScene *optics_scene_create(void);
+OPTICS_API void optics_scene_destroy(OpticsScene *scene);
+OPTICS_API OpticsStatus optics_scene_clear(OpticsScene *scene);
+OPTICS_API size_t optics_scene_element_count(const OpticsScene *scene);
+
+/* Углы в радианах, координаты в единицах сцены */
+OPTICS_API OpticsStatus optics_scene_add_source(OpticsScene *scene, float x, float y, int32_t rays, float start_angle,
+                                                float span_angle, uint32_t *out_index);
+OPTICS_API OpticsStatus optics_scene_add_mirror(OpticsScene *scene, float x1, float y1, float x2, float y2, uint32_t *out_index);
+OPTICS_API OpticsStatus optics_scene_add_lens(OpticsScene *scene, float x1, float y1, float x2, float y2, float focal_length,
+                                              uint32_t *out_index);
+OPTICS_API OpticsStatus optics_scene_add_spherical_mirror(OpticsScene *scene, float center_x, float center_y, float radius,
+                                                          float start_angle, float span_angle, uint32_t *out_index);
+/* Детектор: гистограмма попаданий по bins ячейкам вдоль отрезка (bins ограничивается 4096) */
+OPTICS_API OpticsStatus optics_scene_add_detector(OpticsScene *scene, float x1, float y1, float x2, float y2, int32_t bins,
+                                                  uint32_t *out_index);
+
+/* Изменение положения элемента без перестроения сцены (для циклов оптимизации) */
+OPTICS_API OpticsStatus optics_scene_move_element(OpticsScene *scene, uint32_t index, float dx, float dy);
+OPTICS_API OpticsStatus optics_scene_set_element_angle(OpticsScene *scene, uint32_t index, float angle);
+
+OPTICS_API void optics_trace_options_init(OpticsTraceOptions *options);
+/* options может быть NULL (значения по умолчанию); stats может быть NULL */
+OPTICS_API OpticsStatus optics_scene_trace(OpticsScene *scene, const OpticsTraceOptions *options, OpticsTraceStats *stats);
+
+/*
+ * Пути последней трассировки. Вершины пути i занимают vertices[offsets[i] .. offsets[i + 1]),
+ * поэтому offsets содержит path_count + 1 элементов.
+ * Требуемые размеры записываются в out_path_count и out_vertex_count.
+ */
+OPTICS_API OpticsStatus optics_scene_get_paths(const OpticsScene *scene, uint64_t *offsets, size_t offset_capacity,
+                                               OpticsPathVertex *vertices, size_t vertex_capacity, uint64_t *out_path_count,
+                                               uint64_t *out_vertex_count);
+
+/* Ячейки детектора с номером detector (в порядке добавления детекторов); требуемый размер - out_bin_count */
+OPTICS_API OpticsStatus optics_scene_get_detector_hits(const OpticsScene *scene, uint32_t detector, float *bins, size_t capacity,
+                                                       uint32_t *out_bin_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEADER_GUARD_OPTICS_C_API_H */
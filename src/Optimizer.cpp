@@ -0,0 +1,315 @@
+#include "Optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+
+#include "ParallelFor.hpp"
+
+namespace
+{
+    const double NO_HIT_MERIT = 1e9; // Лучи не попали в детектор
+
+    // Коэффициенты метода Нелдера-Мида
+    const float REFLECTION = 1.f;
+    const float EXPANSION = 2.f;
+    const float CONTRACTION = 0.5f;
+    const float SHRINK = 0.5f;
+}
+
+Optimizer::Optimizer(unsigned threadCount)
+    : m_threadCount(threadCount), m_running(false), m_cancel(false), m_evaluations(0)
+{
+}
+
+Optimizer::~Optimizer()
+{
+    cancel();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+bool Optimizer::start(const SceneSnapshot &scene, const OptimizerRequest &request)
+{
+    if (isRunning() || request.parameters.empty())
+        return false;
+    for (const OptimizerParameter &p : request.parameters)
+    {
+        if (p.elementIndex >= scene.size() || !ParameterSweep::supports(*scene[p.elementIndex], p.parameter))
+            return false;
+    }
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_scene = scene;
+    m_request = request;
+    m_request.traceOptions.recordPaths = false;
+    collectSnapshotElements(m_scene, m_sceneElements);
+    m_evaluations = 0;
+    launch(false, &Optimizer::run);
+    return true;
+}
+
+bool Optimizer::startSweep(const SceneSnapshot &scene, const SweepRequest &request)
+{
+    if (isRunning() || request.elementIndex >= scene.size() || request.steps == 0 ||
+        !ParameterSweep::supports(*scene[request.elementIndex], request.parameter))
+        return false;
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_scene = scene;
+    m_sweepRequest = request;
+    launch(true, &Optimizer::runSweep);
+    return true;
+}
+
+void Optimizer::launch(bool sweep, void (Optimizer::*job)())
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_progress = OptimizerProgress();
+        m_progress.running = true;
+        m_progress.sweep = sweep;
+        m_best.clear();
+        m_sweepResults.clear();
+    }
+    m_cancel.store(false);
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(job, this);
+}
+
+void Optimizer::cancel()
+{
+    m_cancel.store(true);
+}
+
+OptimizerProgress Optimizer::getProgress() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_progress;
+}
+
+bool Optimizer::takeResult(std::vector<float> &values, SceneSnapshot &scene)
+{
+    if (isRunning())
+        return false;
+    if (m_thread.joinable())
+        m_thread.join();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_progress.finished || m_progress.sweep || m_best.empty())
+        return false;
+    m_progress.finished = false;
+    values = m_best;
+    scene = m_scene;
+    return true;
+}
+
+bool Optimizer::takeSweepResult(SweepRequest &request, std::vector<SweepVariant> &results)
+{
+    if (isRunning())
+        return false;
+    if (m_thread.joinable())
+        m_thread.join();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_progress.finished || !m_progress.sweep)
+        return false;
+    m_progress.finished = false;
+    request = m_sweepRequest;
+    results = std::move(m_sweepResults);
+    m_sweepResults.clear();
+    return true;
+}
+
+double Optimizer::evaluatePoint(const SceneSnapshot &scene, const OptimizerRequest &request, const std::vector<float> &values)
+{
+    Worker worker;
+    collectSnapshotElements(scene, worker.elements);
+    TraceOptions options = request.traceOptions;
+    options.recordPaths = false;
+    worker.tracer.setOptions(options);
+    return evaluateWith(worker, scene, request, values);
+}
+
+double Optimizer::evaluateWith(Worker &worker, const SceneSnapshot &scene, const OptimizerRequest &request, const std::vector<float> &values)
+{
+    // Копируются только элементы со свободными параметрами; все параметры элемента применяются к одной копии
+    std::vector<std::unique_ptr<OpticalElement>> copies;
+    std::vector<size_t> copiedIndices;
+    for (size_t i = 0; i < request.parameters.size(); ++i)
+    {
+        const OptimizerParameter &p = request.parameters[i];
+        auto it = std::find(copiedIndices.begin(), copiedIndices.end(), p.elementIndex);
+        OpticalElement *copy;
+        if (it == copiedIndices.end())
+        {
+            copies.push_back(scene[p.elementIndex]->clone());
+            copiedIndices.push_back(p.elementIndex);
+            copy = copies.back().get();
+            worker.elements[p.elementIndex] = copy;
+        }
+        else
+        {
+            copy = copies[it - copiedIndices.begin()].get();
+        }
+        ParameterSweep::applyParameter(*copy, p.parameter, values[i]);
+    }
+
+    worker.tracer.trace(worker.elements, worker.result);
+    SweepVariant metrics;
+    ParameterSweep::evaluate(worker.elements, worker.result, request.detectorIndex, metrics);
+    for (size_t index : copiedIndices)
+        worker.elements[index] = scene[index].get();
+
+    if (metrics.detectorFlux <= 0.0)
+        return NO_HIT_MERIT;
+    if (request.merit == MeritFunction::TARGET_MISS)
+        return std::abs(metrics.spotCenter - request.targetPosition);
+    return metrics.spotRms;
+}
+
+void Optimizer::evaluateBatch(const std::vector<std::vector<float>> &points, std::vector<double> &merits)
+{
+    merits.assign(points.size(), NO_HIT_MERIT);
+    unsigned totalThreads = m_threadCount > 0 ? m_threadCount : Parallel::workerCount();
+    unsigned outerThreads = static_cast<unsigned>(std::min<size_t>(totalThreads, points.size()));
+    if (m_workers.size() < outerThreads)
+        m_workers.resize(outerThreads);
+    TraceOptions options = m_request.traceOptions;
+    options.threadCount = std::max(1u, totalThreads / std::max(1u, outerThreads));
+
+    Parallel::forEachDynamic(points.size(), 1, [&](size_t begin, size_t end, unsigned w)
+    {
+        Worker &worker = m_workers[w];
+        if (worker.elements.size() != m_sceneElements.size())
+            worker.elements = m_sceneElements;
+        worker.tracer.setOptions(options);
+        for (size_t i = begin; i < end; ++i)
+            merits[i] = evaluateWith(worker, m_scene, m_request, points[i]);
+    }, outerThreads);
+    m_evaluations += points.size();
+}
+
+void Optimizer::publishProgress(size_t iteration, double bestMerit, const std::vector<float> &best)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_progress.iteration = iteration;
+    m_progress.evaluations = m_evaluations;
+    m_progress.bestMerit = bestMerit;
+    m_best = best;
+}
+
+void Optimizer::run()
+{
+    const size_t n = m_request.parameters.size();
+
+    // Начальный симплекс: исходная точка и сдвиги по каждому параметру
+    std::vector<std::vector<float>> simplex(n + 1, std::vector<float>(n));
+    for (size_t i = 0; i < n; ++i)
+        simplex[0][i] = m_request.parameters[i].initialValue;
+    for (size_t k = 1; k <= n; ++k)
+    {
+        simplex[k] = simplex[0];
+        simplex[k][k - 1] += m_request.parameters[k - 1].initialStep;
+    }
+    std::vector<double> values;
+    evaluateBatch(simplex, values);
+
+    std::vector<size_t> order(n + 1);
+    std::vector<float> centroid(n);
+    std::vector<std::vector<float>> candidates(4, std::vector<float>(n));
+    std::vector<double> candidateValues;
+    size_t iteration = 0;
+
+    auto lerp = [n](const std::vector<float> &from, const std::vector<float> &to, float t, std::vector<float> &out)
+    {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = from[i] + (to[i] - from[i]) * t;
+    };
+
+    while (!m_cancel.load(std::memory_order_relaxed))
+    {
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::sort(order.begin(), order.end(), [&values](size_t a, size_t b) { return values[a] < values[b]; });
+        size_t best = order.front(), worst = order.back(), secondWorst = order[n - 1];
+        publishProgress(iteration, values[best], simplex[best]);
+        if (iteration >= m_request.maxIterations || values[worst] - values[best] <= m_request.tolerance)
+            break;
+        ++iteration;
+
+        std::fill(centroid.begin(), centroid.end(), 0.f);
+        for (size_t k = 0; k <= n; ++k)
+        {
+            if (k == worst)
+                continue;
+            for (size_t i = 0; i < n; ++i)
+                centroid[i] += simplex[k][i] / static_cast<float>(n);
+        }
+
+        // Отражение, растяжение, внешнее и внутреннее сжатие - одним пакетом
+        lerp(centroid, simplex[worst], -REFLECTION, candidates[0]);
+        lerp(centroid, simplex[worst], -REFLECTION * EXPANSION, candidates[1]);
+        lerp(centroid, simplex[worst], -REFLECTION * CONTRACTION, candidates[2]);
+        lerp(centroid, simplex[worst], CONTRACTION, candidates[3]);
+        evaluateBatch(candidates, candidateValues);
+
+        int accepted = -1;
+        double fr = candidateValues[0];
+        if (fr < values[best])
+            accepted = candidateValues[1] < fr ? 1 : 0;
+        else if (fr < values[secondWorst])
+            accepted = 0;
+        else if (fr < values[worst])
+            accepted = candidateValues[2] <= fr ? 2 : -1;
+        else
+            accepted = candidateValues[3] < values[worst] ? 3 : -1;
+
+        if (accepted >= 0)
+        {
+            simplex[worst] = candidates[accepted];
+            values[worst] = candidateValues[accepted];
+            continue;
+        }
+
+        // Сжатие всего симплекса к лучшей вершине
+        std::vector<std::vector<float>> shrunk;
+        std::vector<size_t> shrunkIndices;
+        for (size_t k = 0; k <= n; ++k)
+        {
+            if (k == best)
+                continue;
+            lerp(simplex[best], simplex[k], SHRINK, simplex[k]);
+            shrunk.push_back(simplex[k]);
+            shrunkIndices.push_back(k);
+        }
+        std::vector<double> shrunkValues;
+        evaluateBatch(shrunk, shrunkValues);
+        for (size_t j = 0; j < shrunkIndices.size(); ++j)
+            values[shrunkIndices[j]] = shrunkValues[j];
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_progress.running = false;
+        m_progress.finished = true;
+        m_progress.cancelled = m_cancel.load();
+    }
+    m_running.store(false, std::memory_order_release);
+}
+
+void Optimizer::runSweep()
+{
+    ParameterSweep sweep(m_threadCount);
+    std::vector<SweepVariant> results;
+    sweep.run(m_scene, m_sweepRequest, results);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sweepResults = std::move(results);
+        m_progress.running = false;
+        m_progress.finished = true;
+    }
+    m_running.store(false, std::memory_order_release);
+}
@@ -0,0 +1,115 @@
+#ifndef HEADER_GUARD_OPTIMIZER_HPP
+#define HEADER_GUARD_OPTIMIZER_HPP
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ParameterSweep.hpp"
+
+// Свободный параметр оптимизации
+struct OptimizerParameter
+{
+    size_t elementIndex = 0;
+    SweepParameter parameter = SweepParameter::ANGLE;
+    float initialValue = 0.f; // Для смещений и поворота - 0
+    float initialStep = 1.f;  // Размер начального симплекса по этому параметру
+};
+
+// Функция качества (минимизируется)
+enum class MeritFunction
+{
+    SPOT_RMS,   // Среднеквадратичный размер пятна на детекторе
+    TARGET_MISS // Расстояние от центра пятна до целевой точки детектора
+};
+
+struct OptimizerRequest
+{
+    std::vector<OptimizerParameter> parameters;
+    MeritFunction merit = MeritFunction::SPOT_RMS;
+    int detectorIndex = 0;
+    float targetPosition = 0.f; // Целевая точка на детекторе (расстояние от его начала)
+    size_t maxIterations = 200;
+    double tolerance = 1e-3;    // Останов, когда значения в вершинах симплекса отличаются меньше
+    TraceOptions traceOptions;
+};
+
+// Состояние оптимизации для отображения
+struct OptimizerProgress
+{
+    size_t iteration = 0;
+    size_t evaluations = 0;
+    double bestMerit = 0.0;
+    bool running = false;
+    bool finished = false; // Результат готов и ещё не забран
+    bool cancelled = false;
+    bool sweep = false;    // Фоновая задача - перебор параметра, а не оптимизация
+};
+
+// Оптимизация параметров элементов методом Нелдера-Мида в фоновом потоке.
+// На каждой итерации отражённая, растянутая и обе сжатые точки вычисляются одним пакетом
+// параллельно (лишние вычисления дешевле последовательных трассировок); сжатие симплекса
+// также вычисляется пакетом. Сцена передаётся снимком, поэтому редактирование во время
+// оптимизации её не затрагивает. Тот же фоновый поток выполняет перебор параметра (F5):
+// перебор и оптимизация занимают все ядра и поэтому не запускаются одновременно.
+class Optimizer
+{
+public:
+    explicit Optimizer(unsigned threadCount = 0);
+    ~Optimizer();
+
+    // false, если оптимизация уже идёт или параметры не поддерживаются элементами сцены
+    bool start(const SceneSnapshot &scene, const OptimizerRequest &request);
+    void cancel();
+    bool isRunning() const { return m_running.load(std::memory_order_acquire); }
+    OptimizerProgress getProgress() const;
+    const OptimizerRequest &getRequest() const { return m_request; } // Последний запущенный запрос
+
+    // Лучшие найденные значения после завершения (false, если результата нет).
+    // scene - снимок, для которого выполнялась оптимизация
+    bool takeResult(std::vector<float> &values, SceneSnapshot &scene);
+
+    // Перебор параметра в фоновом потоке; false, если поток занят или запрос не поддерживается
+    bool startSweep(const SceneSnapshot &scene, const SweepRequest &request);
+    // Результаты перебора после завершения (false, если результата нет)
+    bool takeSweepResult(SweepRequest &request, std::vector<SweepVariant> &results);
+
+    // Значение функции качества для одного набора параметров (вызывающий поток)
+    static double evaluatePoint(const SceneSnapshot &scene, const OptimizerRequest &request, const std::vector<float> &values);
+
+private:
+    struct Worker
+    {
+        RayTracer tracer;
+        std::vector<const OpticalElement *> elements;
+        TraceResult result;
+    };
+
+    void run();
+    void runSweep();
+    void launch(bool sweep, void (Optimizer::*job)());
+    void evaluateBatch(const std::vector<std::vector<float>> &points, std::vector<double> &merits);
+    static double evaluateWith(Worker &worker, const SceneSnapshot &scene, const OptimizerRequest &request, const std::vector<float> &values);
+    void publishProgress(size_t iteration, double bestMerit, const std::vector<float> &best);
+
+    unsigned m_threadCount;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_cancel;
+
+    // Данные фонового потока
+    SceneSnapshot m_scene;
+    OptimizerRequest m_request;
+    std::vector<Worker> m_workers;
+    std::vector<const OpticalElement *> m_sceneElements;
+    size_t m_evaluations;
+    SweepRequest m_sweepRequest;
+
+    mutable std::mutex m_mutex; // Защищает прогресс и результат
+    OptimizerProgress m_progress;
+    std::vector<float> m_best;
+    std::vector<SweepVariant> m_sweepResults;
+};
+
+#endif // HEADER_GUARD_OPTIMIZER_HPP
@@ -0,0 +1,205 @@
+#ifndef HEADER_GUARD_PARALLEL_FOR_HPP
+#define HEADER_GUARD_PARALLEL_FOR_HPP
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace Parallel
+{
+    // Количество рабочих потоков (не меньше одного)
+    inline unsigned workerCount()
+    {
+        unsigned n = std::thread::hardware_concurrency();
+        return n == 0 ? 1u : n;
+    }
+
+    // Постоянные рабочие потоки для forEachChunk и forEachDynamic: потоки создаются один раз,
+    // а не на каждый вызов. Задание - tasks вызовов body(task); вызывающий поток сам выполняет
+    // ещё не взятые задачи своего задания, поэтому вложенные вызовы (трассировка внутри перебора)
+    // не ждут свободного потока и не блокируются, даже если все потоки пула заняты.
+    class ThreadPool
+    {
+    public:
+        // threads - число потоков пула; вызывающий поток участвует дополнительно
+        explicit ThreadPool(unsigned threads)
+        {
+            m_jobs.reserve(16);
+            for (unsigned i = 0; i < threads; ++i)
+                m_threads.emplace_back([this] { workerLoop(); });
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wake.notify_all();
+            for (std::thread &thread : m_threads)
+                thread.join();
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        unsigned threadCount() const { return static_cast<unsigned>(m_threads.size()); }
+
+        // Выполняет body(task) для каждого task из [0, tasks) ровно один раз и ждёт завершения всех задач.
+        // Номер задачи можно использовать как индекс состояния потока: одна задача выполняется одним потоком
+        template <typename Body>
+        void run(unsigned tasks, Body &&body)
+        {
+            if (tasks == 0)
+                return;
+            if (tasks == 1 || m_threads.empty())
+            {
+                for (unsigned task = 0; task < tasks; ++task)
+                    body(task);
+                return;
+            }
+            // Задание живёт в стеке вызывающего потока: оно убирается из очереди до возврата
+            Job job;
+            job.tasks = tasks;
+            job.context = &body;
+            job.invoke = [](void *context, unsigned task) { (*static_cast<Body *>(context))(task); };
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(&job);
+            }
+            if (tasks - 1 >= m_threads.size())
+                m_wake.notify_all();
+            else
+                for (unsigned i = 0; i + 1 < tasks; ++i)
+                    m_wake.notify_one();
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (job.next < job.tasks)
+            {
+                unsigned task = job.next++;
+                lock.unlock();
+                job.invoke(job.context, task);
+                lock.lock();
+                ++job.done;
+            }
+            m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &job));
+            m_finished.wait(lock, [&job] { return job.done == job.tasks; });
+        }
+
+        // Пул процесса: workerCount() - 1 потоков, создаётся при первом обращении
+        static ThreadPool &shared()
+        {
+            static ThreadPool pool(workerCount() - 1);
+            return pool;
+        }
+
+        // Пул для forEachChunk и forEachDynamic текущего потока: заданный ближайшим Scope, иначе shared().
+        // Потоки пула выполняют вложенные вызовы в своём же пуле
+        static ThreadPool &current() { return s_current ? *s_current : shared(); }
+
+        // Выбор пула для параллельных циклов текущего потока на время жизни объекта
+        class Scope
+        {
+        public:
+            explicit Scope(ThreadPool &pool) : m_previous(s_current) { s_current = &pool; }
+            ~Scope() { s_current = m_previous; }
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            ThreadPool *m_previous;
+        };
+
+    private:
+        struct Job
+        {
+            unsigned tasks = 0;
+            unsigned next = 0; // Следующая не взятая задача (под m_mutex)
+            unsigned done = 0; // Завершённые задачи (под m_mutex)
+            void *context = nullptr;
+            void (*invoke)(void *, unsigned) = nullptr;
+        };
+
+        void workerLoop()
+        {
+            s_current = this;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true)
+            {
+                Job *job = nullptr;
+                m_wake.wait(lock, [&]
+                            {
+                                for (Job *candidate : m_jobs)
+                                {
+                                    if (candidate->next < candidate->tasks)
+                                    {
+                                        job = candidate;
+                                        return true;
+                                    }
+                                }
+                                return m_stopping; });
+                if (!job)
+                    return;
+                unsigned task = job->next++;
+                lock.unlock();
+                job->invoke(job->context, task);
+                lock.lock();
+                if (++job->done == job->tasks)
+                    m_finished.notify_all();
+            }
+        }
+
+        static inline thread_local ThreadPool *s_current = nullptr;
+
+        std::vector<std::thread> m_threads;
+        std::vector<Job *> m_jobs; // Задания, у которых могут остаться не взятые задачи
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_finished;
+        bool m_stopping = false;
+    };
+
+    // Делит диапазон [0, count) на непрерывные блоки и вызывает fn(begin, end, workerIndex)
+    // для каждого блока на потоках пула (ThreadPool::current); блоки выполняет и вызывающий поток.
+    template <typename Fn>
+    void forEachChunk(size_t count, Fn &&fn, unsigned maxWorkers = 0)
+    {
+        if (count == 0)
+            return;
+        unsigned workers = maxWorkers > 0 ? maxWorkers : workerCount();
+        workers = static_cast<unsigned>(std::min<size_t>(workers, count));
+        if (workers <= 1)
+        {
+            fn(size_t(0), count, 0u);
+            return;
+        }
+
+        size_t chunk = (count + workers - 1) / workers;
+        unsigned chunks = static_cast<unsigned>((count + chunk - 1) / chunk);
+        ThreadPool::current().run(chunks, [&fn, count, chunk](unsigned w)
+                                  { fn(w * chunk, std::min(count, (w + 1) * chunk), w); });
+    }
+
+    // Динамическое распределение: потоки забирают блоки по grain элементов из общего счётчика.
+    // Подходит для работы неравной стоимости (например, деревьев лучей разного размера)
+    template <typename Fn>
+    void forEachDynamic(size_t count, size_t grain, Fn &&fn, unsigned maxWorkers = 0)
+    {
+        if (count == 0)
+            return;
+        grain = std::max<size_t>(1, grain);
+        unsigned workers = maxWorkers > 0 ? maxWorkers : workerCount();
+        workers = static_cast<unsigned>(std::min<size_t>(workers, (count + grain - 1) / grain));
+        std::atomic<size_t> next(0);
+        ThreadPool::current().run(workers, [&fn, &next, count, grain](unsigned w)
+                                  {
+            for (size_t begin = next.fetch_add(grain); begin < count; begin = next.fetch_add(grain))
+                fn(begin, std::min(count, begin + grain), w); });
+    }
+}
+
+#endif // HEADER_GUARD_PARALLEL_FOR_HPP
@@ -0,0 +1,212 @@
+#include "ParameterSweep.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "ParallelFor.hpp"
+#include "IdealLens.hpp"
+#include "SphericalMirror.hpp"
+#include "PointSource.hpp"
+#include "Detector.hpp"
+
+namespace
+{
+    // Данные потока перебора
+    struct SweepWorker
+    {
+        RayTracer tracer;
+        std::vector<const OpticalElement *> elements; // Сцена потока: заменяется только изменяемый элемент
+        TraceResult result;
+    };
+}
+
+void ParameterSweep::evaluate(const std::vector<const OpticalElement *> &elements, const TraceResult &trace, int detectorIndex, SweepVariant &variant)
+{
+    double emitted = 0.0;
+    for (const OpticalElement *element : elements)
+    {
+        if (const auto *source = dynamic_cast<const PointSource *>(element))
+            emitted += source->numRays;
+    }
+    variant.escapedFraction = emitted > 0.0 ? trace.escapedEnergy / emitted : 0.0;
+    variant.droppedBranches = trace.droppedBranches;
+
+    variant.detectorFlux = 0.0;
+    for (const auto &bins : trace.detectorBins)
+    {
+        for (float v : bins)
+            variant.detectorFlux += v;
+    }
+
+    // Момент первого и второго порядка распределения по ячейкам выбранного детектора
+    variant.spotCenter = 0.0;
+    variant.spotRms = 0.0;
+    if (detectorIndex < 0 || detectorIndex >= static_cast<int>(trace.detectorBins.size()))
+        return;
+    const auto &bins = trace.detectorBins[detectorIndex];
+    const Detector *detector = trace.detectors[detectorIndex];
+    if (bins.empty() || !detector)
+        return;
+    double binWidth = detector->length / static_cast<double>(bins.size());
+    double sum = 0.0, sumX = 0.0, sumXX = 0.0;
+    for (size_t b = 0; b < bins.size(); ++b)
+    {
+        double x = (static_cast<double>(b) + 0.5) * binWidth;
+        sum += bins[b];
+        sumX += bins[b] * x;
+        sumXX += bins[b] * x * x;
+    }
+    if (sum <= 0.0)
+        return;
+    variant.spotCenter = sumX / sum;
+    variant.spotRms = std::sqrt(std::max(0.0, sumXX / sum - variant.spotCenter * variant.spotCenter));
+}
+
+bool ParameterSweep::run(const SceneSnapshot &scene, const SweepRequest &request, std::vector<SweepVariant> &results)
+{
+    results.clear();
+    if (request.elementIndex >= scene.size() || request.steps == 0)
+        return false;
+    const OpticalElement &base = *scene[request.elementIndex];
+    if (!supports(base, request.parameter))
+        return false;
+
+    std::vector<const OpticalElement *> elements;
+    collectSnapshotElements(scene, elements);
+    results.resize(request.steps);
+
+    unsigned totalThreads = m_threadCount > 0 ? m_threadCount : Parallel::workerCount();
+    unsigned outerThreads = static_cast<unsigned>(std::min<size_t>(totalThreads, request.steps));
+    TraceOptions options = request.traceOptions;
+    options.recordPaths = false;
+    options.threadCount = std::max(1u, totalThreads / outerThreads);
+
+    std::vector<SweepWorker> workers(outerThreads);
+    Parallel::forEachDynamic(request.steps, 1, [&](size_t begin, size_t end, unsigned w)
+    {
+        SweepWorker &worker = workers[w];
+        if (worker.elements.empty())
+        {
+            worker.elements = elements;
+            worker.tracer.setOptions(options);
+        }
+        for (size_t i = begin; i < end; ++i)
+        {
+            float t = request.steps > 1 ? static_cast<float>(i) / static_cast<float>(request.steps - 1) : 0.f;
+            SweepVariant &variant = results[i];
+            variant.value = request.from + (request.to - request.from) * t;
+
+            std::unique_ptr<OpticalElement> changed = base.clone();
+            applyParameter(*changed, request.parameter, variant.value);
+            worker.elements[request.elementIndex] = changed.get();
+            worker.tracer.trace(worker.elements, worker.result);
+            evaluate(worker.elements, worker.result, request.detectorIndex, variant);
+            worker.elements[request.elementIndex] = &base;
+        }
+    }, outerThreads);
+    return true;
+}
+
+bool ParameterSweep::supports(const OpticalElement &element, SweepParameter parameter)
+{
+    switch (parameter)
+    {
+    case SweepParameter::FOCAL_LENGTH:
+        return element.getType() == OpticalElement::Type::LENS;
+    case SweepParameter::RADIUS:
+        return element.getType() == OpticalElement::Type::SPHERICAL_MIRROR;
+    case SweepParameter::NUM_RAYS:
+        return element.getType() == OpticalElement::Type::SOURCE;
+    case SweepParameter::ANGLE:
+    case SweepParameter::POSITION_X:
+    case SweepParameter::POSITION_Y:
+        return true;
+    }
+    return false;
+}
+
+void ParameterSweep::applyParameter(OpticalElement &element, SweepParameter parameter, float value)
+{
+    switch (parameter)
+    {
+    case SweepParameter::FOCAL_LENGTH:
+        if (auto *lens = dynamic_cast<IdealLens *>(&element))
+            lens->focalLength = std::abs(value) < 1.f ? (value >= 0.f ? 1.f : -1.f) : value;
+        break;
+    case SweepParameter::RADIUS:
+        if (auto *mirror = dynamic_cast<SphericalMirror *>(&element))
+            mirror->radius = std::abs(value) < 1.f ? (value >= 0.f ? 1.f : -1.f) : value;
+        break;
+    case SweepParameter::NUM_RAYS:
+        if (auto *source = dynamic_cast<PointSource *>(&element))
+            source->numRays = std::max(1, static_cast<int>(std::lround(value)));
+        break;
+    case SweepParameter::ANGLE:
+        element.rotate(value * static_cast<float>(M_PI) / 180.f);
+        break;
+    case SweepParameter::POSITION_X:
+        element.move(sf::Vector2f(value, 0.f));
+        break;
+    case SweepParameter::POSITION_Y:
+        element.move(sf::Vector2f(0.f, value));
+        break;
+    }
+}
+
+float ParameterSweep::currentValue(const OpticalElement &element, SweepParameter parameter)
+{
+    if (const auto *lens = dynamic_cast<const IdealLens *>(&element); lens && parameter == SweepParameter::FOCAL_LENGTH)
+        return lens->focalLength;
+    if (const auto *mirror = dynamic_cast<const SphericalMirror *>(&element); mirror && parameter == SweepParameter::RADIUS)
+        return mirror->radius;
+    if (const auto *source = dynamic_cast<const PointSource *>(&element); source && parameter == SweepParameter::NUM_RAYS)
+        return static_cast<float>(source->numRays);
+    return 0.f;
+}
+
+const char *ParameterSweep::parameterName(SweepParameter parameter)
+{
+    switch (parameter)
+    {
+    case SweepParameter::FOCAL_LENGTH: return "focal_length";
+    case SweepParameter::RADIUS: return "radius";
+    case SweepParameter::ANGLE: return "angle_offset_deg";
+    case SweepParameter::POSITION_X: return "offset_x";
+    case SweepParameter::POSITION_Y: return "offset_y";
+    case SweepParameter::NUM_RAYS: return "num_rays";
+    }
+    return "value";
+}
+
+bool ParameterSweep::writeCsv(const std::string &path, const SweepRequest &request, const std::vector<SweepVariant> &results)
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << "Cannot open file for sweep export: '" << path << "'" << std::endl;
+        return false;
+    }
+    out << parameterName(request.parameter) << ",detector_flux,spot_center,spot_rms,escaped_fraction,dropped_branches\n";
+    for (const SweepVariant &v : results)
+    {
+        out << v.value << "," << v.detectorFlux << "," << v.spotCenter << "," << v.spotRms << ","
+            << v.escapedFraction << "," << v.droppedBranches << "\n";
+    }
+    return true;
+}
+
+void ParameterSweep::printTable(const SweepRequest &request, const std::vector<SweepVariant> &results)
+{
+    std::cout << std::setw(18) << parameterName(request.parameter) << std::setw(14) << "flux" << std::setw(12) << "spot_rms"
+              << std::setw(12) << "escaped" << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+    for (const SweepVariant &v : results)
+    {
+        std::cout << std::setw(18) << v.value << std::setw(14) << v.detectorFlux << std::setw(12) << v.spotRms
+                  << std::setw(12) << v.escapedFraction << "\n";
+    }
+    std::cout << std::defaultfloat << std::flush;
+}
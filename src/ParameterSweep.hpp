@@ -0,0 +1,74 @@
+#ifndef HEADER_GUARD_PARAMETER_SWEEP_HPP
+#define HEADER_GUARD_PARAMETER_SWEEP_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "OpticalElement.hpp"
+#include "RayTracer.hpp"
+#include "SceneHistory.hpp"
+
+// Изменяемый параметр элемента
+enum class SweepParameter
+{
+    FOCAL_LENGTH, // Фокусное расстояние линзы
+    RADIUS,       // Радиус кривизны сферического зеркала
+    ANGLE,        // Поворот относительно текущего положения, градусы
+    POSITION_X,   // Сдвиг по X относительно текущего положения
+    POSITION_Y,   // Сдвиг по Y относительно текущего положения
+    NUM_RAYS      // Количество лучей источника
+};
+
+// Описание перебора: значения from..to с равным шагом, steps вариантов
+struct SweepRequest
+{
+    size_t elementIndex = 0;
+    SweepParameter parameter = SweepParameter::ANGLE;
+    float from = 0.f;
+    float to = 0.f;
+    size_t steps = 1;
+    int detectorIndex = 0;     // Детектор, по которому считается размер пятна (-1 - не считать)
+    TraceOptions traceOptions; // Пути не сохраняются, число потоков задаёт ParameterSweep
+};
+
+// Метрики одного варианта
+struct SweepVariant
+{
+    float value = 0.f;            // Значение параметра
+    double detectorFlux = 0.0;    // Суммарная энергия, попавшая во все детекторы
+    double spotCenter = 0.0;      // Центр пятна на выбранном детекторе (от его начала)
+    double spotRms = 0.0;         // Среднеквадратичный размер пятна на выбранном детекторе
+    double escapedFraction = 0.0; // Доля энергии источников, ушедшая из сцены
+    size_t droppedBranches = 0;
+};
+
+// Перебор параметра элемента без окна. Каждый вариант - копия сцены, в которой заменён
+// только изменяемый элемент (остальные элементы общие, сцена передаётся снимком).
+// Варианты распределяются между потоками; у каждого потока свой трассировщик.
+// Если вариантов меньше, чем потоков, каждый вариант трассируется несколькими потоками.
+class ParameterSweep
+{
+public:
+    explicit ParameterSweep(unsigned threadCount = 0) : m_threadCount(threadCount) {}
+
+    // false, если элемент не поддерживает параметр или номер элемента неверен
+    bool run(const SceneSnapshot &scene, const SweepRequest &request, std::vector<SweepVariant> &results);
+
+    static bool supports(const OpticalElement &element, SweepParameter parameter);
+    // Установка значения параметра в копии элемента
+    static void applyParameter(OpticalElement &element, SweepParameter parameter, float value);
+    // Текущее значение абсолютного параметра (для смещений - 0)
+    static float currentValue(const OpticalElement &element, SweepParameter parameter);
+    static const char *parameterName(SweepParameter parameter);
+    // Метрики результата трассировки (detectorIndex - детектор для размера пятна)
+    static void evaluate(const std::vector<const OpticalElement *> &elements, const TraceResult &trace, int detectorIndex, SweepVariant &variant);
+
+    static bool writeCsv(const std::string &path, const SweepRequest &request, const std::vector<SweepVariant> &results);
+    static void printTable(const SweepRequest &request, const std::vector<SweepVariant> &results);
+
+private:
+    unsigned m_threadCount;
+};
+
+#endif // HEADER_GUARD_PARAMETER_SWEEP_HPP
@@ -0,0 +1,223 @@
+#include "ParaxialSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Constants.hpp"
+#include "VectorMath.hpp"
+#include "PointSource.hpp"
+#include "Mirror.hpp"
+#include "IdealLens.hpp"
+#include "SphericalMirror.hpp"
+
+namespace
+{
+    const float CENTER_TOLERANCE = 2.f;    // Допустимое смещение центра элемента от оси, пикселей
+    const float ANGLE_TOLERANCE = 0.02f;   // Допустимый наклон линзы к оси, радиан
+    const float CHECK_ANGLE = 0.005f;      // Угол проверочного луча к оси, радиан
+    const size_t MAX_CHAIN_ELEMENTS = 64;  // Ось между двумя зеркалами не должна зацикливаться
+    const float AXIS_TAIL = 200.f;         // Продолжение оси за последним элементом при отрисовке
+    const double MIN_POWER = 1e-9;
+
+    float crossProduct(const sf::Vector2f &a, const sf::Vector2f &b) { return a.x * b.y - a.y * b.x; }
+}
+
+const char *ParaxialSystem::stopReasonName(StopReason reason)
+{
+    switch (reason)
+    {
+    case StopReason::NO_SOURCE: return "no source";
+    case StopReason::ESCAPED: return "axis leaves scene";
+    case StopReason::NOT_CENTERED: return "element off axis";
+    case StopReason::OTHER_ELEMENT: return "non-paraxial element";
+    case StopReason::MAX_ELEMENTS: return "too many elements";
+    }
+    return "";
+}
+
+const ParaxialSystem::Result &ParaxialSystem::build(const std::vector<OpticalElement *> &elements, size_t sourceIndex)
+{
+    m_result = Result();
+    Result &r = m_result;
+    const auto *source = sourceIndex < elements.size() ? dynamic_cast<const PointSource *>(elements[sourceIndex]) : nullptr;
+    if (!source)
+        return r;
+
+    // Ось - центральный луч сектора источника
+    float axisAngle = source->startAngle + source->spanAngle / 2.f;
+    Ray axis;
+    axis.origin = source->position;
+    axis.direction = sf::Vector2f(std::cos(axisAngle), std::sin(axisAngle));
+    r.inputDirection = axis.direction;
+    r.axisPoints.push_back(source->position);
+
+    Matrix system;
+    double objectDistance = 0.0;
+    bool hasPower = false;
+    r.stopReason = StopReason::MAX_ELEMENTS;
+    for (size_t step = 0; step < MAX_CHAIN_ELEMENTS; ++step)
+    {
+        size_t hitIndex = elements.size();
+        VectorMath::IntersectionResult hit;
+        hit.distance = AppConstants::MAX_RAY_LENGTH;
+        for (size_t i = 0; i < elements.size(); ++i)
+        {
+            if (!elements[i] || elements[i]->getType() == OpticalElement::Type::SOURCE)
+                continue;
+            VectorMath::IntersectionResult candidate = elements[i]->findIntersection(axis);
+            if (candidate.intersects && candidate.distance > EPSILON && candidate.distance < hit.distance)
+            {
+                hit = candidate;
+                hitIndex = i;
+            }
+        }
+        if (hitIndex == elements.size())
+        {
+            r.stopReason = StopReason::ESCAPED;
+            break;
+        }
+
+        const OpticalElement *element = elements[hitIndex];
+        sf::Vector2f direction = axis.direction;
+        sf::Vector2f outDirection = direction;
+        Matrix elementMatrix;
+        bool accepted = true;
+        switch (element->getType())
+        {
+        case OpticalElement::Type::LENS:
+        {
+            const auto *lens = static_cast<const IdealLens *>(element);
+            sf::Vector2f normal(-std::sin(lens->angle), std::cos(lens->angle));
+            if (std::abs(crossProduct(normal, direction)) > ANGLE_TOLERANCE || VectorMath::distance(hit.point, lens->center) > CENTER_TOLERANCE)
+            {
+                r.stopReason = StopReason::NOT_CENTERED;
+                accepted = false;
+            }
+            else if (std::abs(lens->focalLength) > EPSILON)
+            {
+                elementMatrix = Matrix::thinLens(lens->focalLength);
+                hasPower = true;
+            }
+            break;
+        }
+        case OpticalElement::Type::SPHERICAL_MIRROR:
+        {
+            // Развёрнутое зеркало - линза с f = R/2; вогнутое, если центр кривизны со стороны падающего луча
+            const auto *mirror = static_cast<const SphericalMirror *>(element);
+            sf::Vector2f toCenter = mirror->center - hit.point;
+            if (std::abs(crossProduct(direction, toCenter)) > CENTER_TOLERANCE)
+            {
+                r.stopReason = StopReason::NOT_CENTERED;
+                accepted = false;
+                break;
+            }
+            float halfRadius = std::abs(mirror->radius) / 2.f;
+            elementMatrix = Matrix::thinLens(VectorMath::dot(toCenter, direction) < 0.f ? halfRadius : -halfRadius);
+            outDirection = -direction;
+            hasPower = true;
+            break;
+        }
+        case OpticalElement::Type::MIRROR:
+            // Плоское зеркало только поворачивает ось
+            outDirection = Mirror::reflectDirection(VectorMath::Vec2T<float>(direction), element->getAngle()).value();
+            break;
+        default:
+            r.stopReason = StopReason::OTHER_ELEMENT;
+            accepted = false;
+            break;
+        }
+        if (!accepted)
+        {
+            r.axisPoints.push_back(hit.point);
+            break;
+        }
+
+        double gap = VectorMath::distance(r.axisPoints.back(), hit.point);
+        if (r.elementIndices.empty())
+        {
+            objectDistance = gap;
+            system = elementMatrix;
+        }
+        else
+        {
+            system = elementMatrix * Matrix::translation(gap) * system;
+        }
+        r.elementIndices.push_back(hitIndex);
+        r.axisPoints.push_back(hit.point);
+        r.outputDirection = outDirection;
+        axis.origin = hit.point + outDirection * EPSILON * 10.f;
+        axis.direction = outDirection;
+    }
+
+    r.system = system;
+    r.valid = hasPower;
+    double tail = AXIS_TAIL;
+    if (r.valid)
+    {
+        sf::Vector2f first = r.axisPoints[1];
+        sf::Vector2f last = r.axisPoints[r.elementIndices.size()];
+        const Matrix &m = system;
+        r.afocal = std::abs(m.c) < MIN_POWER;
+        if (!r.afocal)
+        {
+            r.effectiveFocalLength = -1.0 / m.c;
+            r.backFocalDistance = -m.a / m.c;
+            r.frontFocalDistance = -m.d / m.c;
+            r.backFocus = last + r.outputDirection * static_cast<float>(r.backFocalDistance);
+            r.frontFocus = first - r.inputDirection * static_cast<float>(r.frontFocalDistance);
+            r.backPrincipal = last + r.outputDirection * static_cast<float>((1.0 - m.a) / m.c);
+            r.frontPrincipal = first + r.inputDirection * static_cast<float>((m.d - 1.0) / m.c);
+            tail = std::max(tail, r.backFocalDistance + AXIS_TAIL / 4.f);
+        }
+
+        // Изображение источника: перенос от источника до первого элемента и матрица системы
+        Matrix total = system * Matrix::translation(objectDistance);
+        r.imageAtInfinity = std::abs(total.d) < MIN_POWER;
+        if (!r.imageAtInfinity)
+        {
+            r.imageDistance = -total.b / total.d;
+            r.magnification = total.a + r.imageDistance * total.c;
+            r.imagePoint = last + r.outputDirection * static_cast<float>(r.imageDistance);
+            tail = std::max(tail, r.imageDistance + AXIS_TAIL / 4.f);
+        }
+        crossCheck(elements, source->position);
+    }
+
+    // Продолжение оси для отрисовки, если она не закончилась на элементе
+    if (r.stopReason == StopReason::ESCAPED || r.stopReason == StopReason::MAX_ELEMENTS)
+    {
+        sf::Vector2f direction = r.elementIndices.empty() ? r.inputDirection : r.outputDirection;
+        tail = std::min<double>(tail, AppConstants::MAX_RAY_LENGTH);
+        r.axisPoints.push_back(r.axisPoints.back() + direction * static_cast<float>(tail));
+    }
+    return r;
+}
+
+void ParaxialSystem::crossCheck(const std::vector<OpticalElement *> &elements, const sf::Vector2f &sourcePosition)
+{
+    Result &r = m_result;
+    Ray ray;
+    ray.origin = sourcePosition;
+    ray.direction = VectorMath::direction(std::atan2(r.inputDirection.y, r.inputDirection.x) + CHECK_ANGLE).value();
+    ray.bounces_left = static_cast<int>(r.elementIndices.size()) + 1;
+    for (size_t index : r.elementIndices)
+    {
+        VectorMath::IntersectionResult hit = elements[index]->findIntersection(ray);
+        if (!hit.intersects)
+            return;
+        RayAction action = elements[index]->interact(ray, hit.point);
+        if (!action.outgoingRay.has_value())
+            return;
+        ray = action.outgoingRay.value();
+    }
+
+    // Пересечение проверочного луча с осью после последнего элемента
+    sf::Vector2f last = r.axisPoints[r.elementIndices.size()];
+    float denominator = crossProduct(r.outputDirection, ray.direction);
+    if (std::abs(denominator) < EPSILON * CHECK_ANGLE)
+        return;
+    float t = crossProduct(r.outputDirection, last - ray.origin) / denominator;
+    sf::Vector2f crossing = ray.origin + ray.direction * t;
+    r.tracedImageDistance = VectorMath::dot(crossing - last, r.outputDirection);
+    r.checked = true;
+}
@@ -0,0 +1,83 @@
+#ifndef HEADER_GUARD_PARAXIAL_SYSTEM_HPP
+#define HEADER_GUARD_PARAXIAL_SYSTEM_HPP
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+#include <cstddef>
+
+#include "OpticalElement.hpp"
+
+// Параксиальная модель соосной цепочки элементов (матрицы ABCD).
+// Ось строится от источника по центральному направлению его сектора и проходит
+// через элементы в порядке попадания: IdealLens и SphericalMirror должны быть центрированы
+// на оси (линза - перпендикулярна оси, центр кривизны зеркала - на оси), плоское зеркало
+// только поворачивает ось. Зеркала разворачиваются в эквивалентную линзу с f = R/2,
+// поэтому вся цепочка описывается произведением 2x2 матриц (y, u) за O(числа элементов).
+// Цепочка заканчивается на первом элементе другого типа, нецентрированном элементе или уходе оси.
+class ParaxialSystem
+{
+public:
+    // Матрица переноса луча (высота y, наклон u): y' = a*y + b*u, u' = c*y + d*u
+    struct Matrix
+    {
+        double a = 1.0, b = 0.0, c = 0.0, d = 1.0;
+
+        static Matrix translation(double distance) { return {1.0, distance, 0.0, 1.0}; }
+        static Matrix thinLens(double focalLength) { return {1.0, 0.0, -1.0 / focalLength, 1.0}; }
+        // Композиция: сначала other, затем *this
+        Matrix operator*(const Matrix &o) const
+        {
+            return {a * o.a + b * o.c, a * o.b + b * o.d, c * o.a + d * o.c, c * o.b + d * o.d};
+        }
+    };
+
+    enum class StopReason
+    {
+        NO_SOURCE,     // Нет источника
+        ESCAPED,       // Ось ушла из сцены
+        NOT_CENTERED,  // Элемент наклонён или смещён относительно оси
+        OTHER_ELEMENT, // Элемент без параксиальной модели (детектор, тело, делитель)
+        MAX_ELEMENTS   // Слишком длинная цепочка (например, ось между двумя зеркалами)
+    };
+
+    struct Result
+    {
+        bool valid = false;                  // В цепочке есть хотя бы одна линза или сферическое зеркало
+        StopReason stopReason = StopReason::NO_SOURCE;
+        std::vector<size_t> elementIndices;  // Элементы цепочки по ходу оси
+        std::vector<sf::Vector2f> axisPoints; // Источник, точки оси на элементах и конец оси
+        sf::Vector2f inputDirection;         // Направление оси перед первым элементом
+        sf::Vector2f outputDirection;        // Направление оси после последнего элемента
+        Matrix system;                       // От первого до последнего элемента цепочки
+
+        bool afocal = false;                 // c = 0: нет конечного фокусного расстояния
+        double effectiveFocalLength = 0.0;
+        double backFocalDistance = 0.0;      // От последнего элемента до заднего фокуса
+        double frontFocalDistance = 0.0;     // От переднего фокуса до первого элемента
+        sf::Vector2f frontFocus, backFocus;
+        sf::Vector2f frontPrincipal, backPrincipal;
+
+        bool imageAtInfinity = false;
+        double imageDistance = 0.0;          // Изображение источника от последнего элемента (< 0 - мнимое)
+        double magnification = 0.0;
+        sf::Vector2f imagePoint;
+
+        bool checked = false;                // Изображение найдено также реальной трассировкой
+        double tracedImageDistance = 0.0;
+    };
+
+    // Построение цепочки от источника sourceIndex; при изменении сцены вызывается заново
+    const Result &build(const std::vector<OpticalElement *> &elements, size_t sourceIndex);
+    const Result &getResult() const { return m_result; }
+
+    static const char *stopReasonName(StopReason reason);
+
+private:
+    // Проверка параксиальной модели: луч под малым углом к оси проходит через элементы
+    // цепочки их собственными interact(), пересечение с осью сравнивается с imageDistance
+    void crossCheck(const std::vector<OpticalElement *> &elements, const sf::Vector2f &sourcePosition);
+
+    Result m_result;
+};
+
+#endif // HEADER_GUARD_PARAXIAL_SYSTEM_HPP
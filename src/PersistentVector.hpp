@@ -0,0 +1,204 @@
+#ifndef HEADER_GUARD_PERSISTENT_VECTOR_HPP
+#define HEADER_GUARD_PERSISTENT_VECTOR_HPP
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Неизменяемый вектор со структурным разделением (дерево с ветвлением 32).
+// set() и push_back() копируют только путь от корня до изменённого листа - O(log32 N),
+// остальные узлы разделяются между старой и новой версиями.
+template <typename T>
+class PersistentVector
+{
+public:
+    static const unsigned BITS = 5;
+    static const size_t BRANCH = size_t(1) << BITS;
+    static const size_t MASK = BRANCH - 1;
+
+    PersistentVector() = default;
+
+    // Построение из обычного вектора за O(N)
+    static PersistentVector fromVector(const std::vector<T> &items)
+    {
+        PersistentVector result;
+        result.m_size = items.size();
+        if (items.empty())
+            return result;
+        std::vector<NodePtr> level;
+        for (size_t i = 0; i < items.size(); i += BRANCH)
+        {
+            auto leaf = std::make_shared<Node>();
+            size_t end = std::min(items.size(), i + BRANCH);
+            leaf->items.assign(items.begin() + i, items.begin() + end);
+            level.push_back(std::move(leaf));
+        }
+        unsigned shift = 0;
+        while (level.size() > 1)
+        {
+            std::vector<NodePtr> parents;
+            for (size_t i = 0; i < level.size(); i += BRANCH)
+            {
+                auto node = std::make_shared<Node>();
+                size_t end = std::min(level.size(), i + BRANCH);
+                node->children.assign(level.begin() + i, level.begin() + end);
+                parents.push_back(std::move(node));
+            }
+            level = std::move(parents);
+            shift += BITS;
+        }
+        result.m_root = level.front();
+        result.m_shift = shift;
+        return result;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const T &operator[](size_t index) const
+    {
+        const Node *node = m_root.get();
+        for (unsigned shift = m_shift; shift > 0; shift -= BITS)
+            node = node->children[(index >> shift) & MASK].get();
+        return node->items[index & MASK];
+    }
+
+    // Новая версия с заменённым элементом
+    PersistentVector set(size_t index, T value) const
+    {
+        PersistentVector result = *this;
+        result.m_root = setInNode(m_root, m_shift, index, std::move(value));
+        return result;
+    }
+
+    // Новая версия с добавленным в конец элементом
+    PersistentVector push_back(T value) const
+    {
+        PersistentVector result = *this;
+        if (!m_root)
+        {
+            auto leaf = std::make_shared<Node>();
+            leaf->items.push_back(std::move(value));
+            result.m_root = leaf;
+            result.m_size = 1;
+            return result;
+        }
+        // Дерево заполнено: новый корень на уровень выше
+        if (m_size == (BRANCH << m_shift))
+        {
+            auto root = std::make_shared<Node>();
+            root->children.push_back(m_root);
+            result.m_root = root;
+            result.m_shift = m_shift + BITS;
+        }
+        result.m_root = appendToNode(result.m_root, result.m_shift, m_size, std::move(value));
+        result.m_size = m_size + 1;
+        return result;
+    }
+
+    // Новая версия из первых count элементов. Поддеревья целиком левее границы
+    // разделяются, копируется только путь к последнему сохранённому элементу - O(log32 N)
+    PersistentVector take(size_t count) const
+    {
+        if (count >= m_size)
+            return *this;
+        PersistentVector result;
+        if (count == 0)
+            return result;
+        result.m_root = takeFromNode(m_root, m_shift, count);
+        result.m_shift = m_shift;
+        result.m_size = count;
+        // Лишние уровни с единственным потомком убираются
+        while (result.m_shift > 0 && result.m_root->children.size() == 1)
+        {
+            result.m_root = result.m_root->children.front();
+            result.m_shift -= BITS;
+        }
+        return result;
+    }
+
+    void toVector(std::vector<T> &out) const
+    {
+        out.clear();
+        out.reserve(m_size);
+        if (m_root)
+            collect(m_root.get(), m_shift, out);
+    }
+
+    // Совпадают ли версии целиком (один и тот же корень)
+    bool sharesRootWith(const PersistentVector &other) const { return m_root == other.m_root && m_size == other.m_size; }
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node
+    {
+        std::vector<NodePtr> children; // Внутренний узел
+        std::vector<T> items;          // Лист
+    };
+
+    static NodePtr setInNode(const NodePtr &node, unsigned shift, size_t index, T value)
+    {
+        auto copy = std::make_shared<Node>(*node);
+        if (shift == 0)
+            copy->items[index & MASK] = std::move(value);
+        else
+        {
+            size_t slot = (index >> shift) & MASK;
+            copy->children[slot] = setInNode(node->children[slot], shift - BITS, index, std::move(value));
+        }
+        return copy;
+    }
+
+    static NodePtr appendToNode(const NodePtr &node, unsigned shift, size_t index, T value)
+    {
+        auto copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+        if (shift == 0)
+        {
+            copy->items.push_back(std::move(value));
+            return copy;
+        }
+        size_t slot = (index >> shift) & MASK;
+        if (slot < copy->children.size())
+            copy->children[slot] = appendToNode(copy->children[slot], shift - BITS, index, std::move(value));
+        else
+            copy->children.push_back(appendToNode(nullptr, shift - BITS, index, std::move(value)));
+        return copy;
+    }
+
+    static NodePtr takeFromNode(const NodePtr &node, unsigned shift, size_t count)
+    {
+        auto copy = std::make_shared<Node>();
+        if (shift == 0)
+        {
+            copy->items.assign(node->items.begin(), node->items.begin() + count);
+            return copy;
+        }
+        const size_t span = size_t(1) << shift; // Элементов в каждом потомке
+        const size_t full = count / span;
+        copy->children.assign(node->children.begin(), node->children.begin() + full);
+        if (count % span != 0)
+            copy->children.push_back(takeFromNode(node->children[full], shift - BITS, count % span));
+        return copy;
+    }
+
+    static void collect(const Node *node, unsigned shift, std::vector<T> &out)
+    {
+        if (shift == 0)
+        {
+            out.insert(out.end(), node->items.begin(), node->items.end());
+            return;
+        }
+        for (const NodePtr &child : node->children)
+            collect(child.get(), shift - BITS, out);
+    }
+
+    NodePtr m_root;
+    size_t m_size = 0;
+    unsigned m_shift = 0; // Сдвиг индекса для корня (BITS * высота)
+};
+
+#endif // HEADER_GUARD_PERSISTENT_VECTOR_HPP
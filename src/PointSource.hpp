@@ -2,16 +2,20 @@
 #define HEADER_GUARD_POINT_SOURCE_HPP
 
 #include "OpticalElement.hpp"
+#include "Random.hpp"
 
 
 class PointSource : public OpticalElement
 {
 public:
+    static constexpr float HANDLE_DISTANCE = 40.f; // Расстояние от источника до ручек угла
+
     sf::Vector2f position; // Позиция источника
     int numRays;           // Количество испускаемых лучей
     sf::Color color;       // Цвет лучей
     float startAngle;      // Угол начала сектора испускания (в радианах)
     float spanAngle;       // Угловой размер сектора испускания (в радианах)
+    Spectral::SourceSpectrum spectrum;         // Спектр излучения (по умолчанию монохроматический)
     mutable sf::Text numRaysText;              // Текст для отображения кол-ва лучей "N = ..."
     mutable sf::Font const *fontPtr = nullptr; // Указатель на шрифт
 
@@ -31,15 +35,23 @@ public:
     }
 
     Type getType() const override { return Type::SOURCE; }
+    std::unique_ptr<OpticalElement> clone() const override { return std::make_unique<PointSource>(*this); }
 
     // Генерация исходящих лучей в заданном угловом диапазоне
     std::vector<Ray> emitRays() const
     {
         std::vector<Ray> rays;
+        appendRays(rays);
+        return rays;
+    }
+
+    // Добавление исходящих лучей в конец rays (без выделения памяти, если ёмкости хватает)
+    void appendRays(std::vector<Ray> &rays) const
+    {
         if (numRays <= 0 || spanAngle <= EPSILON)
-            return rays;
+            return;
 
-        rays.reserve(numRays);
+        rays.reserve(rays.size() + numRays);
         float angleStep = 0;
         bool fullCircle = (spanAngle >= 2.f * M_PI - EPSILON); // Проверяем, близок ли угол к полному кругу
 
@@ -72,10 +84,44 @@ public:
             }
 
             sf::Vector2f dir = VectorMath::normalize(sf::Vector2f(std::cos(angle), std::sin(angle)));
-            rays.push_back({position, dir, Ray().bounces_left, color});
+            rays.push_back({position, dir, Ray().bounces_left, color, spectrum.wavelengthAt(0)});
         }
-        return rays;
     }
+
+    // Пакет всех длин волн спектра для геометрического луча
+    RayPacket makePacket(const Ray &ray) const
+    {
+        RayPacket packet;
+        packet.origin = ray.origin;
+        packet.direction = ray.direction;
+        packet.bounces_left = ray.bounces_left;
+        packet.laneCount = std::clamp(spectrum.sampleCount, 1, Spectral::MAX_PACKET_LANES);
+        for (int k = 0; k < packet.laneCount; ++k)
+        {
+            packet.wavelength[k] = spectrum.wavelengthAt(k);
+            packet.color[k] = spectrum.isMonochromatic() ? color : Spectral::wavelengthToColor(packet.wavelength[k]);
+        }
+        return packet;
+    }
+
+    // Количество длин волн, испускаемых вдоль каждого направления
+    int getLaneCount() const { return std::clamp(spectrum.sampleCount, 1, Spectral::MAX_PACKET_LANES); }
+
+    void cycleSpectrum()
+    {
+        spectrum.cycle();
+        updateParameterString();
+    }
+
+    // Случайный луч для стохастического режима: направление равномерно распределено в секторе испускания.
+    // Луч однозначно определяется ключом потока и номером, что делает параллельную трассировку воспроизводимой
+    Ray sampleRay(uint64_t streamKey, uint64_t index) const
+    {
+        float angle = startAngle + Random::uniformFloat(streamKey, index) * spanAngle;
+        sf::Vector2f dir(std::cos(angle), std::sin(angle));
+        return {position, dir, Ray().bounces_left, color, spectrum.wavelengthAt(0)};
+    }
+
     void draw(sf::RenderTarget &target) const override
     {
         sf::CircleShape shape(6.f);
@@ -101,20 +147,30 @@ public:
 // Получение ручек: центр (0), начало угла (1), конец угла (2)
     std::vector<sf::Vector2f> getHandles() const override
     {
-        float handleDist = 40.f;
-        sf::Vector2f p1 = position + handleDist * sf::Vector2f(std::cos(startAngle), std::sin(startAngle));
-        sf::Vector2f p2 = position + handleDist * sf::Vector2f(std::cos(startAngle + spanAngle), std::sin(startAngle + spanAngle));
-        return {position, p1, p2};
+        return {position, getStartHandle(), getEndHandle()};
+    }
+    sf::Vector2f getStartHandle() const
+    {
+        return position + HANDLE_DISTANCE * sf::Vector2f(std::cos(startAngle), std::sin(startAngle));
+    }
+    sf::Vector2f getEndHandle() const
+    {
+        return position + HANDLE_DISTANCE * sf::Vector2f(std::cos(startAngle + spanAngle), std::sin(startAngle + spanAngle));
+    }
+    // Ручки угла лежат на окружности этого радиуса вокруг источника
+    sf::FloatRect getBounds() const override
+    {
+        return sf::FloatRect(position.x - HANDLE_DISTANCE, position.y - HANDLE_DISTANCE, 2.f * HANDLE_DISTANCE, 2.f * HANDLE_DISTANCE);
     }
 
+    // Проверка без построения вектора ручек: вызывается при каждом выборе элемента
     int getHandleAtPoint(const sf::Vector2f &point, float tolerance = 8.0f) const override
     {
-        auto handles = getHandles();
-        if (VectorMath::distance(point, handles[1]) <= tolerance)
+        if (VectorMath::distance(point, getStartHandle()) <= tolerance)
             return 1; // Ручка начала угла
-        if (VectorMath::distance(point, handles[2]) <= tolerance)
+        if (VectorMath::distance(point, getEndHandle()) <= tolerance)
             return 2; // Ручка конца угла
-        if (VectorMath::distance(point, handles[0]) <= tolerance)
+        if (VectorMath::distance(point, position) <= tolerance)
             return 0; // Ручка центра
         return -1;    // Не попали
     }
@@ -202,7 +258,12 @@ public:
     {
         if (!fontPtr)
             return;
-        numRaysText.setString("N = " + std::to_string(numRays));
+        std::string text = "N = " + std::to_string(numRays);
+        if (!spectrum.isMonochromatic())
+        {
+            text += " x " + std::to_string(getLaneCount()) + " wavelengths";
+        }
+        numRaysText.setString(text);
 
         sf::Vector2f textPos = position + sf::Vector2f(0, -20.f);
         numRaysText.setCharacterSize(14);
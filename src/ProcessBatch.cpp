@@ -0,0 +1,394 @@
+#include "ProcessBatch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "ParallelFor.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PROCESS_BATCH_POSIX 1
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Detector.hpp"
+#include "RayTracer.hpp"
+#include "SceneIO.hpp"
+#endif
+
+#ifdef PROCESS_BATCH_POSIX
+namespace
+{
+    const size_t SEGMENT_ALIGNMENT = 64; // Кэш-линия: счётчик очереди и слоты не делят строки
+    const int64_t NO_TASK = -1;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Очередь задач требует 64-битных атомарных операций без блокировок");
+    static_assert(std::atomic<int64_t>::is_always_lock_free, "Слоты процессов требуют 64-битных атомарных операций без блокировок");
+
+    enum TaskState : uint32_t
+    {
+        TASK_PENDING = 0,
+        TASK_DONE,
+        TASK_FAILED
+    };
+
+    struct alignas(SEGMENT_ALIGNMENT) SegmentHeader
+    {
+        std::atomic<uint64_t> nextTask; // Очередь задач: следующий свободный номер
+        uint64_t taskCount;
+        uint64_t sceneCount;
+        uint64_t workerCount;
+    };
+
+    struct SceneEntry
+    {
+        uint64_t textOffset, textSize; // Текст сцены в формате SceneIO
+        uint64_t binOffset;            // Ячейки первого кадра сцены (в float от начала области ячеек)
+        uint64_t binCount;             // Ячеек всех детекторов сцены на кадр
+    };
+
+    struct TaskSlot
+    {
+        std::atomic<uint32_t> state;
+        uint32_t scene;
+        uint64_t frame;
+        uint64_t totalRays;
+        double escapedEnergy;
+        double seconds;
+    };
+
+    struct alignas(SEGMENT_ALIGNMENT) WorkerSlot
+    {
+        std::atomic<int64_t> currentTask; // Задача, которую выполняет процесс (NO_TASK - нет)
+    };
+
+    size_t alignUp(size_t value) { return (value + SEGMENT_ALIGNMENT - 1) / SEGMENT_ALIGNMENT * SEGMENT_ALIGNMENT; }
+
+    // Размещение частей в сегменте
+    struct Layout
+    {
+        size_t scenes, tasks, workers, texts, bins, total;
+
+        Layout(size_t sceneCount, size_t taskCount, size_t workerCount, size_t textBytes, size_t binCount)
+        {
+            scenes = alignUp(sizeof(SegmentHeader));
+            tasks = alignUp(scenes + sceneCount * sizeof(SceneEntry));
+            workers = alignUp(tasks + taskCount * sizeof(TaskSlot));
+            texts = alignUp(workers + workerCount * sizeof(WorkerSlot));
+            bins = alignUp(texts + textBytes);
+            total = alignUp(bins + binCount * sizeof(float));
+        }
+    };
+
+    struct Segment
+    {
+        char *base = nullptr;
+        Layout layout;
+
+        SegmentHeader *header() const { return reinterpret_cast<SegmentHeader *>(base); }
+        SceneEntry *scenes() const { return reinterpret_cast<SceneEntry *>(base + layout.scenes); }
+        TaskSlot *tasks() const { return reinterpret_cast<TaskSlot *>(base + layout.tasks); }
+        WorkerSlot *workers() const { return reinterpret_cast<WorkerSlot *>(base + layout.workers); }
+        const char *texts() const { return base + layout.texts; }
+        float *bins() const { return reinterpret_cast<float *>(base + layout.bins); }
+    };
+
+    // Тело рабочего процесса: задачи забираются из очереди, пока она не опустеет
+    int runWorker(const Segment &segment, size_t workerIndex, const ProcessBatch::Settings &settings)
+    {
+        SegmentHeader *header = segment.header();
+        WorkerSlot &slot = segment.workers()[workerIndex];
+
+        TraceOptions options;
+        options.maxRayLength = settings.maxRayLength;
+        options.threadCount = 1; // Параллельность обеспечивают процессы
+        options.recordPaths = false;
+        options.stochastic = true;
+        options.seed = settings.seed;
+        options.importanceEmission = settings.importanceEmission;
+        RayTracer tracer(options);
+        TraceResult result;
+
+        std::vector<std::unique_ptr<OpticalElement>> elements;
+        std::vector<const OpticalElement *> view;
+        int64_t loadedScene = -1;
+        bool sceneValid = false;
+
+        for (;;)
+        {
+            uint64_t taskIndex = header->nextTask.fetch_add(1, std::memory_order_relaxed);
+            if (taskIndex >= header->taskCount)
+                break;
+            slot.currentTask.store(static_cast<int64_t>(taskIndex), std::memory_order_relaxed);
+            TaskSlot &task = segment.tasks()[taskIndex];
+            const SceneEntry &scene = segment.scenes()[task.scene];
+
+            if (static_cast<int64_t>(task.scene) != loadedScene)
+            {
+                std::string error;
+                std::string text(segment.texts() + scene.textOffset, scene.textSize);
+                sceneValid = SceneIO::fromString(text, elements, error);
+                loadedScene = task.scene;
+                view.clear();
+                for (const auto &element : elements)
+                    view.push_back(element.get());
+            }
+            if (!sceneValid)
+            {
+                task.state.store(TASK_FAILED, std::memory_order_release);
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            options.frameIndex = task.frame;
+            tracer.setOptions(options);
+            tracer.trace(view, result);
+            task.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            float *bins = segment.bins() + scene.binOffset + task.frame * scene.binCount;
+            size_t written = 0;
+            for (const auto &detectorBins : result.detectorBins)
+            {
+                for (float value : detectorBins)
+                {
+                    if (written < scene.binCount)
+                        bins[written++] = value;
+                }
+            }
+            task.totalRays = result.totalRays;
+            task.escapedEnergy = result.escapedEnergy;
+            task.state.store(TASK_DONE, std::memory_order_release);
+        }
+        slot.currentTask.store(NO_TASK, std::memory_order_relaxed);
+        return 0;
+    }
+
+    pid_t spawnWorker(const Segment &segment, size_t workerIndex, const ProcessBatch::Settings &settings)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            int code = 1;
+            try
+            {
+                code = runWorker(segment, workerIndex, settings);
+            }
+            catch (...)
+            {
+            }
+            _exit(code); // Без деструкторов и обработчиков atexit родителя
+        }
+        return pid;
+    }
+}
+#endif
+
+bool ProcessBatch::isSupported()
+{
+#ifdef PROCESS_BATCH_POSIX
+    return true;
+#else
+    return false;
+#endif
+}
+
+ProcessBatch::Report ProcessBatch::run(const std::vector<std::string> &sceneTexts, const Settings &settings)
+{
+    Report report;
+#ifndef PROCESS_BATCH_POSIX
+    (void)sceneTexts;
+    (void)settings;
+    report.error = "multi-process tracing requires a POSIX system";
+    return report;
+#else
+    auto wallStart = std::chrono::steady_clock::now();
+    const size_t frames = std::max<size_t>(1, settings.frames);
+
+    // Число ячеек каждой сцены известно только после разбора: детекторы и их ячейки
+    std::vector<size_t> binCounts;
+    size_t textBytes = 0, totalBins = 0;
+    for (size_t i = 0; i < sceneTexts.size(); ++i)
+    {
+        std::vector<std::unique_ptr<OpticalElement>> elements;
+        std::string error;
+        if (!SceneIO::fromString(sceneTexts[i], elements, error))
+        {
+            report.error = "scene " + std::to_string(i) + ": " + error;
+            return report;
+        }
+        size_t bins = 0;
+        for (const auto &element : elements)
+        {
+            if (element->getType() == OpticalElement::Type::DETECTOR)
+                bins += static_cast<const Detector *>(element.get())->numBins;
+        }
+        binCounts.push_back(bins);
+        textBytes += sceneTexts[i].size();
+        totalBins += bins * frames;
+    }
+
+    const size_t taskCount = sceneTexts.size() * frames;
+    unsigned workers = settings.workers > 0 ? settings.workers : Parallel::workerCount();
+    workers = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(workers, taskCount)));
+    report.workers = workers;
+
+    Segment segment{nullptr, Layout(sceneTexts.size(), taskCount, workers, textBytes, totalBins)};
+    // Имя нужно только для открытия: сегмент сразу удаляется из пространства имён и
+    // освобождается системой после завершения всех процессов, даже аварийного
+    std::string name = "/optics_batch_" + std::to_string(getpid());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        report.error = "shm_open failed: " + std::string(std::strerror(errno));
+        return report;
+    }
+    shm_unlink(name.c_str());
+    if (ftruncate(fd, static_cast<off_t>(segment.layout.total)) != 0)
+    {
+        report.error = "ftruncate failed: " + std::string(std::strerror(errno));
+        close(fd);
+        return report;
+    }
+    void *memory = mmap(nullptr, segment.layout.total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        report.error = "mmap failed: " + std::string(std::strerror(errno));
+        return report;
+    }
+    segment.base = static_cast<char *>(memory);
+
+    SegmentHeader *header = new (segment.base) SegmentHeader();
+    header->nextTask.store(0);
+    header->taskCount = taskCount;
+    header->sceneCount = sceneTexts.size();
+    header->workerCount = workers;
+    size_t textOffset = 0, binOffset = 0;
+    for (size_t i = 0; i < sceneTexts.size(); ++i)
+    {
+        SceneEntry &scene = segment.scenes()[i];
+        scene = {textOffset, sceneTexts[i].size(), binOffset, binCounts[i]};
+        std::copy(sceneTexts[i].begin(), sceneTexts[i].end(), segment.base + segment.layout.texts + textOffset);
+        textOffset += sceneTexts[i].size();
+        binOffset += binCounts[i] * frames;
+        for (size_t frame = 0; frame < frames; ++frame)
+        {
+            TaskSlot *task = new (&segment.tasks()[i * frames + frame]) TaskSlot();
+            task->state.store(TASK_PENDING);
+            task->scene = static_cast<uint32_t>(i);
+            task->frame = frame;
+        }
+    }
+    std::vector<pid_t> pids(workers, -1);
+    for (unsigned w = 0; w < workers; ++w)
+    {
+        new (&segment.workers()[w]) WorkerSlot();
+        segment.workers()[w].currentTask.store(NO_TASK);
+    }
+
+    size_t alive = 0;
+    for (unsigned w = 0; w < workers; ++w)
+    {
+        pids[w] = spawnWorker(segment, w, settings);
+        if (pids[w] > 0)
+            ++alive;
+    }
+    if (alive == 0)
+    {
+        report.error = "fork failed: " + std::string(std::strerror(errno));
+        munmap(segment.base, segment.layout.total);
+        return report;
+    }
+
+    // Ожидание процессов; упавший процесс заменяется новым, пока в очереди есть задачи
+    while (alive > 0)
+    {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        auto it = std::find(pids.begin(), pids.end(), pid);
+        if (it == pids.end())
+            continue;
+        --alive;
+        size_t w = static_cast<size_t>(it - pids.begin());
+        pids[w] = -1;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            continue;
+
+        ++report.crashedWorkers;
+        int64_t taskIndex = segment.workers()[w].currentTask.exchange(NO_TASK);
+        if (taskIndex != NO_TASK)
+        {
+            uint32_t pending = TASK_PENDING;
+            segment.tasks()[taskIndex].state.compare_exchange_strong(pending, TASK_FAILED);
+        }
+        if (header->nextTask.load() < taskCount)
+        {
+            pids[w] = spawnWorker(segment, w, settings);
+            if (pids[w] > 0)
+                ++alive;
+        }
+    }
+
+    // Сводка в порядке задач: результат не зависит от числа процессов и порядка выполнения
+    report.scenes.resize(sceneTexts.size());
+    for (size_t i = 0; i < sceneTexts.size(); ++i)
+    {
+        const SceneEntry &scene = segment.scenes()[i];
+        SceneResult &result = report.scenes[i];
+        std::vector<double> binSums(scene.binCount, 0.0);
+        for (size_t frame = 0; frame < frames; ++frame)
+        {
+            const TaskSlot &task = segment.tasks()[i * frames + frame];
+            if (task.state.load(std::memory_order_acquire) != TASK_DONE)
+            {
+                ++result.failedFrames;
+                continue;
+            }
+            ++result.completedFrames;
+            result.totalRays += task.totalRays;
+            result.escapedEnergy += task.escapedEnergy;
+            result.traceSeconds += task.seconds;
+            const float *bins = segment.bins() + scene.binOffset + frame * scene.binCount;
+            for (size_t b = 0; b < scene.binCount; ++b)
+                binSums[b] += bins[b];
+        }
+
+        std::vector<std::unique_ptr<OpticalElement>> elements;
+        std::string error;
+        SceneIO::fromString(sceneTexts[i], elements, error);
+        size_t offset = 0;
+        for (const auto &element : elements)
+        {
+            if (element->getType() != OpticalElement::Type::DETECTOR)
+                continue;
+            size_t count = static_cast<const Detector *>(element.get())->numBins;
+            double flux = 0.0;
+            for (size_t b = offset; b < offset + count; ++b)
+                flux += binSums[b];
+            offset += count;
+            result.detectorFlux.push_back(result.completedFrames > 0 ? flux / result.completedFrames : 0.0);
+        }
+        if (result.completedFrames > 0)
+            result.escapedEnergy /= result.completedFrames;
+    }
+
+    munmap(segment.base, segment.layout.total);
+    report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    report.ok = true;
+    return report;
+#endif
+}
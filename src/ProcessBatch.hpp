@@ -0,0 +1,55 @@
+#ifndef HEADER_GUARD_PROCESS_BATCH_HPP
+#define HEADER_GUARD_PROCESS_BATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Constants.hpp"
+
+// Пакетная трассировка в нескольких процессах на одной машине (только POSIX).
+// Координатор размещает сцены (в текстовом формате SceneIO), очередь задач и буферы результатов
+// в сегменте разделяемой памяти и запускает рабочие процессы. Задача - один стохастический кадр
+// одной сцены; рабочие забирают номера задач атомарным счётчиком без блокировок, трассируют
+// в одном потоке и записывают ячейки детекторов в слот задачи. Падение рабочего процесса не
+// прерывает пакет: его задача помечается неудачной, вместо него запускается новый процесс.
+// Результаты суммируются в порядке задач, поэтому не зависят от числа процессов.
+class ProcessBatch
+{
+public:
+    struct Settings
+    {
+        unsigned workers = 0;       // 0 - по числу аппаратных потоков
+        size_t frames = 64;         // Кадров (задач) на сцену
+        uint64_t seed = 1;
+        float maxRayLength = AppConstants::MAX_RAY_LENGTH;
+        bool importanceEmission = false;
+    };
+
+    struct SceneResult
+    {
+        std::vector<double> detectorFlux; // Средняя за кадр сумма ячеек каждого детектора
+        double escapedEnergy = 0.0;       // Средняя за кадр ушедшая энергия
+        size_t totalRays = 0;             // Первичные лучи всех выполненных кадров
+        size_t completedFrames = 0;
+        size_t failedFrames = 0;          // Кадры, на которых рабочий процесс упал или сцена не разобрана
+        double traceSeconds = 0.0;        // Суммарное время трассировки кадров во всех процессах
+    };
+
+    struct Report
+    {
+        bool ok = false;
+        std::string error;
+        std::vector<SceneResult> scenes;
+        unsigned workers = 0;
+        size_t crashedWorkers = 0;
+        double wallSeconds = 0.0;
+    };
+
+    static bool isSupported();
+    // sceneTexts - сцены в формате SceneIO
+    static Report run(const std::vector<std::string> &sceneTexts, const Settings &settings);
+};
+
+#endif // HEADER_GUARD_PROCESS_BATCH_HPP
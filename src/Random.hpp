@@ -0,0 +1,48 @@
+#ifndef HEADER_GUARD_RANDOM_HPP
+#define HEADER_GUARD_RANDOM_HPP
+
+#include <cstdint>
+
+// Счётчиковый генератор случайных чисел: значение зависит только от ключа потока
+// и номера выборки, поэтому результат не зависит от порядка вычислений и числа потоков.
+namespace Random
+{
+    // Финализатор SplitMix64
+    inline uint64_t mix64(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    inline uint64_t counterHash(uint64_t key, uint64_t counter)
+    {
+        return mix64(key ^ mix64(counter + 0x9e3779b97f4a7c15ULL));
+    }
+
+    // Ключ потока из нескольких идентификаторов (например, seed, номер источника, номер кадра)
+    inline uint64_t streamKey(uint64_t seed, uint64_t a, uint64_t b = 0)
+    {
+        return mix64(seed ^ mix64(a * 0x9e3779b97f4a7c15ULL ^ mix64(b + 0x632be59bd9b4e019ULL)));
+    }
+
+    // Равномерное число в [0, 1)
+    inline float uniformFloat(uint64_t key, uint64_t counter)
+    {
+        return static_cast<float>(counterHash(key, counter) >> 40) * (1.0f / 16777216.0f);
+    }
+
+    // Поток выборок с последовательным счётчиком
+    struct CounterRng
+    {
+        uint64_t key;
+        uint64_t counter;
+
+        float nextFloat() { return uniformFloat(key, counter++); }
+    };
+}
+
+#endif // HEADER_GUARD_RANDOM_HPP
@@ -0,0 +1,177 @@
+#include "RayDensityMap.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include "VectorMath.hpp"
+#include "ParallelFor.hpp"
+
+RayDensityMap::RayDensityMap(unsigned width, unsigned height)
+    : m_width(0), m_height(0), m_maxDensity(0.f)
+{
+    resize(width, height);
+}
+
+void RayDensityMap::resize(unsigned width, unsigned height)
+{
+    m_width = std::max(1u, width);
+    m_height = std::max(1u, height);
+    m_worldRect = sf::FloatRect(0.f, 0.f, static_cast<float>(m_width), static_cast<float>(m_height));
+    m_density.assign(static_cast<size_t>(m_width) * m_height, 0.f);
+    m_pixels.assign(static_cast<size_t>(m_width) * m_height * 4, 0);
+    m_maxDensity = 0.f;
+}
+
+void RayDensityMap::setWorldRect(const sf::FloatRect &rect)
+{
+    if (rect.width > EPSILON && rect.height > EPSILON)
+    {
+        m_worldRect = rect;
+    }
+}
+
+void RayDensityMap::clear()
+{
+    std::fill(m_density.begin(), m_density.end(), 0.f);
+    m_maxDensity = 0.f;
+}
+
+sf::Vector2f RayDensityMap::worldToPixel(const sf::Vector2f &p) const
+{
+    return sf::Vector2f((p.x - m_worldRect.left) * m_width / m_worldRect.width,
+                        (p.y - m_worldRect.top) * m_height / m_worldRect.height);
+}
+
+void RayDensityMap::accumulate(const std::vector<RayPath> &paths, float weight)
+{
+    if (paths.empty())
+        return;
+
+    // Полосы строк те же, что у forEachChunk с тем же числом потоков
+    const unsigned workers = static_cast<unsigned>(std::min<size_t>(Parallel::workerCount(), m_height));
+    const size_t bandRows = (m_height + workers - 1) / workers;
+    // Раскладка тоже параллельна: поток раскладки t пишет отрезки полосы w в m_bands[t * workers + w]
+    const unsigned binners = static_cast<unsigned>(std::min<size_t>(workers, paths.size()));
+    m_bands.resize(static_cast<size_t>(workers) * workers);
+    for (auto &band : m_bands)
+        band.clear();
+
+    Parallel::forEachChunk(paths.size(), [&](size_t begin, size_t end, unsigned binner)
+                           {
+        std::vector<BandSegment> *bands = &m_bands[static_cast<size_t>(binner) * workers];
+        for (size_t p = begin; p < end; ++p)
+        {
+            const RayPath &path = paths[p];
+            for (size_t i = 1; i < path.size(); ++i)
+            {
+                sf::Vector2f a = worldToPixel(path[i - 1].position);
+                sf::Vector2f b = worldToPixel(path[i].position);
+                float minY = std::min(a.y, b.y), maxY = std::max(a.y, b.y);
+                if (!(maxY >= -1.f && minY <= static_cast<float>(m_height) + 1.f))
+                    continue;
+                // Полоса w принимает строки [w * bandRows - 1, (w + 1) * bandRows + 1]
+                long first = static_cast<long>(std::floor((minY - 1.f) / bandRows)) - 1;
+                long last = static_cast<long>(std::floor((maxY + 1.f) / bandRows));
+                first = std::max(first, 0L);
+                last = std::min(last, static_cast<long>(workers) - 1);
+                // Отрезок несёт энергию, записанную в его конечной вершине
+                float segmentWeight = weight * path[i].intensity;
+                for (long band = first; band <= last; ++band)
+                    bands[band].push_back({a, b, segmentWeight});
+            }
+        } }, binners);
+
+    // Каждый поток владеет своей полосой строк; пиксели полос не пересекаются.
+    // Отрезки полосы обходятся в порядке путей, как при последовательной раскладке
+    Parallel::forEachChunk(m_height, [&](size_t rowBegin, size_t rowEnd, unsigned worker)
+                           {
+        const float bandTop = static_cast<float>(rowBegin) - 1.f;
+        const float bandBottom = static_cast<float>(rowEnd) + 1.f;
+        for (unsigned binner = 0; binner < binners; ++binner)
+        {
+            for (const BandSegment &segment : m_bands[static_cast<size_t>(binner) * workers + worker])
+            {
+                sf::Vector2f a = segment.a, b = segment.b;
+                if (!VectorMath::clipSegmentToRect(a, b, -1.f, bandTop, static_cast<float>(m_width) + 1.f, bandBottom))
+                    continue;
+                splatSegment(a, b, segment.weight, static_cast<int>(rowBegin), static_cast<int>(rowEnd));
+            }
+        } }, workers);
+}
+
+void RayDensityMap::splatSegment(sf::Vector2f a, sf::Vector2f b, float weight, int rowBegin, int rowEnd)
+{
+    const int width = static_cast<int>(m_width);
+    float *density = m_density.data();
+    auto plot = [&](int col, int row, float w)
+    {
+        if (row >= rowBegin && row < rowEnd && col >= 0 && col < width)
+            density[static_cast<size_t>(row) * width + col] += w;
+    };
+
+    bool steep = std::abs(b.y - a.y) > std::abs(b.x - a.x);
+    if (steep)
+    {
+        std::swap(a.x, a.y);
+        std::swap(b.x, b.y);
+    }
+    if (a.x > b.x)
+        std::swap(a, b);
+
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    float gradient = (dx < EPSILON) ? 0.f : dy / dx;
+    // Вес на пиксель пропорционален длине отрезка внутри столбца
+    float w = weight * std::sqrt(1.f + gradient * gradient);
+
+    int xStart = static_cast<int>(std::round(a.x));
+    int xEnd = static_cast<int>(std::round(b.x));
+    for (int x = xStart; x <= xEnd; ++x)
+    {
+        float y = a.y + gradient * (static_cast<float>(x) - a.x);
+        int yi = static_cast<int>(std::floor(y));
+        float frac = y - static_cast<float>(yi);
+        if (steep)
+        {
+            plot(yi, x, (1.f - frac) * w);
+            plot(yi + 1, x, frac * w);
+        }
+        else
+        {
+            plot(x, yi, (1.f - frac) * w);
+            plot(x, yi + 1, frac * w);
+        }
+    }
+}
+
+void RayDensityMap::updatePixels()
+{
+    m_pixels.resize(m_density.size() * 4);
+
+    // Максимум плотности по полосам
+    unsigned workers = Parallel::workerCount();
+    std::vector<float> partialMax(workers, 0.f);
+    Parallel::forEachChunk(m_density.size(), [&](size_t begin, size_t end, unsigned worker)
+                           {
+        float localMax = 0.f;
+        for (size_t i = begin; i < end; ++i)
+            localMax = std::max(localMax, m_density[i]);
+        partialMax[worker] = localMax; }, workers);
+    m_maxDensity = *std::max_element(partialMax.begin(), partialMax.end());
+
+    const float invLogMax = m_maxDensity > EPSILON ? 1.f / std::log1p(m_maxDensity) : 0.f;
+    Parallel::forEachChunk(m_density.size(), [&](size_t begin, size_t end, unsigned)
+                           {
+        for (size_t i = begin; i < end; ++i)
+        {
+            float t = std::min(1.f, std::log1p(m_density[i]) * invLogMax);
+            // Тепловая шкала: синий -> красный -> жёлтый -> белый
+            float r = std::min(1.f, t * 2.f);
+            float g = std::clamp(t * 2.f - 0.8f, 0.f, 1.f);
+            float bl = std::clamp(std::max(0.6f - t * 2.f, t * 3.f - 2.f), 0.f, 1.f);
+            m_pixels[i * 4 + 0] = static_cast<sf::Uint8>(r * 255.f);
+            m_pixels[i * 4 + 1] = static_cast<sf::Uint8>(g * 255.f);
+            m_pixels[i * 4 + 2] = static_cast<sf::Uint8>(bl * 255.f);
+            m_pixels[i * 4 + 3] = static_cast<sf::Uint8>(std::min(1.f, t * 3.f) * 255.f);
+        } });
+}
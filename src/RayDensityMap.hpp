@@ -0,0 +1,61 @@
+#ifndef HEADER_GUARD_RAY_DENSITY_MAP_HPP
+#define HEADER_GUARD_RAY_DENSITY_MAP_HPP
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+#include "AppDefs.hpp"
+
+// Карта плотности лучей: отрезки путей растеризуются со сглаживанием в буфер float,
+// затем буфер тонально отображается в RGBA-пиксели. Стоимость отрисовки зависит
+// только от числа пикселей, а не от количества лучей. Текстуру из пикселей
+// создаёт поток отрисовки (см. RenderThread).
+class RayDensityMap
+{
+public:
+    RayDensityMap(unsigned width, unsigned height);
+
+    // Изменение размера буфера (сбрасывает накопленные данные)
+    void resize(unsigned width, unsigned height);
+    // Область мировых координат, отображаемая в буфер
+    void setWorldRect(const sf::FloatRect &rect);
+    const sf::FloatRect &getWorldRect() const { return m_worldRect; }
+    // Обнуление буфера плотности
+    void clear();
+
+    // Накопление отрезков всех путей. Экран делится на горизонтальные полосы; потоки параллельно
+    // раскладывают отрезки своих путей по полосам, затем каждая полоса обрабатывается одним потоком без атомиков.
+    void accumulate(const std::vector<RayPath> &paths, float weight = 1.f);
+
+    // Тональное отображение буфера в пиксели (логарифмическая шкала)
+    void updatePixels();
+    // Обмен пиксельного буфера с внешним: кадр забирает пиксели без копирования,
+    // а карта получает освободившийся буфер, который полностью перезапишется при следующем updatePixels
+    void swapPixels(std::vector<sf::Uint8> &pixels) { m_pixels.swap(pixels); }
+
+    unsigned getWidth() const { return m_width; }
+    unsigned getHeight() const { return m_height; }
+    float getMaxDensity() const { return m_maxDensity; }
+
+private:
+    // Отрезок в пиксельных координатах с весом
+    struct BandSegment
+    {
+        sf::Vector2f a, b;
+        float weight;
+    };
+
+    // Сглаженная (алгоритм Ву) растеризация отрезка в строках [rowBegin, rowEnd)
+    void splatSegment(sf::Vector2f a, sf::Vector2f b, float weight, int rowBegin, int rowEnd);
+    sf::Vector2f worldToPixel(const sf::Vector2f &p) const;
+
+    unsigned m_width;
+    unsigned m_height;
+    sf::FloatRect m_worldRect;
+    std::vector<float> m_density;    // Накопленная плотность (длина лучей на пиксель)
+    std::vector<sf::Uint8> m_pixels; // RGBA после тонального отображения
+    float m_maxDensity;
+    std::vector<std::vector<BandSegment>> m_bands; // Отрезки по потоку раскладки и полосе (память переиспользуется)
+};
+
+#endif // HEADER_GUARD_RAY_DENSITY_MAP_HPP
@@ -0,0 +1,537 @@
+#include "RayTracer.hpp"
+
+#include <algorithm>
+
+#include "PointSource.hpp"
+#include "Detector.hpp"
+#include "ParallelFor.hpp"
+
+namespace
+{
+    const size_t SWEEP_MIN_TARGETS = 8;    // Угловой обход окупается сортировкой лучей только при многих элементах
+}
+
+RayTracer::RayTracer(const TraceOptions &options) : m_options(options)
+{
+}
+
+void RayTracer::trace(const std::vector<OpticalElement *> &elements, TraceResult &result)
+{
+    trace(elements.data(), elements.size(), result);
+}
+
+void RayTracer::trace(const std::vector<const OpticalElement *> &elements, TraceResult &result)
+{
+    trace(elements.data(), elements.size(), result);
+}
+
+void RayTracer::prepareScene(const OpticalElement *const *elements, size_t count, TraceResult &result)
+{
+    m_targets.clear();
+    m_targetDetector.clear();
+    m_mediumTargets.clear();
+    m_detectorOffsets.clear();
+    m_primaryRays.clear();
+    m_sourceRanges.clear();
+    m_primaryRayCount = 0;
+    m_pathCount = 0;
+    m_totalBins = 0;
+    result.detectors.clear();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const OpticalElement *el = elements[i];
+        if (!el)
+            continue;
+        if (el->getType() == OpticalElement::Type::SOURCE)
+        {
+            if (const auto *source = dynamic_cast<const PointSource *>(el))
+            {
+                if (source->getNumRays() <= 0 || source->spanAngle <= EPSILON)
+                    continue;
+                SourceRange range{source, m_primaryRayCount, m_pathCount, source->getLaneCount(), 0, EmissionPlan()};
+                if (m_options.importanceEmission)
+                    range.plan = EmissionPlan::build(*source, elements, count, m_options.emptyDirectionRays);
+                size_t rayCount = 0;
+                if (m_options.stochastic)
+                {
+                    // Лучи генерируются потоками по номеру, здесь запоминается только диапазон
+                    range.streamKey = Random::streamKey(m_options.seed, m_sourceRanges.size(), m_options.frameIndex);
+                    rayCount = static_cast<size_t>(source->getNumRays());
+                }
+                else if (range.plan.isActive())
+                {
+                    rayCount = static_cast<size_t>(source->getNumRays());
+                    for (size_t i = 0; i < rayCount; ++i)
+                        m_primaryRays.push_back(range.plan.ray(*source, i));
+                }
+                else
+                {
+                    size_t firstRay = m_primaryRays.size();
+                    source->appendRays(m_primaryRays);
+                    rayCount = m_primaryRays.size() - firstRay;
+                }
+                m_sourceRanges.push_back(range);
+                m_primaryRayCount += rayCount;
+                m_pathCount += rayCount * static_cast<size_t>(range.lanes);
+            }
+            continue;
+        }
+        int detectorIndex = -1;
+        if (el->getType() == OpticalElement::Type::DETECTOR)
+        {
+            if (const auto *detector = dynamic_cast<const Detector *>(el))
+            {
+                detectorIndex = static_cast<int>(result.detectors.size());
+                result.detectors.push_back(detector);
+                m_detectorOffsets.push_back(m_totalBins);
+                m_totalBins += static_cast<size_t>(detector->getNumBins());
+            }
+        }
+        m_targets.push_back(el);
+        m_targetDetector.push_back(detectorIndex);
+    }
+
+    for (const OpticalElement *body : m_targets)
+    {
+        if (body->getType() != OpticalElement::Type::DIELECTRIC)
+            continue;
+        sf::FloatRect bounds = body->getBounds();
+        std::vector<size_t> &candidates = m_mediumTargets[body];
+        for (size_t i = 0; i < m_targets.size(); ++i)
+        {
+            sf::FloatRect other = m_targets[i]->getBounds();
+            // Прямоугольники нулевой толщины (горизонтальные и вертикальные отрезки) проверяются по замкнутым границам
+            bool overlaps = other.left <= bounds.left + bounds.width && other.left + other.width >= bounds.left &&
+                            other.top <= bounds.top + bounds.height && other.top + other.height >= bounds.top;
+            if (m_targets[i] == body || overlaps)
+                candidates.push_back(i);
+        }
+    }
+}
+
+void RayTracer::trace(const OpticalElement *const *elements, size_t count, TraceResult &result)
+{
+    prepareScene(elements, count, result);
+
+    result.totalRays = m_pathCount;
+    result.escapedRays = 0;
+    result.escapedEnergy = 0.0;
+    result.droppedBranches = 0;
+    if (m_options.recordPaths)
+    {
+        result.paths.resize(m_pathCount);
+    }
+    else
+    {
+        result.paths.clear();
+    }
+
+    unsigned workers = m_options.threadCount > 0 ? m_options.threadCount : Parallel::workerCount();
+    m_workers.resize(std::max(1u, workers));
+    for (auto &state : m_workers)
+    {
+        state.bins.assign(m_totalBins, 0.f);
+        state.escapedRays = 0;
+        state.escapedEnergy = 0.0;
+        state.droppedBranches = 0;
+        state.branchPathCount = 0;
+        state.rayQueue.reserve(m_options.maxPendingBranches);
+        state.packetQueue.reserve(m_options.maxPendingBranches);
+    }
+
+    solvePrimaryHits();
+    // Деревья лучей имеют разный размер, поэтому первичные лучи раздаются потокам небольшими порциями
+    Parallel::forEachDynamic(m_primaryRayCount, m_options.batchSize, [&](size_t begin, size_t end, unsigned worker)
+                             { traceRange(begin, end, m_workers[worker], result); }, static_cast<unsigned>(m_workers.size()));
+
+    // Слияние буферов потоков
+    result.detectorBins.resize(result.detectors.size());
+    for (size_t d = 0; d < result.detectors.size(); ++d)
+    {
+        size_t bins = static_cast<size_t>(result.detectors[d]->getNumBins());
+        std::vector<float> &merged = result.detectorBins[d];
+        merged.assign(bins, 0.f);
+        for (const auto &state : m_workers)
+        {
+            for (size_t b = 0; b < bins; ++b)
+                merged[b] += state.bins[m_detectorOffsets[d] + b];
+        }
+    }
+    size_t branchPaths = 0;
+    for (const auto &state : m_workers)
+    {
+        result.escapedRays += state.escapedRays;
+        result.escapedEnergy += state.escapedEnergy;
+        result.droppedBranches += state.droppedBranches;
+        branchPaths += state.branchPathCount;
+    }
+
+    // Пути дочерних ветвей переносятся обменом, чтобы буферы потоков сохраняли выделенную память
+    if (m_options.recordPaths)
+    {
+        size_t pathIndex = m_pathCount;
+        result.paths.resize(m_pathCount + branchPaths);
+        for (auto &state : m_workers)
+        {
+            for (size_t i = 0; i < state.branchPathCount; ++i)
+                std::swap(result.paths[pathIndex++], state.branchPaths[i]);
+        }
+    }
+}
+
+const RayTracer::SourceRange &RayTracer::findRange(size_t rayIndex, size_t &rangeHint) const
+{
+    // Лучи обходятся по возрастанию номера, поэтому диапазон источника только сдвигается вперёд
+    while (rangeHint + 1 < m_sourceRanges.size() && m_sourceRanges[rangeHint + 1].firstRay <= rayIndex)
+        ++rangeHint;
+    return m_sourceRanges[rangeHint];
+}
+
+Ray RayTracer::primaryRay(size_t rayIndex, const SourceRange &range) const
+{
+    Ray ray;
+    if (!m_options.stochastic)
+        ray = m_primaryRays[rayIndex];
+    else if (range.plan.isActive())
+        ray = range.plan.sampleRay(*range.source, range.streamKey, rayIndex - range.firstRay);
+    else
+        ray = range.source->sampleRay(range.streamKey, rayIndex - range.firstRay);
+    if (m_options.maxBounces > 0)
+        ray.bounces_left = m_options.maxBounces;
+    return ray;
+}
+
+float RayTracer::primaryWeight(size_t rayIndex, const SourceRange &range) const
+{
+    return range.plan.isActive() ? range.plan.weight(rayIndex - range.firstRay) : 1.f;
+}
+
+void RayTracer::solvePrimaryHits()
+{
+    m_primaryHits.clear();
+    if (!m_options.angularSweep || m_targets.size() < SWEEP_MIN_TARGETS || m_primaryRayCount == 0)
+        return;
+    m_primaryHits.resize(m_primaryRayCount);
+    if (m_options.stochastic)
+    {
+        m_sweepRays.resize(m_primaryRayCount);
+        size_t rangeHint = 0;
+        for (size_t rayIndex = 0; rayIndex < m_primaryRayCount; ++rayIndex)
+            m_sweepRays[rayIndex] = primaryRay(rayIndex, findRange(rayIndex, rangeHint));
+    }
+    const std::vector<Ray> &rays = m_options.stochastic ? m_sweepRays : m_primaryRays;
+
+    for (const SourceRange &range : m_sourceRanges)
+    {
+        size_t count = static_cast<size_t>(range.source->getNumRays());
+        const Ray *sourceRays = rays.data() + range.firstRay;
+        m_sweepOrder.resize(count);
+        for (size_t i = 0; i < count; ++i)
+            m_sweepOrder[i] = AngularSweep::sweepRay(sourceRays[i], static_cast<uint32_t>(i));
+        std::sort(m_sweepOrder.begin(), m_sweepOrder.end());
+
+        // Каждый поток обходит свой диапазон углов, начиная с собственного множества активных элементов
+        m_sweep.build(range.source->position, m_targets, static_cast<unsigned>(m_workers.size()));
+        Hit *hits = m_primaryHits.data() + range.firstRay;
+        Parallel::forEachChunk(count, [&](size_t begin, size_t end, unsigned worker)
+                               { m_sweep.solve(sourceRays, m_sweepOrder.data(), begin, end, m_options.maxRayLength, hits, worker); },
+                               static_cast<unsigned>(m_workers.size()));
+    }
+}
+
+void RayTracer::traceRange(size_t begin, size_t end, WorkerState &state, TraceResult &result) const
+{
+    size_t rangeHint = 0;
+    for (size_t rayIndex = begin; rayIndex < end; ++rayIndex)
+    {
+        const SourceRange &range = findRange(rayIndex, rangeHint);
+        Ray ray = primaryRay(rayIndex, range);
+        float weight = primaryWeight(rayIndex, range);
+        size_t pathIndex = range.firstPath + (rayIndex - range.firstRay) * static_cast<size_t>(range.lanes);
+        RayPath *paths = m_options.recordPaths ? &result.paths[pathIndex] : nullptr;
+        // Решения рулетки зависят только от номера луча, а не от потока, который его обрабатывает
+        state.rng = Random::CounterRng{Random::streamKey(m_options.seed ^ 0x5bd1e995ULL, rayIndex, m_options.frameIndex), 0};
+
+        if (range.lanes == 1)
+        {
+            if (paths)
+            {
+                paths->clear();
+                paths->push_back(PathVertex(ray.origin, ray.color, ray.intensity * weight));
+            }
+            traceRay(ray, weight, paths, state, primaryHit(rayIndex));
+        }
+        else
+        {
+            RayPacket packet = range.source->makePacket(ray);
+            RayPath *lanePaths[Spectral::MAX_PACKET_LANES] = {};
+            if (paths)
+            {
+                for (int k = 0; k < packet.laneCount; ++k)
+                {
+                    lanePaths[k] = &paths[k];
+                    lanePaths[k]->clear();
+                    lanePaths[k]->push_back(PathVertex(packet.origin, packet.color[k], ray.intensity * weight / static_cast<float>(packet.laneCount)));
+                }
+            }
+            tracePacket(packet, weight, lanePaths, state, primaryHit(rayIndex));
+        }
+    }
+}
+
+RayTracer::Hit RayTracer::findClosestHit(const Ray &ray) const
+{
+    Hit hit;
+    hit.intersection.distance = m_options.maxRayLength;
+    hit.targetIndex = m_targets.size();
+    auto testTarget = [&](size_t i)
+    {
+        VectorMath::IntersectionResult intersection = m_targets[i]->findIntersection(ray);
+        if (intersection.intersects && intersection.distance > EPSILON && intersection.distance < hit.intersection.distance)
+        {
+            hit.intersection = intersection;
+            hit.targetIndex = i;
+        }
+    };
+
+    // Луч внутри тела не может выйти за его границы, не пересёкши их.
+    // Если пересечения нет, среда луча устарела (скользящее попадание в ребро) - проверяются все элементы
+    if (ray.medium)
+    {
+        auto it = m_mediumTargets.find(ray.medium);
+        if (it != m_mediumTargets.end())
+        {
+            for (size_t i : it->second)
+                testTarget(i);
+            if (hit.targetIndex < m_targets.size())
+                return hit;
+        }
+    }
+    for (size_t i = 0; i < m_targets.size(); ++i)
+        testTarget(i);
+    return hit;
+}
+
+void RayTracer::recordDetectorHit(const Hit &hit, const Ray &ray, float weight, WorkerState &state) const
+{
+    int detectorIndex = m_targetDetector[hit.targetIndex];
+    if (detectorIndex < 0)
+        return;
+    const Detector *detector = static_cast<const Detector *>(m_targets[hit.targetIndex]);
+    size_t bin = m_detectorOffsets[detectorIndex] + static_cast<size_t>(detector->binIndexAt(hit.intersection.point));
+    state.bins[bin] += detector->hitWeight(ray) * ray.intensity * weight;
+}
+
+bool RayTracer::survives(Ray &ray, WorkerState &state) const
+{
+    if (ray.bounces_left <= 0 || ray.intensity <= 0.f)
+        return false;
+    const float threshold = m_options.rouletteThreshold;
+    if (ray.intensity >= threshold)
+        return true;
+    // Вероятность выживания пропорциональна энергии: оценка остаётся несмещённой
+    if (state.rng.nextFloat() * threshold >= ray.intensity)
+        return false;
+    ray.intensity = threshold;
+    return true;
+}
+
+// Прозрачность пути отражает долю энергии ветви
+static sf::Color branchColor(const Ray &ray)
+{
+    sf::Color color = ray.color;
+    color.a = static_cast<sf::Uint8>(color.a * std::sqrt(std::clamp(ray.intensity, 0.f, 1.f)));
+    return color;
+}
+
+RayPath *RayTracer::beginBranchPath(WorkerState &state, const sf::Vector2f &start, const sf::Color &color, float intensity) const
+{
+    if (!m_options.recordPaths)
+        return nullptr;
+    if (state.branchPathCount == state.branchPaths.size())
+        state.branchPaths.emplace_back();
+    RayPath &path = state.branchPaths[state.branchPathCount++];
+    path.clear();
+    path.push_back(PathVertex(start, color, intensity));
+    return &path;
+}
+
+void RayTracer::traceRay(const Ray &ray, float weight, RayPath *path, WorkerState &state, const Hit *firstHit) const
+{
+    // Дерево обходится в глубину: очередь содержит не больше одной ветви на уровень вложенности
+    state.rayQueue.push_back({ray, weight, path});
+    while (!state.rayQueue.empty())
+    {
+        PendingRay pending = state.rayQueue.back();
+        state.rayQueue.pop_back();
+        traceBranch(pending.ray, pending.weight, pending.path, state, firstHit);
+        firstHit = nullptr;
+    }
+}
+
+void RayTracer::traceBranch(Ray currentRay, float weight, RayPath *path, WorkerState &state, const Hit *firstHit) const
+{
+    while (currentRay.bounces_left > 0)
+    {
+        Hit hit = firstHit ? *firstHit : findClosestHit(currentRay);
+        firstHit = nullptr;
+        if (hit.targetIndex < m_targets.size())
+        {
+            const OpticalElement *hitElement = m_targets[hit.targetIndex];
+            if (path)
+                path->push_back(PathVertex(hit.intersection.point, branchColor(currentRay), currentRay.intensity * weight));
+            recordDetectorHit(hit, currentRay, weight, state);
+
+            RayAction interaction = hitElement->interact(currentRay, hit.intersection.point);
+            if (interaction.secondaryRay.has_value() && survives(interaction.secondaryRay.value(), state))
+            {
+                if (state.rayQueue.size() < m_options.maxPendingBranches)
+                {
+                    const Ray &branch = interaction.secondaryRay.value();
+                    state.rayQueue.push_back({branch, weight, beginBranchPath(state, hit.intersection.point, branchColor(branch), branch.intensity * weight)});
+                }
+                else
+                {
+                    ++state.droppedBranches;
+                }
+            }
+            if (interaction.outgoingRay.has_value() && survives(interaction.outgoingRay.value(), state))
+            {
+                currentRay = interaction.outgoingRay.value();
+            }
+            else
+            {
+                break;
+            }
+        }
+        else
+        {
+            if (path)
+                path->push_back(PathVertex(currentRay.origin + currentRay.direction * m_options.maxRayLength, branchColor(currentRay), currentRay.intensity * weight));
+            ++state.escapedRays;
+            state.escapedEnergy += currentRay.intensity * weight;
+            break;
+        }
+    }
+}
+
+void RayTracer::tracePacket(const RayPacket &packet, float weight, RayPath *const *lanePaths, WorkerState &state, const Hit *firstHit) const
+{
+    // Геометрический луч пакета; длина волны первой дорожки используется для недисперсионных элементов
+    Ray geometric{packet.origin, packet.direction, packet.bounces_left, packet.color[0], packet.wavelength[0]};
+    PendingPacket root{geometric, {}};
+    std::copy(lanePaths, lanePaths + Spectral::MAX_PACKET_LANES, root.lanePaths);
+    state.packetQueue.push_back(root);
+    while (!state.packetQueue.empty())
+    {
+        PendingPacket pending = state.packetQueue.back();
+        state.packetQueue.pop_back();
+        tracePacketBranch(packet, weight, pending.geometric, pending.lanePaths, state, firstHit);
+        firstHit = nullptr;
+    }
+}
+
+void RayTracer::tracePacketBranch(const RayPacket &packet, float weight, Ray geometric, RayPath *const *lanePaths, WorkerState &state,
+                                  const Hit *firstHit) const
+{
+    const int lanes = packet.laneCount;
+    const float laneWeight = weight / static_cast<float>(lanes);
+
+    auto appendToLanes = [&](const sf::Vector2f &point)
+    {
+        for (int k = 0; k < lanes; ++k)
+        {
+            if (!lanePaths[k])
+                continue;
+            sf::Color color = packet.color[k];
+            color.a = branchColor(geometric).a;
+            lanePaths[k]->push_back(PathVertex(point, color, geometric.intensity * laneWeight));
+        }
+    };
+
+    while (geometric.bounces_left > 0)
+    {
+        Hit hit = firstHit ? *firstHit : findClosestHit(geometric);
+        firstHit = nullptr;
+        if (hit.targetIndex >= m_targets.size())
+        {
+            appendToLanes(geometric.origin + geometric.direction * m_options.maxRayLength);
+            state.escapedRays += static_cast<size_t>(lanes);
+            state.escapedEnergy += geometric.intensity * weight;
+            return;
+        }
+
+        const OpticalElement *hitElement = m_targets[hit.targetIndex];
+        const sf::Vector2f &point = hit.intersection.point;
+        appendToLanes(point);
+        // Все дорожки попадают в одну ячейку детектора
+        recordDetectorHit(hit, geometric, weight, state);
+
+        if (!hitElement->isDispersive())
+        {
+            RayAction interaction = hitElement->interact(geometric, point);
+            if (interaction.secondaryRay.has_value() && survives(interaction.secondaryRay.value(), state))
+            {
+                if (state.packetQueue.size() < m_options.maxPendingBranches)
+                {
+                    PendingPacket branch{interaction.secondaryRay.value(), {}};
+                    for (int k = 0; k < lanes; ++k)
+                    {
+                        sf::Color color = packet.color[k];
+                        color.a = branchColor(branch.geometric).a;
+                        branch.lanePaths[k] = lanePaths[k] ? beginBranchPath(state, point, color, branch.geometric.intensity * laneWeight) : nullptr;
+                    }
+                    state.packetQueue.push_back(branch);
+                }
+                else
+                {
+                    ++state.droppedBranches;
+                }
+            }
+            if (!interaction.outgoingRay.has_value() || !survives(interaction.outgoingRay.value(), state))
+                return;
+            geometric = interaction.outgoingRay.value();
+            continue;
+        }
+
+        // Дисперсионный элемент: направления по дорожкам
+        RayPacket current = packet;
+        current.origin = geometric.origin;
+        current.direction = geometric.direction;
+        current.bounces_left = geometric.bounces_left;
+        sf::Vector2f directions[Spectral::MAX_PACKET_LANES];
+        bool coherent = hitElement->interactPacket(current, point, directions);
+        for (int k = 1; coherent && k < lanes; ++k)
+        {
+            sf::Vector2f d = directions[k] - directions[0];
+            coherent = std::abs(d.x) < Spectral::PACKET_COHERENCE_EPSILON && std::abs(d.y) < Spectral::PACKET_COHERENCE_EPSILON;
+        }
+        if (coherent)
+        {
+            geometric.direction = directions[0];
+            geometric.origin = point + directions[0] * EPSILON * 10.f;
+            geometric.bounces_left -= 1;
+            continue;
+        }
+
+        // Пути дорожек разошлись: дальше каждая длина волны трассируется отдельно
+        for (int k = 0; k < lanes; ++k)
+        {
+            Ray laneRay = geometric;
+            laneRay.wavelength = packet.wavelength[k];
+            laneRay.color = packet.color[k];
+            RayAction interaction = hitElement->interact(laneRay, point);
+            if (interaction.secondaryRay.has_value() && survives(interaction.secondaryRay.value(), state))
+            {
+                const Ray &branch = interaction.secondaryRay.value();
+                traceRay(branch, laneWeight, lanePaths[k] ? beginBranchPath(state, point, branchColor(branch), branch.intensity * laneWeight) : nullptr, state);
+            }
+            if (interaction.outgoingRay.has_value() && survives(interaction.outgoingRay.value(), state))
+            {
+                traceRay(interaction.outgoingRay.value(), laneWeight, lanePaths[k], state);
+            }
+        }
+        return;
+    }
+}
@@ -0,0 +1,156 @@
+#ifndef HEADER_GUARD_RAY_TRACER_HPP
+#define HEADER_GUARD_RAY_TRACER_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <deque>
+
+#include "AppDefs.hpp"
+#include "Constants.hpp"
+#include "OpticalElement.hpp"
+#include "Random.hpp"
+#include "EmissionPlan.hpp"
+#include "AngularSweep.hpp"
+
+class PointSource;
+class Detector;
+
+// Параметры трассировки
+struct TraceOptions
+{
+    float maxRayLength = AppConstants::MAX_RAY_LENGTH; // Длина продолжения луча, ни во что не попавшего
+    unsigned threadCount = 0;                          // 0 - по числу аппаратных потоков
+    bool recordPaths = true;                           // Сохранять ли пути лучей для отрисовки
+    bool stochastic = false;                           // Случайные направления вместо равномерного веера
+    uint64_t seed = 0;                                 // Начальное значение для стохастического режима
+    uint64_t frameIndex = 0;                           // Номер кадра: каждый кадр получает свежую выборку
+    float rouletteThreshold = 0.05f;                   // Ветви слабее этой доли энергии проходят русскую рулетку
+    size_t maxPendingBranches = 64;                    // Ёмкость очереди отложенных ветвей одного потока
+    size_t batchSize = 64;                             // Число первичных лучей, забираемых потоком за раз
+    bool importanceEmission = false;                   // Лучи источников направляются на элементы (см. EmissionPlan)
+    int emptyDirectionRays = AppConstants::IMPORTANCE_EMPTY_RAYS; // Лучи, представляющие пустые направления источника
+    bool angularSweep = true;                          // Первое попадание первичных лучей - угловым обходом (см. AngularSweep)
+    int maxBounces = 0;                                // Взаимодействий на первичный луч; 0 - по умолчанию (Ray::bounces_left)
+};
+
+// Результат трассировки сцены
+struct TraceResult
+{
+    std::vector<RayPath> paths;                   // Путь каждого первичного луча и каждой его длины волны (если recordPaths)
+    std::vector<const Detector *> detectors;      // Детекторы сцены в порядке их следования
+    std::vector<std::vector<float>> detectorBins; // Ячейки детекторов, по одному вектору на детектор
+    size_t totalRays = 0;                         // Количество первичных лучей (с учётом всех длин волн)
+    size_t escapedRays = 0;                       // Лучи, ушедшие из сцены без поглощения
+    double escapedEnergy = 0.0;                   // Энергия, ушедшая из сцены (в долях первичного луча)
+    size_t droppedBranches = 0;                   // Ветви, отброшенные из-за переполнения очереди
+};
+
+// Трассировщик лучей, не зависящий от окна приложения.
+// Первичные лучи делятся между потоками; каждый поток накапливает попадания
+// в детекторы в собственный буфер, буферы суммируются после завершения потоков.
+// Лучи источников с несколькими длинами волн трассируются пакетами (см. RayPacket).
+// Если взаимодействие делит луч (RayAction::secondaryRay), дочерняя ветвь откладывается
+// в ограниченную очередь потока; слабые ветви обрываются русской рулеткой.
+// Пути дочерних ветвей добавляются в TraceResult::paths после путей первичных лучей.
+class RayTracer
+{
+public:
+    explicit RayTracer(const TraceOptions &options = TraceOptions());
+
+    void setOptions(const TraceOptions &options) { m_options = options; }
+    const TraceOptions &getOptions() const { return m_options; }
+
+    // Трассировка лучей всех источников сцены
+    void trace(const OpticalElement *const *elements, size_t count, TraceResult &result);
+    void trace(const std::vector<OpticalElement *> &elements, TraceResult &result);
+    void trace(const std::vector<const OpticalElement *> &elements, TraceResult &result);
+
+private:
+    // Локальное состояние рабочего потока
+    // Отложенная ветвь одиночного луча
+    struct PendingRay
+    {
+        Ray ray;
+        float weight;
+        RayPath *path;
+    };
+
+    // Отложенная ветвь пакета длин волн
+    struct PendingPacket
+    {
+        Ray geometric;
+        RayPath *lanePaths[Spectral::MAX_PACKET_LANES];
+    };
+
+    struct WorkerState
+    {
+        std::vector<float> bins; // Ячейки всех детекторов подряд (см. m_detectorOffsets)
+        size_t escapedRays = 0;
+        double escapedEnergy = 0.0;
+        size_t droppedBranches = 0;
+        std::vector<PendingRay> rayQueue;
+        std::vector<PendingPacket> packetQueue;
+        std::deque<RayPath> branchPaths; // deque: указатели на пути не меняются при добавлении
+        size_t branchPathCount = 0;
+        Random::CounterRng rng{0, 0};    // Рулетка; ключ зависит от номера первичного луча
+    };
+
+    // Диапазон первичных лучей одного источника
+    struct SourceRange
+    {
+        const PointSource *source;
+        size_t firstRay;    // Номер первого геометрического луча
+        size_t firstPath;   // Номер первого пути (на каждый луч приходится lanes путей)
+        int lanes;          // Число длин волн на геометрический луч
+        uint64_t streamKey; // Ключ потока случайных чисел (стохастический режим)
+        EmissionPlan plan;  // Выборка по значимости (если активна)
+    };
+
+    // Ближайшее пересечение луча с элементами сцены
+    using Hit = AngularSweep::Hit;
+
+    void prepareScene(const OpticalElement *const *elements, size_t count, TraceResult &result);
+    void traceRange(size_t begin, size_t end, WorkerState &state, TraceResult &result) const;
+    const SourceRange &findRange(size_t rayIndex, size_t &rangeHint) const;
+    Ray primaryRay(size_t rayIndex, const SourceRange &range) const;
+    // Вес первичного луча: 1 для равномерного веера, отношение долей сектора при выборке по значимости
+    float primaryWeight(size_t rayIndex, const SourceRange &range) const;
+    // Первые попадания всех первичных лучей угловым обходом по источникам (m_primaryHits)
+    void solvePrimaryHits();
+    const Hit *primaryHit(size_t rayIndex) const { return m_primaryHits.empty() ? nullptr : &m_primaryHits[rayIndex]; }
+    Hit findClosestHit(const Ray &ray) const;
+    void recordDetectorHit(const Hit &hit, const Ray &ray, float weight, WorkerState &state) const;
+    // Русская рулетка: слабая ветвь либо обрывается, либо продолжается с энергией порога
+    bool survives(Ray &ray, WorkerState &state) const;
+    // Новый путь для дочерней ветви (nullptr, если пути не сохраняются)
+    RayPath *beginBranchPath(WorkerState &state, const sf::Vector2f &start, const sf::Color &color, float intensity) const;
+    // Трассировка дерева одиночного луча; weight - доля луча в пакете (для дорожек спектрального пакета 1/K).
+    // firstHit - заранее найденное первое попадание луча (nullptr - искать перебором)
+    void traceRay(const Ray &ray, float weight, RayPath *path, WorkerState &state, const Hit *firstHit = nullptr) const;
+    void traceBranch(Ray currentRay, float weight, RayPath *path, WorkerState &state, const Hit *firstHit) const;
+    // Трассировка пакета длин волн как одного геометрического луча до расхождения дорожек; weight - вес первичного луча
+    void tracePacket(const RayPacket &packet, float weight, RayPath *const *lanePaths, WorkerState &state, const Hit *firstHit = nullptr) const;
+    void tracePacketBranch(const RayPacket &packet, float weight, Ray geometric, RayPath *const *lanePaths, WorkerState &state, const Hit *firstHit) const;
+
+    TraceOptions m_options;
+    std::vector<const OpticalElement *> m_targets; // Элементы, с которыми могут взаимодействовать лучи
+    std::vector<int> m_targetDetector;             // Индекс детектора для каждого элемента из m_targets (-1 - не детектор)
+    // Для каждого преломляющего тела - само тело и элементы, чьи границы его пересекают.
+    // Луч внутри тела проверяется только по этому списку, а не по всей сцене
+    std::unordered_map<const OpticalElement *, std::vector<size_t>> m_mediumTargets;
+    std::vector<size_t> m_detectorOffsets;         // Смещение ячеек детектора в WorkerState::bins
+    size_t m_totalBins = 0;
+    std::vector<Ray> m_primaryRays;
+    std::vector<SourceRange> m_sourceRanges;
+    size_t m_primaryRayCount = 0;
+    size_t m_pathCount = 0;
+    std::vector<WorkerState> m_workers;
+    AngularSweep m_sweep;
+    std::vector<Ray> m_sweepRays;                  // Первичные лучи стохастического режима для углового обхода
+    std::vector<AngularSweep::SweepRay> m_sweepOrder; // Лучи источника по возрастанию угла
+    std::vector<Hit> m_primaryHits;                // Первое попадание каждого первичного луча (пусто - обход не выполнялся)
+};
+
+#endif // HEADER_GUARD_RAY_TRACER_HPP
@@ -0,0 +1,164 @@
+#include "RenderThread.hpp"
+
+#include "Constants.hpp"
+#include "Detector.hpp"
+
+RenderThread::RenderThread(sf::RenderWindow &window)
+    : m_window(window),
+      m_running(false),
+      m_backIndex(0),
+      m_frontIndex(1),
+      m_readyIndex(2),
+      m_renderedFrames(0),
+      m_pickedSequence(0),
+      m_latency(AppConstants::LATENCY_SAMPLE_WINDOW),
+      m_uploadedDensityVersion(0)
+{
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+}
+
+void RenderThread::start()
+{
+    if (m_running.exchange(true))
+        return;
+    // Контекст OpenGL может быть активен только в одном потоке
+    m_window.setActive(false);
+    m_thread = std::thread(&RenderThread::run, this);
+}
+
+void RenderThread::stop()
+{
+    if (!m_running.exchange(false))
+        return;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void RenderThread::publish()
+{
+    m_backIndex = m_readyIndex.exchange(m_backIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+void RenderThread::run()
+{
+    m_window.setActive(true);
+    while (m_running.load(std::memory_order_acquire))
+    {
+        if (m_readyIndex.load(std::memory_order_acquire) & FRESH_BIT)
+        {
+            m_frontIndex = m_readyIndex.exchange(m_frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+            m_pickedSequence.store(m_frames[m_frontIndex].sequence, std::memory_order_release);
+        }
+        const RenderFrame &frame = m_frames[m_frontIndex];
+        drawFrame(frame);
+        // display() ждёт ограничения частоты кадров только в этом потоке
+        m_window.display();
+        if (frame.latency.valid && frame.latency.input > m_lastLatencyInput)
+        {
+            m_latency.record(frame.latency, LatencyStamp::Clock::now());
+            m_lastLatencyInput = frame.latency.input;
+        }
+        m_renderedFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_window.setActive(false);
+}
+
+void RenderThread::drawFrame(const RenderFrame &frame)
+{
+    m_window.clear(AppConstants::COLOR_BACKGROUND);
+    m_window.setView(frame.worldView);
+
+    if (frame.displayMode == DisplayMode::DENSITY_MAP)
+    {
+        if (frame.densityVersion > m_uploadedDensityVersion && !frame.densityPixels.empty())
+        {
+            if (m_densityTexture.getSize() != sf::Vector2u(frame.densityWidth, frame.densityHeight))
+            {
+                m_densityTexture.create(frame.densityWidth, frame.densityHeight);
+                m_densityTexture.setSmooth(true);
+            }
+            m_densityTexture.update(frame.densityPixels.data());
+            m_uploadedDensityVersion = frame.densityVersion;
+        }
+        if (m_uploadedDensityVersion != 0 && frame.densityWidth > 0 && frame.densityHeight > 0)
+        {
+            sf::Sprite sprite(m_densityTexture);
+            sprite.setPosition(frame.densityWorldRect.left, frame.densityWorldRect.top);
+            sprite.setScale(frame.densityWorldRect.width / frame.densityWidth, frame.densityWorldRect.height / frame.densityHeight);
+            m_window.draw(sprite);
+        }
+    }
+    else if (frame.showBeams)
+    {
+        if (frame.beamTriangles && !frame.beamTriangles->empty())
+            m_window.draw(frame.beamTriangles->data(), frame.beamTriangles->size(), sf::Triangles);
+    }
+    else if (!frame.rayVertices.empty())
+    {
+        m_window.draw(frame.rayVertices.data(), frame.rayVertices.size(), sf::Lines);
+    }
+
+    for (size_t i = 0; i < frame.elements.size(); ++i)
+    {
+        if (!frame.elements[i])
+            continue;
+        const OpticalElement &element = *frame.elements[i];
+        if (element.getType() == OpticalElement::Type::DETECTOR && i < frame.detectorBins.size())
+        {
+            const Detector &detector = static_cast<const Detector &>(element);
+            detector.drawBody(m_window);
+            detector.drawHistogram(m_window, frame.detectorBins[i]);
+        }
+        else
+        {
+            element.draw(m_window);
+        }
+        if (static_cast<int>(i) == frame.selectedIndex)
+        {
+            frame.elements[i]->drawHandles(m_window, AppConstants::COLOR_HANDLE_MOVE, AppConstants::COLOR_HANDLE_RESIZE);
+        }
+    }
+    for (size_t index : frame.groupIndices)
+    {
+        if (index < frame.elements.size() && frame.elements[index])
+            frame.elements[index]->drawHandles(m_window, AppConstants::COLOR_HANDLE_MOVE, AppConstants::COLOR_HANDLE_MOVE);
+    }
+    if (frame.showMarquee)
+        m_window.draw(frame.marquee);
+    if (frame.showSelectedLabel)
+        m_window.draw(frame.selectedLabel);
+
+    if (frame.showPlacementLine)
+        m_window.draw(frame.placementLine);
+    if (frame.showPlacementCircle)
+        m_window.draw(frame.placementCircle);
+
+    if (frame.showSpotAnalysis)
+    {
+        m_window.draw(frame.spotPlane);
+        if (!frame.spotPoints.empty())
+            m_window.draw(frame.spotPoints.data(), frame.spotPoints.size(), sf::Points);
+    }
+    if (frame.showParaxial && !frame.paraxialLines.empty())
+        m_window.draw(frame.paraxialLines.data(), frame.paraxialLines.size(), sf::Lines);
+    // Поле ввода стоит рядом с элементом, поэтому рисуется в координатах сцены
+    if (frame.showParameterEditor)
+    {
+        m_window.draw(frame.inputBackground);
+        m_window.draw(frame.editPromptText);
+        m_window.draw(frame.inputText);
+    }
+
+    m_window.setView(frame.screenView);
+    if (frame.showSpotAnalysis)
+        m_window.draw(frame.spotText);
+    if (frame.showBeams)
+        m_window.draw(frame.beamText);
+    if (frame.showParaxial)
+        m_window.draw(frame.paraxialText);
+    m_window.draw(frame.helpText);
+}
@@ -0,0 +1,119 @@
+#ifndef HEADER_GUARD_RENDER_THREAD_HPP
+#define HEADER_GUARD_RENDER_THREAD_HPP
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "AppDefs.hpp"
+#include "LatencyTracker.hpp"
+#include "OpticalElement.hpp"
+
+// Данные одного кадра для потока отрисовки. Кадр не ссылается на изменяемую сцену:
+// элементы - неизменяемые копии (общие для кадров, пока элемент не изменился),
+// тексты скопированы с уже построенной геометрией
+struct RenderFrame
+{
+    DisplayMode displayMode = DisplayMode::RAY_PATHS;
+    sf::View worldView;                  // Масштаб и сдвиг сцены
+    sf::View screenView;                 // Вид для текста интерфейса (в пикселях окна)
+
+    std::vector<sf::Vertex> rayVertices; // Отрезки путей лучей (sf::Lines), отсечённые видимой областью
+
+    std::vector<sf::Uint8> densityPixels; // RGBA карты плотности
+    unsigned densityWidth = 0;
+    unsigned densityHeight = 0;
+    sf::FloatRect densityWorldRect;
+    uint64_t densityVersion = 0; // Растёт при каждом обновлении пикселей; устаревшие буферы не загружаются
+
+    std::vector<std::shared_ptr<const OpticalElement>> elements; // nullptr - элемент вне видимой области
+    std::vector<std::vector<float>> detectorBins; // Гистограммы детекторов по номерам элементов (текущие, не из копии)
+    int selectedIndex = -1;               // Элемент, для которого рисуются ручки
+    std::vector<size_t> groupIndices;     // Элементы, выделенные рамкой
+    bool showMarquee = false;
+    sf::RectangleShape marquee;
+    bool showSelectedLabel = false;
+    sf::Text selectedLabel;               // Текст параметра выбранного элемента
+
+    bool showPlacementLine = false;
+    bool showPlacementCircle = false;
+    sf::VertexArray placementLine{sf::Lines, 2};
+    sf::CircleShape placementCircle;
+
+    bool showSpotAnalysis = false;
+    sf::VertexArray spotPlane{sf::Lines, 2};  // Плоскость анализа пятна
+    std::vector<sf::Vertex> spotPoints;       // Точки пятна (sf::Points)
+    sf::Text spotText;                        // Центр, RMS, энергия в круге
+
+    bool showBeams = false;
+    std::shared_ptr<const std::vector<sf::Vertex>> beamTriangles; // Освещённые области пучков (sf::Triangles), общие с BeamTracer
+    sf::Text beamText;
+
+    bool showParaxial = false;
+    std::vector<sf::Vertex> paraxialLines;    // Ось, фокусы, главные плоскости и изображение (sf::Lines)
+    sf::Text paraxialText;
+
+    sf::Text helpText;
+    bool showParameterEditor = false;
+    sf::RectangleShape inputBackground;
+    sf::Text editPromptText;
+    sf::Text inputText;
+
+    uint64_t sequence = 0;               // Номер публикации
+    LatencyStamp latency;                // Взаимодействие, результат которого показывает кадр
+};
+
+// Поток отрисовки: владеет контекстом OpenGL окна и рисует последний опубликованный кадр.
+// Кадры передаются через тройной буфер без блокировок: главный поток заполняет задний буфер
+// и обменивает его с буфером "готов", поток отрисовки забирает "готовый" буфер, если он новый.
+// Поэтому ожидание вертикальной синхронизации не задерживает обработку ввода, а медленная
+// трассировка не останавливает отрисовку.
+class RenderThread
+{
+public:
+    explicit RenderThread(sf::RenderWindow &window);
+    ~RenderThread();
+
+    void start();
+    void stop();
+
+    // Задний буфер для заполнения главным потоком
+    RenderFrame &backFrame() { return m_frames[m_backIndex]; }
+    // Публикация заполненного заднего буфера
+    void publish();
+
+    // Количество кадров, выведенных на экран с момента запуска
+    uint64_t getRenderedFrames() const { return m_renderedFrames.load(std::memory_order_relaxed); }
+    // Номер последнего кадра, забранного потоком отрисовки
+    uint64_t getPickedSequence() const { return m_pickedSequence.load(std::memory_order_acquire); }
+    // Задержка от ввода до вывода кадра с результатом на экран
+    LatencyTracker &latency() { return m_latency; }
+    const LatencyTracker &latency() const { return m_latency; }
+
+private:
+    static const int FRESH_BIT = 4; // Флаг в m_readyIndex: буфер опубликован и ещё не забран
+    static const int INDEX_MASK = 3;
+
+    void run();
+    void drawFrame(const RenderFrame &frame);
+
+    sf::RenderWindow &m_window;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    RenderFrame m_frames[3];
+    int m_backIndex;             // Только главный поток
+    int m_frontIndex;            // Только поток отрисовки
+    std::atomic<int> m_readyIndex;
+    std::atomic<uint64_t> m_renderedFrames;
+    std::atomic<uint64_t> m_pickedSequence;
+    LatencyTracker m_latency;
+    LatencyStamp::Clock::time_point m_lastLatencyInput; // Кадр рисуется многократно: задержка учитывается один раз
+
+    // Ресурсы потока отрисовки
+    sf::Texture m_densityTexture;
+    uint64_t m_uploadedDensityVersion;
+};
+
+#endif // HEADER_GUARD_RENDER_THREAD_HPP
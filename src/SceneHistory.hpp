@@ -0,0 +1,280 @@
+#ifndef HEADER_GUARD_SCENE_HISTORY_HPP
+#define HEADER_GUARD_SCENE_HISTORY_HPP
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "OpticalElement.hpp"
+#include "PersistentVector.hpp"
+
+// Неизменяемый снимок сцены. Копия снимка - копия одного указателя на корень,
+// неизменённые элементы разделяются между снимками. Снимок можно передать другому
+// потоку как вход трассировщика: его элементы никогда не изменяются.
+using SceneSnapshot = PersistentVector<std::shared_ptr<const OpticalElement>>;
+
+// Указатели на элементы снимка в виде, принимаемом RayTracer::trace
+inline void collectSnapshotElements(const SceneSnapshot &snapshot, std::vector<const OpticalElement *> &out)
+{
+    out.clear();
+    out.reserve(snapshot.size());
+    for (size_t i = 0; i < snapshot.size(); ++i)
+        out.push_back(snapshot[i].get());
+}
+
+// История изменений сцены для отмены/повтора.
+// Изменённые элементы помечаются через touch()/erase(), commit() копирует только их в новый снимок.
+// Шаг истории хранит номера изменённых и удалённых элементов; снимок шага разделяет с предыдущим
+// все узлы левее первого удалённого элемента. Отмена и повтор заменяют в рабочей сцене только
+// элементы из этих списков, остальные объекты остаются на месте.
+class SceneHistory
+{
+public:
+    explicit SceneHistory(size_t maxEntries = 256) : m_maxEntries(std::max<size_t>(2, maxEntries)) {}
+
+    // Начальное состояние истории (копируются все элементы)
+    void reset(const std::vector<OpticalElement *> &live)
+    {
+        m_liveSources.clear();
+        for (const OpticalElement *element : live)
+            m_liveSources.push_back(cloneShared(*element));
+        m_entries.clear();
+        m_entries.push_back({SceneSnapshot::fromVector(m_liveSources), {}, {}, true});
+        m_position = 0;
+        m_dirty.clear();
+        m_removed.clear();
+    }
+
+    // Элемент изменён или добавлен в конец сцены
+    void touch(size_t index)
+    {
+        if (index >= m_liveSources.size())
+            m_liveSources.resize(index + 1);
+        m_dirty.push_back(index);
+    }
+
+    // Элементы удалены из сцены (номера до удаления)
+    void erase(std::vector<size_t> indices)
+    {
+        std::sort(indices.begin(), indices.end(), std::greater<size_t>());
+        for (size_t index : indices)
+        {
+            if (index >= m_liveSources.size())
+                continue;
+            // Элементы записанного снимка идут первыми в прежнем порядке,
+            // добавленные после commit() - в конце
+            if (index < current().size() - m_removed.size())
+            {
+                size_t original = index;
+                for (size_t removed : m_removed)
+                {
+                    if (removed > original)
+                        break;
+                    ++original;
+                }
+                m_removed.insert(std::upper_bound(m_removed.begin(), m_removed.end(), original), original);
+            }
+            m_liveSources.erase(m_liveSources.begin() + index);
+            // Номера помеченных элементов после удалённого сдвигаются
+            for (auto it = m_dirty.begin(); it != m_dirty.end();)
+            {
+                if (*it == index)
+                    it = m_dirty.erase(it);
+                else
+                {
+                    if (*it > index)
+                        --*it;
+                    ++it;
+                }
+            }
+        }
+    }
+
+    bool hasPendingChanges() const { return !m_removed.empty() || !m_dirty.empty() || m_liveSources.size() != current().size(); }
+
+    // Запись нового шага истории. Возвращает false, если изменений не было
+    bool commit(const std::vector<OpticalElement *> &live)
+    {
+        if (!hasPendingChanges())
+            return false;
+        std::sort(m_dirty.begin(), m_dirty.end());
+        m_dirty.erase(std::unique(m_dirty.begin(), m_dirty.end()), m_dirty.end());
+        for (size_t index : m_dirty)
+            m_liveSources[index] = cloneShared(*live[index]);
+
+        // Начало снимка до первого удалённого элемента разделяется с предыдущим,
+        // остаток сцены дописывается заново
+        const SceneSnapshot &previous = current();
+        SceneSnapshot snapshot = m_removed.empty() ? previous : previous.take(m_removed.front());
+        for (size_t index : m_dirty)
+        {
+            if (index < snapshot.size())
+                snapshot = snapshot.set(index, m_liveSources[index]);
+        }
+        for (size_t index = snapshot.size(); index < m_liveSources.size(); ++index)
+            snapshot = snapshot.push_back(m_liveSources[index]);
+        const bool structural = !m_removed.empty() || snapshot.size() != previous.size();
+
+        m_entries.resize(m_position + 1); // Новый шаг отменяет возможность повтора
+        m_entries.push_back({std::move(snapshot), std::move(m_dirty), std::move(m_removed), structural});
+        ++m_position;
+        if (m_entries.size() > m_maxEntries)
+        {
+            m_entries.erase(m_entries.begin());
+            --m_position;
+        }
+        m_dirty.clear();
+        m_removed.clear();
+        return true;
+    }
+
+    bool canUndo() const { return m_position > 0; }
+    bool canRedo() const { return m_position + 1 < m_entries.size(); }
+
+    // Отмена/повтор. Перед вызовом незаписанные изменения должны быть записаны через commit().
+    // changed получает номера заменённых элементов; возвращается true, если изменился состав сцены
+    bool undo(std::vector<OpticalElement *> &live, std::vector<size_t> &changed)
+    {
+        const Entry &step = m_entries[m_position];
+        --m_position;
+        const SceneSnapshot &target = m_entries[m_position].snapshot;
+        changed.clear();
+        if (!step.structural)
+        {
+            for (size_t index : step.changed)
+                replace(live, target, index, changed);
+            return false;
+        }
+
+        // Добавленные шагом элементы стоят в конце сцены
+        const size_t kept = target.size() - step.removed.size();
+        while (live.size() > kept)
+        {
+            delete live.back();
+            live.pop_back();
+            m_liveSources.pop_back();
+        }
+        // Номер сохранившегося элемента в целевом снимке больше на число удалённых перед ним
+        size_t skipped = 0;
+        for (size_t index : step.changed)
+        {
+            if (index >= kept)
+                break;
+            while (skipped < step.removed.size() && step.removed[skipped] <= index + skipped)
+                ++skipped;
+            delete live[index];
+            live[index] = target[index + skipped]->clone().release();
+            m_liveSources[index] = target[index + skipped];
+            changed.push_back(index + skipped);
+        }
+        // Удалённые элементы возвращаются на свои места, сцена сдвигается с конца
+        live.resize(target.size(), nullptr);
+        m_liveSources.resize(target.size());
+        size_t from = kept;
+        for (size_t r = step.removed.size(), to = target.size(); r > 0;)
+        {
+            --to;
+            if (step.removed[r - 1] == to)
+            {
+                --r;
+                live[to] = target[to]->clone().release();
+                m_liveSources[to] = target[to];
+                changed.push_back(to);
+            }
+            else
+            {
+                --from;
+                live[to] = live[from];
+                m_liveSources[to] = std::move(m_liveSources[from]);
+            }
+        }
+        std::sort(changed.begin(), changed.end());
+        return true;
+    }
+
+    bool redo(std::vector<OpticalElement *> &live, std::vector<size_t> &changed)
+    {
+        ++m_position;
+        const Entry &step = m_entries[m_position];
+        const SceneSnapshot &target = step.snapshot;
+        changed.clear();
+        if (!step.structural)
+        {
+            for (size_t index : step.changed)
+                replace(live, target, index, changed);
+            return false;
+        }
+
+        // Удаление элементов шага со сдвигом остатка сцены
+        if (!step.removed.empty())
+        {
+            size_t to = step.removed.front(), r = 0;
+            for (size_t from = to; from < live.size(); ++from)
+            {
+                if (r < step.removed.size() && step.removed[r] == from)
+                {
+                    ++r;
+                    delete live[from];
+                    continue;
+                }
+                live[to] = live[from];
+                m_liveSources[to] = std::move(m_liveSources[from]);
+                ++to;
+            }
+            live.resize(to);
+            m_liveSources.resize(to);
+        }
+        // Изменённые элементы заменяются, добавленные дописываются в конец
+        for (size_t index : step.changed)
+        {
+            if (index < live.size())
+            {
+                delete live[index];
+                live[index] = target[index]->clone().release();
+            }
+            else
+            {
+                live.push_back(target[index]->clone().release());
+                m_liveSources.emplace_back();
+            }
+            m_liveSources[index] = target[index];
+            changed.push_back(index);
+        }
+        return true;
+    }
+
+    // Снимок, соответствующий последнему записанному состоянию сцены
+    const SceneSnapshot &current() const { return m_entries[m_position].snapshot; }
+
+private:
+    struct Entry
+    {
+        SceneSnapshot snapshot;
+        std::vector<size_t> changed; // Изменённые и добавленные элементы (номера в этом снимке)
+        std::vector<size_t> removed; // Удалённые элементы (номера в предыдущем снимке)
+        bool structural;             // Шаг добавил или удалил элементы
+    };
+
+    static std::shared_ptr<const OpticalElement> cloneShared(const OpticalElement &element)
+    {
+        return std::shared_ptr<const OpticalElement>(element.clone());
+    }
+
+    void replace(std::vector<OpticalElement *> &live, const SceneSnapshot &target, size_t index, std::vector<size_t> &changed)
+    {
+        delete live[index];
+        live[index] = target[index]->clone().release();
+        m_liveSources[index] = target[index];
+        changed.push_back(index);
+    }
+
+    size_t m_maxEntries;
+    std::vector<Entry> m_entries;
+    size_t m_position = 0;
+    std::vector<std::shared_ptr<const OpticalElement>> m_liveSources; // Снимок-источник каждого элемента рабочей сцены
+    std::vector<size_t> m_dirty;
+    std::vector<size_t> m_removed; // Удалённые после commit() элементы (номера в текущем снимке), по возрастанию
+};
+
+#endif // HEADER_GUARD_SCENE_HISTORY_HPP
@@ -0,0 +1,295 @@
+#include "SceneIO.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "PointSource.hpp"
+#include "Mirror.hpp"
+#include "IdealLens.hpp"
+#include "SphericalMirror.hpp"
+#include "Detector.hpp"
+#include "DielectricBody.hpp"
+#include "BeamSplitter.hpp"
+
+namespace
+{
+    const int FLOAT_PRECISION = 9; // Знаков достаточно для точного восстановления float
+    const int MAX_BODY_VERTICES = 4096;
+
+    std::string glassName(const Spectral::Dispersion &dispersion)
+    {
+        return dispersion.isDispersive() ? dispersion.name() : "none";
+    }
+
+    bool parseGlass(const std::string &name, Spectral::Dispersion &dispersion)
+    {
+        if (name == "none")
+            dispersion.glass = Spectral::Dispersion::Glass::NONE;
+        else if (name == "crown")
+            dispersion.glass = Spectral::Dispersion::Glass::CROWN;
+        else if (name == "flint")
+            dispersion.glass = Spectral::Dispersion::Glass::FLINT;
+        else
+            return false;
+        return true;
+    }
+
+    void writeColor(std::ostream &out, const sf::Color &color)
+    {
+        out << ' ' << int(color.r) << ' ' << int(color.g) << ' ' << int(color.b) << ' ' << int(color.a);
+    }
+
+    bool readColor(std::istream &in, sf::Color &color)
+    {
+        int r = 0, g = 0, b = 0, a = 0;
+        if (!(in >> r >> g >> b >> a))
+            return false;
+        auto valid = [](int v) { return v >= 0 && v <= 255; };
+        if (!valid(r) || !valid(g) || !valid(b) || !valid(a))
+            return false;
+        color = sf::Color(static_cast<sf::Uint8>(r), static_cast<sf::Uint8>(g), static_cast<sf::Uint8>(b), static_cast<sf::Uint8>(a));
+        return true;
+    }
+
+    // Концы отрезка по центру, длине и углу - для конструкторов по двум точкам
+    void segmentEnds(sf::Vector2f center, float length, float angle, sf::Vector2f &p1, sf::Vector2f &p2)
+    {
+        sf::Vector2f half(std::cos(angle) * length / 2.f, std::sin(angle) * length / 2.f);
+        p1 = center - half;
+        p2 = center + half;
+    }
+
+    std::unique_ptr<OpticalElement> parseElement(const std::string &type, std::istringstream &in)
+    {
+        float x = 0.f, y = 0.f;
+        if (!(in >> x >> y))
+            return nullptr;
+        const sf::Vector2f center(x, y);
+        sf::Color color;
+
+        if (type == "source")
+        {
+            int rays = 0, samples = 1;
+            float start = 0.f, span = 0.f, minWl = 0.f, maxWl = 0.f;
+            if (!(in >> rays >> start >> span) || !readColor(in, color) || !(in >> samples >> minWl >> maxWl) || rays <= 0 || samples <= 0)
+                return nullptr;
+            auto source = std::make_unique<PointSource>(center, rays, color, start, span);
+            source->spectrum.sampleCount = samples;
+            source->spectrum.minWavelength = minWl;
+            source->spectrum.maxWavelength = maxWl;
+            return source;
+        }
+        if (type == "mirror")
+        {
+            float length = 0.f, angle = 0.f;
+            if (!(in >> length >> angle) || !readColor(in, color))
+                return nullptr;
+            return std::make_unique<Mirror>(center, length, angle, color);
+        }
+        if (type == "lens")
+        {
+            float height = 0.f, angle = 0.f, focal = 0.f;
+            std::string glass;
+            Spectral::Dispersion dispersion;
+            if (!(in >> height >> angle >> focal >> glass) || !parseGlass(glass, dispersion) || !readColor(in, color))
+                return nullptr;
+            auto lens = std::make_unique<IdealLens>(center, height, angle, focal, color);
+            lens->dispersion = dispersion;
+            return lens;
+        }
+        if (type == "sphmirror")
+        {
+            float radius = 0.f, start = 0.f, span = 0.f;
+            if (!(in >> radius >> start >> span) || !readColor(in, color))
+                return nullptr;
+            return std::make_unique<SphericalMirror>(center, radius, start, span, color);
+        }
+        if (type == "detector")
+        {
+            float length = 0.f, angle = 0.f;
+            int bins = 0, weighted = 0;
+            if (!(in >> length >> angle >> bins >> weighted) || !readColor(in, color) || bins <= 0)
+                return nullptr;
+            sf::Vector2f p1, p2;
+            segmentEnds(center, length, angle, p1, p2);
+            auto detector = std::make_unique<Detector>(p1, p2, bins, color);
+            // Точные значения вместо пересчитанных из концов
+            detector->center = center;
+            detector->length = length;
+            detector->angle = angle;
+            detector->angleWeighted = weighted != 0;
+            return detector;
+        }
+        if (type == "body")
+        {
+            float radius = 0.f, angle = 0.f, n = 0.f;
+            std::string glass;
+            Spectral::Dispersion dispersion;
+            int count = 0;
+            if (!(in >> radius >> angle >> n >> glass) || !parseGlass(glass, dispersion) || !readColor(in, color) || !(in >> count))
+                return nullptr;
+            if (count < 3 || count > MAX_BODY_VERTICES)
+                return nullptr;
+            std::vector<sf::Vector2f> shape(count);
+            for (auto &vertex : shape)
+            {
+                if (!(in >> vertex.x >> vertex.y))
+                    return nullptr;
+            }
+            auto body = std::make_unique<DielectricBody>(center, radius, angle, std::move(shape), n, color);
+            body->dispersion = dispersion;
+            return body;
+        }
+        if (type == "splitter")
+        {
+            float length = 0.f, angle = 0.f;
+            int percent = 0;
+            if (!(in >> length >> angle >> percent) || !readColor(in, color))
+                return nullptr;
+            sf::Vector2f p1, p2;
+            segmentEnds(center, length, angle, p1, p2);
+            auto splitter = std::make_unique<BeamSplitter>(p1, p2, percent, color);
+            splitter->center = center;
+            splitter->length = length;
+            splitter->angle = angle;
+            return splitter;
+        }
+        return nullptr;
+    }
+}
+
+void SceneIO::write(std::ostream &out, const std::vector<const OpticalElement *> &elements)
+{
+    out << std::setprecision(FLOAT_PRECISION);
+    for (const OpticalElement *el : elements)
+    {
+        switch (el->getType())
+        {
+        case OpticalElement::Type::SOURCE:
+        {
+            const auto *source = static_cast<const PointSource *>(el);
+            out << "source " << source->position.x << ' ' << source->position.y << ' ' << source->numRays << ' '
+                << source->startAngle << ' ' << source->spanAngle;
+            writeColor(out, source->color);
+            out << ' ' << source->spectrum.sampleCount << ' ' << source->spectrum.minWavelength << ' ' << source->spectrum.maxWavelength;
+            break;
+        }
+        case OpticalElement::Type::MIRROR:
+        {
+            const auto *mirror = static_cast<const Mirror *>(el);
+            out << "mirror " << mirror->center.x << ' ' << mirror->center.y << ' ' << mirror->length << ' ' << mirror->angle;
+            writeColor(out, mirror->color);
+            break;
+        }
+        case OpticalElement::Type::LENS:
+        {
+            const auto *lens = static_cast<const IdealLens *>(el);
+            out << "lens " << lens->center.x << ' ' << lens->center.y << ' ' << lens->height << ' ' << lens->angle << ' '
+                << lens->focalLength << ' ' << glassName(lens->dispersion);
+            writeColor(out, lens->color);
+            break;
+        }
+        case OpticalElement::Type::SPHERICAL_MIRROR:
+        {
+            const auto *mirror = static_cast<const SphericalMirror *>(el);
+            out << "sphmirror " << mirror->center.x << ' ' << mirror->center.y << ' ' << mirror->radius << ' '
+                << mirror->startAngle << ' ' << mirror->spanAngle;
+            writeColor(out, mirror->color);
+            break;
+        }
+        case OpticalElement::Type::DETECTOR:
+        {
+            const auto *detector = static_cast<const Detector *>(el);
+            out << "detector " << detector->center.x << ' ' << detector->center.y << ' ' << detector->length << ' '
+                << detector->angle << ' ' << detector->numBins << ' ' << (detector->angleWeighted ? 1 : 0);
+            writeColor(out, detector->color);
+            break;
+        }
+        case OpticalElement::Type::DIELECTRIC:
+        {
+            const auto *body = static_cast<const DielectricBody *>(el);
+            out << "body " << body->center.x << ' ' << body->center.y << ' ' << body->radius << ' ' << body->angle << ' '
+                << body->refractiveIndex << ' ' << glassName(body->dispersion);
+            writeColor(out, body->color);
+            out << ' ' << body->getShape().size();
+            for (const sf::Vector2f &vertex : body->getShape())
+                out << ' ' << vertex.x << ' ' << vertex.y;
+            break;
+        }
+        case OpticalElement::Type::BEAM_SPLITTER:
+        {
+            const auto *splitter = static_cast<const BeamSplitter *>(el);
+            out << "splitter " << splitter->center.x << ' ' << splitter->center.y << ' ' << splitter->length << ' '
+                << splitter->angle << ' ' << splitter->reflectancePercent;
+            writeColor(out, splitter->color);
+            break;
+        }
+        default:
+            continue;
+        }
+        out << '\n';
+    }
+}
+
+std::string SceneIO::toString(const std::vector<const OpticalElement *> &elements)
+{
+    std::ostringstream out;
+    write(out, elements);
+    return out.str();
+}
+
+bool SceneIO::save(const std::string &path, const std::vector<const OpticalElement *> &elements)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not open file " << path << " for writing" << std::endl;
+        return false;
+    }
+    write(file, elements);
+    return static_cast<bool>(file);
+}
+
+bool SceneIO::read(std::istream &in, std::vector<std::unique_ptr<OpticalElement>> &elements, std::string &error)
+{
+    std::vector<std::unique_ptr<OpticalElement>> parsed;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        std::istringstream lineStream(line);
+        std::string type;
+        if (!(lineStream >> type) || type[0] == '#')
+            continue;
+        std::unique_ptr<OpticalElement> element = parseElement(type, lineStream);
+        std::string rest;
+        if (!element || lineStream >> rest)
+        {
+            error = "line " + std::to_string(lineNumber) + ": invalid '" + type + "' element";
+            return false;
+        }
+        parsed.push_back(std::move(element));
+    }
+    elements = std::move(parsed);
+    return true;
+}
+
+bool SceneIO::fromString(const std::string &text, std::vector<std::unique_ptr<OpticalElement>> &elements, std::string &error)
+{
+    std::istringstream in(text);
+    return read(in, elements, error);
+}
+
+bool SceneIO::load(const std::string &path, std::vector<std::unique_ptr<OpticalElement>> &elements, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        error = "could not open " + path;
+        return false;
+    }
+    return read(file, elements, error);
+}
@@ -0,0 +1,34 @@
+#ifndef HEADER_GUARD_SCENE_IO_HPP
+#define HEADER_GUARD_SCENE_IO_HPP
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OpticalElement.hpp"
+
+// Текстовый формат сцены: одна строка на элемент, первое слово - тип, далее параметры
+// (координаты, углы в радианах, цвет RGBA). Строки, начинающиеся с '#', и пустые строки пропускаются.
+// Числа записываются с точностью, достаточной для восстановления float без потерь:
+//   source x y rays start span r g b a samples minWavelength maxWavelength
+//   mirror x y length angle r g b a
+//   lens x y height angle focalLength glass r g b a
+//   sphmirror x y radius start span r g b a
+//   detector x y length angle bins weighted r g b a
+//   body x y radius angle n glass r g b a count x1 y1 ... (вершины в локальных координатах)
+//   splitter x y length angle percent r g b a
+// glass: none, crown или flint
+namespace SceneIO
+{
+    void write(std::ostream &out, const std::vector<const OpticalElement *> &elements);
+    std::string toString(const std::vector<const OpticalElement *> &elements);
+    bool save(const std::string &path, const std::vector<const OpticalElement *> &elements);
+
+    // false и описание ошибки с номером строки, если сцена не разобрана; elements не изменяется
+    bool read(std::istream &in, std::vector<std::unique_ptr<OpticalElement>> &elements, std::string &error);
+    bool fromString(const std::string &text, std::vector<std::unique_ptr<OpticalElement>> &elements, std::string &error);
+    bool load(const std::string &path, std::vector<std::unique_ptr<OpticalElement>> &elements, std::string &error);
+}
+
+#endif // HEADER_GUARD_SCENE_IO_HPP
@@ -0,0 +1,199 @@
+#ifndef HEADER_GUARD_SPATIAL_INDEX_HPP
+#define HEADER_GUARD_SPATIAL_INDEX_HPP
+
+#include <SFML/Graphics/Rect.hpp>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "OpticalElement.hpp"
+
+// Равномерная сетка по границам элементов (геометрия и ручки, расширенные на допуск выбора).
+// Ячейка хранит номера элементов, чьи границы её задевают. Выбор точки проверяет одну ячейку,
+// поэтому его стоимость не зависит от числа элементов сцены.
+class SpatialIndex
+{
+public:
+    explicit SpatialIndex(float cellSize = 64.f, float margin = 12.f) : m_cellSize(cellSize), m_margin(margin) {}
+
+    void clear()
+    {
+        m_entries.clear();
+        m_cells.clear();
+        m_oversized.clear();
+    }
+
+    // Полное построение (после удаления элементов номера сдвигаются)
+    void rebuild(const std::vector<OpticalElement *> &elements)
+    {
+        clear();
+        m_entries.resize(elements.size());
+        for (size_t i = 0; i < elements.size(); ++i)
+        {
+            if (elements[i])
+                insert(i, *elements[i]);
+        }
+    }
+
+    // Обновление границ одного элемента после его изменения или добавления
+    void update(size_t index, const OpticalElement &element)
+    {
+        if (index >= m_entries.size())
+            m_entries.resize(index + 1);
+        remove(index);
+        insert(index, element);
+    }
+
+    // Кандидаты для точки по убыванию номера (последний добавленный элемент рисуется сверху)
+    void queryPoint(const sf::Vector2f &point, std::vector<size_t> &out) const
+    {
+        out.clear();
+        auto it = m_cells.find(cellKey(cellCoord(point.x), cellCoord(point.y)));
+        if (it != m_cells.end())
+        {
+            for (uint32_t index : it->second)
+            {
+                if (m_entries[index].bounds.contains(point))
+                    out.push_back(index);
+            }
+        }
+        for (uint32_t index : m_oversized)
+        {
+            if (m_entries[index].bounds.contains(point))
+                out.push_back(index);
+        }
+        std::sort(out.begin(), out.end(), std::greater<size_t>());
+    }
+
+    // Элементы, чьи расширенные границы пересекают прямоугольник (по возрастанию номера)
+    void queryRect(const sf::FloatRect &rect, std::vector<size_t> &out) const
+    {
+        out.clear();
+        int minX = cellCoord(rect.left), maxX = cellCoord(rect.left + rect.width);
+        int minY = cellCoord(rect.top), maxY = cellCoord(rect.top + rect.height);
+        int64_t cellCount = (static_cast<int64_t>(maxX) - minX + 1) * (static_cast<int64_t>(maxY) - minY + 1);
+        auto collect = [&](const std::vector<uint32_t> &indices)
+        {
+            for (uint32_t index : indices)
+            {
+                if (m_entries[index].bounds.intersects(rect))
+                    out.push_back(index);
+            }
+        };
+        // Для прямоугольника больше заполненной части сетки дешевле обойти непустые ячейки
+        if (cellCount > static_cast<int64_t>(m_cells.size()))
+        {
+            for (const auto &cell : m_cells)
+                collect(cell.second);
+        }
+        else
+        {
+            for (int cy = minY; cy <= maxY; ++cy)
+            {
+                for (int cx = minX; cx <= maxX; ++cx)
+                {
+                    auto it = m_cells.find(cellKey(cx, cy));
+                    if (it != m_cells.end())
+                        collect(it->second);
+                }
+            }
+        }
+        collect(m_oversized);
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+private:
+    static const int MAX_CELLS_PER_ELEMENT = 4096; // Элементы крупнее проверяются при каждом запросе
+
+    struct Entry
+    {
+        sf::FloatRect bounds;
+        int minX = 0, minY = 0, maxX = -1, maxY = -1; // Диапазон занятых ячеек (пустой, если maxX < minX)
+        bool oversized = false;
+    };
+
+    int cellCoord(float v) const { return static_cast<int>(std::floor(v / m_cellSize)); }
+    // Ключ ячейки: биты cx в старшей половине, cy - в младшей (сдвиг беззнаковый, отрицательные координаты допустимы)
+    static uint64_t cellKey(int cx, int cy) { return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy); }
+
+    // Границы выбора: геометрия и все ручки с запасом на допуск
+    sf::FloatRect pickBounds(const OpticalElement &element) const
+    {
+        sf::FloatRect b = element.getBounds();
+        float minX = b.left, minY = b.top, maxX = b.left + b.width, maxY = b.top + b.height;
+        for (const sf::Vector2f &h : element.getHandles())
+        {
+            minX = std::min(minX, h.x);
+            minY = std::min(minY, h.y);
+            maxX = std::max(maxX, h.x);
+            maxY = std::max(maxY, h.y);
+        }
+        return sf::FloatRect(minX - m_margin, minY - m_margin, maxX - minX + 2.f * m_margin, maxY - minY + 2.f * m_margin);
+    }
+
+    void insert(size_t index, const OpticalElement &element)
+    {
+        Entry &entry = m_entries[index];
+        entry.bounds = pickBounds(element);
+        entry.minX = cellCoord(entry.bounds.left);
+        entry.minY = cellCoord(entry.bounds.top);
+        entry.maxX = cellCoord(entry.bounds.left + entry.bounds.width);
+        entry.maxY = cellCoord(entry.bounds.top + entry.bounds.height);
+        int64_t cells = (static_cast<int64_t>(entry.maxX) - entry.minX + 1) * (static_cast<int64_t>(entry.maxY) - entry.minY + 1);
+        entry.oversized = cells > MAX_CELLS_PER_ELEMENT;
+        if (entry.oversized)
+        {
+            m_oversized.push_back(static_cast<uint32_t>(index));
+            return;
+        }
+        for (int cy = entry.minY; cy <= entry.maxY; ++cy)
+            for (int cx = entry.minX; cx <= entry.maxX; ++cx)
+                m_cells[cellKey(cx, cy)].push_back(static_cast<uint32_t>(index));
+    }
+
+    void remove(size_t index)
+    {
+        Entry &entry = m_entries[index];
+        auto eraseFrom = [index](std::vector<uint32_t> &indices)
+        {
+            auto it = std::find(indices.begin(), indices.end(), static_cast<uint32_t>(index));
+            if (it != indices.end())
+            {
+                *it = indices.back();
+                indices.pop_back();
+            }
+        };
+        if (entry.oversized)
+        {
+            eraseFrom(m_oversized);
+        }
+        else
+        {
+            for (int cy = entry.minY; cy <= entry.maxY; ++cy)
+            {
+                for (int cx = entry.minX; cx <= entry.maxX; ++cx)
+                {
+                    auto it = m_cells.find(cellKey(cx, cy));
+                    if (it == m_cells.end())
+                        continue;
+                    eraseFrom(it->second);
+                    if (it->second.empty())
+                        m_cells.erase(it);
+                }
+            }
+        }
+        entry = Entry();
+    }
+
+    float m_cellSize;
+    float m_margin;
+    std::vector<Entry> m_entries;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;
+    std::vector<uint32_t> m_oversized;
+};
+
+#endif // HEADER_GUARD_SPATIAL_INDEX_HPP
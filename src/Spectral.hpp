@@ -0,0 +1,150 @@
+#ifndef HEADER_GUARD_SPECTRAL_HPP
+#define HEADER_GUARD_SPECTRAL_HPP
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+// Спектральные величины: длины волн в нанометрах
+namespace Spectral
+{
+    const int MAX_PACKET_LANES = 8;                // Максимальное число длин волн в пакете
+    const float REFERENCE_WAVELENGTH = 587.6f;     // Линия d гелия: на ней задаётся номинальное фокусное расстояние
+    const float DEFAULT_WAVELENGTH = 550.f;        // Длина волны монохроматического луча по умолчанию
+    const float PACKET_COHERENCE_EPSILON = 1e-4f;  // Допустимое расхождение направлений дорожек пакета
+
+    // Приближённый цвет видимого излучения (аппроксимация Брутона)
+    inline sf::Color wavelengthToColor(float nm)
+    {
+        float r = 0.f, g = 0.f, b = 0.f;
+        if (nm >= 380.f && nm < 440.f)
+        {
+            r = -(nm - 440.f) / 60.f;
+            b = 1.f;
+        }
+        else if (nm < 490.f)
+        {
+            g = (nm - 440.f) / 50.f;
+            b = 1.f;
+        }
+        else if (nm < 510.f)
+        {
+            g = 1.f;
+            b = -(nm - 510.f) / 20.f;
+        }
+        else if (nm < 580.f)
+        {
+            r = (nm - 510.f) / 70.f;
+            g = 1.f;
+        }
+        else if (nm < 645.f)
+        {
+            r = 1.f;
+            g = -(nm - 645.f) / 65.f;
+        }
+        else if (nm <= 780.f)
+        {
+            r = 1.f;
+        }
+        r = std::clamp(r, 0.f, 1.f);
+        g = std::clamp(g, 0.f, 1.f);
+        b = std::clamp(b, 0.f, 1.f);
+        return sf::Color(static_cast<sf::Uint8>(r * 255.f), static_cast<sf::Uint8>(g * 255.f), static_cast<sf::Uint8>(b * 255.f));
+    }
+
+    // Модель дисперсии стекла по формуле Коши: n(λ) = A + B / λ^2 (λ в мкм)
+    struct Dispersion
+    {
+        enum class Glass
+        {
+            NONE,  // Без дисперсии
+            CROWN, // Крон (близко к BK7)
+            FLINT  // Флинт (близко к SF2)
+        };
+
+        Glass glass = Glass::NONE;
+
+        float cauchyA() const { return glass == Glass::FLINT ? 1.6280f : 1.5046f; }
+        float cauchyB() const { return glass == Glass::FLINT ? 0.01024f : 0.00420f; }
+
+        bool isDispersive() const { return glass != Glass::NONE; }
+
+        float refractiveIndex(float nm) const
+        {
+            float um = nm * 1e-3f;
+            return cauchyA() + cauchyB() / (um * um);
+        }
+
+        // Множитель оптической силы тонкой линзы относительно опорной длины волны: (n(λ) - 1) / (n_ref - 1)
+        float powerScale(float nm) const
+        {
+            if (!isDispersive())
+                return 1.f;
+            return (refractiveIndex(nm) - 1.f) / (refractiveIndex(REFERENCE_WAVELENGTH) - 1.f);
+        }
+
+        void cycle()
+        {
+            glass = glass == Glass::NONE ? Glass::CROWN : (glass == Glass::CROWN ? Glass::FLINT : Glass::NONE);
+        }
+
+        std::string name() const
+        {
+            return glass == Glass::CROWN ? "crown" : (glass == Glass::FLINT ? "flint" : "");
+        }
+    };
+
+    // Спектр источника: sampleCount длин волн, равномерно распределённых в [minWavelength, maxWavelength]
+    struct SourceSpectrum
+    {
+        int sampleCount = 1;
+        float minWavelength = DEFAULT_WAVELENGTH;
+        float maxWavelength = DEFAULT_WAVELENGTH;
+
+        bool isMonochromatic() const { return sampleCount <= 1; }
+
+        float wavelengthAt(int i) const
+        {
+            if (sampleCount <= 1)
+                return 0.5f * (minWavelength + maxWavelength);
+            return minWavelength + (maxWavelength - minWavelength) * static_cast<float>(i) / static_cast<float>(sampleCount - 1);
+        }
+
+        // Переключение: монохроматический -> 3 линии (RGB) -> непрерывный видимый спектр
+        void cycle()
+        {
+            if (sampleCount <= 1)
+            {
+                sampleCount = 3;
+                minWavelength = 460.f;
+                maxWavelength = 640.f;
+            }
+            else if (sampleCount == 3)
+            {
+                sampleCount = MAX_PACKET_LANES;
+                minWavelength = 400.f;
+                maxWavelength = 700.f;
+            }
+            else
+            {
+                sampleCount = 1;
+                minWavelength = maxWavelength = DEFAULT_WAVELENGTH;
+            }
+        }
+    };
+}
+
+// Пакет лучей разных длин волн с общими началом и направлением.
+// Пакет трассируется как один геометрический луч, пока направления дорожек совпадают
+struct RayPacket
+{
+    sf::Vector2f origin;
+    sf::Vector2f direction;
+    int bounces_left = 5;
+    int laneCount = 1;
+    float wavelength[Spectral::MAX_PACKET_LANES];
+    sf::Color color[Spectral::MAX_PACKET_LANES];
+};
+
+#endif // HEADER_GUARD_SPECTRAL_HPP
@@ -36,6 +36,7 @@ public:
     {
         return Type::SPHERICAL_MIRROR;
     }
+    std::unique_ptr<OpticalElement> clone() const override { return std::make_unique<SphericalMirror>(*this); }
 
     // Получение координат конечных точек дуги
     sf::Vector2f getP1() const
@@ -80,13 +81,22 @@ public:
         return result;
     }
 
+    // Направление отражённого луча в точке point дуги с центром center (T - float или Dual<N>)
+    template <typename T>
+    static VectorMath::Vec2T<T> reflectDirection(const VectorMath::Vec2T<T> &direction, const VectorMath::Vec2T<T> &point, const VectorMath::Vec2T<T> &center)
+    {
+        return VectorMath::reflect(direction, VectorMath::normalize(center - point));
+    }
+
     RayAction interact(const Ray &incomingRay, const sf::Vector2f &intersectionPoint) const override
     {
-        sf::Vector2f normal = getNormalAt(intersectionPoint);
-        sf::Vector2f reflectedDir = VectorMath::reflect(incomingRay.direction, normal);
-        return RayAction(
-            intersectionPoint,
-            Ray{intersectionPoint + reflectedDir * EPSILON * 10.f, reflectedDir, incomingRay.bounces_left - 1, incomingRay.color});
+        sf::Vector2f reflectedDir = reflectDirection(VectorMath::Vec2T<float>(incomingRay.direction), VectorMath::Vec2T<float>(intersectionPoint),
+                                                     VectorMath::Vec2T<float>(center)).value();
+        Ray outgoingRay = incomingRay;
+        outgoingRay.origin = intersectionPoint + reflectedDir * EPSILON * 10.f;
+        outgoingRay.direction = reflectedDir;
+        outgoingRay.bounces_left = incomingRay.bounces_left - 1;
+        return RayAction(intersectionPoint, outgoingRay);
     }
 
     bool isPointNear(const sf::Vector2f &point, float tolerance = 5.0f) const override
@@ -109,18 +119,39 @@ public:
     {
         return center;
     }
+    // Границы дуги: концы дуги и крайние точки окружности, попадающие в дугу
+    sf::FloatRect getBounds() const override
+    {
+        sf::Vector2f p1 = getP1();
+        sf::Vector2f p2 = getP2();
+        float minX = std::min(p1.x, p2.x), maxX = std::max(p1.x, p2.x);
+        float minY = std::min(p1.y, p2.y), maxY = std::max(p1.y, p2.y);
+        float r = std::abs(radius);
+        const float axisAngles[4] = {0.f, static_cast<float>(M_PI) / 2.f, static_cast<float>(M_PI), -static_cast<float>(M_PI) / 2.f};
+        for (float a : axisAngles)
+        {
+            if (VectorMath::isAngleBetween(a, startAngle, spanAngle))
+            {
+                sf::Vector2f p = center + r * sf::Vector2f(std::cos(a), std::sin(a));
+                minX = std::min(minX, p.x);
+                maxX = std::max(maxX, p.x);
+                minY = std::min(minY, p.y);
+                maxY = std::max(maxY, p.y);
+            }
+        }
+        return sf::FloatRect(minX, minY, maxX - minX, maxY - minY);
+    }
     std::vector<sf::Vector2f> getHandles() const override
     {
         return {center, getP1(), getP2()};
     } // Центр, начало, конец дуги
     int getHandleAtPoint(const sf::Vector2f &point, float tolerance = 8.0f) const override
     {
-        auto handles = getHandles();
-        if (VectorMath::distance(point, handles[1]) <= tolerance)
+        if (VectorMath::distance(point, getP1()) <= tolerance)
             return 1;
-        if (VectorMath::distance(point, handles[2]) <= tolerance)
+        if (VectorMath::distance(point, getP2()) <= tolerance)
             return 2;
-        if (VectorMath::distance(point, handles[0]) <= tolerance)
+        if (VectorMath::distance(point, center) <= tolerance)
             return 0;
         if (isPointNear(point, tolerance))
             return 0;
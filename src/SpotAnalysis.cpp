@@ -0,0 +1,231 @@
+#include "SpotAnalysis.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "VectorMath.hpp"
+#include "ParallelFor.hpp"
+
+namespace
+{
+    const float MIN_AXIS_COSINE = 0.1f;  // Лучи почти вдоль плоскости не учитываются
+    const float PLANE_TOLERANCE = 0.01f; // Путь, закончившийся на детекторе, касается плоскости с погрешностью
+}
+
+SpotAnalysis::SpotAnalysis(size_t histogramBins, size_t maxSpotPoints)
+    : m_autoFocus(true), m_planeReady(false), m_origin(0.f, 0.f), m_tangent(0.f, 1.f), m_normal(1.f, 0.f),
+      m_halfExtent(0.f), m_maxSpotPoints(maxSpotPoints), m_histogram(std::max<size_t>(1, histogramBins), 0.0)
+{
+}
+
+void SpotAnalysis::setPlane(const sf::Vector2f &p1, const sf::Vector2f &p2)
+{
+    sf::Vector2f origin = (p1 + p2) / 2.f;
+    sf::Vector2f tangent = VectorMath::normalize(p2 - p1);
+    float halfExtent = VectorMath::distance(p1, p2) / 2.f;
+    if (!m_autoFocus && m_planeReady && origin == m_origin && tangent == m_tangent && halfExtent == m_halfExtent)
+        return;
+    m_autoFocus = false;
+    m_origin = origin;
+    m_tangent = tangent;
+    m_normal = sf::Vector2f(tangent.y, -tangent.x);
+    m_halfExtent = std::max(halfExtent, EPSILON);
+    reset();
+    m_planeReady = true;
+}
+
+void SpotAnalysis::setAutoFocus(float halfExtent)
+{
+    if (m_autoFocus && m_halfExtent == halfExtent)
+        return;
+    m_autoFocus = true;
+    m_halfExtent = halfExtent;
+    reset();
+}
+
+void SpotAnalysis::reset()
+{
+    m_moments = Moments();
+    std::fill(m_histogram.begin(), m_histogram.end(), 0.0);
+    m_spotPoints.clear();
+    m_result = Result();
+    // Автоматическая плоскость ищется заново по лучам следующего кадра
+    if (m_autoFocus)
+        m_planeReady = false;
+}
+
+bool SpotAnalysis::crossPlane(const RayPath &path, double &y, double &m, double &w, sf::Vector2f &point) const
+{
+    if (path.size() < 2)
+        return false;
+    // В автоматическом режиме используется прямая последнего отрезка (луч после всех элементов),
+    // иначе - первый отрезок, пересекающий опорную плоскость
+    size_t first = m_autoFocus ? path.size() - 2 : 0;
+    for (size_t k = first; k + 1 < path.size(); ++k)
+    {
+        sf::Vector2f a = path[k].position;
+        sf::Vector2f b = path[k + 1].position;
+        sf::Vector2f dir = b - a;
+        float dn = VectorMath::dot(dir, m_normal);
+        float len = VectorMath::length(dir);
+        if (len < EPSILON || std::abs(dn) < MIN_AXIS_COSINE * len)
+            continue;
+        float da = VectorMath::dot(a - m_origin, m_normal);
+        float db = VectorMath::dot(b - m_origin, m_normal);
+        if (!m_autoFocus && ((da > PLANE_TOLERANCE && db > PLANE_TOLERANCE) || (da < -PLANE_TOLERANCE && db < -PLANE_TOLERANCE)))
+            continue;
+        point = a + dir * (da / (da - db));
+        y = VectorMath::dot(point - m_origin, m_tangent);
+        if (std::abs(y) > m_halfExtent)
+            continue;
+        m = VectorMath::dot(dir, m_tangent) / dn;
+        w = path[k + 1].intensity; // Энергия отрезка, а не прозрачность для отображения
+        return true;
+    }
+    return false;
+}
+
+bool SpotAnalysis::placeAutoPlane(const std::vector<RayPath> &paths)
+{
+    // Средняя точка и среднее направление последних отрезков
+    sf::Vector2f sumDir(0.f, 0.f), sumPoint(0.f, 0.f);
+    size_t count = 0;
+    for (const RayPath &path : paths)
+    {
+        if (path.size() < 2)
+            continue;
+        sf::Vector2f a = path[path.size() - 2].position;
+        sumDir += VectorMath::normalize(path.back().position - a);
+        sumPoint += a;
+        ++count;
+    }
+    if (count == 0 || VectorMath::length(sumDir) < EPSILON * count)
+        return false;
+    m_normal = VectorMath::normalize(sumDir);
+    m_tangent = sf::Vector2f(-m_normal.y, m_normal.x);
+    m_origin = sumPoint / static_cast<float>(count);
+
+    // Переход в плоскость наилучшей фокусировки по моментам в исходной плоскости
+    float searchExtent = m_halfExtent;
+    m_halfExtent = std::numeric_limits<float>::max();
+    Moments moments;
+    for (const RayPath &path : paths)
+    {
+        double y, m, w;
+        sf::Vector2f point;
+        if (crossPlane(path, y, m, w, point))
+            moments.add(y, m, w);
+    }
+    m_halfExtent = searchExtent;
+    if (moments.weight <= 0.0)
+        return false;
+    double meanY = moments.sumY / moments.weight;
+    double meanM = moments.sumM / moments.weight;
+    double varM = moments.sumMM / moments.weight - meanM * meanM;
+    double cov = moments.sumYM / moments.weight - meanY * meanM;
+    double shift = varM > 1e-12 ? -cov / varM : 0.0;
+    m_origin += m_normal * static_cast<float>(shift) + m_tangent * static_cast<float>(meanY + shift * meanM);
+    return true;
+}
+
+void SpotAnalysis::accumulate(const std::vector<RayPath> &paths)
+{
+    if (!m_planeReady)
+    {
+        if (!m_autoFocus || !placeAutoPlane(paths))
+            return;
+        m_planeReady = true;
+    }
+
+    unsigned workers = Parallel::workerCount();
+    const size_t bins = m_histogram.size();
+    m_partials.resize(workers);
+    for (Partial &partial : m_partials)
+    {
+        partial.moments = Moments();
+        partial.histogram.assign(bins, 0.0);
+        partial.points.clear();
+    }
+    size_t maxPoints = std::max<size_t>(1, m_maxSpotPoints);
+    size_t stride = (paths.size() + maxPoints - 1) / maxPoints;
+    const double binScale = bins / (2.0 * m_halfExtent);
+    Parallel::forEachChunk(paths.size(), [&](size_t begin, size_t end, unsigned w)
+    {
+        Partial &partial = m_partials[w];
+        for (size_t i = begin; i < end; ++i)
+        {
+            double y, m, weight;
+            sf::Vector2f point;
+            if (!crossPlane(paths[i], y, m, weight, point))
+                continue;
+            partial.moments.add(y, m, weight);
+            size_t bin = std::min(bins - 1, static_cast<size_t>((y + m_halfExtent) * binScale));
+            partial.histogram[bin] += weight;
+            if (i % stride == 0)
+                partial.points.push_back(point);
+        }
+    }, workers);
+
+    m_spotPoints.clear();
+    for (const Partial &partial : m_partials)
+    {
+        m_moments.merge(partial.moments);
+        for (size_t b = 0; b < bins; ++b)
+            m_histogram[b] += partial.histogram[b];
+        m_spotPoints.insert(m_spotPoints.end(), partial.points.begin(), partial.points.end());
+    }
+    updateResult();
+}
+
+void SpotAnalysis::updateResult()
+{
+    Result &r = m_result;
+    r.planeOrigin = m_origin;
+    r.planeTangent = m_tangent;
+    r.halfExtent = m_halfExtent;
+    r.rayCount = m_moments.count;
+    r.totalWeight = m_moments.weight;
+    r.valid = m_moments.weight > 0.0;
+    if (!r.valid)
+        return;
+
+    double W = m_moments.weight;
+    double meanY = m_moments.sumY / W;
+    double meanM = m_moments.sumM / W;
+    double varY = std::max(0.0, m_moments.sumYY / W - meanY * meanY);
+    double varM = std::max(0.0, m_moments.sumMM / W - meanM * meanM);
+    double cov = m_moments.sumYM / W - meanY * meanM;
+    r.centroid = meanY;
+    r.rmsRadius = std::sqrt(varY);
+    r.bestFocusShift = varM > 1e-12 ? -cov / varM : 0.0;
+    r.bestFocusRms = std::sqrt(std::max(0.0, varY + 2.0 * r.bestFocusShift * cov + r.bestFocusShift * r.bestFocusShift * varM));
+
+    // Энергия в круге: ячейки гистограммы по удалению от центра
+    const size_t bins = m_histogram.size();
+    double binWidth = 2.0 * m_halfExtent / bins;
+    std::vector<size_t> order(bins);
+    std::iota(order.begin(), order.end(), size_t(0));
+    auto distanceOf = [&](size_t b) { return std::abs(-m_halfExtent + (b + 0.5) * binWidth - meanY); };
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return distanceOf(a) < distanceOf(b); });
+    double total = std::accumulate(m_histogram.begin(), m_histogram.end(), 0.0);
+    double cumulative = 0.0;
+    r.ee50Radius = r.ee80Radius = 0.0;
+    bool found50 = false;
+    for (size_t b : order)
+    {
+        cumulative += m_histogram[b];
+        double radius = distanceOf(b) + binWidth / 2.0;
+        if (!found50 && cumulative >= 0.5 * total)
+        {
+            r.ee50Radius = radius;
+            found50 = true;
+        }
+        if (cumulative >= 0.8 * total)
+        {
+            r.ee80Radius = radius;
+            break;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef HEADER_GUARD_SPOT_ANALYSIS_HPP
+#define HEADER_GUARD_SPOT_ANALYSIS_HPP
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+#include <cstddef>
+
+#include "AppDefs.hpp"
+
+// Анализ пятна рассеяния в опорной плоскости (в 2D - прямой).
+// Лучи пересекаются с плоскостью, статистика считается потоковыми суммами без хранения
+// точек: моменты положения y и наклона m = tg угла к нормали плоскости. По ним находятся
+// центр, среднеквадратичный радиус и сдвиг плоскости наилучшей фокусировки:
+// y(s) = y + s*m, RMS(s) минимален при s = -cov(y, m) / var(m).
+// Энергия в круге считается по гистограмме положений. Суммы потоков объединяются,
+// а суммы последовательных кадров накапливаются, пока не изменится сцена.
+class SpotAnalysis
+{
+public:
+    // Потоковые суммы по лучам, пересёкшим плоскость
+    struct Moments
+    {
+        double weight = 0.0;
+        double sumY = 0.0, sumYY = 0.0;
+        double sumM = 0.0, sumMM = 0.0, sumYM = 0.0;
+        size_t count = 0;
+
+        void add(double y, double m, double w)
+        {
+            weight += w;
+            sumY += w * y;
+            sumYY += w * y * y;
+            sumM += w * m;
+            sumMM += w * m * m;
+            sumYM += w * y * m;
+            ++count;
+        }
+        void merge(const Moments &o)
+        {
+            weight += o.weight;
+            sumY += o.sumY;
+            sumYY += o.sumYY;
+            sumM += o.sumM;
+            sumMM += o.sumMM;
+            sumYM += o.sumYM;
+            count += o.count;
+        }
+    };
+
+    struct Result
+    {
+        bool valid = false;
+        sf::Vector2f planeOrigin;   // Точка плоскости (начало отсчёта y)
+        sf::Vector2f planeTangent;  // Направление вдоль плоскости
+        float halfExtent = 0.f;     // Половина длины плоскости
+        double centroid = 0.0;      // Центр пятна (y)
+        double rmsRadius = 0.0;     // Среднеквадратичный радиус относительно центра
+        double ee50Radius = 0.0;    // Радиус, содержащий 50% энергии
+        double ee80Radius = 0.0;    // Радиус, содержащий 80% энергии
+        double bestFocusShift = 0.0; // Сдвиг плоскости наилучшей фокусировки вдоль нормали
+        double bestFocusRms = 0.0;   // RMS в плоскости наилучшей фокусировки
+        size_t rayCount = 0;
+        double totalWeight = 0.0;
+    };
+
+    explicit SpotAnalysis(size_t histogramBins = 1024, size_t maxSpotPoints = 4096);
+
+    // Опорная плоскость задана отрезком (например, детектором)
+    void setPlane(const sf::Vector2f &p1, const sf::Vector2f &p2);
+    // Плоскость выбирается автоматически в положении наилучшей фокусировки
+    void setAutoFocus(float halfExtent);
+    // Сброс накопленных сумм (сцена изменилась)
+    void reset();
+
+    // Добавление лучей кадра: параллельный проход по путям, суммы объединяются с накопленными
+    void accumulate(const std::vector<RayPath> &paths);
+
+    const Result &getResult() const { return m_result; }
+    // Точки пятна последнего кадра (для отрисовки)
+    const std::vector<sf::Vector2f> &getSpotPoints() const { return m_spotPoints; }
+
+private:
+    struct Partial
+    {
+        Moments moments;
+        std::vector<double> histogram;
+        std::vector<sf::Vector2f> points;
+    };
+
+    // Пересечение пути с плоскостью: положение y, наклон m и вес луча
+    bool crossPlane(const RayPath &path, double &y, double &m, double &w, sf::Vector2f &point) const;
+    // Автоматическая плоскость: перпендикулярно среднему направлению последних отрезков
+    bool placeAutoPlane(const std::vector<RayPath> &paths);
+    void updateResult();
+
+    bool m_autoFocus;
+    bool m_planeReady;
+    sf::Vector2f m_origin;
+    sf::Vector2f m_tangent;
+    sf::Vector2f m_normal;
+    float m_halfExtent;
+
+    size_t m_maxSpotPoints;
+    Moments m_moments;
+    std::vector<double> m_histogram; // Вес лучей по положению y в [-halfExtent, halfExtent]
+    std::vector<Partial> m_partials;
+    std::vector<sf::Vector2f> m_spotPoints;
+    Result m_result;
+};
+
+#endif // HEADER_GUARD_SPOT_ANALYSIS_HPP
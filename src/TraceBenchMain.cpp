@@ -0,0 +1,246 @@
+#include "AngularSweep.hpp"
+#include "AppDefs.hpp"
+#include "Mirror.hpp"
+#include "Random.hpp"
+#include "SpatialIndex.hpp"
+#include "Constants.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct BenchSettings
+    {
+        size_t elements = 0; // 0 - по умолчанию для режима
+        size_t queries = 10000;
+        size_t repeats = 7; // Выводится лучший из повторов
+        uint64_t seed = 1;
+        int rays = 0;       // Лучей на источник; 0 - по умолчанию для режима
+    };
+
+    double microseconds(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::micro>(to - from).count();
+    }
+
+    // Элемент под точкой по правилам OpticalApplication::findElementAt
+    bool picks(const OpticalElement &element, const sf::Vector2f &point)
+    {
+        return element.getHandleAtPoint(point, AppConstants::HANDLE_SELECT_TOLERANCE) != static_cast<int>(HandleType::NONE) ||
+               element.isPointNear(point, AppConstants::ELEMENT_SELECT_TOLERANCE);
+    }
+
+    // Выбор точкой: сетка SpatialIndex против перебора всех элементов сверху вниз
+    int benchPick(const BenchSettings &settings)
+    {
+        const float worldSize = 20000.f;
+        Random::CounterRng rng{settings.seed, 0};
+        std::vector<std::unique_ptr<OpticalElement>> owned;
+        std::vector<OpticalElement *> elements;
+        const size_t count = settings.elements > 0 ? settings.elements : 100000;
+        for (size_t i = 0; i < count; ++i)
+        {
+            sf::Vector2f center(rng.nextFloat() * worldSize, rng.nextFloat() * worldSize);
+            owned.push_back(std::make_unique<Mirror>(center, 20.f + rng.nextFloat() * 40.f, rng.nextFloat() * 6.2831853f));
+            elements.push_back(owned.back().get());
+        }
+        std::vector<sf::Vector2f> points;
+        for (size_t q = 0; q < settings.queries; ++q)
+            points.emplace_back(rng.nextFloat() * worldSize, rng.nextFloat() * worldSize);
+
+        SpatialIndex index;
+        auto buildStart = Clock::now();
+        index.rebuild(elements);
+        double buildUs = microseconds(buildStart, Clock::now());
+
+        std::vector<long> indexed(points.size(), -1), scanned(points.size(), -1);
+        std::vector<size_t> candidates;
+        double indexUs = 0.0, scanUs = 0.0;
+        for (size_t repeat = 0; repeat < settings.repeats; ++repeat)
+        {
+            auto start = Clock::now();
+            for (size_t q = 0; q < points.size(); ++q)
+            {
+                index.queryPoint(points[q], candidates);
+                indexed[q] = -1;
+                for (size_t i : candidates)
+                {
+                    if (picks(*elements[i], points[q]))
+                    {
+                        indexed[q] = static_cast<long>(i);
+                        break;
+                    }
+                }
+            }
+            double us = microseconds(start, Clock::now());
+            indexUs = repeat == 0 ? us : std::min(indexUs, us);
+        }
+        // Перебор медленный: повторяется один раз
+        auto start = Clock::now();
+        for (size_t q = 0; q < points.size(); ++q)
+        {
+            for (size_t i = elements.size(); i-- > 0;)
+            {
+                if (picks(*elements[i], points[q]))
+                {
+                    scanned[q] = static_cast<long>(i);
+                    break;
+                }
+            }
+        }
+        scanUs = microseconds(start, Clock::now());
+
+        size_t mismatches = 0, found = 0;
+        for (size_t q = 0; q < points.size(); ++q)
+        {
+            mismatches += indexed[q] != scanned[q];
+            found += indexed[q] >= 0;
+        }
+        const double n = static_cast<double>(std::max<size_t>(1, points.size()));
+        std::cout << std::fixed << std::setprecision(2) << "pick: " << elements.size() << " mirrors, " << points.size() << " points ("
+                  << found << " hits), build " << buildUs / 1000.0 << " ms, index " << indexUs / n << " us/query, scan " << scanUs / n
+                  << " us/query, " << mismatches << " mismatches" << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    // Первое попадание веера лучей из одной точки: AngularSweep против перебора всех элементов
+    // (как RayTracer без углового обхода), один поток. Количества элементов - 32 и 512 либо --elements
+    int benchSweep(const BenchSettings &settings)
+    {
+        const float worldSize = 2000.f;
+        const sf::Vector2f origin(0.5f * worldSize, 0.5f * worldSize);
+        const size_t rayCount = static_cast<size_t>(settings.rays > 0 ? settings.rays : 100000);
+        std::vector<size_t> counts{32, 512};
+        if (settings.elements > 0)
+            counts = {settings.elements};
+
+        std::vector<Ray> rays(rayCount);
+        std::vector<AngularSweep::SweepRay> order(rayCount);
+        for (size_t i = 0; i < rayCount; ++i)
+        {
+            float angle = 6.2831853f * (static_cast<float>(i) + 0.5f) / static_cast<float>(rayCount);
+            rays[i] = {origin, sf::Vector2f(std::cos(angle), std::sin(angle)), Ray().bounces_left, sf::Color::White, 550.f};
+            order[i] = AngularSweep::sweepRay(rays[i], static_cast<uint32_t>(i));
+        }
+        std::sort(order.begin(), order.end());
+        const float maxDistance = worldSize;
+
+        size_t mismatches = 0;
+        for (size_t count : counts)
+        {
+            Random::CounterRng rng{settings.seed, count};
+            std::vector<std::unique_ptr<OpticalElement>> owned;
+            std::vector<const OpticalElement *> targets;
+            for (size_t i = 0; i < count; ++i)
+            {
+                sf::Vector2f center(rng.nextFloat() * worldSize, rng.nextFloat() * worldSize);
+                owned.push_back(std::make_unique<Mirror>(center, 20.f + rng.nextFloat() * 40.f, rng.nextFloat() * 6.2831853f));
+                targets.push_back(owned.back().get());
+            }
+
+            std::vector<AngularSweep::Hit> swept(rayCount), scanned(rayCount);
+            AngularSweep sweep;
+            double sweepUs = 0.0, scanUs = 0.0;
+            for (size_t repeat = 0; repeat < settings.repeats; ++repeat)
+            {
+                auto start = Clock::now();
+                sweep.build(origin, targets);
+                sweep.solve(rays.data(), order.data(), 0, rayCount, maxDistance, swept.data());
+                double us = microseconds(start, Clock::now());
+                sweepUs = repeat == 0 ? us : std::min(sweepUs, us);
+
+                start = Clock::now();
+                for (size_t r = 0; r < rayCount; ++r)
+                {
+                    AngularSweep::Hit &hit = scanned[r];
+                    hit.intersection = VectorMath::IntersectionResult();
+                    hit.intersection.distance = maxDistance;
+                    hit.targetIndex = targets.size();
+                    for (size_t t = 0; t < targets.size(); ++t)
+                    {
+                        VectorMath::IntersectionResult intersection = targets[t]->findIntersection(rays[r]);
+                        if (intersection.intersects && intersection.distance > EPSILON && intersection.distance < hit.intersection.distance)
+                        {
+                            hit.intersection = intersection;
+                            hit.targetIndex = t;
+                        }
+                    }
+                }
+                us = microseconds(start, Clock::now());
+                scanUs = repeat == 0 ? us : std::min(scanUs, us);
+            }
+
+            size_t different = 0, hits = 0;
+            for (size_t r = 0; r < rayCount; ++r)
+            {
+                different += swept[r].targetIndex != scanned[r].targetIndex ||
+                             (scanned[r].targetIndex < targets.size() && swept[r].intersection.distance != scanned[r].intersection.distance);
+                hits += scanned[r].targetIndex < targets.size();
+            }
+            mismatches += different;
+            std::cout << std::fixed << std::setprecision(2) << "sweep: " << count << " mirrors, " << rayCount << " rays (" << hits
+                      << " hits), sweep " << sweepUs / 1000.0 << " ms, scan " << scanUs / 1000.0 << " ms, " << different << " mismatches"
+                      << std::endl;
+        }
+        return mismatches == 0 ? 0 : 1;
+    }
+}
+
+// Замеры ускоряющих структур с проверкой совпадения результатов с прямым перебором:
+// trace_bench [--mode pick|sweep] [--elements N] [--queries Q] [--rays R] [--repeats R] [--seed S]
+int main(int argc, char *argv[])
+{
+    BenchSettings settings;
+    std::string mode = "pick";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 2;
+        }
+        std::string value = argv[++i];
+        try
+        {
+            if (arg == "--mode")
+                mode = value;
+            else if (arg == "--elements")
+                settings.elements = static_cast<size_t>(std::stoul(value));
+            else if (arg == "--queries")
+                settings.queries = static_cast<size_t>(std::stoul(value));
+            else if (arg == "--rays")
+                settings.rays = std::max(1, std::stoi(value));
+            else if (arg == "--repeats")
+                settings.repeats = std::max<size_t>(1, std::stoul(value));
+            else if (arg == "--seed")
+                settings.seed = std::stoull(value);
+            else
+            {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return 2;
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 2;
+        }
+    }
+
+    if (mode == "pick")
+        return benchPick(settings);
+    if (mode == "sweep")
+        return benchSweep(settings);
+    std::cerr << "Invalid value for --mode: " << mode << std::endl;
+    return 2;
+}
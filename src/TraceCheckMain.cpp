@@ -0,0 +1,121 @@
+#include "TraceEquivalence.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+// Проверка эквивалентности трассировщиков, производных DiffTracer и областей BeamTracer:
+// trace_check [--random N] [--beam-random N] [--seed S] [--elements M] [--tolerance T] [--verbose]
+int main(int argc, char *argv[])
+{
+    size_t randomScenes = 32;
+    // Области пучков проверяются быстро, а промахи в них редки: случайных сцен нужно больше
+    size_t beamRandomScenes = 256;
+    size_t randomElements = 12;
+    unsigned long long seed = 1;
+    bool verbose = false;
+    TraceEquivalence::Settings settings;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--verbose")
+        {
+            verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 2;
+        }
+        std::string value = argv[++i];
+        try
+        {
+            if (arg == "--random")
+                randomScenes = static_cast<size_t>(std::stoul(value));
+            else if (arg == "--beam-random")
+                beamRandomScenes = static_cast<size_t>(std::stoul(value));
+            else if (arg == "--seed")
+                seed = std::stoull(value);
+            else if (arg == "--elements")
+                randomElements = static_cast<size_t>(std::stoul(value));
+            else if (arg == "--tolerance")
+                settings.positionTolerance = std::stof(value);
+            else
+            {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return 2;
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<TraceEquivalence::Scene> scenes = TraceEquivalence::regressionScenes();
+    for (size_t i = 0; i < randomScenes; ++i)
+        scenes.push_back(TraceEquivalence::randomScene(seed + i, randomElements));
+
+    TraceEquivalence checker(settings);
+    std::vector<TraceEquivalence::Engine> engines = TraceEquivalence::defaultEngines();
+    size_t failures = 0;
+    for (const auto &scene : scenes)
+    {
+        for (const auto &engine : engines)
+        {
+            TraceEquivalence::Report report = checker.check(scene, engine);
+            if (!report.equivalent)
+            {
+                ++failures;
+                std::cout << "FAIL " << report.divergence << std::endl;
+            }
+            else if (verbose)
+            {
+                std::cout << "ok   scene '" << scene.name << "', engine '" << engine.name << "': " << report.comparedPaths << " paths" << std::endl;
+            }
+        }
+    }
+    std::cout << scenes.size() << " scenes x " << engines.size() << " engines, " << failures << " divergent" << std::endl;
+
+    size_t derivatives = 0, derivativeFailures = 0;
+    for (const auto &scene : scenes)
+    {
+        TraceEquivalence::Report report = checker.checkDerivatives(scene);
+        derivatives += report.comparedDerivatives;
+        if (!report.equivalent)
+        {
+            ++derivativeFailures;
+            std::cout << "FAIL " << report.divergence << std::endl;
+        }
+        else if (verbose)
+        {
+            std::cout << "ok   scene '" << scene.name << "': " << report.comparedDerivatives << " derivatives" << std::endl;
+        }
+    }
+    std::cout << derivatives << " derivatives vs finite differences, " << derivativeFailures << " scenes divergent" << std::endl;
+
+    std::vector<TraceEquivalence::Scene> beamScenes = TraceEquivalence::regressionScenes();
+    for (size_t i = 0; i < std::max(randomScenes, beamRandomScenes); ++i)
+        beamScenes.push_back(TraceEquivalence::randomScene(seed + i, randomElements));
+
+    size_t samples = 0, grazing = 0, beamFailures = 0;
+    for (const auto &scene : beamScenes)
+    {
+        TraceEquivalence::Report report = checker.checkBeams(scene);
+        samples += report.comparedSamples;
+        grazing += report.grazingPaths;
+        if (!report.equivalent)
+        {
+            ++beamFailures;
+            std::cout << "FAIL " << report.divergence << std::endl;
+        }
+        else if (verbose)
+        {
+            std::cout << "ok   scene '" << scene.name << "': " << report.comparedSamples << " ray samples in beam regions" << std::endl;
+        }
+    }
+    std::cout << beamScenes.size() << " scenes: " << samples << " ray samples vs beam regions (" << grazing << " paths stopped at grazing re-hits), " << beamFailures << " scenes divergent" << std::endl;
+    return failures == 0 && derivativeFailures == 0 && beamFailures == 0 ? 0 : 1;
+}
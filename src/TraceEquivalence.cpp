@@ -0,0 +1,765 @@
+#include "TraceEquivalence.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+
+#include "PointSource.hpp"
+#include "Mirror.hpp"
+#include "IdealLens.hpp"
+#include "SphericalMirror.hpp"
+#include "Detector.hpp"
+#include "DielectricBody.hpp"
+#include "BeamSplitter.hpp"
+#include "DiffTracer.hpp"
+#include "BeamTracer.hpp"
+
+namespace
+{
+    const char *typeName(OpticalElement::Type type)
+    {
+        switch (type)
+        {
+        case OpticalElement::Type::NONE: return "none";
+        case OpticalElement::Type::SOURCE: return "source";
+        case OpticalElement::Type::MIRROR: return "mirror";
+        case OpticalElement::Type::LENS: return "lens";
+        case OpticalElement::Type::SPHERICAL_MIRROR: return "spherical mirror";
+        case OpticalElement::Type::DETECTOR: return "detector";
+        case OpticalElement::Type::DIELECTRIC: return "dielectric";
+        case OpticalElement::Type::BEAM_SPLITTER: return "beam splitter";
+        }
+        return "?";
+    }
+
+    bool alive(const Ray &ray) { return ray.bounces_left > 0 && ray.intensity > 0.f; }
+
+    bool relativelyClose(double a, double b, double tolerance)
+    {
+        return std::abs(a - b) <= tolerance * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+    }
+
+    std::string formatPoint(const sf::Vector2f &p)
+    {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(3) << "(" << p.x << ", " << p.y << ")";
+        return ss.str();
+    }
+}
+
+// Эталонная трассировка
+
+VectorMath::IntersectionResult ReferenceTracer::intersect(const OpticalElement &element, const Ray &ray)
+{
+    const auto *body = dynamic_cast<const DielectricBody *>(&element);
+    if (!body)
+        return element.findIntersection(ray);
+    VectorMath::IntersectionResult best;
+    const std::vector<sf::Vector2f> &vertices = body->getVertices();
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        VectorMath::IntersectionResult hit = VectorMath::raySegmentIntersection(ray.origin, ray.direction, vertices[i], vertices[(i + 1) % vertices.size()]);
+        if (hit.intersects && hit.distance < best.distance)
+            best = hit;
+    }
+    return best;
+}
+
+void ReferenceTracer::trace(const std::vector<const OpticalElement *> &elements, Result &result) const
+{
+    result = Result();
+    TraceResult &out = result.trace;
+
+    std::vector<size_t> targets;
+    std::unordered_map<size_t, size_t> detectorOf;
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        if (!elements[i] || elements[i]->getType() == OpticalElement::Type::SOURCE)
+            continue;
+        if (const auto *detector = dynamic_cast<const Detector *>(elements[i]))
+        {
+            detectorOf[i] = out.detectors.size();
+            out.detectors.push_back(detector);
+            out.detectorBins.emplace_back(static_cast<size_t>(detector->getNumBins()), 0.f);
+        }
+        targets.push_back(i);
+    }
+
+    struct Pending
+    {
+        Ray ray;
+        float weight;
+        size_t path; // Номер в branchPaths или в out.paths
+        bool branch;
+    };
+    std::vector<RayPath> branchPaths;
+    std::vector<std::vector<int>> branchElements;
+    std::vector<PathOrigin> branchOrigins;
+
+    auto traceTree = [&](const Ray &root, float weight, size_t rootPath, const PathOrigin &origin)
+    {
+        std::vector<Pending> stack{{root, weight, rootPath, false}};
+        while (!stack.empty())
+        {
+            Pending pending = stack.back();
+            stack.pop_back();
+            Ray ray = pending.ray;
+            while (ray.bounces_left > 0)
+            {
+                RayPath &path = pending.branch ? branchPaths[pending.path] : out.paths[pending.path];
+                std::vector<int> &pathElements = pending.branch ? branchElements[pending.path] : result.pathElements[pending.path];
+
+                size_t hitIndex = elements.size();
+                VectorMath::IntersectionResult hit;
+                hit.distance = m_options.maxRayLength;
+                for (size_t i : targets)
+                {
+                    VectorMath::IntersectionResult candidate = intersect(*elements[i], ray);
+                    if (candidate.intersects && candidate.distance > EPSILON && candidate.distance < hit.distance)
+                    {
+                        hit = candidate;
+                        hitIndex = i;
+                    }
+                }
+                if (hitIndex == elements.size())
+                {
+                    path.push_back(PathVertex(ray.origin + ray.direction * m_options.maxRayLength, ray.color, ray.intensity * pending.weight));
+                    pathElements.push_back(-1);
+                    ++out.escapedRays;
+                    out.escapedEnergy += ray.intensity * pending.weight;
+                    break;
+                }
+
+                const OpticalElement *element = elements[hitIndex];
+                path.push_back(PathVertex(hit.point, ray.color, ray.intensity * pending.weight));
+                pathElements.push_back(static_cast<int>(hitIndex));
+                auto detector = detectorOf.find(hitIndex);
+                if (detector != detectorOf.end())
+                {
+                    const Detector *d = out.detectors[detector->second];
+                    out.detectorBins[detector->second][static_cast<size_t>(d->binIndexAt(hit.point))] += d->hitWeight(ray) * ray.intensity * pending.weight;
+                }
+
+                RayAction action = element->interact(ray, hit.point);
+                if (action.secondaryRay.has_value() && alive(action.secondaryRay.value()))
+                {
+                    PathOrigin branchOrigin = origin;
+                    branchOrigin.branch = true;
+                    branchPaths.push_back(RayPath{PathVertex(hit.point, action.secondaryRay->color, action.secondaryRay->intensity * pending.weight)});
+                    branchElements.push_back({static_cast<int>(hitIndex)});
+                    branchOrigins.push_back(branchOrigin);
+                    stack.push_back({action.secondaryRay.value(), pending.weight, branchPaths.size() - 1, true});
+                }
+                if (!action.outgoingRay.has_value() || !alive(action.outgoingRay.value()))
+                    break;
+                ray = action.outgoingRay.value();
+            }
+        }
+    };
+
+    // Лучи каждой длины волны трассируются отдельно, с долей 1/K энергии геометрического луча
+    size_t sourceOrdinal = 0;
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        const auto *source = dynamic_cast<const PointSource *>(elements[i]);
+        if (!source || source->getNumRays() <= 0 || source->spanAngle <= EPSILON)
+            continue;
+        std::vector<Ray> rays;
+        EmissionPlan plan;
+        if (m_options.importanceEmission)
+            plan = EmissionPlan::build(*source, elements.data(), elements.size(), m_options.emptyDirectionRays);
+        if (m_options.stochastic)
+        {
+            uint64_t key = Random::streamKey(m_options.seed, sourceOrdinal, m_options.frameIndex);
+            for (int k = 0; k < source->getNumRays(); ++k)
+                rays.push_back(plan.isActive() ? plan.sampleRay(*source, key, static_cast<size_t>(k)) : source->sampleRay(key, static_cast<uint64_t>(k)));
+        }
+        else if (plan.isActive())
+        {
+            for (int k = 0; k < source->getNumRays(); ++k)
+                rays.push_back(plan.ray(*source, static_cast<size_t>(k)));
+        }
+        else
+        {
+            rays = source->emitRays();
+        }
+        const int lanes = source->getLaneCount();
+        for (size_t r = 0; r < rays.size(); ++r)
+        {
+            RayPacket packet = source->makePacket(rays[r]);
+            for (int lane = 0; lane < lanes; ++lane)
+            {
+                Ray laneRay = rays[r];
+                if (lanes > 1)
+                {
+                    laneRay.wavelength = packet.wavelength[lane];
+                    laneRay.color = packet.color[lane];
+                }
+                float weight = plan.isActive() ? plan.weight(r) : 1.f;
+                out.paths.push_back(RayPath{PathVertex(laneRay.origin, laneRay.color, laneRay.intensity * weight / static_cast<float>(lanes))});
+                result.pathElements.push_back({-1});
+                result.pathOrigins.push_back({sourceOrdinal, r, lane, false});
+                traceTree(laneRay, weight / static_cast<float>(lanes), out.paths.size() - 1, result.pathOrigins.back());
+            }
+        }
+        ++sourceOrdinal;
+    }
+    out.totalRays = out.paths.size();
+
+    out.paths.insert(out.paths.end(), branchPaths.begin(), branchPaths.end());
+    result.pathElements.insert(result.pathElements.end(), branchElements.begin(), branchElements.end());
+    result.pathOrigins.insert(result.pathOrigins.end(), branchOrigins.begin(), branchOrigins.end());
+}
+
+// Сцены
+
+std::vector<const OpticalElement *> TraceEquivalence::Scene::view() const
+{
+    std::vector<const OpticalElement *> out;
+    for (const auto &element : elements)
+        out.push_back(element.get());
+    return out;
+}
+
+std::vector<TraceEquivalence::Scene> TraceEquivalence::regressionScenes()
+{
+    std::vector<Scene> scenes;
+    auto add = [&](const std::string &name)
+    {
+        scenes.emplace_back();
+        scenes.back().name = name;
+        return &scenes.back().elements;
+    };
+
+    auto *s = add("lens_mirror_detector");
+    s->push_back(std::make_unique<PointSource>(sf::Vector2f(100.f, 400.f), 64, sf::Color::Yellow, -0.3f, 0.6f));
+    s->push_back(std::make_unique<IdealLens>(sf::Vector2f(300.f, 250.f), sf::Vector2f(300.f, 550.f), 100.f));
+    s->push_back(std::make_unique<Mirror>(sf::Vector2f(550.f, 300.f), sf::Vector2f(650.f, 500.f)));
+    s->push_back(std::make_unique<Detector>(sf::Vector2f(300.f, 700.f), sf::Vector2f(700.f, 700.f), 32));
+
+    s = add("spherical_mirror_focus");
+    s->push_back(std::make_unique<PointSource>(sf::Vector2f(200.f, 400.f), 128, sf::Color::Yellow, -0.4f, 0.8f));
+    s->push_back(std::make_unique<SphericalMirror>(sf::Vector2f(500.f, 400.f), 400.f, -0.6f, 1.2f));
+    s->push_back(std::make_unique<Detector>(sf::Vector2f(700.f, 300.f), sf::Vector2f(700.f, 500.f), 64));
+
+    s = add("prism_dispersion");
+    auto source = std::make_unique<PointSource>(sf::Vector2f(150.f, 420.f), 48, sf::Color::White, -0.1f, 0.2f);
+    source->spectrum.cycle();
+    source->spectrum.cycle();
+    s->push_back(std::move(source));
+    auto prism = std::make_unique<DielectricBody>(sf::Vector2f(500.f, 400.f), 120.f, 0.f, DielectricBody::regularPolygon(3), 1.5f);
+    prism->dispersion.cycle();
+    prism->dispersion.cycle();
+    s->push_back(std::move(prism));
+    s->push_back(std::make_unique<Detector>(sf::Vector2f(900.f, 100.f), sf::Vector2f(900.f, 700.f), 128));
+
+    s = add("dispersive_lens_packets");
+    source = std::make_unique<PointSource>(sf::Vector2f(100.f, 400.f), 64, sf::Color::White, -0.25f, 0.5f);
+    source->spectrum.cycle();
+    s->push_back(std::move(source));
+    auto lens = std::make_unique<IdealLens>(sf::Vector2f(350.f, 250.f), sf::Vector2f(350.f, 550.f), 150.f);
+    lens->cycleDispersion();
+    s->push_back(std::move(lens));
+    s->push_back(std::make_unique<Detector>(sf::Vector2f(650.f, 300.f), sf::Vector2f(650.f, 500.f), 64));
+
+    s = add("splitter_tree");
+    s->push_back(std::make_unique<PointSource>(sf::Vector2f(100.f, 400.f), 32, sf::Color::Yellow, -0.05f, 0.1f));
+    s->push_back(std::make_unique<BeamSplitter>(sf::Vector2f(300.f, 350.f), sf::Vector2f(400.f, 450.f), 50));
+    s->push_back(std::make_unique<BeamSplitter>(sf::Vector2f(550.f, 350.f), sf::Vector2f(650.f, 450.f), 30));
+    s->push_back(std::make_unique<Mirror>(sf::Vector2f(300.f, 700.f), sf::Vector2f(400.f, 750.f)));
+    s->push_back(std::make_unique<Detector>(sf::Vector2f(900.f, 300.f), sf::Vector2f(900.f, 500.f), 32));
+    s->push_back(std::make_unique<Detector>(sf::Vector2f(550.f, 100.f), sf::Vector2f(650.f, 100.f), 32));
+
+    s = add("slab_fresnel");
+    s->push_back(std::make_unique<PointSource>(sf::Vector2f(150.f, 300.f), 96, sf::Color::Yellow, 0.2f, 0.6f));
+    s->push_back(std::make_unique<DielectricBody>(sf::Vector2f(500.f, 450.f), 150.f, 0.3f, DielectricBody::slab(), 1.7f));
+    auto angled = std::make_unique<Detector>(sf::Vector2f(800.f, 500.f), sf::Vector2f(900.f, 750.f), 48);
+    angled->angleWeighted = true;
+    s->push_back(std::move(angled));
+    return scenes;
+}
+
+TraceEquivalence::Scene TraceEquivalence::randomScene(uint64_t seed, size_t count)
+{
+    Scene scene;
+    scene.name = "random_" + std::to_string(seed);
+    std::mt19937_64 rng(seed);
+    auto uniform = [&](float a, float b) { return std::uniform_real_distribution<float>(a, b)(rng); };
+    auto point = [&]() { return sf::Vector2f(uniform(0.f, static_cast<float>(AppConstants::WINDOW_WIDTH)), uniform(0.f, static_cast<float>(AppConstants::WINDOW_HEIGHT))); };
+    auto segmentEnd = [&](const sf::Vector2f &p) { return p + VectorMath::direction(uniform(0.f, 6.2832f)).value() * uniform(40.f, 300.f); };
+
+    // Хотя бы один источник
+    size_t sources = 1 + rng() % 2;
+    for (size_t i = 0; i < sources; ++i)
+    {
+        float span = uniform(0.05f, 6.2832f);
+        auto source = std::make_unique<PointSource>(point(), 8 + static_cast<int>(rng() % 56), sf::Color::Yellow, uniform(-3.1416f, 3.1416f), span);
+        for (int c = static_cast<int>(rng() % 3); c > 0; --c)
+            source->spectrum.cycle();
+        scene.elements.push_back(std::move(source));
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        sf::Vector2f p = point();
+        switch (rng() % 6)
+        {
+        case 0:
+            scene.elements.push_back(std::make_unique<Mirror>(p, segmentEnd(p)));
+            break;
+        case 1:
+        {
+            float f = uniform(30.f, 300.f) * (rng() % 4 == 0 ? -1.f : 1.f);
+            auto lens = std::make_unique<IdealLens>(p, segmentEnd(p), f);
+            if (rng() % 3 == 0)
+                lens->cycleDispersion();
+            scene.elements.push_back(std::move(lens));
+            break;
+        }
+        case 2:
+        {
+            float start = uniform(-3.1416f, 3.1416f);
+            scene.elements.push_back(std::make_unique<SphericalMirror>(p, uniform(40.f, 300.f), start, uniform(0.3f, 3.f)));
+            break;
+        }
+        case 3:
+            scene.elements.push_back(std::make_unique<Detector>(p, segmentEnd(p), 8 + static_cast<int>(rng() % 64)));
+            break;
+        case 4:
+        {
+            auto shape = rng() % 2 ? DielectricBody::slab() : DielectricBody::regularPolygon(3 + static_cast<int>(rng() % 6));
+            auto body = std::make_unique<DielectricBody>(p, uniform(30.f, 150.f), uniform(0.f, 6.2832f), std::move(shape), uniform(1.2f, 2.f));
+            for (int c = static_cast<int>(rng() % 3); c > 0; --c)
+                body->dispersion.cycle();
+            scene.elements.push_back(std::move(body));
+            break;
+        }
+        default:
+            scene.elements.push_back(std::make_unique<BeamSplitter>(p, segmentEnd(p), 10 + static_cast<int>(rng() % 81)));
+            break;
+        }
+    }
+    return scene;
+}
+
+// Сравнение
+
+TraceOptions TraceEquivalence::checkOptions()
+{
+    TraceOptions options;
+    options.rouletteThreshold = 0.f;
+    options.maxPendingBranches = 4096;
+    return options;
+}
+
+std::vector<TraceEquivalence::Engine> TraceEquivalence::defaultEngines()
+{
+    auto rayTracer = [](unsigned threads, size_t batchSize, bool recordPaths, bool angularSweep = true)
+    {
+        return [=](const std::vector<const OpticalElement *> &elements, const TraceOptions &base, TraceResult &result)
+        {
+            TraceOptions options = base;
+            options.threadCount = threads;
+            options.batchSize = batchSize;
+            options.recordPaths = recordPaths;
+            options.angularSweep = angularSweep;
+            RayTracer tracer(options);
+            tracer.trace(elements, result);
+        };
+    };
+    return {
+        {"RayTracer, 1 thread", rayTracer(1, 64, true), true},
+        {"RayTracer, all threads", rayTracer(0, 64, true), true},
+        {"RayTracer, batch 1", rayTracer(0, 1, true), true},
+        {"RayTracer, no angular sweep", rayTracer(0, 64, true, false), true},
+        {"RayTracer, no paths", rayTracer(0, 64, false), false},
+        {"RayTracer, importance emission", rayTracer(0, 64, true), true, true},
+    };
+}
+
+TraceEquivalence::Report TraceEquivalence::check(const Scene &scene, const Engine &engine) const
+{
+    std::vector<const OpticalElement *> elements = scene.view();
+    TraceOptions options = checkOptions();
+    options.importanceEmission = engine.importanceEmission;
+    ReferenceTracer::Result reference;
+    ReferenceTracer(options).trace(elements, reference);
+    TraceResult candidate;
+    engine.run(elements, options, candidate);
+    return compare(scene, reference, engine, candidate);
+}
+
+TraceEquivalence::Report TraceEquivalence::checkDerivatives(const Scene &scene) const
+{
+    Report report;
+    std::vector<const OpticalElement *> elements = scene.view();
+    size_t detector = elements.size();
+    for (size_t i = 0; i < elements.size() && detector == elements.size(); ++i)
+    {
+        if (elements[i]->getType() == OpticalElement::Type::DETECTOR)
+            detector = i;
+    }
+    if (detector == elements.size())
+        return report;
+
+    // Шаг разности: градусы для поворота, пиксели для остальных параметров
+    const float STEP = 0.05f;
+    const SweepParameter candidates[] = {SweepParameter::POSITION_X, SweepParameter::POSITION_Y, SweepParameter::ANGLE,
+                                         SweepParameter::FOCAL_LENGTH, SweepParameter::RADIUS};
+    DiffTracer tracer(checkOptions().maxRayLength);
+    auto sameHits = [](const std::vector<DiffTracer::RayResult> &a, const std::vector<DiffTracer::RayResult> &b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t r = 0; r < a.size(); ++r)
+        {
+            if (a[r].hitElements != b[r].hitElements || a[r].differentiable != b[r].differentiable)
+                return false;
+        }
+        return true;
+    };
+
+    std::vector<DiffTracer::RayResult> rays, shiftedRays;
+    for (size_t index = 0; index < elements.size(); ++index)
+    {
+        for (SweepParameter parameter : candidates)
+        {
+            if (!DiffTracer::supports(*elements[index], parameter))
+                continue;
+            std::vector<DiffTracer::Parameter> parameters{{index, parameter}};
+            DiffTracer::Scalar center, rms;
+            if (!tracer.trace(elements, parameters, rays) || !DiffTracer::spotOnDetector(rays, elements, parameters, detector, center, rms))
+                continue;
+
+            // Центральная разность по копиям элемента со сдвинутым параметром
+            const float base = ParameterSweep::currentValue(*elements[index], parameter);
+            float shiftedCenter[2] = {0.f, 0.f}, shiftedRms[2] = {0.f, 0.f};
+            bool comparable = true;
+            for (int side = 0; side < 2 && comparable; ++side)
+            {
+                std::unique_ptr<OpticalElement> copy = elements[index]->clone();
+                ParameterSweep::applyParameter(*copy, parameter, base + (side == 0 ? -STEP : STEP));
+                std::vector<const OpticalElement *> shifted = elements;
+                shifted[index] = copy.get();
+                DiffTracer::Scalar c, r;
+                comparable = tracer.trace(shifted, {}, shiftedRays) && sameHits(rays, shiftedRays) &&
+                             DiffTracer::spotOnDetector(shiftedRays, shifted, {}, detector, c, r);
+                shiftedCenter[side] = c.v;
+                shiftedRms[side] = r.v;
+            }
+            if (!comparable)
+                continue;
+
+            const float fdCenter = (shiftedCenter[1] - shiftedCenter[0]) / (2.f * STEP);
+            const float fdRms = (shiftedRms[1] - shiftedRms[0]) / (2.f * STEP);
+            auto close = [this](float exact, float finite)
+            { return std::abs(exact - finite) <= m_settings.derivativeTolerance * std::max(1.f, std::abs(finite)); };
+            ++report.comparedDerivatives;
+            // Производная размера пятна не определена у точного фокуса
+            bool rmsComparable = rms.v > 1.f && std::min(shiftedRms[0], shiftedRms[1]) > 1.f;
+            if (!close(center.d[0], fdCenter) || (rmsComparable && !close(rms.d[0], fdRms)))
+            {
+                std::ostringstream out;
+                out << "scene '" << scene.name << "', " << typeName(elements[index]->getType()) << " #" << index << ", d/d "
+                    << ParameterSweep::parameterName(parameter) << ": center " << center.d[0] << " vs finite difference " << fdCenter
+                    << ", rms " << rms.d[0] << " vs " << fdRms;
+                report.equivalent = false;
+                report.divergence = out.str();
+                return report;
+            }
+        }
+    }
+    return report;
+}
+
+TraceEquivalence::Report TraceEquivalence::checkBeams(const Scene &scene) const
+{
+    Report report;
+    // Пучок строится для первой длины волны источника, поэтому источники заменяются монохроматическими
+    std::vector<std::unique_ptr<OpticalElement>> copies;
+    std::vector<const OpticalElement *> elements;
+    for (const auto &element : scene.elements)
+    {
+        copies.push_back(element->clone());
+        if (auto *source = dynamic_cast<PointSource *>(copies.back().get()))
+            source->spectrum = Spectral::SourceSpectrum();
+        elements.push_back(copies.back().get());
+    }
+    TraceOptions options = checkOptions();
+    BeamTracer beams;
+    const BeamTracer::Result &regions = beams.trace(elements, options.maxRayLength);
+    if (regions.truncated || !regions.triangles)
+        return report;
+    TraceResult rays;
+    RayTracer(options).trace(elements, rays);
+
+    // Сетка треугольников по ограничивающим прямоугольникам
+    const std::vector<sf::Vertex> &triangles = *regions.triangles;
+    const float CELL = 32.f;
+    const float tolerance = m_settings.positionTolerance + m_settings.beamTolerance;
+    std::unordered_map<uint64_t, std::vector<size_t>> grid;
+    auto cellKey = [](long x, long y) { return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y); };
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3)
+    {
+        float minX = triangles[t].position.x, minY = triangles[t].position.y, maxX = minX, maxY = minY;
+        for (size_t k = 1; k < 3; ++k)
+        {
+            minX = std::min(minX, triangles[t + k].position.x);
+            minY = std::min(minY, triangles[t + k].position.y);
+            maxX = std::max(maxX, triangles[t + k].position.x);
+            maxY = std::max(maxY, triangles[t + k].position.y);
+        }
+        for (long x = std::lround(std::floor((minX - tolerance) / CELL)); x <= std::lround(std::floor((maxX + tolerance) / CELL)); ++x)
+            for (long y = std::lround(std::floor((minY - tolerance) / CELL)); y <= std::lround(std::floor((maxY + tolerance) / CELL)); ++y)
+                grid[cellKey(x, y)].push_back(t);
+    }
+    auto covered = [&](const sf::Vector2f &point)
+    {
+        auto cell = grid.find(cellKey(std::lround(std::floor(point.x / CELL)), std::lround(std::floor(point.y / CELL))));
+        if (cell == grid.end())
+            return false;
+        for (size_t t : cell->second)
+        {
+            const sf::Vector2f &a = triangles[t].position, &b = triangles[t + 1].position, &c = triangles[t + 2].position;
+            float d0 = (b.x - a.x) * (point.y - a.y) - (b.y - a.y) * (point.x - a.x);
+            float d1 = (c.x - b.x) * (point.y - b.y) - (c.y - b.y) * (point.x - b.x);
+            float d2 = (a.x - c.x) * (point.y - c.y) - (a.y - c.y) * (point.x - c.x);
+            // Сумма d0 + d1 + d2 - удвоенная площадь; вырожденный треугольник ничего не покрывает
+            bool inside = std::abs(d0 + d1 + d2) > EPSILON && ((d0 >= 0.f && d1 >= 0.f && d2 >= 0.f) || (d0 <= 0.f && d1 <= 0.f && d2 <= 0.f));
+            if (inside || VectorMath::distancePointSegment(point, a, b) <= tolerance || VectorMath::distancePointSegment(point, b, c) <= tolerance ||
+                VectorMath::distancePointSegment(point, c, a) <= tolerance)
+                return true;
+        }
+        return false;
+    };
+
+    // Почти нулевой отрезок - повторное касательное попадание в ту же дугу или в угол тела (численный
+    // артефакт обоих трассировщиков лучей), которого у пучков нет: дальше путь не проверяется, как и
+    // ветви, начавшиеся после такой точки (пути ветвей идут после родительских путей)
+    std::vector<sf::Vector2f> grazingVertices;
+    auto afterGrazing = [&](const sf::Vector2f &point)
+    {
+        return std::any_of(grazingVertices.begin(), grazingVertices.end(),
+                           [&](const sf::Vector2f &vertex) { return VectorMath::distance(vertex, point) <= m_settings.positionTolerance; });
+    };
+
+    // Слабые ветви пучков обрываются раньше, чем лучи
+    const float MIN_SEGMENT_INTENSITY = 0.01f;
+    for (size_t p = 0; p < rays.paths.size(); ++p)
+    {
+        const RayPath &path = rays.paths[p];
+        size_t grazing = path.size();
+        if (!path.empty() && afterGrazing(path.front().position))
+            grazing = 0;
+        for (size_t k = 1; k < grazing; ++k)
+        {
+            if (VectorMath::distance(path[k - 1].position, path[k].position) <= m_settings.positionTolerance)
+                grazing = k;
+        }
+        if (grazing < path.size())
+        {
+            ++report.grazingPaths;
+            for (size_t k = grazing; k < path.size(); ++k)
+                grazingVertices.push_back(path[k].position);
+        }
+        for (size_t k = 1; k < grazing; ++k)
+        {
+            if (path[k].intensity < MIN_SEGMENT_INTENSITY)
+                break;
+            for (float t : {0.25f, 0.5f, 0.75f})
+            {
+                sf::Vector2f point = path[k - 1].position + (path[k].position - path[k - 1].position) * t;
+                ++report.comparedSamples;
+                if (!covered(point))
+                {
+                    std::ostringstream out;
+                    out << "scene '" << scene.name << "': path " << p << ", segment " << k << " point " << formatPoint(point)
+                        << " is outside the beam regions (" << regions.regions << " regions, " << regions.wedges << " wedges)";
+                    report.equivalent = false;
+                    report.divergence = out.str();
+                    return report;
+                }
+            }
+        }
+    }
+    return report;
+}
+
+std::string TraceEquivalence::describePath(const Scene &scene, const ReferenceTracer::Result &reference, size_t pathIndex,
+                                           const RayPath &candidatePath, size_t vertex) const
+{
+    const ReferenceTracer::PathOrigin &origin = reference.pathOrigins[pathIndex];
+    const RayPath &expected = reference.trace.paths[pathIndex];
+    const std::vector<int> &hitElements = reference.pathElements[pathIndex];
+    std::ostringstream ss;
+    ss << "  " << (origin.branch ? "branch of " : "") << "source #" << origin.source << ", ray " << origin.ray << ", lane " << origin.lane
+       << " (reference " << expected.size() << " vertices, candidate " << candidatePath.size() << ")\n";
+    size_t first = vertex > m_settings.contextVertices / 2 ? vertex - m_settings.contextVertices / 2 : 0;
+    size_t last = std::min(std::max(expected.size(), candidatePath.size()), first + m_settings.contextVertices);
+    for (size_t k = first; k < last; ++k)
+    {
+        ss << (k == vertex ? "  > " : "    ") << k << ": ";
+        if (k < expected.size())
+        {
+            ss << "reference " << formatPoint(expected[k].position);
+            int element = hitElements[k];
+            if (element >= 0)
+                ss << " on " << typeName(scene.elements[element]->getType()) << " #" << element;
+            else
+                ss << (k == 0 ? " start" : " escaped");
+        }
+        else
+        {
+            ss << "reference -";
+        }
+        ss << " | candidate " << (k < candidatePath.size() ? formatPoint(candidatePath[k].position) : std::string("-")) << "\n";
+    }
+    return ss.str();
+}
+
+TraceEquivalence::Report TraceEquivalence::compare(const Scene &scene, const ReferenceTracer::Result &reference, const Engine &engine,
+                                                   const TraceResult &candidate) const
+{
+    Report report;
+    const TraceResult &expected = reference.trace;
+    std::ostringstream ss;
+    ss << "scene '" << scene.name << "', engine '" << engine.name << "': ";
+    auto fail = [&](const std::string &what)
+    {
+        report.equivalent = false;
+        report.divergence = ss.str() + what;
+        return report;
+    };
+
+    if (candidate.totalRays != expected.totalRays)
+        return fail("primary ray count " + std::to_string(candidate.totalRays) + ", reference " + std::to_string(expected.totalRays));
+    if (candidate.droppedBranches != 0)
+        return fail(std::to_string(candidate.droppedBranches) + " branches dropped (queue limit)");
+    // Итоги сравниваются после путей: расхождение пути описывается подробнее, чем расхождение счётчиков
+    auto compareTotals = [&]()
+    {
+        if (candidate.escapedRays != expected.escapedRays)
+            return fail("escaped rays " + std::to_string(candidate.escapedRays) + ", reference " + std::to_string(expected.escapedRays));
+        if (!relativelyClose(candidate.escapedEnergy, expected.escapedEnergy, m_settings.binTolerance))
+            return fail("escaped energy " + std::to_string(candidate.escapedEnergy) + ", reference " + std::to_string(expected.escapedEnergy));
+        if (candidate.detectorBins.size() != expected.detectorBins.size())
+            return fail("detector count differs");
+        for (size_t d = 0; d < expected.detectorBins.size(); ++d)
+        {
+            const auto &a = expected.detectorBins[d];
+            const auto &b = candidate.detectorBins[d];
+            if (a.size() != b.size())
+                return fail("detector " + std::to_string(d) + " bin count differs");
+            for (size_t k = 0; k < a.size(); ++k)
+            {
+                if (!relativelyClose(b[k], a[k], m_settings.binTolerance))
+                    return fail("detector " + std::to_string(d) + ", bin " + std::to_string(k) + ": " + std::to_string(b[k]) + ", reference " + std::to_string(a[k]));
+            }
+        }
+        return report;
+    };
+    if (!engine.recordsPaths)
+        return compareTotals();
+
+    if (candidate.paths.size() != expected.paths.size())
+        return fail("path count " + std::to_string(candidate.paths.size()) + ", reference " + std::to_string(expected.paths.size()));
+
+    const float tolerance = m_settings.positionTolerance;
+    // Первое несовпадение двух путей: номер вершины или размер пути, если все общие вершины совпали
+    auto firstMismatch = [&](const RayPath &a, const RayPath &b)
+    {
+        size_t common = std::min(a.size(), b.size());
+        for (size_t k = 0; k < common; ++k)
+        {
+            // Погрешность направления растёт с длиной отрезка (особенно до точки ухода луча)
+            float allowed = tolerance;
+            if (k > 0)
+                allowed += m_settings.angleTolerance * VectorMath::distance(a[k - 1].position, a[k].position);
+            if (VectorMath::distance(a[k].position, b[k].position) > allowed)
+                return k;
+        }
+        return a.size() == b.size() ? a.size() + 1 : common;
+    };
+
+    // Первичные пути идут в одном порядке
+    for (size_t i = 0; i < expected.totalRays; ++i)
+    {
+        size_t k = firstMismatch(expected.paths[i], candidate.paths[i]);
+        ++report.comparedPaths;
+        if (k <= expected.paths[i].size())
+            return fail("path " + std::to_string(i) + " diverges at vertex " + std::to_string(k) + "\n" + describePath(scene, reference, i, candidate.paths[i], k));
+    }
+
+    // Пути ветвей сопоставляются по начальной точке (сетка с шагом 2*tolerance, проверяются соседние ячейки)
+    const float cell = 2.f * std::max(tolerance, EPSILON);
+    auto cellKey = [&](const sf::Vector2f &p, int dx, int dy)
+    {
+        int64_t x = static_cast<int64_t>(std::floor(p.x / cell)) + dx;
+        int64_t y = static_cast<int64_t>(std::floor(p.y / cell)) + dy;
+        return static_cast<uint64_t>(x) * 0x9e3779b97f4a7c15ULL ^ static_cast<uint64_t>(y);
+    };
+    std::unordered_map<uint64_t, std::vector<size_t>> candidatesByStart;
+    for (size_t i = expected.totalRays; i < candidate.paths.size(); ++i)
+    {
+        if (!candidate.paths[i].empty())
+            candidatesByStart[cellKey(candidate.paths[i][0].position, 0, 0)].push_back(i);
+    }
+    // Из подходящих ветвей выбирается ближайшая: совпадающие в пределах допуска ветви соседних лучей
+    // не должны забирать друг у друга пару
+    auto maxDeviation = [](const RayPath &a, const RayPath &b)
+    {
+        float deviation = 0.f;
+        for (size_t k = 0; k < a.size(); ++k)
+            deviation = std::max(deviation, VectorMath::distance(a[k].position, b[k].position));
+        return deviation;
+    };
+    std::vector<bool> matched(candidate.paths.size(), false);
+    for (size_t i = expected.totalRays; i < expected.paths.size(); ++i)
+    {
+        const RayPath &path = expected.paths[i];
+        size_t best = candidate.paths.size(), closest = candidate.paths.size(), closestVertex = 0;
+        float bestDeviation = std::numeric_limits<float>::max();
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                auto it = candidatesByStart.find(cellKey(path[0].position, dx, dy));
+                if (it == candidatesByStart.end())
+                    continue;
+                for (size_t c : it->second)
+                {
+                    if (matched[c])
+                        continue;
+                    size_t k = firstMismatch(path, candidate.paths[c]);
+                    if (k > path.size())
+                    {
+                        float deviation = maxDeviation(path, candidate.paths[c]);
+                        if (deviation <= bestDeviation)
+                        {
+                            bestDeviation = deviation;
+                            best = c;
+                        }
+                    }
+                    else if (closest == candidate.paths.size() || k > closestVertex)
+                    {
+                        // Для описания расхождения запоминается ветвь, совпавшая дольше других
+                        closest = c;
+                        closestVertex = k;
+                    }
+                }
+            }
+        }
+        ++report.comparedPaths;
+        if (best == candidate.paths.size())
+        {
+            return fail("branch path " + std::to_string(i) + " has no matching candidate branch (closest agrees up to vertex " +
+                        std::to_string(closestVertex) + ")\n" +
+                        describePath(scene, reference, i, closest < candidate.paths.size() ? candidate.paths[closest] : RayPath(), closestVertex));
+        }
+        matched[best] = true;
+    }
+    return compareTotals();
+}
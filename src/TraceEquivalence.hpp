@@ -0,0 +1,126 @@
+#ifndef HEADER_GUARD_TRACE_EQUIVALENCE_HPP
+#define HEADER_GUARD_TRACE_EQUIVALENCE_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "RayTracer.hpp"
+
+// Эталонная трассировка: один поток, без пакетов длин волн, без очередей и рулетки,
+// пересечения - полным перебором элементов (для тел - полным перебором рёбер вместо EdgeBVH).
+// Результат имеет ту же раскладку путей, что и RayTracer: пути первичных лучей по источникам,
+// лучам и длинам волн, затем пути дочерних ветвей. Для каждого пути сохраняется последовательность
+// элементов, в которые он попал, чтобы расхождение можно было описать полностью.
+class ReferenceTracer
+{
+public:
+    // Происхождение пути: источник, номер луча источника, дорожка спектра
+    struct PathOrigin
+    {
+        size_t source = 0;
+        size_t ray = 0;
+        int lane = 0;
+        bool branch = false;
+    };
+
+    struct Result
+    {
+        TraceResult trace;
+        std::vector<std::vector<int>> pathElements; // Номер элемента для каждой вершины пути (-1 - начало или уход луча)
+        std::vector<PathOrigin> pathOrigins;
+    };
+
+    explicit ReferenceTracer(const TraceOptions &options = TraceOptions()) : m_options(options) {}
+
+    void trace(const std::vector<const OpticalElement *> &elements, Result &result) const;
+
+    // Пересечение без ускоряющих структур
+    static VectorMath::IntersectionResult intersect(const OpticalElement &element, const Ray &ray);
+
+private:
+    TraceOptions m_options;
+};
+
+// Проверка эквивалентности оптимизированных трассировщиков эталонной трассировке.
+// Сравниваются пути первичных лучей (по порядку), пути дочерних ветвей (сопоставлением по начальной точке,
+// так как их порядок зависит от распределения лучей по потокам), ячейки детекторов и ушедшая энергия.
+// Рулетка отключается, а очереди ветвей не ограничиваются, чтобы результат не зависел от случайных чисел.
+class TraceEquivalence
+{
+public:
+    using EngineFn = std::function<void(const std::vector<const OpticalElement *> &, const TraceOptions &, TraceResult &)>;
+
+    struct Engine
+    {
+        std::string name;
+        EngineFn run;
+        bool recordsPaths = true;
+        bool importanceEmission = false; // Эталон и кандидат испускают лучи по EmissionPlan
+    };
+
+    struct Scene
+    {
+        std::string name;
+        std::vector<std::unique_ptr<OpticalElement>> elements;
+
+        std::vector<const OpticalElement *> view() const;
+    };
+
+    struct Settings
+    {
+        float positionTolerance = 0.25f;  // Допустимое расхождение точек попадания, пикселей
+        float angleTolerance = 1e-3f;     // Добавка к допуску на единицу длины отрезка пути, радиан
+        float binTolerance = 1e-3f;       // Относительное расхождение ячеек детекторов и ушедшей энергии
+        size_t contextVertices = 12;      // Число вершин пути в описании расхождения
+        float derivativeTolerance = 0.02f; // Расхождение производных DiffTracer с конечными разностями (доля, не меньше 1)
+        float beamTolerance = 2.f;        // Приближение клиньев после линз и кривых границ, пикселей
+    };
+
+    struct Report
+    {
+        bool equivalent = true;
+        std::string divergence; // Первое расхождение с контекстом
+        size_t comparedPaths = 0;
+        size_t comparedDerivatives = 0;
+        size_t comparedSamples = 0;
+        size_t grazingPaths = 0; // checkBeams: пути, остановленные на повторном касательном попадании
+    };
+
+    TraceEquivalence() = default;
+    explicit TraceEquivalence(const Settings &settings) : m_settings(settings) {}
+
+    // Параметры трассировки, при которых результат детерминирован
+    static TraceOptions checkOptions();
+    // Варианты RayTracer: один поток, все потоки, мелкие порции, без углового обхода, без сохранения путей,
+    // выборка направлений по значимости
+    static std::vector<Engine> defaultEngines();
+
+    // Фиксированные сцены: линзы и зеркала, призма с дисперсией, дерево светоделителей и т.д.
+    static std::vector<Scene> regressionScenes();
+    // Случайная сцена из count элементов (воспроизводима по seed)
+    static Scene randomScene(uint64_t seed, size_t count);
+
+    Report compare(const Scene &scene, const ReferenceTracer::Result &reference, const Engine &engine, const TraceResult &candidate) const;
+    Report check(const Scene &scene, const Engine &engine) const;
+    // Производные пятна на первом детекторе (DiffTracer) против центральных конечных разностей
+    // по каждому поддерживаемому параметру каждого элемента. Параметры, при сдвиге которых
+    // меняется последовательность попаданий хотя бы одного луча, пропускаются
+    Report checkDerivatives(const Scene &scene) const;
+    // Освещённые области BeamTracer против путей RayTracer: точки отрезков путей с заметной энергией
+    // должны лежать в областях (с допуском positionTolerance + beamTolerance). Спектральные источники
+    // заменяются монохроматическими; сцены, где достигнут предел пучков, пропускаются. Путь проверяется
+    // до почти нулевого отрезка (повторного касательного попадания в дугу); ветви, начатые в таких точках, пропускаются
+    Report checkBeams(const Scene &scene) const;
+
+private:
+    std::string describePath(const Scene &scene, const ReferenceTracer::Result &reference, size_t pathIndex,
+                             const RayPath &candidatePath, size_t vertex) const;
+
+    Settings m_settings;
+};
+
+#endif // HEADER_GUARD_TRACE_EQUIVALENCE_HPP
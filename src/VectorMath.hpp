@@ -3,10 +3,12 @@
 #define VECTORMATH_HPP
 
 #include <SFML/System/Vector2.hpp> // 2D вектор
+#include <SFML/Graphics/Rect.hpp>  // Прямоугольники (границы элементов)
 #define _USE_MATH_DEFINES          // Для числа пи (M_PI)
 #include <cmath>
 #include <limits>
 #include <vector>
+#include <algorithm>
 
 // Небольшое значение для сравнения float-ов
 const float EPSILON = 1e-5f;
@@ -111,6 +113,51 @@ namespace VectorMath
         return distance(p, projection);
     }
 
+    // Отсекает отрезок [a, b] прямоугольником [minX, maxX] x [minY, maxY] (алгоритм Лианга-Барски).
+    // Возвращает false, если отрезок целиком вне прямоугольника; иначе a и b заменяются концами видимой части
+    inline bool clipSegmentToRect(sf::Vector2f &a, sf::Vector2f &b, float minX, float minY, float maxX, float maxY)
+    {
+        float t0 = 0.f;
+        float t1 = 1.f;
+        sf::Vector2f d = b - a;
+        const float p[4] = {-d.x, d.x, -d.y, d.y};
+        const float q[4] = {a.x - minX, maxX - a.x, a.y - minY, maxY - a.y};
+        for (int i = 0; i < 4; ++i)
+        {
+            if (std::abs(p[i]) < EPSILON)
+            {
+                if (q[i] < 0.f)
+                    return false; // Параллелен границе и снаружи
+                continue;
+            }
+            float r = q[i] / p[i];
+            if (p[i] < 0.f)
+                t0 = std::max(t0, r);
+            else
+                t1 = std::min(t1, r);
+            if (t0 > t1)
+                return false;
+        }
+        sf::Vector2f start = a + t0 * d;
+        b = a + t1 * d;
+        a = start;
+        return true;
+    }
+
+    // Ограничивающий прямоугольник отрезка
+    inline sf::FloatRect segmentBounds(const sf::Vector2f &a, const sf::Vector2f &b)
+    {
+        float minX = std::min(a.x, b.x);
+        float minY = std::min(a.y, b.y);
+        return sf::FloatRect(minX, minY, std::max(a.x, b.x) - minX, std::max(a.y, b.y) - minY);
+    }
+
+    // То же для прямоугольника SFML
+    inline bool clipSegmentToRect(sf::Vector2f &a, sf::Vector2f &b, const sf::FloatRect &rect)
+    {
+        return clipSegmentToRect(a, b, rect.left, rect.top, rect.left + rect.width, rect.top + rect.height);
+    }
+
     // Вращает точку p вокруг точки center на угол angle (в радианах)
     inline sf::Vector2f rotatePoint(const sf::Vector2f &p, const sf::Vector2f &center, float angle)
     {
@@ -207,6 +254,125 @@ namespace VectorMath
         }
     }
 
+    // Угловой сектор [start, start + span], под которым из точки origin виден прямоугольник (span < PI).
+    // false, если точка лежит в прямоугольнике, расширенном на margin: тогда виден весь круг
+    inline bool angularExtent(const sf::Vector2f &origin, const sf::FloatRect &bounds, float margin, float &start, float &span)
+    {
+        if (origin.x >= bounds.left - margin && origin.x <= bounds.left + bounds.width + margin &&
+            origin.y >= bounds.top - margin && origin.y <= bounds.top + bounds.height + margin)
+            return false;
+        float axis = std::atan2(bounds.top + bounds.height * 0.5f - origin.y, bounds.left + bounds.width * 0.5f - origin.x);
+        float lo = 0.f, hi = 0.f;
+        const sf::Vector2f corners[4] = {{bounds.left, bounds.top}, {bounds.left + bounds.width, bounds.top},
+                                         {bounds.left, bounds.top + bounds.height}, {bounds.left + bounds.width, bounds.top + bounds.height}};
+        for (const sf::Vector2f &corner : corners)
+        {
+            float delta = normalizeAngle(std::atan2(corner.y - origin.y, corner.x - origin.x) - axis);
+            lo = std::min(lo, delta);
+            hi = std::max(hi, delta);
+        }
+        start = axis + lo;
+        span = hi - lo;
+        return true;
+    }
+
+    // Расстояние от точки до прямоугольника (0, если точка внутри)
+    inline float distanceToRect(const sf::Vector2f &p, const sf::FloatRect &rect)
+    {
+        float dx = std::max({rect.left - p.x, 0.f, p.x - rect.left - rect.width});
+        float dy = std::max({rect.top - p.y, 0.f, p.y - rect.top - rect.height});
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    // Обобщённые версии для дифференцируемой трассировки: T - float или Dual<N> (см. Dual.hpp).
+    // Ветвления выполняются по значению, поэтому производные считаются при фиксированном выборе ветвей
+    inline float scalarValue(float x) { return x; }
+
+    template <typename T>
+    struct Vec2T
+    {
+        using scalar_type = T;
+        T x, y;
+
+        Vec2T() : x(0.f), y(0.f) {}
+        Vec2T(const T &x_, const T &y_) : x(x_), y(y_) {}
+        explicit Vec2T(const sf::Vector2f &v) : x(v.x), y(v.y) {}
+
+        sf::Vector2f value() const { return sf::Vector2f(scalarValue(x), scalarValue(y)); }
+    };
+
+    template <typename T> inline Vec2T<T> operator+(const Vec2T<T> &a, const Vec2T<T> &b) { return Vec2T<T>(a.x + b.x, a.y + b.y); }
+    template <typename T> inline Vec2T<T> operator-(const Vec2T<T> &a, const Vec2T<T> &b) { return Vec2T<T>(a.x - b.x, a.y - b.y); }
+    template <typename T> inline Vec2T<T> operator-(const Vec2T<T> &a) { return Vec2T<T>(-a.x, -a.y); }
+    template <typename T> inline Vec2T<T> operator*(const Vec2T<T> &a, const typename Vec2T<T>::scalar_type &s) { return Vec2T<T>(a.x * s, a.y * s); }
+    template <typename T> inline Vec2T<T> operator*(const typename Vec2T<T>::scalar_type &s, const Vec2T<T> &a) { return Vec2T<T>(a.x * s, a.y * s); }
+    template <typename T> inline Vec2T<T> operator/(const Vec2T<T> &a, const typename Vec2T<T>::scalar_type &s) { return Vec2T<T>(a.x / s, a.y / s); }
+
+    template <typename T> inline T dot(const Vec2T<T> &a, const Vec2T<T> &b) { return a.x * b.x + a.y * b.y; }
+    template <typename T> inline T cross(const Vec2T<T> &a, const Vec2T<T> &b) { return a.x * b.y - a.y * b.x; }
+
+    template <typename T>
+    inline T length(const Vec2T<T> &v)
+    {
+        using std::sqrt;
+        return sqrt(dot(v, v));
+    }
+
+    template <typename T>
+    inline Vec2T<T> normalize(const Vec2T<T> &v)
+    {
+        T l = length(v);
+        if (scalarValue(l) < EPSILON)
+            return Vec2T<T>();
+        return v / l;
+    }
+
+    template <typename T>
+    inline Vec2T<T> reflect(const Vec2T<T> &v, const Vec2T<T> &n)
+    {
+        return v - n * (dot(v, n) * 2.f);
+    }
+
+    // Единичный вектор под углом angle
+    template <typename T>
+    inline Vec2T<T> direction(const T &angle)
+    {
+        using std::cos;
+        using std::sin;
+        return Vec2T<T>(cos(angle), sin(angle));
+    }
+
+    // Расстояние вдоль луча до прямой, проходящей через point в направлении lineDir
+    template <typename T>
+    inline T rayLineDistance(const Vec2T<T> &origin, const Vec2T<T> &dir, const Vec2T<T> &point, const Vec2T<T> &lineDir)
+    {
+        return cross(point - origin, lineDir) / cross(dir, lineDir);
+    }
+
+    // Параметр t пересечения луча с окружностью: root = 0 - ближний корень, 1 - дальний
+    template <typename T>
+    inline T rayCircleRoot(const Vec2T<T> &origin, const Vec2T<T> &dir, const Vec2T<T> &center, const T &radius, int root)
+    {
+        using std::sqrt;
+        Vec2T<T> oc = origin - center;
+        T a = dot(dir, dir);
+        T b = dot(oc, dir) * 2.f;
+        T c = dot(oc, oc) - radius * radius;
+        T disc = b * b - a * c * 4.f;
+        if (scalarValue(disc) < 0.f)
+            disc = T(0.f);
+        T s = sqrt(disc);
+        return root == 0 ? (-b - s) / (a * 2.f) : (-b + s) / (a * 2.f);
+    }
+
+    // normalizeAngle для обобщённого типа: сдвиг на кратное 2*PI не меняет производных
+    template <typename T>
+    inline T wrapAngle(const T &angle)
+    {
+        float v = scalarValue(angle);
+        return angle + (normalizeAngle(v) - v);
+    }
+
 }
 
 #endif // VECTORMATH_HPP
\ No newline at end of file
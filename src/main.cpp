@@ -1,9 +1,28 @@
 #include "OpticalApplication.hpp"
 #include <iostream>
+#include <string>
+
+// interactive_optics [--record file | --replay file [--fast]]
+int main(int argc, char* argv[]) {
+    std::string recordPath;
+    std::string replayPath;
+    bool fastReplay = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--fast") {
+            fastReplay = true;
+        } else if ((arg == "--record" || arg == "--replay") && i + 1 < argc) {
+            (arg == "--record" ? recordPath : replayPath) = argv[++i];
+        } else {
+            std::cerr << "Usage: interactive_optics [--record file | --replay file [--fast]]" << std::endl;
+            return 2;
+        }
+    }
 
-int main() {
     try {
         OpticalApplication app;
+        if (!recordPath.empty() && !app.recordInput(recordPath)) return 1;
+        if (!replayPath.empty() && !app.replayInput(replayPath, !fastReplay)) return 1;
         app.run();
     } catch (const std::exception& e) {
         std::cerr << "An unhandled C++ standard exception reached main: " << e.what() << std::endl;
@@ -13,4 +32,4 @@ int main() {
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}